@@ -26,6 +26,14 @@
  * - Why use 'static' for the counter variable?
  * - What happens to a normal (non-static) variable between function calls?
  * - When should you increment the counter?
+ *
+ * NOW WITH PER-TAG CEILINGS (log_tag.h):
+ * The ESP_LOGx calls became LOGx and TAG is declared with LOG_TAG, which
+ * gives this file its own compile-time ceiling. At ESP_LOG_DEBUG the
+ * counter message is built in and logSetLevel() turns it on at runtime.
+ * Lower the ceiling to ESP_LOG_INFO and the LOGD line produces no code and
+ * no format string, whatever CONFIG_LOG_MAXIMUM_LEVEL is for the rest of
+ * the firmware. logTagBenchmark() logs the .text/.rodata sizes to compare.
  */
 
 #include <stdio.h>
@@ -33,10 +41,11 @@
 #include "freertos/task.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "log_tag.h"
 
 #define LED_PIN GPIO_NUM_2
 
-static const char *TAG = "Day1-Ex3";
+LOG_TAG(TAG, "Day1-Ex3", ESP_LOG_DEBUG);
 /*
 
 I (1000) Day1-Ex3: LED ON
@@ -56,7 +65,7 @@ void led_blink_task(void *pvParameter)
     gpio_reset_pin(LED_PIN);
     gpio_set_direction(LED_PIN, GPIO_MODE_OUTPUT);
 
-    ESP_LOGI(TAG, "LED blink task started - Exercise 3");
+    LOGI(TAG, "LED blink task started - Exercise 3");
 
     uint32_t blinkCounter = 0;
 
@@ -64,38 +73,38 @@ void led_blink_task(void *pvParameter)
     {
         // TODO: Turn LED ON
         // TODO: Log "LED ON" using appropriate log level (check requirements)
-        ESP_LOGI(TAG, "LED ON");
+        LOGI(TAG, "LED ON");
         gpio_set_level(LED_PIN, 1);
 
         vTaskDelay(1000 / portTICK_PERIOD_MS);
 
         // TODO: Turn LED OFF
         // TODO: Log "LED OFF" using appropriate log level (check requirements)
-        ESP_LOGW(TAG, "LED OFF");
+        LOGW(TAG, "LED OFF");
         gpio_set_level(LED_PIN, 0);
         vTaskDelay(1000 / portTICK_PERIOD_MS);
 
         // TODO: Increment counter after complete ON/OFF cycle
         blinkCounter++;
-        // TODO: Log current counter value using ESP_LOGD()
-        ESP_LOGD(TAG, "Counter : %d", blinkCounter);
+        // TODO: Log current counter value using LOGD()
+        LOGD(TAG, "Counter : %lu", (unsigned long)blinkCounter);
 
         // TODO: Check if counter is divisible by 5
-        // TODO: If yes, log "X blinks completed" using ESP_LOGE()
+        // TODO: If yes, log "X blinks completed" using LOGE()
         if (blinkCounter % 5 == 0)
         {
-            ESP_LOGE(TAG, "%d blinks completed", blinkCounter);
+            LOGE(TAG, "%lu blinks completed", (unsigned long)blinkCounter);
         }
     }
 }
 
 extern "C" void app_main(void)
 {
-        esp_log_level_set("*", ESP_LOG_DEBUG);
+    logSetLevel("*", ESP_LOG_DEBUG);
 
-    ESP_LOGI(TAG, "=================================");
-    ESP_LOGI(TAG, "Day 1 - Exercise 3: Logging Levels");
-    ESP_LOGI(TAG, "=================================");
+    LOGI(TAG, "=================================");
+    LOGI(TAG, "Day 1 - Exercise 3: Logging Levels");
+    LOGI(TAG, "=================================");
 
     xTaskCreate(&led_blink_task, "led_blink", 2048, NULL, 5, NULL);
 }
@@ -69,6 +69,13 @@
  * - portMAX_DELAY = Block forever until space/data available
  * - 0 = Don't wait, return immediately if full/empty
  * - pdMS_TO_TICKS(1000) = Wait up to 1 second
+ *
+ * NOW ON A PIPE CHANNEL (pipe_channel.h):
+ * With xQueueSend(queue, &counter, portMAX_DELAY) a slow consumer stalls
+ * the producer inside the send, so its 500 ms rhythm slips. The queue is
+ * now wrapped in a pipe channel: pipeSend() never waits (a full channel
+ * drops its oldest number), and pipePace() replaces vTaskDelay() with an
+ * AIMD pace of at most 2 Hz that backs off while the consumer lags.
  */
 
 #include <stdio.h>
@@ -76,36 +83,37 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
+#include "pipe_channel.h"
 
 static const char *TAG = "QueueDemo";
 
-// TODO: Declare a QueueHandle_t variable to store the queue handle
-QueueHandle_t my_queue;
+// The channel owns the queue of 5 integers
+static pipe_channel_t my_channel;
 
 void producerTask(void *pvParameter)
 {
-    QueueHandle_t queue = (QueueHandle_t)pvParameter;
+    pipe_channel_t *channel = (pipe_channel_t *)pvParameter;
     const char *TAG = "producer";
     int counter = 0;
-    int delayms = 500;
     while (1)
     {
-        xQueueSend(queue, &counter, portMAX_DELAY);
-        ESP_LOGI(TAG, "Sent %d to Queue", counter++);
-
-        vTaskDelay(pdMS_TO_TICKS(delayms));
+        // Every 500 ms while the consumer keeps up, less often when it lags
+        float rateHz = pipePace(channel);
+        if (pipeSend(channel, &counter))
+            ESP_LOGI(TAG, "Sent %d to Queue (%.1f Hz)", counter, rateHz);
+        counter++;
     }
 }
 
 void consumerTask(void *pvParameter)
 {
-    QueueHandle_t queue = (QueueHandle_t)pvParameter;
+    pipe_channel_t *channel = (pipe_channel_t *)pvParameter;
     const char *TAG = "consumer";
     int receivedData = 0;
 
     while (1)
     {
-        xQueueReceive(queue, &receivedData, portMAX_DELAY);
+        pipeReceive(channel, &receivedData, portMAX_DELAY);
         ESP_LOGI(TAG, "Received %d from Queue", receivedData);
     }
 }
@@ -117,7 +125,15 @@ extern "C" void app_main(void)
     ESP_LOGI(TAG, "Day 4 - Exercise 1: Producer-Consumer");
     ESP_LOGI(TAG, "=================================");
 
-    my_queue = xQueueCreate(5, sizeof(int));
-    xTaskCreate(&producerTask, "Producer", 2048, (void *)my_queue, 5, NULL);
-    xTaskCreate(&consumerTask, "Consumer", 2048, (void *)my_queue, 5, NULL);
+    pipe_config_t config = PIPE_CONFIG_DEFAULT(PIPE_DROP_OLDEST);
+    config.rateMaxHz = 2.0f; // the old 500 ms period
+    config.rateMinHz = 0.5f;
+    config.increaseHz = 0.2f;
+    if (!pipeInit(&my_channel, "numbers", 5, sizeof(int), &config))
+    {
+        ESP_LOGE(TAG, "Failed to create channel!");
+        return;
+    }
+    xTaskCreate(&producerTask, "Producer", 2048, (void *)&my_channel, 5, NULL);
+    xTaskCreate(&consumerTask, "Consumer", 2048, (void *)&my_channel, 5, NULL);
 }
\ No newline at end of file
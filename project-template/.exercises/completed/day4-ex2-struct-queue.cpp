@@ -96,6 +96,21 @@
  * - How would you handle variable-length data (strings, arrays)?
  * - Why not use a global struct instead of queuing? (Hint: thread safety)
  * - What fields would YOU add to make this more realistic?
+ *
+ * NOW ON REAL SAMPLES (acquisition.h):
+ * The producer used to make up a value every 800 ms. Now ADC1 channel 6
+ * (GPIO34 on esp32dev) runs in continuous mode at 20 kHz: the DMA fills
+ * frames of 256 samples and the acquisition task hands them over by
+ * pointer. The consumer gets each frame with acqReceive(), folds it into
+ * the same sensor_data_t (timestamp of the frame, channel, mean raw value)
+ * and gives the buffer back with acqRelease(). One reading is logged every
+ * 800 ms, averaged over all the frames in between.
+ *
+ * HISTORY (sensor_history.h):
+ * Every frame's mean also goes, as a sensor_data_t, into a queue drained by
+ * historyConsumerTask, which keeps raw samples and 1 s / 1 min / 1 h
+ * min/max/mean buckets. Type "history 6 1s" (or raw, 1m, 1h) on the serial
+ * monitor to dump one tier.
  */
 
 #include <stdio.h>
@@ -103,46 +118,77 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_adc/adc_continuous.h"
+#include "acquisition.h"
+#include "sensor_history.h"
 
 static const char *TAG = "StructQueue";
 
-typedef struct
-{
-    uint32_t timeStamp;
-    uint8_t sensorID;
-    float sensorVal;
-} sensor_data_t;
+#define SAMPLE_RATE_HZ 20000
+#define SAMPLES_PER_FRAME 256
+#define FRAMES 4
+#define REPORT_MS 800
+#define HISTORY_QUEUE_LEN 16
 
-QueueHandle_t qHandle;
+// sensor_data_t (timeStamp, sensorID, sensorVal) comes from sensor_data.h,
+// so this exercise and the history store share one layout
 
-void producerTask(void *pvParameter)
+static acquisition_t g_acq;
+static QueueHandle_t g_historyQueue = NULL;
+
+void consumerTask(void *pvParameter)
 {
-    QueueHandle_t handle = (QueueHandle_t)pvParameter;
-    const char *TAG = "Producer";
-    uint32_t timeStamp = 0;
-    sensor_data_t dataToSend;
+    acquisition_t *acq = (acquisition_t *)pvParameter;
+    const char *TAG = "Consumer";
+    sensor_data_t rxData = {};
+    uint64_t sum = 0;
+    uint32_t count = 0;
+    uint32_t nextReportMs = 0;
 
     while (1)
     {
-        dataToSend.timeStamp = timeStamp * 800;
-        dataToSend.sensorID = 1;
-        dataToSend.sensorVal = 0.2f + (timeStamp / 10.0f);
-        xQueueSend(handle, &dataToSend, portMAX_DELAY);
-        ESP_LOGI(TAG, "Sending Data - Timestamp: %lu ms, Sensor ID: %u, Sensor Value: %.2f", (unsigned long)dataToSend.timeStamp, dataToSend.sensorID, dataToSend.sensorVal);
-        timeStamp++;
-        vTaskDelay(pdMS_TO_TICKS(800));
+        acq_frame_t *frame = acqReceive(acq, portMAX_DELAY);
+        if (frame == NULL)
+            continue;
+        uint16_t frameCount = frame->count;
+        uint32_t frameSum = 0;
+        for (uint16_t i = 0; i < frameCount; i++)
+            frameSum += frame->samples[i].value;
+        sum += frameSum;
+        count += frameCount;
+        rxData.timeStamp = (uint32_t)(frame->timeUs / 1000);
+        rxData.sensorID = frameCount > 0 ? frame->samples[0].channel : 0;
+        acqRelease(acq, frame);
+
+        // One history sample per frame; if the history task falls behind
+        // the reading is skipped, never the acquisition
+        if (frameCount > 0)
+        {
+            sensor_data_t frameData = {rxData.timeStamp, rxData.sensorID, (float)frameSum / frameCount};
+            xQueueSend(g_historyQueue, &frameData, 0);
+        }
+
+        if (rxData.timeStamp >= nextReportMs && count > 0)
+        {
+            rxData.sensorVal = (float)sum / count;
+            ESP_LOGI(TAG, "Received Data - Timestamp: %lu ms, Sensor ID: %u, Sensor Value: %.2f", (unsigned long)rxData.timeStamp, rxData.sensorID, rxData.sensorVal);
+            sum = 0;
+            count = 0;
+            nextReportMs = rxData.timeStamp + REPORT_MS;
+        }
     }
 }
 
-void consumerTask(void *pvParameter)
+void serialTask(void *pvParameter)
 {
-    QueueHandle_t handle = (QueueHandle_t)pvParameter;
-    const char *TAG = "Consumer";
-    sensor_data_t rxData;
+    const char *TAG = "Serial";
+    char rxtext[50] = {0};
+
     while (1)
     {
-        xQueueReceive(handle, &rxData, portMAX_DELAY);
-        ESP_LOGI(TAG, "Received Data - Timestamp: %lu ms, Sensor ID: %u, Sensor Value: %.2f", (unsigned long)rxData.timeStamp, rxData.sensorID, rxData.sensorVal);
+        if (fgets(rxtext, sizeof(rxtext), stdin) != NULL && !historyCommand(rxtext))
+            ESP_LOGW(TAG, "Commands: history <id> <raw|1s|1m|1h>");
+        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
@@ -153,7 +199,23 @@ extern "C" void app_main(void)
     ESP_LOGI(TAG, "=================================");
     ESP_LOGI(TAG, "Day 4 - Exercise 2: Sending Structs");
     ESP_LOGI(TAG, "=================================");
-    qHandle = xQueueCreate(5, sizeof(sensor_data_t));
-    xTaskCreate(producerTask,"prod",2048,(void*)qHandle,5,NULL);
-    xTaskCreate(consumerTask,"cons",2048,(void*)qHandle,5,NULL);
+
+    g_historyQueue = xQueueCreate(HISTORY_QUEUE_LEN, sizeof(sensor_data_t));
+    if (g_historyQueue == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create history queue!");
+        return;
+    }
+
+    static const uint8_t channels[] = {ADC_CHANNEL_6};
+    acq_driver_t adc;
+    if (!acqAdcDriver(&adc, channels, 1, SAMPLES_PER_FRAME) ||
+        !acqStart(&g_acq, &adc, SAMPLE_RATE_HZ, FRAMES, SAMPLES_PER_FRAME, 6, 1))
+    {
+        ESP_LOGE(TAG, "Failed to start acquisition!");
+        return;
+    }
+    xTaskCreate(consumerTask,"cons",3072,(void*)&g_acq,5,NULL);
+    xTaskCreate(historyConsumerTask, "history", 3072, g_historyQueue, 4, NULL);
+    xTaskCreate(serialTask, "serial", 4096, NULL, 2, NULL);
 }
\ No newline at end of file
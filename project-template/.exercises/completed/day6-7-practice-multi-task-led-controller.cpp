@@ -7,136 +7,185 @@
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "snapshot.h"
+#include "settings.h"
+#include "event_bus.h"
+#include "profiler.h"
+#include "msg_channel.h"
 
 static const char *TAG = "LEDController";
 
-typedef struct
-{
-    QueueHandle_t patternQHandle;
-    QueueHandle_t speedQHandle;
-} g_serialHandle;
-
 gpio_num_t LED[4] = {(gpio_num_t)4, (gpio_num_t)16, (gpio_num_t)17, (gpio_num_t)5};
 gpio_num_t BUTTON = (gpio_num_t)15;
 
-uint16_t g_speed_ms = 400;
-volatile uint16_t g_selectedPattern = 0;
+// Written by patternSequencer, read by statusReporter (snapshot.h).
+// The snapshot copies whole 32-bit words, so the shared copy must be
+// 4-byte aligned.
+typedef struct alignas(4)
+{
+    uint16_t pattern;
+    uint16_t speedMs;
+} controller_state_t;
+
+static controller_state_t g_stateData = {0, 400};
+static snapshot_t g_state;
+
+// Last pattern and speed survive a reboot (settings.h). Changes are RAM
+// writes; the settings task commits them to NVS once they settle.
+static SETTING_DEFINE(g_patternSetting, "ledctrl", "pattern", SETTING_U8, 0);
+static SETTING_DEFINE(g_speedSetting, "ledctrl", "speed", SETTING_U16, 400);
+static bool g_settingsReady = false;
+
+static void saveSetting(setting_t *setting, uint16_t value)
+{
+    if (g_settingsReady)
+        settingsUpdate(setting, value);
+}
 
-QueueHandle_t g_patternQueue = NULL;
-QueueHandle_t g_speedQueue = NULL;
-g_serialHandle sHandle;
+// Pattern and speed changes are published by the button and serial tasks;
+// patternSequencer follows both topics through its one subscriber queue
+EVENT_BUS_TOPIC(g_patternTopic, uint16_t);
+EVENT_BUS_TOPIC(g_speedTopic, uint16_t);
+event_subscriber_t g_sequencerSub;
 SemaphoreHandle_t g_uartMutex = NULL; // Protects UART/serial output
 
+// Console lines go from consoleReader to serialTask through a message
+// channel: fgets writes straight into the ring, and a line takes its own
+// length (rounded up to 4, plus a 4-byte header) instead of a fixed buffer
+#define CONSOLE_LINE_MAX 128
+static uint8_t g_consoleRing[512]; // MSG_CHANNEL_MAX_MESSAGE(512) = 252 >= CONSOLE_LINE_MAX
+static msg_channel_t g_console;
+
 char g_commandBuffer[32] = {0};
 
-int knightRider(void)
+int knightRider(uint16_t speedMs)
 {
     static int pos = 0;
     static int direction = 1;
 
-    for (int i = 0; i < 4; i++)
     {
-        gpio_set_level(LED[i], (i == pos) ? 0 : 1);
-    }
+        // Only the LED step; the delay is the pattern's period, not its cost
+        PROFILE_SCOPE("knightRider");
+        for (int i = 0; i < 4; i++)
+        {
+            gpio_set_level(LED[i], (i == pos) ? 0 : 1);
+        }
 
-    pos += direction;
+        pos += direction;
 
-    if (pos == 3 || pos == 0)
-    {
-        direction = -direction;
+        if (pos == 3 || pos == 0)
+        {
+            direction = -direction;
+        }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(g_speed_ms));
+    vTaskDelay(pdMS_TO_TICKS(speedMs));
     return 0;
 }
 
-int blinkAll(void)
+int blinkAll(uint16_t speedMs)
 {
     static bool ON_OFF = 0;
 
-    for (int i = 0; i < 4; i++)
     {
-        gpio_set_level(LED[i], (ON_OFF) ? 0 : 1);
-    }
+        PROFILE_SCOPE("blinkAll");
+        for (int i = 0; i < 4; i++)
+        {
+            gpio_set_level(LED[i], (ON_OFF) ? 0 : 1);
+        }
 
-    ON_OFF = !ON_OFF;
-    vTaskDelay(pdMS_TO_TICKS(g_speed_ms));
+        ON_OFF = !ON_OFF;
+    }
+    vTaskDelay(pdMS_TO_TICKS(speedMs));
     return 0;
 }
 
-int alternatingPair(void)
+int alternatingPair(uint16_t speedMs)
 {
     static bool pairNumber = 0;
 
-    if (pairNumber == 0)
-    {
-        gpio_set_level(LED[0], 0);
-        gpio_set_level(LED[1], 0);
-        gpio_set_level(LED[2], 1);
-        gpio_set_level(LED[3], 1);
-    }
-    else
     {
-        gpio_set_level(LED[0], 1);
-        gpio_set_level(LED[1], 1);
-        gpio_set_level(LED[2], 0);
-        gpio_set_level(LED[3], 0);
-    }
+        PROFILE_SCOPE("alternatingPair");
+        if (pairNumber == 0)
+        {
+            gpio_set_level(LED[0], 0);
+            gpio_set_level(LED[1], 0);
+            gpio_set_level(LED[2], 1);
+            gpio_set_level(LED[3], 1);
+        }
+        else
+        {
+            gpio_set_level(LED[0], 1);
+            gpio_set_level(LED[1], 1);
+            gpio_set_level(LED[2], 0);
+            gpio_set_level(LED[3], 0);
+        }
 
-    pairNumber = !pairNumber;
-    vTaskDelay(pdMS_TO_TICKS(g_speed_ms));
+        pairNumber = !pairNumber;
+    }
+    vTaskDelay(pdMS_TO_TICKS(speedMs));
     return 0;
 }
 
-int randomPattern(void)
+int randomPattern(uint16_t speedMs)
 {
-    for (int i = 0; i < 4; i++)
     {
-        gpio_set_level(LED[i], rand() % 2);
+        PROFILE_SCOPE("randomPattern");
+        for (int i = 0; i < 4; i++)
+        {
+            gpio_set_level(LED[i], rand() % 2);
+        }
     }
-    vTaskDelay(pdMS_TO_TICKS(g_speed_ms));
+    vTaskDelay(pdMS_TO_TICKS(speedMs));
     return 0;
 }
 
 void patternSequencer(void *pvParameter)
 {
-    g_serialHandle *g_Handle = (g_serialHandle *)pvParameter;
-    uint16_t newPattern = 0;
-    uint16_t newSpeed = 0;
+    event_subscriber_t *sub = (event_subscriber_t *)pvParameter;
+    controller_state_t state;
+    snapshotRead(&g_state, &state);
     while (1)
     {
-        if (xQueueReceive(g_Handle->speedQHandle, &newSpeed, 0) == pdTRUE)
+        event_msg_t *msg;
+        while ((msg = eventBusReceive(sub, 0)) != NULL)
         {
-            g_speed_ms = newSpeed;
+            uint16_t value;
+            bool isSpeed;
+            {
+                // Applying a change; the log below waits on the UART mutex
+                PROFILE_SCOPE("patternSequencer.apply");
+                memcpy(&value, msg->payload, sizeof(value));
+                isSpeed = (msg->topic == &g_speedTopic);
+                eventBusRelease(msg);
+
+                if (isSpeed)
+                    state.speedMs = value;
+                else
+                    state.pattern = value;
+                snapshotWrite(&g_state, &state);
+            }
             xSemaphoreTake(g_uartMutex, portMAX_DELAY);
-            ESP_LOGI("PATTERN_SEQUENCER", "SELECTED SPEED: %d", newSpeed);
+            ESP_LOGI("PATTERN_SEQUENCER", "SELECTED %s: %d", isSpeed ? "SPEED" : "PATTERN", value);
             xSemaphoreGive(g_uartMutex);
         }
 
-        if (xQueueReceive(g_Handle->patternQHandle, &newPattern, 0) == pdTRUE)
-
-        {
-            g_selectedPattern = newPattern;
-            xSemaphoreTake(g_uartMutex, portMAX_DELAY);
-
-            ESP_LOGI("PATTERN_SEQUENCER", "SELECTED PATTERN: %d", newPattern);
-            xSemaphoreGive(g_uartMutex);
-        }
-        if (g_selectedPattern == 0)
-            knightRider();
-        else if (g_selectedPattern == 1)
-            blinkAll();
-        else if (g_selectedPattern == 2)
-            alternatingPair();
-        else if (g_selectedPattern == 3)
-            randomPattern();
+        if (state.pattern == 0)
+            knightRider(state.speedMs);
+        else if (state.pattern == 1)
+            blinkAll(state.speedMs);
+        else if (state.pattern == 2)
+            alternatingPair(state.speedMs);
+        else if (state.pattern == 3)
+            randomPattern(state.speedMs);
     }
 }
 
 void buttonTask(void *pvParameter)
 {
-    QueueHandle_t qHandle = (QueueHandle_t)pvParameter;
-    uint16_t buttonCounter = 0;
+    controller_state_t state;
+    snapshotRead(&g_state, &state);
+    uint16_t buttonCounter = state.pattern; // carry on from the restored pattern
     while (1)
     {
         if (gpio_get_level(BUTTON) == 1)
@@ -145,7 +194,8 @@ void buttonTask(void *pvParameter)
             buttonCounter = buttonCounter + 1;
             if (buttonCounter == 4)
                 buttonCounter = 0;
-            xQueueSend(qHandle, &buttonCounter, portMAX_DELAY);
+            eventBusPublish(&g_patternTopic, &buttonCounter, sizeof(buttonCounter));
+            saveSetting(&g_patternSetting, buttonCounter);
             xSemaphoreTake(g_uartMutex, portMAX_DELAY);
 
             ESP_LOGI("BUTTON_TASK", "BUTTON COUNTER VALUE: %d", buttonCounter);
@@ -155,10 +205,24 @@ void buttonTask(void *pvParameter)
     }
 }
 
+void consoleReader(void *pvParameter)
+{
+    msg_channel_t *channel = (msg_channel_t *)pvParameter;
+    while (1)
+    {
+        // The reservation stays open while the console has nothing to read
+        char *line = (char *)msgChannelReserve(channel, CONSOLE_LINE_MAX, portMAX_DELAY);
+        while (fgets(line, CONSOLE_LINE_MAX, stdin) == NULL)
+        {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+        msgChannelCommit(channel, strlen(line) + 1); // keep the terminator
+    }
+}
+
 void serialTask(void *pvParameter)
 {
-    g_serialHandle *handles = (g_serialHandle *)pvParameter;
-    char rxtext[50] = {0};
+    msg_channel_t *channel = (msg_channel_t *)pvParameter;
     uint16_t rxdPattern = 0;
     uint16_t rxdSpeed = 0;
     xSemaphoreTake(g_uartMutex, portMAX_DELAY);
@@ -168,7 +232,10 @@ void serialTask(void *pvParameter)
 
     while (1)
     {
-        if (fgets(rxtext, sizeof(rxtext), stdin) != NULL)
+        // Parsed in place; the line stays in the ring until released
+        size_t len = 0;
+        const char *rxtext = (const char *)msgChannelReceive(channel, &len, portMAX_DELAY);
+        if (rxtext != NULL)
         {
             xSemaphoreTake(g_uartMutex, portMAX_DELAY);
 
@@ -178,12 +245,14 @@ void serialTask(void *pvParameter)
             char cmd[20] = {0};
             int value = 0;
 
-            if (sscanf(rxtext, "%s %d", cmd, &value) >= 1)
+            // "profile ..." lines go to the profiler (profiler.h)
+            if (!profileCommand(rxtext) && sscanf(rxtext, "%19s %d", cmd, &value) >= 1)
             {
                 if (strcmp(cmd, "pattern") == 0 && value >= 0 && value <= 3)
                 {
                     rxdPattern = (uint16_t)value;
-                    xQueueSend(handles->patternQHandle, &rxdPattern, 0);
+                    eventBusPublish(&g_patternTopic, &rxdPattern, sizeof(rxdPattern));
+                    saveSetting(&g_patternSetting, rxdPattern);
                     xSemaphoreTake(g_uartMutex, portMAX_DELAY);
 
                     ESP_LOGI("SERIALTASK", "Pattern changed to: %d", rxdPattern);
@@ -192,7 +261,8 @@ void serialTask(void *pvParameter)
                 else if (strcmp(cmd, "speed") == 0 && value >= 50 && value <= 1000)
                 {
                     rxdSpeed = (uint16_t)value;
-                    xQueueSend(handles->speedQHandle, &rxdSpeed, 0);
+                    eventBusPublish(&g_speedTopic, &rxdSpeed, sizeof(rxdSpeed));
+                    saveSetting(&g_speedSetting, rxdSpeed);
                     xSemaphoreTake(g_uartMutex, portMAX_DELAY);
 
                     ESP_LOGI("SERIALTASK", "Speed changed to: %d", rxdSpeed);
@@ -203,27 +273,33 @@ void serialTask(void *pvParameter)
                     xSemaphoreTake(g_uartMutex, portMAX_DELAY);
                     ESP_LOGI("SERIALTASK", "Status requested");
                     xSemaphoreGive(g_uartMutex);
+                    eventBusReport();
                 }
             }
+            msgChannelRelease(channel);
         }
-
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
 void statusReporter(void *pvParameter)
 {
     const char *patternNames[] = {"Knight Rider", "Blink All", "Alternating Pair", "Random"};
+    const uint16_t patternCount = sizeof(patternNames) / sizeof(patternNames[0]);
     uint32_t reportCount = 0;
+    controller_state_t state;
     
     while (1)
     {
         vTaskDelay(pdMS_TO_TICKS(5000)); // Report every 5 seconds
+
+        // Pattern and speed from the same write, never one old and one new
+        snapshotRead(&g_state, &state);
+        const char *name = (state.pattern < patternCount) ? patternNames[state.pattern] : "Unknown";
         
         xSemaphoreTake(g_uartMutex, portMAX_DELAY);
         ESP_LOGI("STATUS_REPORTER", "========== System Status Report #%lu ==========", reportCount++);
-        ESP_LOGI("STATUS_REPORTER", "Current Pattern: %d (%s)", g_selectedPattern, patternNames[g_selectedPattern]);
-        ESP_LOGI("STATUS_REPORTER", "Current Speed: %d ms", g_speed_ms);
+        ESP_LOGI("STATUS_REPORTER", "Current Pattern: %d (%s)", state.pattern, name);
+        ESP_LOGI("STATUS_REPORTER", "Current Speed: %d ms", state.speedMs);
         ESP_LOGI("STATUS_REPORTER", "=============================================");
         xSemaphoreGive(g_uartMutex);
     }
@@ -234,16 +310,51 @@ extern "C" void app_main(void)
     ESP_LOGI(TAG, "===========================================");
     ESP_LOGI(TAG, "Multi-Task LED Controller - Practice Project");
     ESP_LOGI(TAG, "===========================================");
-    g_patternQueue = xQueueCreate(10, sizeof(int));
-    g_speedQueue = xQueueCreate(10, sizeof(int));
-    sHandle.patternQHandle = g_patternQueue;
-    sHandle.speedQHandle = g_speedQueue;
     g_uartMutex = xSemaphoreCreateMutex();
     if (g_uartMutex == NULL)
     {
         ESP_LOGE(TAG, "Failed to create UART mutex!");
         return; // Cannot continue without mutex
     }
+
+    // Subscribe before any task can publish
+    if (!eventBusRegisterTopic(&g_patternTopic) || !eventBusRegisterTopic(&g_speedTopic) ||
+        !eventBusSubscriberInit(&g_sequencerSub, "pattern", 10) ||
+        !eventBusSubscribe(&g_patternTopic, &g_sequencerSub) || !eventBusSubscribe(&g_speedTopic, &g_sequencerSub))
+    {
+        ESP_LOGE(TAG, "Failed to set up the event bus!");
+        return;
+    }
+
+    if (!msgChannelInit(&g_console, g_consoleRing, sizeof(g_consoleRing)))
+    {
+        ESP_LOGE(TAG, "Failed to set up the console channel!");
+        return;
+    }
+
+    // Start from the saved pattern and speed; without NVS, run on defaults
+    g_settingsReady = settingsInit(SETTINGS_QUIET_MS, SETTINGS_MAX_DELAY_MS) &&
+                      settingsAdd(&g_patternSetting) && settingsAdd(&g_speedSetting);
+    if (g_settingsReady)
+        settingsBoot();
+    else
+        ESP_LOGW(TAG, "Settings unavailable, changes will not be saved");
+    uint32_t savedPattern = settingsGet(&g_patternSetting);
+    uint32_t savedSpeed = settingsGet(&g_speedSetting);
+    if (savedPattern <= 3)
+        g_stateData.pattern = (uint16_t)savedPattern;
+    if (savedSpeed >= 50 && savedSpeed <= 1000)
+        g_stateData.speedMs = (uint16_t)savedSpeed;
+
+    if (!snapshotInit(&g_state, &g_stateData, sizeof(g_stateData)))
+    {
+        ESP_LOGE(TAG, "Failed to set up the controller state!");
+        return;
+    }
+#ifdef PROFILE_ENABLED
+    profileInit();
+#endif
+
     for (int i = 0; i < 4; i++)
     {
         gpio_reset_pin(LED[i]);
@@ -254,11 +365,13 @@ extern "C" void app_main(void)
     gpio_set_direction(BUTTON, GPIO_MODE_INPUT);
     gpio_pulldown_en(BUTTON);
 
-    ESP_LOGI(TAG, "System initialized. Tasks running...");
-    ESP_LOGI(TAG, "Commands: pattern <0-3>, speed <50-1000>, status");
+    ESP_LOGI(TAG, "System initialized (pattern %d, speed %d ms). Tasks running...", g_stateData.pattern,
+             g_stateData.speedMs);
+    ESP_LOGI(TAG, "Commands: pattern <0-3>, speed <50-1000>, status, profile [reset|on|off]");
 
-    xTaskCreate(patternSequencer, "pattern", 2048, &sHandle, 3, NULL);
-    xTaskCreate(buttonTask, "buttonTask", 2048, g_patternQueue, 5, NULL);
-    xTaskCreate(serialTask, "SerialTask", 4096, &sHandle, 2, NULL);
+    xTaskCreate(patternSequencer, "pattern", 2048, &g_sequencerSub, 3, NULL);
+    xTaskCreate(buttonTask, "buttonTask", 2048, NULL, 5, NULL);
+    xTaskCreate(consoleReader, "consoleReader", 3072, &g_console, 2, NULL);
+    xTaskCreate(serialTask, "SerialTask", 4096, &g_console, 2, NULL);
     xTaskCreate(statusReporter, "statusReporter", 2048, NULL, 1, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "acq_core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "host_test.h"
+
+#define RING_MASK (ACQ_MAX_FRAMES - 1)
+
+// --- pool ------------------------------------------------------------------
+
+static inline uint32_t loadCounter(const volatile uint32_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+}
+
+static inline void storeCounter(volatile uint32_t *counter, uint32_t value)
+{
+    __atomic_store_n(counter, value, __ATOMIC_RELEASE);
+}
+
+bool acqPoolInit(acq_pool_t *pool, acq_sample_t *storage, uint8_t frames, uint16_t samplesPerFrame)
+{
+    if (frames == 0 || frames > ACQ_MAX_FRAMES || samplesPerFrame == 0)
+        return false;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->frameCount = frames;
+    for (uint8_t i = 0; i <= frames; i++)
+    {
+        acq_frame_t *frame = (i < frames) ? &pool->frames[i] : &pool->scratch;
+        frame->capacity = samplesPerFrame;
+        frame->samples = storage + (size_t)i * samplesPerFrame;
+    }
+    // Every frame starts out free
+    for (uint8_t i = 0; i < frames; i++)
+    {
+        pool->freeRing[i] = i;
+    }
+    pool->freeHead = frames;
+    return true;
+}
+
+acq_frame_t *acqPoolAcquire(acq_pool_t *pool)
+{
+    uint32_t tail = pool->freeTail;
+    if (loadCounter(&pool->freeHead) == tail)
+        return &pool->scratch;
+    acq_frame_t *frame = &pool->frames[pool->freeRing[tail & RING_MASK]];
+    storeCounter(&pool->freeTail, tail + 1);
+    return frame;
+}
+
+bool acqPoolPublish(acq_pool_t *pool, acq_frame_t *frame)
+{
+    frame->seq = pool->nextSeq++;
+    if (frame == &pool->scratch)
+    {
+        pool->stats.overruns++;
+        return false;
+    }
+
+    // Cannot be full: there are only frameCount frames to publish
+    uint32_t head = pool->fullHead;
+    pool->fullRing[head & RING_MASK] = (uint8_t)(frame - pool->frames);
+    pool->stats.frames++;
+    pool->stats.samples += frame->count;
+    storeCounter(&pool->fullHead, head + 1);
+    return true;
+}
+
+acq_frame_t *acqPoolNext(acq_pool_t *pool)
+{
+    uint32_t tail = pool->fullTail;
+    if (loadCounter(&pool->fullHead) == tail)
+        return NULL;
+    acq_frame_t *frame = &pool->frames[pool->fullRing[tail & RING_MASK]];
+    storeCounter(&pool->fullTail, tail + 1);
+    return frame;
+}
+
+void acqPoolRelease(acq_pool_t *pool, acq_frame_t *frame)
+{
+    uint32_t head = pool->freeHead;
+    pool->freeRing[head & RING_MASK] = (uint8_t)(frame - pool->frames);
+    storeCounter(&pool->freeHead, head + 1);
+}
+
+// --- replay driver ---------------------------------------------------------
+
+bool acqReplayLoad(acq_replay_t *replay, const char *path, bool loop)
+{
+    memset(replay, 0, sizeof(*replay));
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+
+    uint32_t capacity = 1024;
+    acq_sample_t *samples = (acq_sample_t *)malloc(capacity * sizeof(acq_sample_t));
+    uint32_t count = 0;
+    char line[64];
+    while (samples != NULL && fgets(line, sizeof(line), file) != NULL)
+    {
+        unsigned unit, channel, value;
+        if (line[0] == '#' || sscanf(line, "%u,%u,%u", &unit, &channel, &value) != 3)
+            continue;
+        if (count == capacity)
+        {
+            capacity *= 2;
+            acq_sample_t *grown = (acq_sample_t *)realloc(samples, capacity * sizeof(acq_sample_t));
+            if (grown == NULL)
+            {
+                free(samples);
+                samples = NULL;
+                break;
+            }
+            samples = grown;
+        }
+        samples[count++] = {(uint16_t)value, (uint8_t)channel, (uint8_t)unit};
+    }
+    fclose(file);
+
+    if (samples == NULL || count == 0)
+    {
+        free(samples);
+        return false;
+    }
+    acqReplayFromMemory(replay, samples, count, loop);
+    return true;
+}
+
+void acqReplayFromMemory(acq_replay_t *replay, acq_sample_t *samples, uint32_t count, bool loop)
+{
+    memset(replay, 0, sizeof(*replay));
+    replay->samples = samples;
+    replay->count = count;
+    replay->loop = loop;
+}
+
+void acqReplayFree(acq_replay_t *replay)
+{
+    free(replay->samples);
+    replay->samples = NULL;
+    replay->count = 0;
+}
+
+static bool replayStart(void *ctx, uint32_t rateHz)
+{
+    acq_replay_t *replay = (acq_replay_t *)ctx;
+    replay->rateHz = rateHz;
+    replay->pos = 0;
+    replay->played = 0;
+    return replay->count > 0;
+}
+
+static void replayStop(void *ctx)
+{
+    (void)ctx;
+}
+
+static bool replayFill(void *ctx, acq_frame_t *frame, uint32_t timeoutMs)
+{
+    (void)timeoutMs;
+    acq_replay_t *replay = (acq_replay_t *)ctx;
+    uint16_t n = 0;
+    while (n < frame->capacity)
+    {
+        if (replay->pos == replay->count)
+        {
+            if (!replay->loop)
+                break;
+            replay->pos = 0;
+        }
+        uint32_t chunk = replay->count - replay->pos;
+        if (chunk > (uint32_t)(frame->capacity - n))
+            chunk = frame->capacity - n;
+        memcpy(&frame->samples[n], &replay->samples[replay->pos], chunk * sizeof(acq_sample_t));
+        replay->pos += chunk;
+        n += chunk;
+    }
+    if (n == 0)
+        return false;
+
+    frame->count = n;
+    frame->rateHz = replay->rateHz;
+    frame->timeUs = replay->rateHz ? (int64_t)(replay->played * 1000000 / replay->rateHz) : 0;
+    replay->played += n;
+    return true;
+}
+
+acq_driver_t acqReplayDriver(acq_replay_t *replay)
+{
+    return {"replay", replayStart, replayStop, replayFill, replay};
+}
+
+// --- self test -------------------------------------------------------------
+
+bool acqSelfTest(void)
+{
+    printf("Acquisition self test\n");
+    bool ok = true;
+
+    const uint16_t perFrame = 16;
+    static acq_sample_t storage[(4 + 1) * perFrame];
+    static acq_sample_t recording[100];
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        recording[i] = {(uint16_t)i, (uint8_t)(i % 4), 0};
+    }
+
+    acq_pool_t pool;
+    acq_replay_t replay;
+    acqReplayFromMemory(&replay, recording, 100, false);
+    acq_driver_t driver = acqReplayDriver(&replay);
+    ok &= testCheck("pool init", acqPoolInit(&pool, storage, 4, perFrame));
+    driver.start(driver.ctx, 1000);
+
+    // Producer fills all four frames while the consumer holds none
+    bool filled = true;
+    for (int i = 0; i < 4; i++)
+    {
+        acq_frame_t *f = acqPoolAcquire(&pool);
+        filled &= f != &pool.scratch && driver.fill(driver.ctx, f, 0) && acqPoolPublish(&pool, f);
+    }
+    ok &= testCheck("four frames published", filled && pool.stats.frames == 4);
+
+    // Fifth frame has nowhere to go
+    acq_frame_t *f = acqPoolAcquire(&pool);
+    driver.fill(driver.ctx, f, 0);
+    ok &= testCheck("overrun goes to the scratch frame", f == &pool.scratch && !acqPoolPublish(&pool, f) &&
+                                                          pool.stats.overruns == 1);
+
+    // Consumer sees frames in order, by reference, with the gap visible
+    acq_frame_t *first = acqPoolNext(&pool);
+    ok &= testCheck("first frame, no copy", first == &pool.frames[0] && first->seq == 0 &&
+                                            first->samples[0].value == 0 && first->count == perFrame);
+    ok &= testCheck("timestamps follow the sample rate", first->timeUs == 0 && pool.frames[1].timeUs == 16000);
+    acqPoolRelease(&pool, first);
+    f = acqPoolAcquire(&pool);
+    ok &= testCheck("released frame is reused", f == first);
+    driver.fill(driver.ctx, f, 0);
+    acqPoolPublish(&pool, f);
+    uint32_t seqs[4];
+    for (int i = 0; i < 4; i++)
+    {
+        acq_frame_t *g = acqPoolNext(&pool);
+        seqs[i] = g ? g->seq : 99;
+        if (g)
+            acqPoolRelease(&pool, g);
+    }
+    ok &= testCheck("sequence shows the dropped frame", seqs[0] == 1 && seqs[2] == 3 && seqs[3] == 5);
+    ok &= testCheck("empty pool returns NULL", acqPoolNext(&pool) == NULL);
+
+    // 100 samples = 6 full frames + 4; the replay then ends
+    f = acqPoolAcquire(&pool);
+    ok &= testCheck("short last frame", driver.fill(driver.ctx, f, 0) && f->count == 4 && f->samples[3].value == 99);
+    ok &= testCheck("end of recording", !driver.fill(driver.ctx, f, 0));
+
+    // File round trip
+    const char *path = "acq_selftest.csv";
+    FILE *file = fopen(path, "w");
+    if (file != NULL)
+    {
+        fprintf(file, "# unit,channel,value\n0,3,4095\n\n1,6,17\n");
+        fclose(file);
+    }
+    acq_replay_t loaded;
+    bool parsed = acqReplayLoad(&loaded, path, true);
+    ok &= testCheck("recording file parsed", parsed && loaded.count == 2 && loaded.samples[0].value == 4095 &&
+                                             loaded.samples[1].unit == 1 && loaded.samples[1].channel == 6);
+    if (parsed)
+        acqReplayFree(&loaded);
+    remove(path);
+
+    return testSummary(ok);
+}
+
+// --- benchmark -------------------------------------------------------------
+
+void acqBenchmark(const char *path, double seconds)
+{
+    acq_replay_t replay;
+    if (path != NULL)
+    {
+        if (!acqReplayLoad(&replay, path, true))
+        {
+            printf("Cannot load %s\n", path);
+            return;
+        }
+    }
+    else
+    {
+        // One second of four channels at 20 kHz: a sine per channel
+        const uint32_t count = 20000;
+        acq_sample_t *samples = (acq_sample_t *)malloc(count * sizeof(acq_sample_t));
+        if (samples == NULL)
+            return;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint8_t channel = (uint8_t)(i % 4);
+            double phase = 2 * M_PI * (i / 4) * (channel + 1) / 5000.0;
+            samples[i] = {(uint16_t)(2048 + 2000 * sin(phase)), channel, 0};
+        }
+        acqReplayFromMemory(&replay, samples, count, true);
+    }
+
+    printf("Replaying %u samples (%s) through the frame pool\n", (unsigned)replay.count, path ? path : "synthetic");
+    static const uint16_t frameSizes[] = {64, 256, 1024};
+    for (uint16_t perFrame : frameSizes)
+    {
+        acq_sample_t *storage = (acq_sample_t *)malloc((ACQ_MAX_FRAMES + 1) * perFrame * sizeof(acq_sample_t));
+        if (storage == NULL)
+            break;
+        acq_pool_t pool;
+        acqPoolInit(&pool, storage, ACQ_MAX_FRAMES, perFrame);
+        acq_driver_t driver = acqReplayDriver(&replay);
+        driver.start(driver.ctx, 20000);
+
+        // The consumer keeps a running sum per channel so the data is read
+        uint64_t sums[16] = {0};
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < seconds)
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                acq_frame_t *f = acqPoolAcquire(&pool);
+                if (driver.fill(driver.ctx, f, 0))
+                    acqPoolPublish(&pool, f);
+                while ((f = acqPoolNext(&pool)) != NULL)
+                {
+                    for (uint16_t s = 0; s < f->count; s++)
+                        sums[f->samples[s].channel & 15] += f->samples[s].value;
+                    acqPoolRelease(&pool, f);
+                }
+            }
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        uint64_t checksum = 0;
+        for (uint64_t s : sums)
+            checksum += s;
+
+        printf("  %5u samples/frame  %8.2f Msamples/s  %9.0f frames/s  (checksum %llu)\n", perFrame,
+               pool.stats.samples / elapsed / 1e6, pool.stats.frames / elapsed, (unsigned long long)checksum);
+        free(storage);
+    }
+    acqReplayFree(&replay);
+}
+
+#ifdef ACQ_HOST_MAIN
+int main(int argc, char **argv)
+{
+    bool ok = acqSelfTest();
+    acqBenchmark(argc > 1 ? argv[1] : NULL, 1.0);
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,127 @@
+/**
+ * Acquisition frames, driver interface and sample replay
+ *
+ * The Day 4 struct-queue producerTask makes up a value every 800 ms with
+ * vTaskDelay. Real sampling at kHz rates cannot wake a task per
+ * conversion, so acquisition works on frames: a driver fills a whole
+ * buffer of samples in the background (ADC continuous mode and DMA on the
+ * target, see acquisition.h) and each full frame is stamped and handed on.
+ *
+ * Frames are never copied after the driver fills them. A pool owns a fixed
+ * set of frame buffers and passes pointers between two index rings:
+ *
+ *   producer:  f = acqPoolAcquire(pool);  driver fills f;  acqPoolPublish(pool, f);
+ *   consumer:  f = acqPoolNext(pool);  use f->samples;  acqPoolRelease(pool, f);
+ *
+ * Whoever holds the pointer owns the buffer. When the consumer holds every
+ * frame, acqPoolAcquire returns a spare scratch frame instead. The driver
+ * keeps draining into it, and publishing it only counts an overrun. Frame
+ * sequence numbers still advance, so the consumer sees the gap.
+ *
+ * Drivers sit behind acq_driver_t. The replay driver here plays a recorded
+ * sample file ("unit,channel,value" per line) as fast as it is asked, with
+ * timestamps derived from the nominal sample rate. This file only uses the
+ * C++ standard library, so the pool and the replay run on a PC:
+ *
+ *   g++ -std=c++17 -O2 -DACQ_HOST_MAIN acq_core.cpp -o acq && ./acq [recording.csv]
+ *
+ * One producer and one consumer per pool.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ACQ_MAX_FRAMES 8 // power of two
+
+typedef struct
+{
+    uint16_t value; // raw conversion result
+    uint8_t channel;
+    uint8_t unit;
+} acq_sample_t;
+
+typedef struct
+{
+    uint32_t seq;
+    int64_t timeUs;   // first sample, esp_timer clock on the target
+    uint32_t rateHz;  // sample spacing within the frame
+    uint16_t count;
+    uint16_t capacity;
+    acq_sample_t *samples;
+} acq_frame_t;
+
+typedef struct
+{
+    const char *name;
+    bool (*start)(void *ctx, uint32_t rateHz);
+    void (*stop)(void *ctx);
+    // Fills frame->samples up to capacity and sets count, timeUs and rateHz.
+    // Returns false on timeout or end of data.
+    bool (*fill)(void *ctx, acq_frame_t *frame, uint32_t timeoutMs);
+    void *ctx;
+} acq_driver_t;
+
+typedef struct
+{
+    uint32_t frames;   // published to the consumer
+    uint32_t samples;
+    uint32_t overruns; // frames dropped because the consumer held every buffer
+} acq_stats_t;
+
+typedef struct
+{
+    acq_frame_t frames[ACQ_MAX_FRAMES];
+    acq_frame_t scratch;
+    uint8_t frameCount;
+
+    // Free-running counters into rings of frame indices
+    uint8_t fullRing[ACQ_MAX_FRAMES];
+    volatile uint32_t fullHead; // producer
+    volatile uint32_t fullTail; // consumer
+    uint8_t freeRing[ACQ_MAX_FRAMES];
+    volatile uint32_t freeHead; // consumer
+    volatile uint32_t freeTail; // producer
+
+    uint32_t nextSeq;
+    acq_stats_t stats;
+} acq_pool_t;
+
+// `storage` holds (frames + 1) * samplesPerFrame samples (the +1 is the
+// scratch frame) and must outlive the pool. frames <= ACQ_MAX_FRAMES.
+bool acqPoolInit(acq_pool_t *pool, acq_sample_t *storage, uint8_t frames, uint16_t samplesPerFrame);
+
+// Producer side. Never returns NULL.
+acq_frame_t *acqPoolAcquire(acq_pool_t *pool);
+// Returns false if the frame was the scratch frame (overrun).
+bool acqPoolPublish(acq_pool_t *pool, acq_frame_t *frame);
+
+// Consumer side. NULL when no frame is ready.
+acq_frame_t *acqPoolNext(acq_pool_t *pool);
+void acqPoolRelease(acq_pool_t *pool, acq_frame_t *frame);
+
+typedef struct
+{
+    acq_sample_t *samples;
+    uint32_t count;
+    uint32_t pos;
+    uint32_t rateHz;
+    uint64_t played; // samples handed out, for timestamps
+    bool loop;
+} acq_replay_t;
+
+// Loads a recording. Lines are "unit,channel,value"; blank lines and lines
+// starting with '#' are skipped.
+bool acqReplayLoad(acq_replay_t *replay, const char *path, bool loop);
+// Uses `count` caller-owned samples instead of a file.
+void acqReplayFromMemory(acq_replay_t *replay, acq_sample_t *samples, uint32_t count, bool loop);
+void acqReplayFree(acq_replay_t *replay);
+acq_driver_t acqReplayDriver(acq_replay_t *replay);
+
+bool acqSelfTest(void);
+
+// Replays `path` (or a synthetic 4-channel recording when NULL) through a
+// pool for `seconds` and prints samples/s and frames/s per frame size.
+void acqBenchmark(const char *path, double seconds);
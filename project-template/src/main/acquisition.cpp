@@ -0,0 +1,291 @@
+#include "acquisition.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_adc/adc_continuous.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "Acquisition";
+
+#define FILL_TIMEOUT_MS 100
+
+// --- ADC continuous driver -------------------------------------------------
+
+typedef struct
+{
+    adc_continuous_handle_t handle;
+    adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX];
+    uint8_t patternCount;
+    uint8_t *raw; // one conversion frame as the ADC writes it, while started
+    uint32_t rawBytes;
+    uint32_t rateHz;
+
+    // Written by the ADC callbacks
+    portMUX_TYPE lock;
+    int64_t lastDoneUs;
+    volatile bool resync;
+    volatile uint32_t overflows;
+
+    // Sample clock, owned by the acquisition task
+    bool anchored;
+    int64_t anchorUs;
+    uint64_t sinceAnchor;
+} adc_ctx_t;
+
+static adc_ctx_t g_adc;
+
+static bool IRAM_ATTR adcConvDone(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata,
+                                  void *userData)
+{
+    adc_ctx_t *adc = (adc_ctx_t *)userData;
+    portENTER_CRITICAL_ISR(&adc->lock);
+    adc->lastDoneUs = esp_timer_get_time();
+    portEXIT_CRITICAL_ISR(&adc->lock);
+    return false;
+}
+
+static bool IRAM_ATTR adcPoolOverflow(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata,
+                                      void *userData)
+{
+    adc_ctx_t *adc = (adc_ctx_t *)userData;
+    adc->overflows = adc->overflows + 1;
+    adc->resync = true; // samples were lost, the sample count no longer tracks time
+    return false;
+}
+
+static bool adcStart(void *ctx, uint32_t rateHz)
+{
+    adc_ctx_t *adc = (adc_ctx_t *)ctx;
+    if (rateHz == 0)
+        return false;
+    adc->rateHz = rateHz;
+    adc->anchored = false;
+    adc->raw = (uint8_t *)malloc(adc->rawBytes);
+    if (adc->raw == NULL)
+        return false;
+
+    adc_continuous_handle_cfg_t handleConfig = {};
+    handleConfig.max_store_buf_size = adc->rawBytes * 4;
+    handleConfig.conv_frame_size = adc->rawBytes;
+    if (adc_continuous_new_handle(&handleConfig, &adc->handle) != ESP_OK)
+    {
+        free(adc->raw);
+        adc->raw = NULL;
+        return false;
+    }
+
+    adc_continuous_config_t config = {};
+    config.pattern_num = adc->patternCount;
+    config.adc_pattern = adc->pattern;
+    config.sample_freq_hz = rateHz;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+#else
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+#endif
+
+    adc_continuous_evt_cbs_t callbacks = {};
+    callbacks.on_conv_done = adcConvDone;
+    callbacks.on_pool_ovf = adcPoolOverflow;
+
+    esp_err_t err = adc_continuous_config(adc->handle, &config);
+    if (err == ESP_OK)
+        err = adc_continuous_register_event_callbacks(adc->handle, &callbacks, adc);
+    if (err == ESP_OK)
+        err = adc_continuous_start(adc->handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "ADC start failed: %s", esp_err_to_name(err));
+        adc_continuous_deinit(adc->handle);
+        adc->handle = NULL;
+        free(adc->raw);
+        adc->raw = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void adcStop(void *ctx)
+{
+    adc_ctx_t *adc = (adc_ctx_t *)ctx;
+    if (adc->handle == NULL)
+        return;
+    adc_continuous_stop(adc->handle);
+    adc_continuous_deinit(adc->handle);
+    adc->handle = NULL;
+    free(adc->raw);
+    adc->raw = NULL;
+}
+
+static bool adcFill(void *ctx, acq_frame_t *frame, uint32_t timeoutMs)
+{
+    adc_ctx_t *adc = (adc_ctx_t *)ctx;
+    uint32_t bytes = 0;
+    uint32_t want = frame->capacity * SOC_ADC_DIGI_RESULT_BYTES;
+    if (want > adc->rawBytes)
+        want = adc->rawBytes;
+    if (adc_continuous_read(adc->handle, adc->raw, want, &bytes, timeoutMs) != ESP_OK)
+        return false;
+
+    uint16_t n = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= bytes; i += SOC_ADC_DIGI_RESULT_BYTES)
+    {
+        const adc_digi_output_data_t *out = (const adc_digi_output_data_t *)&adc->raw[i];
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+        frame->samples[n] = {(uint16_t)out->type1.data, (uint8_t)out->type1.channel, 0};
+#else
+        frame->samples[n] = {(uint16_t)out->type2.data, (uint8_t)out->type2.channel, (uint8_t)out->type2.unit};
+#endif
+        n++;
+    }
+    if (n == 0)
+        return false;
+
+    // (Re)anchor on the latest conversion-done interrupt: the last sample
+    // of this frame is taken to be the one it reported
+    int64_t usPerMillionSamples = 1000000LL * 1000000 / adc->rateHz;
+    if (!adc->anchored || adc->resync)
+    {
+        portENTER_CRITICAL(&adc->lock);
+        int64_t doneUs = adc->lastDoneUs;
+        portEXIT_CRITICAL(&adc->lock);
+        adc->resync = false;
+        adc->anchored = true;
+        adc->anchorUs = doneUs - (int64_t)(n - 1) * usPerMillionSamples / 1000000;
+        adc->sinceAnchor = 0;
+    }
+    frame->timeUs = adc->anchorUs + (int64_t)adc->sinceAnchor * usPerMillionSamples / 1000000;
+    frame->rateHz = adc->rateHz;
+    frame->count = n;
+    adc->sinceAnchor += n;
+    return true;
+}
+
+bool acqAdcDriver(acq_driver_t *driver, const uint8_t *channels, uint8_t channelCount, uint16_t samplesPerFrame)
+{
+    if (channelCount == 0 || channelCount > SOC_ADC_PATT_LEN_MAX || g_adc.handle != NULL)
+        return false;
+
+    memset(&g_adc, 0, sizeof(g_adc));
+    g_adc.lock = portMUX_INITIALIZER_UNLOCKED;
+    for (uint8_t i = 0; i < channelCount; i++)
+    {
+        adc_digi_pattern_config_t *p = &g_adc.pattern[i];
+        p->atten = ADC_ATTEN_DB_12;
+        p->channel = channels[i] & 0x7;
+        p->unit = ADC_UNIT_1;
+        p->bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    g_adc.patternCount = channelCount;
+
+    // The conversion frame size must be a whole number of results
+    g_adc.rawBytes = samplesPerFrame * SOC_ADC_DIGI_RESULT_BYTES;
+
+    *driver = {"adc-continuous", adcStart, adcStop, adcFill, &g_adc};
+    return true;
+}
+
+// --- acquisition task ------------------------------------------------------
+
+static void acqTask(void *pvParameter)
+{
+    acquisition_t *acq = (acquisition_t *)pvParameter;
+    acq_frame_t *frame = NULL;
+    while (acq->running)
+    {
+        if (frame == NULL)
+            frame = acqPoolAcquire(&acq->pool);
+        if (!acq->driver.fill(acq->driver.ctx, frame, FILL_TIMEOUT_MS))
+        {
+            acq->timeouts++;
+            continue;
+        }
+        if (acqPoolPublish(&acq->pool, frame))
+            xSemaphoreGive(acq->framesReady);
+        frame = NULL;
+    }
+    acq->task = NULL;
+    xSemaphoreGive(acq->exited);
+    vTaskDelete(NULL);
+}
+
+bool acqStart(acquisition_t *acq, const acq_driver_t *driver, uint32_t rateHz, uint8_t frames,
+              uint16_t samplesPerFrame, UBaseType_t priority, BaseType_t core)
+{
+    memset(acq, 0, sizeof(*acq));
+    acq->driver = *driver;
+    acq->storage = (acq_sample_t *)malloc((size_t)(frames + 1) * samplesPerFrame * sizeof(acq_sample_t));
+    if (acq->storage == NULL || !acqPoolInit(&acq->pool, acq->storage, frames, samplesPerFrame))
+    {
+        ESP_LOGE(TAG, "Cannot allocate %u frames of %u samples", frames, samplesPerFrame);
+        free(acq->storage);
+        return false;
+    }
+
+    acq->framesReady = xSemaphoreCreateCounting(frames, 0);
+    acq->exited = xSemaphoreCreateBinary();
+    if (acq->framesReady == NULL || acq->exited == NULL || !driver->start(driver->ctx, rateHz))
+    {
+        ESP_LOGE(TAG, "Cannot start driver %s", driver->name);
+        if (acq->framesReady != NULL)
+            vSemaphoreDelete(acq->framesReady);
+        if (acq->exited != NULL)
+            vSemaphoreDelete(acq->exited);
+        free(acq->storage);
+        return false;
+    }
+
+    acq->running = true;
+    if (xTaskCreatePinnedToCore(acqTask, "acquisition", 3072, acq, priority, &acq->task, core) != pdPASS)
+    {
+        acq->running = false;
+        driver->stop(driver->ctx);
+        vSemaphoreDelete(acq->framesReady);
+        vSemaphoreDelete(acq->exited);
+        free(acq->storage);
+        return false;
+    }
+    ESP_LOGI(TAG, "%s at %lu Hz, %u frames of %u samples", driver->name, (unsigned long)rateHz, frames,
+             samplesPerFrame);
+    return true;
+}
+
+void acqStop(acquisition_t *acq)
+{
+    acq->running = false;
+    // The task leaves within one fill timeout; until it says so it may
+    // still be filling a frame of the pool
+    xSemaphoreTake(acq->exited, portMAX_DELAY);
+    acq->driver.stop(acq->driver.ctx);
+    vSemaphoreDelete(acq->framesReady);
+    vSemaphoreDelete(acq->exited);
+    free(acq->storage);
+    acq->storage = NULL;
+}
+
+acq_frame_t *acqReceive(acquisition_t *acq, TickType_t timeout)
+{
+    if (xSemaphoreTake(acq->framesReady, timeout) != pdTRUE)
+        return NULL;
+    return acqPoolNext(&acq->pool);
+}
+
+void acqRelease(acquisition_t *acq, acq_frame_t *frame)
+{
+    acqPoolRelease(&acq->pool, frame);
+}
+
+void acqReport(const acquisition_t *acq)
+{
+    const acq_stats_t *s = &acq->pool.stats;
+    ESP_LOGI(TAG, "%s: %lu frames, %lu samples, %lu overruns, %lu empty reads", acq->driver.name,
+             (unsigned long)s->frames, (unsigned long)s->samples, (unsigned long)s->overruns,
+             (unsigned long)acq->timeouts);
+    if (acq->driver.ctx == &g_adc)
+        ESP_LOGI(TAG, "ADC DMA pool overflows: %lu", (unsigned long)g_adc.overflows);
+}
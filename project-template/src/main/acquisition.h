@@ -0,0 +1,68 @@
+/**
+ * Continuous sensor acquisition
+ *
+ * Runs an acq_driver_t (acq_core.h) in its own task and hands full frames
+ * to one consumer by pointer:
+ *
+ *   static acquisition_t g_acq;
+ *   static const uint8_t channels[] = {ADC_CHANNEL_6, ADC_CHANNEL_7};
+ *   acq_driver_t adc;
+ *   acqAdcDriver(&adc, channels, 2, 256);
+ *   acqStart(&g_acq, &adc, 20000, 4, 256, 6, 1);
+ *
+ *   while (1)
+ *   {
+ *       acq_frame_t *f = acqReceive(&g_acq, portMAX_DELAY);
+ *       ... f->samples[0 .. f->count), first one taken at f->timeUs ...
+ *       acqRelease(&g_acq, f);
+ *   }
+ *
+ * The ADC driver uses ADC continuous mode. The ADC's DMA fills
+ * conversion frames while the CPUs do other work; one ESP-IDF read per
+ * frame moves the finished results into the pool buffer. Timestamps come
+ * from the ADC's own sample clock: the first conversion-done interrupt
+ * anchors it to esp_timer, and after that each frame is anchor +
+ * samples / rate. After a DMA pool overflow the anchor is taken again.
+ *
+ * If the consumer holds every frame, new frames are read and dropped (the
+ * DMA must keep draining) and counted as overruns; acqReport() shows them.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "acq_core.h"
+
+typedef struct
+{
+    acq_driver_t driver;
+    acq_pool_t pool;
+    acq_sample_t *storage;
+    SemaphoreHandle_t framesReady;
+    SemaphoreHandle_t exited; // given by the task as it leaves
+    TaskHandle_t task;
+    volatile bool running;
+    uint32_t timeouts; // driver fills that returned nothing
+} acquisition_t;
+
+// Allocates (frames + 1) x samplesPerFrame samples, starts the driver at
+// rateHz and the acquisition task.
+bool acqStart(acquisition_t *acq, const acq_driver_t *driver, uint32_t rateHz, uint8_t frames,
+              uint16_t samplesPerFrame, UBaseType_t priority, BaseType_t core);
+// Waits for the task to leave, then stops the driver and frees the frames.
+void acqStop(acquisition_t *acq);
+
+// The returned frame belongs to the caller until acqRelease().
+acq_frame_t *acqReceive(acquisition_t *acq, TickType_t timeout);
+void acqRelease(acquisition_t *acq, acq_frame_t *frame);
+
+void acqReport(const acquisition_t *acq);
+
+// ADC1 continuous-mode driver for the given channels (sampled round
+// robin). There is one ADC, so one driver at a time: a new one can be
+// set up once the previous one has been stopped.
+bool acqAdcDriver(acq_driver_t *driver, const uint8_t *channels, uint8_t channelCount, uint16_t samplesPerFrame);
@@ -0,0 +1,392 @@
+#include "active_object.h"
+
+#include <string.h>
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+
+static const char *TAG = "ActiveObject";
+
+// --- posting ---------------------------------------------------------------
+
+// Must be called with the dispatcher lock held
+static bool pushLocked(active_object_t *ao, uint16_t sig, uint32_t arg)
+{
+    if (ao->count == AO_QUEUE_DEPTH)
+    {
+        ao->dropped++;
+        return false;
+    }
+    ao_event_t *slot = &ao->queue[(ao->head + ao->count) % AO_QUEUE_DEPTH];
+    slot->sig = sig;
+    slot->arg = arg;
+    ao->count++;
+    if (ao->count > ao->maxQueued)
+        ao->maxQueued = ao->count;
+    ao->dispatcher->readyMask |= (1UL << ao->priority);
+    return true;
+}
+
+bool aoPost(active_object_t *ao, uint16_t sig, uint32_t arg)
+{
+    ao_dispatcher_t *d = ao->dispatcher;
+
+    portENTER_CRITICAL(&d->lock);
+    bool ok = pushLocked(ao, sig, arg);
+    portEXIT_CRITICAL(&d->lock);
+
+    if (ok && d->task != NULL && d->task != xTaskGetCurrentTaskHandle())
+        xTaskNotifyGive(d->task);
+    return ok;
+}
+
+bool aoPostFromISR(active_object_t *ao, uint16_t sig, uint32_t arg, BaseType_t *higherPriorityTaskWoken)
+{
+    ao_dispatcher_t *d = ao->dispatcher;
+
+    portENTER_CRITICAL_ISR(&d->lock);
+    bool ok = pushLocked(ao, sig, arg);
+    portEXIT_CRITICAL_ISR(&d->lock);
+
+    if (ok && d->task != NULL)
+        vTaskNotifyGiveFromISR(d->task, higherPriorityTaskWoken);
+    return ok;
+}
+
+// --- timers ----------------------------------------------------------------
+
+void aoTimerInit(ao_timer_t *t, active_object_t *target, uint16_t sig)
+{
+    ao_dispatcher_t *d = target->dispatcher;
+
+    memset(t, 0, sizeof(*t));
+    t->target = target;
+    t->sig = sig;
+
+    portENTER_CRITICAL(&d->lock);
+    t->next = d->timers;
+    d->timers = t;
+    portEXIT_CRITICAL(&d->lock);
+}
+
+void aoTimerArm(ao_timer_t *t, uint32_t delayMs, uint32_t periodMs)
+{
+    ao_dispatcher_t *d = t->target->dispatcher;
+
+    portENTER_CRITICAL(&d->lock);
+    t->deadline = xTaskGetTickCount() + pdMS_TO_TICKS(delayMs);
+    t->period = pdMS_TO_TICKS(periodMs);
+    if (periodMs > 0 && t->period == 0)
+        t->period = 1; // shorter than a tick still has to make progress
+    t->armed = true;
+    portEXIT_CRITICAL(&d->lock);
+
+    // Let the dispatcher recompute how long it may sleep
+    if (d->task != NULL && d->task != xTaskGetCurrentTaskHandle())
+        xTaskNotifyGive(d->task);
+}
+
+void aoTimerDisarm(ao_timer_t *t)
+{
+    ao_dispatcher_t *d = t->target->dispatcher;
+
+    portENTER_CRITICAL(&d->lock);
+    t->armed = false;
+    portEXIT_CRITICAL(&d->lock);
+}
+
+// Posts expired timers and returns the ticks until the next deadline.
+// Runs on the dispatcher task.
+static TickType_t processTimers(ao_dispatcher_t *d)
+{
+    TickType_t sleepTicks = portMAX_DELAY;
+
+    portENTER_CRITICAL(&d->lock);
+    TickType_t now = xTaskGetTickCount();
+    for (ao_timer_t *t = d->timers; t != NULL; t = t->next)
+    {
+        if (!t->armed)
+            continue;
+
+        TickType_t remaining = t->deadline - now;
+        if ((int32_t)remaining <= 0)
+        {
+            pushLocked(t->target, t->sig, now);
+            if (t->period == 0)
+            {
+                t->armed = false;
+                continue;
+            }
+            t->deadline += t->period;
+            if ((int32_t)(t->deadline - now) <= 0)
+                t->deadline = now + t->period; // fell behind; skip, don't burst
+            remaining = t->deadline - now;
+        }
+        if (remaining < sleepTicks)
+            sleepTicks = remaining;
+    }
+    portEXIT_CRITICAL(&d->lock);
+    return sleepTicks;
+}
+
+// --- dispatcher ------------------------------------------------------------
+
+void aoDispatcherInit(ao_dispatcher_t *d, const char *name)
+{
+    memset(d, 0, sizeof(*d));
+    d->name = name;
+    portMUX_INITIALIZE(&d->lock);
+}
+
+bool aoRegister(ao_dispatcher_t *d, active_object_t *ao)
+{
+    if (ao->priority >= AO_MAX_OBJECTS || ao->handler == NULL)
+    {
+        ESP_LOGE(TAG, "%s: priority must be 0..%d and handler set", ao->name, AO_MAX_OBJECTS - 1);
+        return false;
+    }
+
+    portENTER_CRITICAL(&d->lock);
+    bool available = (d->objects[ao->priority] == NULL);
+    if (available)
+    {
+        ao->dispatcher = d;
+        ao->head = 0;
+        ao->count = 0;
+        d->objects[ao->priority] = ao;
+    }
+    portEXIT_CRITICAL(&d->lock);
+
+    if (!available)
+    {
+        ESP_LOGE(TAG, "%s: priority %u already used on dispatcher %s", ao->name, ao->priority, d->name);
+        return false;
+    }
+    return aoPost(ao, AO_SIG_INIT, 0);
+}
+
+static void dispatcherTask(void *pvParameter)
+{
+    ao_dispatcher_t *d = (ao_dispatcher_t *)pvParameter;
+
+    while (1)
+    {
+        processTimers(d);
+
+        // Drain every ready event, always taking the most urgent object
+        while (1)
+        {
+            ao_event_t event;
+            active_object_t *ao = NULL;
+
+            portENTER_CRITICAL(&d->lock);
+            if (d->readyMask != 0)
+            {
+                uint8_t priority = 31 - __builtin_clz(d->readyMask);
+                ao = d->objects[priority];
+                event = ao->queue[ao->head];
+                ao->head = (ao->head + 1) % AO_QUEUE_DEPTH;
+                if (--ao->count == 0)
+                    d->readyMask &= ~(1UL << priority);
+            }
+            portEXIT_CRITICAL(&d->lock);
+
+            if (ao == NULL)
+                break;
+
+            ao->handler(ao, &event);
+            ao->dispatched++;
+            d->dispatched++;
+        }
+
+        // Handlers may have armed timers; only sleep if nothing is due
+        TickType_t sleepTicks = processTimers(d);
+        if (d->readyMask != 0)
+            continue;
+
+        d->wakeups++;
+        ulTaskNotifyTake(pdTRUE, sleepTicks);
+    }
+}
+
+bool aoDispatcherStart(ao_dispatcher_t *d, uint32_t stackSize, UBaseType_t taskPriority, BaseType_t core)
+{
+    if (xTaskCreatePinnedToCore(dispatcherTask, d->name, stackSize, d, taskPriority, &d->task, core) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create dispatcher %s", d->name);
+        return false;
+    }
+    return true;
+}
+
+void aoReport(const ao_dispatcher_t *d)
+{
+    ESP_LOGI(TAG, "========== Dispatcher %s ==========", d->name);
+    ESP_LOGI(TAG, "Events: %lu  Wakeups: %lu  Stack free: %u bytes",
+             (unsigned long)d->dispatched, (unsigned long)d->wakeups,
+             d->task != NULL ? (unsigned)uxTaskGetStackHighWaterMark(d->task) : 0);
+    for (int p = AO_MAX_OBJECTS - 1; p >= 0; p--)
+    {
+        const active_object_t *ao = d->objects[p];
+        if (ao == NULL)
+            continue;
+        ESP_LOGI(TAG, "  [%2d] %-16s dispatched=%lu dropped=%lu maxQueued=%u/%d",
+                 p, ao->name, (unsigned long)ao->dispatched, (unsigned long)ao->dropped,
+                 ao->maxQueued, AO_QUEUE_DEPTH);
+    }
+}
+
+// --- benchmark -------------------------------------------------------------
+//
+// Both designs handle the same thing: every round, each component gets one
+// event carrying the esp_timer time it was posted, and records the latency
+// until its handler ran.
+
+#define BENCH_MAX_COMPONENTS 16
+#define BENCH_TASK_STACK 2048
+#define BENCH_SIG_WORK AO_SIG_USER
+
+typedef struct
+{
+    uint64_t latencyUsSum;
+    uint32_t handled;
+    uint32_t wakeups;
+} bench_totals_t;
+
+static bench_totals_t g_bench;
+static portMUX_TYPE g_benchLock = portMUX_INITIALIZER_UNLOCKED;
+
+static void benchRecord(uint32_t postedUs)
+{
+    uint32_t latency = (uint32_t)esp_timer_get_time() - postedUs;
+    portENTER_CRITICAL(&g_benchLock);
+    g_bench.latencyUsSum += latency;
+    g_bench.handled++;
+    portEXIT_CRITICAL(&g_benchLock);
+}
+
+static void benchComponentTask(void *pvParameter)
+{
+    QueueHandle_t queue = (QueueHandle_t)pvParameter;
+    uint32_t postedUs = 0;
+
+    while (1)
+    {
+        if (uxQueueMessagesWaiting(queue) == 0)
+        {
+            portENTER_CRITICAL(&g_benchLock);
+            g_bench.wakeups++;
+            portEXIT_CRITICAL(&g_benchLock);
+        }
+        xQueueReceive(queue, &postedUs, portMAX_DELAY);
+        benchRecord(postedUs);
+    }
+}
+
+static void benchHandler(active_object_t *ao, const ao_event_t *event)
+{
+    (void)ao;
+    if (event->sig == BENCH_SIG_WORK)
+        benchRecord(event->arg);
+}
+
+static void logBench(const char *design, size_t heapUsed, uint32_t extraStackBytes)
+{
+    ESP_LOGI(TAG, "%-22s heap used %6u bytes (%u of it stacks), %.2f wakeups/event, %.1f us avg latency",
+             design, (unsigned)heapUsed, (unsigned)extraStackBytes,
+             g_bench.handled ? (float)g_bench.wakeups / g_bench.handled : 0.0f,
+             g_bench.handled ? (float)g_bench.latencyUsSum / g_bench.handled : 0.0f);
+}
+
+void aoBenchmark(uint8_t components, uint32_t rounds)
+{
+    if (components == 0 || components > BENCH_MAX_COMPONENTS)
+    {
+        ESP_LOGE(TAG, "Benchmark needs 1..%d components", BENCH_MAX_COMPONENTS);
+        return;
+    }
+
+    // The posting task must not be preempted by the components while it
+    // posts one round, otherwise neither design can batch anything.
+    UBaseType_t oldPriority = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, 10);
+
+    // --- task per component ---
+    TaskHandle_t tasks[BENCH_MAX_COMPONENTS] = {};
+    QueueHandle_t queues[BENCH_MAX_COMPONENTS] = {};
+    memset(&g_bench, 0, sizeof(g_bench));
+
+    size_t heapBefore = esp_get_free_heap_size();
+    for (uint8_t i = 0; i < components; i++)
+    {
+        queues[i] = xQueueCreate(AO_QUEUE_DEPTH, sizeof(uint32_t));
+        xTaskCreatePinnedToCore(benchComponentTask, "aoBenchTask", BENCH_TASK_STACK, queues[i], 5, &tasks[i], 0);
+    }
+    size_t heapUsed = heapBefore - esp_get_free_heap_size();
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+    g_bench.wakeups = 0;
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint8_t i = 0; i < components; i++)
+        {
+            uint32_t now = (uint32_t)esp_timer_get_time();
+            xQueueSend(queues[i], &now, 0);
+        }
+        vTaskDelay(1);
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+    logBench("task-per-component", heapUsed, components * BENCH_TASK_STACK);
+
+    for (uint8_t i = 0; i < components; i++)
+    {
+        vTaskDelete(tasks[i]);
+        vQueueDelete(queues[i]);
+    }
+
+    // --- active objects on one dispatcher ---
+    memset(&g_bench, 0, sizeof(g_bench));
+    heapBefore = esp_get_free_heap_size();
+    ao_dispatcher_t *d = (ao_dispatcher_t *)pvPortMalloc(sizeof(ao_dispatcher_t));
+    active_object_t *objects = (active_object_t *)pvPortMalloc(sizeof(active_object_t) * components);
+    if (d == NULL || objects == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate benchmark objects!");
+        vPortFree(d);
+        vPortFree(objects);
+        vTaskPrioritySet(NULL, oldPriority);
+        return;
+    }
+    aoDispatcherInit(d, "aoBench");
+    memset(objects, 0, sizeof(active_object_t) * components);
+    for (uint8_t i = 0; i < components; i++)
+    {
+        objects[i].name = "benchObject";
+        objects[i].handler = benchHandler;
+        objects[i].priority = i;
+        aoRegister(d, &objects[i]);
+    }
+    aoDispatcherStart(d, BENCH_TASK_STACK, 5, 0);
+    heapUsed = heapBefore - esp_get_free_heap_size();
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+    g_bench.wakeups = 0;
+    uint32_t wakeupsBefore = d->wakeups;
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint8_t i = 0; i < components; i++)
+        {
+            aoPost(&objects[i], BENCH_SIG_WORK, (uint32_t)esp_timer_get_time());
+        }
+        vTaskDelay(1);
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+    g_bench.wakeups = d->wakeups - wakeupsBefore;
+    logBench("active objects", heapUsed, BENCH_TASK_STACK);
+
+    vTaskDelete(d->task);
+    vPortFree(objects);
+    vPortFree(d);
+    vTaskPrioritySet(NULL, oldPriority);
+}
@@ -0,0 +1,124 @@
+/**
+ * Active-object runtime
+ *
+ * The Day 6-7 controller spends 2048 + 2048 + 4096 + 2048 bytes of stack
+ * on four tasks that are idle almost all the time. Here a component is an
+ * ACTIVE OBJECT instead of a task:
+ *
+ *   - an event-driven state machine: handler(obj, event) runs to
+ *     completion and returns, it never blocks or calls vTaskDelay
+ *   - its own small event ring (AO_QUEUE_DEPTH events, no FreeRTOS queue)
+ *   - a priority (0..31, unique within its dispatcher)
+ *
+ * One DISPATCHER task per core runs all of its objects: it always handles
+ * the next event of the highest-priority object that has one, then sleeps
+ * on a task notification when everything is idle. All objects share that
+ * one stack, and a burst of events for several objects costs one context
+ * switch instead of one per task.
+ *
+ * Periodic work (the old vTaskDelay loops) becomes an ao_timer_t that posts
+ * a signal to its object when it expires. Timers are kept by the dispatcher
+ * and checked whenever it wakes; it sleeps exactly until the next one is due.
+ *
+ * Typical conversion of a blink task:
+ *
+ *   static void blinkHandler(active_object_t *ao, const ao_event_t *e)
+ *   {
+ *       blink_t *self = (blink_t *)ao;   // active_object_t is the first member
+ *       if (e->sig == AO_SIG_INIT)        aoTimerArm(&self->timer, 0, self->delay_ms);
+ *       else if (e->sig == SIG_TOGGLE)    gpio_set_level(self->pin, self->on = !self->on);
+ *   }
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define AO_QUEUE_DEPTH 8 // events buffered per object
+#define AO_MAX_OBJECTS 32 // per dispatcher, one per priority level
+
+enum
+{
+    AO_SIG_INIT = 0, // posted once when the object is registered
+    AO_SIG_USER = 8  // first signal number free for components
+};
+
+typedef struct
+{
+    uint16_t sig;
+    uint32_t arg;
+} ao_event_t;
+
+typedef struct active_object active_object_t;
+typedef struct ao_dispatcher ao_dispatcher_t;
+typedef void (*ao_handler_t)(active_object_t *ao, const ao_event_t *event);
+
+struct active_object
+{
+    const char *name;
+    ao_handler_t handler;
+    uint8_t priority; // 31 = most urgent
+
+    // Owned by the runtime
+    ao_dispatcher_t *dispatcher;
+    ao_event_t queue[AO_QUEUE_DEPTH];
+    uint8_t head;
+    uint8_t count;
+    uint32_t dispatched;
+    uint32_t dropped; // posts rejected because the ring was full
+    uint8_t maxQueued;
+};
+
+typedef struct ao_timer
+{
+    active_object_t *target;
+    uint16_t sig;
+    TickType_t deadline;
+    TickType_t period; // 0 = one-shot
+    bool armed;
+    struct ao_timer *next;
+} ao_timer_t;
+
+struct ao_dispatcher
+{
+    const char *name;
+    TaskHandle_t task;
+    active_object_t *objects[AO_MAX_OBJECTS]; // indexed by priority
+    uint32_t readyMask;                       // bit n = objects[n] has events
+    ao_timer_t *timers;                       // armed and disarmed timers
+    portMUX_TYPE lock;
+
+    uint32_t wakeups; // times the dispatcher had to block and be woken
+    uint32_t dispatched;
+};
+
+// Initialises the dispatcher; call before registering objects.
+void aoDispatcherInit(ao_dispatcher_t *d, const char *name);
+
+// Starts the dispatcher task pinned to `core`. Returns false on failure.
+bool aoDispatcherStart(ao_dispatcher_t *d, uint32_t stackSize, UBaseType_t taskPriority, BaseType_t core);
+
+// Adds an object (name, handler and priority already set) and posts
+// AO_SIG_INIT to it. Fails if its priority is taken or out of range.
+bool aoRegister(ao_dispatcher_t *d, active_object_t *ao);
+
+// Queues an event. Never blocks; returns false if the object's ring is full.
+bool aoPost(active_object_t *ao, uint16_t sig, uint32_t arg);
+bool aoPostFromISR(active_object_t *ao, uint16_t sig, uint32_t arg, BaseType_t *higherPriorityTaskWoken);
+
+// Timers belong to the target's dispatcher. A delay of 0 fires on the
+// dispatcher's next pass; period 0 means one-shot.
+void aoTimerInit(ao_timer_t *t, active_object_t *target, uint16_t sig);
+void aoTimerArm(ao_timer_t *t, uint32_t delayMs, uint32_t periodMs);
+void aoTimerDisarm(ao_timer_t *t);
+
+// Logs per-object dispatch counts and the dispatcher's wakeups and stack.
+void aoReport(const ao_dispatcher_t *d);
+
+// Runs the same workload (components receiving periodic events) as
+// task-per-component and as active objects on one dispatcher, and logs
+// heap used, wakeups per event and post-to-handler latency for both.
+void aoBenchmark(uint8_t components, uint32_t rounds);
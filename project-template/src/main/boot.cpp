@@ -0,0 +1,431 @@
+#include "boot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "Boot";
+
+#define WORKER_STACK 4096 // inits may touch NVS, drivers, logging
+#define TIMELINE_WIDTH 40
+
+// One event bit per component, set when it stops running
+#if BOOT_MAX_COMPONENTS > 24
+#error "BOOT_MAX_COMPONENTS is limited by the 24 bits of an event group"
+#endif
+
+typedef struct
+{
+    const char *label;
+    int64_t us;
+} boot_mark_t;
+
+static boot_component_t *g_components[BOOT_MAX_COMPONENTS];
+static bool g_eager[BOOT_MAX_COMPONENTS];
+static uint8_t g_componentCount = 0;
+static bool g_resolved = false;
+
+static boot_mark_t g_marks[BOOT_MAX_MARKS];
+static uint8_t g_markCount = 0;
+
+static SemaphoreHandle_t g_bootLock = NULL;
+static EventGroupHandle_t g_finished = NULL;
+static SemaphoreHandle_t g_workersDone = NULL;
+static TaskHandle_t g_workers[portNUM_PROCESSORS];
+static uint8_t g_workerCount = 0;
+static int64_t g_runStartUs = 0;
+static int64_t g_runEndUs = 0;
+
+static int findComponent(const char *name)
+{
+    for (int i = 0; i < g_componentCount; i++)
+    {
+        if (strcmp(g_components[i]->name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+bool bootRegister(boot_component_t *component)
+{
+    if (g_bootLock == NULL)
+        g_bootLock = xSemaphoreCreateMutex();
+    if (g_finished == NULL)
+        g_finished = xEventGroupCreate();
+    if (g_bootLock == NULL || g_finished == NULL || g_componentCount == BOOT_MAX_COMPONENTS ||
+        findComponent(component->name) >= 0 || g_resolved)
+    {
+        ESP_LOGE(TAG, "Cannot register %s", component->name);
+        return false;
+    }
+    component->state = BOOT_PENDING;
+    component->core = -1;
+    g_components[g_componentCount++] = component;
+    return true;
+}
+
+// Depth-first walk from component i. A dependency already on the current
+// path closes a cycle: every component on it is skipped, so no worker or
+// bootEnsure() caller ever waits for one of them. Components that merely
+// depend on a cycle are skipped later, as after a failed dependency.
+static void findCycles(int i, uint8_t *visit, int8_t *path, int depth)
+{
+    visit[i] = 1; // on the path
+    path[depth] = (int8_t)i;
+    for (int d = 0; d < BOOT_MAX_DEPS && g_components[i]->depIndex[d] >= 0; d++)
+    {
+        int dep = g_components[i]->depIndex[d];
+        if (visit[dep] == 0)
+        {
+            findCycles(dep, visit, path, depth + 1);
+        }
+        else if (visit[dep] == 1)
+        {
+            for (int k = depth; k >= 0; k--)
+            {
+                boot_component_t *member = g_components[path[k]];
+                if (member->state != BOOT_SKIPPED)
+                {
+                    ESP_LOGE(TAG, "%s is part of a dependency cycle", member->name);
+                    member->state = BOOT_SKIPPED;
+                }
+                if (path[k] == dep)
+                    break;
+            }
+        }
+    }
+    visit[i] = 2; // done
+}
+
+// Turns dependency names into indices, skips dependency cycles and
+// promotes lazy components that an eager one needs
+static void resolveDependencies(void)
+{
+    for (int i = 0; i < g_componentCount; i++)
+    {
+        boot_component_t *c = g_components[i];
+        g_eager[i] = (c->mode == BOOT_EAGER);
+        for (int d = 0; d < BOOT_MAX_DEPS; d++)
+        {
+            c->depIndex[d] = -1;
+            if (c->deps[d] == NULL)
+                break;
+            c->depIndex[d] = (int8_t)findComponent(c->deps[d]);
+            if (c->depIndex[d] < 0)
+            {
+                ESP_LOGE(TAG, "%s needs unknown component %s", c->name, c->deps[d]);
+                c->state = BOOT_FAILED;
+            }
+        }
+    }
+
+    uint8_t visit[BOOT_MAX_COMPONENTS] = {};
+    int8_t path[BOOT_MAX_COMPONENTS];
+    for (int i = 0; i < g_componentCount; i++)
+    {
+        if (visit[i] == 0)
+            findCycles(i, visit, path, 0);
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < g_componentCount; i++)
+        {
+            if (!g_eager[i])
+                continue;
+            for (int d = 0; d < BOOT_MAX_DEPS && g_components[i]->depIndex[d] >= 0; d++)
+            {
+                int dep = g_components[i]->depIndex[d];
+                if (!g_eager[dep])
+                {
+                    g_eager[dep] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+    g_resolved = true;
+}
+
+static void wakeOtherWorkers(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int w = 0; w < g_workerCount; w++)
+    {
+        if (g_workers[w] != NULL && g_workers[w] != self)
+            xTaskNotifyGive(g_workers[w]);
+    }
+}
+
+// Leaves BOOT_RUNNING and wakes whoever waits for it: bootEnsure()
+// callers through its event bit, workers through their notification
+static void finish(int index, boot_state_t state)
+{
+    xSemaphoreTake(g_bootLock, portMAX_DELAY);
+    g_components[index]->state = state;
+    xSemaphoreGive(g_bootLock);
+    xEventGroupSetBits(g_finished, 1UL << index);
+    wakeOtherWorkers();
+}
+
+static void runInit(int index)
+{
+    boot_component_t *c = g_components[index];
+    c->core = (int8_t)xPortGetCoreID();
+    c->startUs = esp_timer_get_time();
+    bool ok = c->init == NULL || c->init();
+    c->endUs = esp_timer_get_time();
+
+    finish(index, ok ? BOOT_DONE : BOOT_FAILED);
+    if (!ok)
+        ESP_LOGE(TAG, "%s failed to initialise", c->name);
+}
+
+static void bootWorker(void *pvParameter)
+{
+    while (1)
+    {
+        int pick = -1;
+        bool anyPending = false;
+
+        xSemaphoreTake(g_bootLock, portMAX_DELAY);
+        for (int i = 0; i < g_componentCount; i++)
+        {
+            boot_component_t *c = g_components[i];
+            if (!g_eager[i])
+                continue;
+            if (c->state != BOOT_PENDING)
+                continue;
+
+            bool ready = true;
+            bool blocked = false;
+            for (int d = 0; d < BOOT_MAX_DEPS && c->depIndex[d] >= 0; d++)
+            {
+                boot_state_t depState = g_components[c->depIndex[d]]->state;
+                ready &= (depState == BOOT_DONE);
+                blocked |= (depState == BOOT_FAILED || depState == BOOT_SKIPPED);
+            }
+            if (blocked)
+            {
+                c->state = BOOT_SKIPPED;
+                continue;
+            }
+            anyPending = true;
+            if (ready && pick < 0)
+            {
+                pick = i;
+                c->state = BOOT_RUNNING;
+            }
+        }
+        xSemaphoreGive(g_bootLock);
+
+        if (pick >= 0)
+        {
+            runInit(pick);
+        }
+        else if (!anyPending)
+        {
+            break;
+        }
+        else
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+
+    wakeOtherWorkers();
+    xSemaphoreGive(g_workersDone);
+    vTaskDelete(NULL);
+}
+
+bool bootRun(void)
+{
+    if (g_bootLock == NULL)
+        g_bootLock = xSemaphoreCreateMutex();
+    if (g_finished == NULL)
+        g_finished = xEventGroupCreate();
+    g_workersDone = xSemaphoreCreateCounting(portNUM_PROCESSORS, 0);
+    if (g_bootLock == NULL || g_finished == NULL || g_workersDone == NULL)
+        return false;
+
+    g_runStartUs = esp_timer_get_time();
+    resolveDependencies();
+
+    // Workers are created suspended-by-lock so the handle array is
+    // complete before any of them wakes another
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+    xSemaphoreTake(g_bootLock, portMAX_DELAY);
+    g_workerCount = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        char name[12];
+        snprintf(name, sizeof(name), "boot%d", core);
+        if (xTaskCreatePinnedToCore(bootWorker, name, WORKER_STACK, NULL, priority, &g_workers[g_workerCount],
+                                    core) == pdPASS)
+            g_workerCount++;
+    }
+    xSemaphoreGive(g_bootLock);
+
+    for (int w = 0; w < g_workerCount; w++)
+    {
+        xSemaphoreTake(g_workersDone, portMAX_DELAY);
+    }
+    g_runEndUs = esp_timer_get_time();
+    memset(g_workers, 0, sizeof(g_workers));
+    vSemaphoreDelete(g_workersDone);
+    g_workersDone = NULL;
+
+    bool ok = g_workerCount > 0;
+    for (int i = 0; i < g_componentCount; i++)
+    {
+        if (g_eager[i] && g_components[i]->state != BOOT_DONE)
+            ok = false;
+    }
+    ESP_LOGI(TAG, "Eager init finished in %lu us on %u workers%s", (unsigned long)(g_runEndUs - g_runStartUs),
+             g_workerCount, ok ? "" : ", with failures");
+    return ok;
+}
+
+// Cycles were skipped by resolveDependencies(), so the recursion ends and
+// a component another caller is running always finishes
+static bool ensureIndex(int index)
+{
+    boot_component_t *c = g_components[index];
+
+    xSemaphoreTake(g_bootLock, portMAX_DELAY);
+    boot_state_t state = c->state;
+    if (state == BOOT_PENDING)
+        c->state = BOOT_RUNNING; // this caller runs it
+    xSemaphoreGive(g_bootLock);
+
+    if (state == BOOT_RUNNING)
+    {
+        // Someone else is running it: sleep until it is finished
+        xEventGroupWaitBits(g_finished, 1UL << index, pdFALSE, pdTRUE, portMAX_DELAY);
+        return c->state == BOOT_DONE;
+    }
+    if (state != BOOT_PENDING)
+        return state == BOOT_DONE;
+
+    for (int d = 0; d < BOOT_MAX_DEPS && c->depIndex[d] >= 0; d++)
+    {
+        if (!ensureIndex(c->depIndex[d]))
+        {
+            finish(index, BOOT_SKIPPED);
+            return false;
+        }
+    }
+    runInit(index);
+    return c->state == BOOT_DONE;
+}
+
+bool bootEnsure(const char *name)
+{
+    if (g_bootLock == NULL || g_finished == NULL)
+        return false;
+    xSemaphoreTake(g_bootLock, portMAX_DELAY);
+    if (!g_resolved)
+        resolveDependencies();
+    int index = findComponent(name);
+    xSemaphoreGive(g_bootLock);
+
+    if (index < 0)
+    {
+        ESP_LOGE(TAG, "No component %s", name);
+        return false;
+    }
+    return ensureIndex(index);
+}
+
+void bootMark(const char *label)
+{
+    int64_t now = esp_timer_get_time();
+    if (g_markCount < BOOT_MAX_MARKS)
+    {
+        g_marks[g_markCount].label = label;
+        g_marks[g_markCount].us = now;
+        g_markCount++;
+    }
+}
+
+static void timelineBar(char *bar, int64_t start, int64_t end, int64_t from, int64_t span)
+{
+    int a = (int)((start - from) * TIMELINE_WIDTH / span);
+    int b = (int)((end - from) * TIMELINE_WIDTH / span);
+    if (b <= a)
+        b = a + 1;
+    for (int i = 0; i < TIMELINE_WIDTH; i++)
+    {
+        bar[i] = (i >= a && i < b) ? '#' : '.';
+    }
+    bar[TIMELINE_WIDTH] = '\0';
+}
+
+void bootReport(void)
+{
+    // Timeline from app_main's bootRun() to the last event seen
+    int64_t from = g_runStartUs;
+    int64_t to = g_runEndUs;
+    for (int i = 0; i < g_componentCount; i++)
+    {
+        if (g_components[i]->endUs > to)
+            to = g_components[i]->endUs;
+    }
+    for (int m = 0; m < g_markCount; m++)
+    {
+        if (g_marks[m].us > to)
+            to = g_marks[m].us;
+    }
+    int64_t span = (to > from) ? to - from : 1;
+
+    ESP_LOGI(TAG, "Boot timeline, ms since power-on (bootRun at %.1f ms)", from / 1000.0);
+
+    // Printed in start order; never-started components last
+    bool printed[BOOT_MAX_COMPONENTS] = {};
+    int64_t serialUs = 0;
+    char bar[TIMELINE_WIDTH + 1];
+    for (int n = 0; n < g_componentCount; n++)
+    {
+        int next = -1;
+        for (int i = 0; i < g_componentCount; i++)
+        {
+            if (printed[i])
+                continue;
+            int64_t start = g_components[i]->startUs;
+            if (next < 0 || (start != 0 && (g_components[next]->startUs == 0 || start < g_components[next]->startUs)))
+                next = i;
+        }
+        printed[next] = true;
+
+        const boot_component_t *c = g_components[next];
+        if (c->startUs == 0)
+        {
+            ESP_LOGI(TAG, "  %-12s %s", c->name,
+                     c->state == BOOT_SKIPPED ? "skipped (dependency failed or circular)"
+                     : c->state == BOOT_FAILED ? "failed before start"
+                                               : "lazy, not started yet");
+            continue;
+        }
+        serialUs += c->endUs - c->startUs;
+        timelineBar(bar, c->startUs, c->endUs, from, span);
+        ESP_LOGI(TAG, "  %-12s %8.1f %8.1f %7.2f ms core %d %s%s", c->name, c->startUs / 1000.0, c->endUs / 1000.0,
+                 (c->endUs - c->startUs) / 1000.0, c->core, bar,
+                 c->state == BOOT_FAILED ? " FAILED" : (c->mode == BOOT_LAZY && !g_eager[next] ? " (lazy)" : ""));
+    }
+
+    for (int m = 0; m < g_markCount; m++)
+    {
+        timelineBar(bar, g_marks[m].us, g_marks[m].us, from, span);
+        ESP_LOGI(TAG, "  * %-20s %8.1f ms                %s", g_marks[m].label, g_marks[m].us / 1000.0, bar);
+    }
+    if (g_runEndUs > g_runStartUs)
+        ESP_LOGI(TAG, "Eager init %.2f ms wall, %.2f ms of init work", (g_runEndUs - g_runStartUs) / 1000.0,
+                 serialUs / 1000.0);
+}
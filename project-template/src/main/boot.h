@@ -0,0 +1,90 @@
+/**
+ * Boot sequencer with dependencies, parallel init and a timeline
+ *
+ * app_main in the exercises creates queues, mutexes, resets GPIO pins and
+ * starts tasks strictly one after another, and nothing says how long any
+ * of it took. Here each component declares its init function and the
+ * components it needs:
+ *
+ *   BOOT_COMPONENT(g_bootLeds, "leds", ledsInit, BOOT_EAGER, "gpio");
+ *   BOOT_COMPONENT(g_bootHistory, "history", historyStart, BOOT_LAZY, "settings");
+ *   bootRegister(&g_bootLeds);  bootRegister(&g_bootHistory);  ...
+ *   bootRun();
+ *
+ * bootRun() starts one worker per core. Each worker takes any eager
+ * component whose dependencies are done, so independent inits run on
+ * both cores at once. A component whose dependency failed is skipped.
+ * Lazy components (status reporting, history, storage...) are left alone
+ * until the first bootEnsure() call, which runs them and their
+ * dependencies in the caller. A lazy component needed by an eager one is
+ * started eagerly. Components on a dependency cycle are found before
+ * anything runs and skipped, together with everything that needs them.
+ *
+ * Every init is timestamped (esp_timer, us since boot) together with any
+ * bootMark("first LED output") milestones. bootReport() prints the
+ * timeline with one bar per component, so time-to-first-useful-work can
+ * be compared across releases.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BOOT_MAX_COMPONENTS 24
+#define BOOT_MAX_DEPS 4
+#define BOOT_MAX_MARKS 8
+
+typedef bool (*boot_init_fn_t)(void);
+
+typedef enum
+{
+    BOOT_EAGER = 0,
+    BOOT_LAZY
+} boot_mode_t;
+
+typedef enum
+{
+    BOOT_PENDING = 0,
+    BOOT_RUNNING,
+    BOOT_DONE,
+    BOOT_FAILED,
+    BOOT_SKIPPED // a dependency failed
+} boot_state_t;
+
+typedef struct
+{
+    const char *name;
+    boot_init_fn_t init;
+    boot_mode_t mode;
+    const char *deps[BOOT_MAX_DEPS + 1]; // NULL terminated
+
+    // Filled in by the sequencer
+    volatile boot_state_t state;
+    int8_t depIndex[BOOT_MAX_DEPS];
+    int8_t core;
+    int64_t startUs;
+    int64_t endUs;
+} boot_component_t;
+
+#define BOOT_COMPONENT(var, name, init, mode, ...) \
+    boot_component_t var = {name, init, mode, {__VA_ARGS__}, BOOT_PENDING, {}, -1, 0, 0}
+
+bool bootRegister(boot_component_t *component);
+
+// Runs every eager component. Returns false if any failed, was skipped or
+// has a missing or circular dependency.
+bool bootRun(void);
+
+// Runs a lazy component (and its dependencies) on first use. Returns
+// true if it is up, false if it or a dependency failed or is on a
+// dependency cycle. Safe to call from any task, any number of times; a
+// caller that finds the component being started by another sleeps until
+// it is finished.
+bool bootEnsure(const char *name);
+
+// Records a named milestone on the timeline.
+void bootMark(const char *label);
+
+// Logs the boot timeline.
+void bootReport(void);
@@ -0,0 +1,406 @@
+#include "coro_runtime.h"
+
+#include <string.h>
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+
+static const char *TAG = "Coro";
+
+// --- frame pool ------------------------------------------------------------
+
+typedef union frame_block
+{
+    union frame_block *next; // while free
+    alignas(16) uint8_t bytes[CORO_FRAME_SIZE];
+} frame_block_t;
+
+static frame_block_t g_frames[CORO_POOL_SIZE];
+static frame_block_t *g_freeFrames = NULL;
+static bool g_poolReady = false;
+
+static uint16_t g_framesInUse = 0;
+static uint16_t g_framesPeak = 0;
+static uint32_t g_allocFailures = 0;
+static size_t g_largestFrame = 0;
+static size_t g_frameBytesTotal = 0; // sum of requested sizes, for the average
+static uint32_t g_framesAllocated = 0;
+
+// One lock for the pool, the ready list and every CoroChannel. All holds
+// are a few pointer updates.
+static portMUX_TYPE g_coroLock = portMUX_INITIALIZER_UNLOCKED;
+
+portMUX_TYPE *coroLock(void)
+{
+    return &g_coroLock;
+}
+
+void *coroFrameAlloc(size_t size)
+{
+    void *frame = NULL;
+
+    portENTER_CRITICAL_SAFE(&g_coroLock);
+    if (!g_poolReady)
+    {
+        for (int i = CORO_POOL_SIZE - 1; i >= 0; i--)
+        {
+            g_frames[i].next = g_freeFrames;
+            g_freeFrames = &g_frames[i];
+        }
+        g_poolReady = true;
+    }
+    if (size <= CORO_FRAME_SIZE && g_freeFrames != NULL)
+    {
+        frame = g_freeFrames;
+        g_freeFrames = g_freeFrames->next;
+        if (++g_framesInUse > g_framesPeak)
+            g_framesPeak = g_framesInUse;
+        g_frameBytesTotal += size;
+        g_framesAllocated++;
+    }
+    else
+    {
+        g_allocFailures++;
+    }
+    if (size > g_largestFrame)
+        g_largestFrame = size;
+    portEXIT_CRITICAL_SAFE(&g_coroLock);
+
+    return frame;
+}
+
+void coroFrameFree(void *frame)
+{
+    frame_block_t *block = (frame_block_t *)frame;
+
+    portENTER_CRITICAL_SAFE(&g_coroLock);
+    block->next = g_freeFrames;
+    g_freeFrames = block;
+    g_framesInUse--;
+    portEXIT_CRITICAL_SAFE(&g_coroLock);
+}
+
+// --- scheduler -------------------------------------------------------------
+
+static TaskHandle_t g_schedulerTask = NULL;
+
+// Ready FIFO, guarded by g_coroLock
+static CoroNode *g_readyHead = NULL;
+static CoroNode *g_readyTail = NULL;
+
+// Sleepers, min-heap on wakeTick. Only touched by the scheduler task.
+static CoroNode *g_sleepers[CORO_POOL_SIZE];
+static uint16_t g_sleeperCount = 0;
+
+static uint32_t g_resumes = 0;
+static uint32_t g_schedulerWakeups = 0;
+
+static inline bool tickBefore(TickType_t a, TickType_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+void coroMakeReadyLocked(CoroNode *node)
+{
+    node->next = NULL;
+    if (g_readyTail != NULL)
+        g_readyTail->next = node;
+    else
+        g_readyHead = node;
+    g_readyTail = node;
+}
+
+void coroWakeScheduler(void)
+{
+    if (g_schedulerTask == NULL)
+        return;
+
+    if (xPortInIsrContext())
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(g_schedulerTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+    else if (xTaskGetCurrentTaskHandle() != g_schedulerTask)
+    {
+        xTaskNotifyGive(g_schedulerTask);
+    }
+}
+
+static void sleeperPush(CoroNode *node)
+{
+    uint16_t i = g_sleeperCount++;
+    while (i > 0)
+    {
+        uint16_t parent = (i - 1) / 2;
+        if (!tickBefore(node->wakeTick, g_sleepers[parent]->wakeTick))
+            break;
+        g_sleepers[i] = g_sleepers[parent];
+        i = parent;
+    }
+    g_sleepers[i] = node;
+}
+
+static CoroNode *sleeperPop(void)
+{
+    CoroNode *top = g_sleepers[0];
+    CoroNode *last = g_sleepers[--g_sleeperCount];
+    uint16_t i = 0;
+
+    while (1)
+    {
+        uint16_t child = 2 * i + 1;
+        if (child >= g_sleeperCount)
+            break;
+        if (child + 1 < g_sleeperCount && tickBefore(g_sleepers[child + 1]->wakeTick, g_sleepers[child]->wakeTick))
+            child++;
+        if (!tickBefore(g_sleepers[child]->wakeTick, last->wakeTick))
+            break;
+        g_sleepers[i] = g_sleepers[child];
+        i = child;
+    }
+    if (g_sleeperCount > 0)
+        g_sleepers[i] = last;
+    return top;
+}
+
+void coroSuspendFor(CoroNode *node, TickType_t ticks)
+{
+    if (ticks == 0)
+    {
+        portENTER_CRITICAL(&g_coroLock);
+        coroMakeReadyLocked(node);
+        portEXIT_CRITICAL(&g_coroLock);
+        return;
+    }
+    node->wakeTick = xTaskGetTickCount() + ticks;
+    sleeperPush(node);
+}
+
+bool coroSpawn(CoroTask task)
+{
+    if (!task.valid())
+    {
+        ESP_LOGE(TAG, "Coroutine frame not allocated (pool empty or frame > %d bytes)", CORO_FRAME_SIZE);
+        return false;
+    }
+
+    CoroTask::handle_t handle = task.release();
+    CoroNode *node = &handle.promise().node;
+    node->handle = handle;
+
+    portENTER_CRITICAL(&g_coroLock);
+    coroMakeReadyLocked(node);
+    portEXIT_CRITICAL(&g_coroLock);
+    coroWakeScheduler();
+    return true;
+}
+
+static void schedulerTask(void *pvParameter)
+{
+    (void)pvParameter;
+
+    while (1)
+    {
+        TickType_t now = xTaskGetTickCount();
+        while (g_sleeperCount > 0 && !tickBefore(now, g_sleepers[0]->wakeTick))
+        {
+            CoroNode *node = sleeperPop();
+            portENTER_CRITICAL(&g_coroLock);
+            coroMakeReadyLocked(node);
+            portEXIT_CRITICAL(&g_coroLock);
+        }
+
+        // Take the current ready list in one go so coroutines that yield
+        // again go to the back of the NEXT pass
+        portENTER_CRITICAL(&g_coroLock);
+        CoroNode *list = g_readyHead;
+        g_readyHead = NULL;
+        g_readyTail = NULL;
+        portEXIT_CRITICAL(&g_coroLock);
+
+        while (list != NULL)
+        {
+            // Read next first: a coroutine that finishes frees its node
+            CoroNode *next = list->next;
+            g_resumes++;
+            list->handle.resume();
+            list = next;
+        }
+
+        portENTER_CRITICAL(&g_coroLock);
+        bool ready = (g_readyHead != NULL);
+        portEXIT_CRITICAL(&g_coroLock);
+        if (ready)
+            continue;
+
+        TickType_t sleepTicks = portMAX_DELAY;
+        if (g_sleeperCount > 0)
+        {
+            TickType_t remaining = g_sleepers[0]->wakeTick - xTaskGetTickCount();
+            if ((int32_t)remaining <= 0)
+                continue;
+            sleepTicks = remaining;
+        }
+        g_schedulerWakeups++;
+        ulTaskNotifyTake(pdTRUE, sleepTicks);
+    }
+}
+
+bool coroSchedulerStart(uint32_t stackSize, UBaseType_t priority, BaseType_t core)
+{
+    if (g_schedulerTask != NULL)
+        return true;
+    if (xTaskCreatePinnedToCore(schedulerTask, "coroSched", stackSize, NULL, priority, &g_schedulerTask, core) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create coroutine scheduler task");
+        return false;
+    }
+    return true;
+}
+
+void coroReport(void)
+{
+    ESP_LOGI(TAG, "========== Coroutine runtime ==========");
+    ESP_LOGI(TAG, "Frames: %u in use, peak %u of %d (%d bytes each), %lu alloc failures",
+             g_framesInUse, g_framesPeak, CORO_POOL_SIZE, CORO_FRAME_SIZE, (unsigned long)g_allocFailures);
+    ESP_LOGI(TAG, "Frame size: largest %u bytes, average %u bytes",
+             (unsigned)g_largestFrame, g_framesAllocated ? (unsigned)(g_frameBytesTotal / g_framesAllocated) : 0);
+    ESP_LOGI(TAG, "Resumes: %lu  Scheduler wakeups: %lu  Sleeping: %u",
+             (unsigned long)g_resumes, (unsigned long)g_schedulerWakeups, g_sleeperCount);
+    if (g_schedulerTask != NULL)
+        ESP_LOGI(TAG, "Scheduler stack free: %u bytes", (unsigned)uxTaskGetStackHighWaterMark(g_schedulerTask));
+}
+
+// --- benchmark -------------------------------------------------------------
+
+#define BENCH_TASK_STACK 2048
+
+static SemaphoreHandle_t g_benchDone = NULL;
+
+// The blinkTask shape without the GPIO: a few sleeps, then finish
+static CoroTask benchSleeper(uint32_t delayMs)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        co_await coroSleepFor(delayMs);
+    }
+}
+
+static void benchSleeperTask(void *pvParameter)
+{
+    (void)pvParameter;
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+}
+
+static CoroChannel<uint32_t, 1> g_ping;
+static CoroChannel<uint32_t, 1> g_pong;
+
+static CoroTask benchPinger(uint32_t switches)
+{
+    for (uint32_t i = 0; i < switches; i++)
+    {
+        g_ping.send(i);
+        co_await g_pong.receive();
+    }
+    xSemaphoreGive(g_benchDone);
+}
+
+static CoroTask benchPonger(uint32_t switches)
+{
+    for (uint32_t i = 0; i < switches; i++)
+    {
+        uint32_t value = co_await g_ping.receive();
+        g_pong.send(value);
+    }
+}
+
+static TaskHandle_t g_nativePeer = NULL;
+static TaskHandle_t g_nativeMain = NULL;
+static uint32_t g_nativeSwitches = 0;
+
+static void nativePongTask(void *pvParameter)
+{
+    (void)pvParameter;
+    for (uint32_t i = 0; i < g_nativeSwitches; i++)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xTaskNotifyGive(g_nativeMain);
+    }
+    vTaskDelete(NULL);
+}
+
+void coroBenchmark(uint16_t activities, uint32_t switches)
+{
+    if (g_schedulerTask == NULL)
+    {
+        ESP_LOGE(TAG, "Start the scheduler before benchmarking");
+        return;
+    }
+    if (g_benchDone == NULL)
+        g_benchDone = xSemaphoreCreateBinary();
+
+    // --- RAM per activity ---
+    TaskHandle_t *tasks = (TaskHandle_t *)pvPortMalloc(sizeof(TaskHandle_t) * activities);
+    if (tasks == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate task handle array!");
+        return;
+    }
+    size_t heapBefore = esp_get_free_heap_size();
+    uint16_t created = 0;
+    for (; created < activities; created++)
+    {
+        if (xTaskCreate(benchSleeperTask, "coroBench", BENCH_TASK_STACK, NULL, 1, &tasks[created]) != pdPASS)
+            break;
+    }
+    size_t taskBytes = heapBefore - esp_get_free_heap_size();
+    for (uint16_t i = 0; i < created; i++)
+    {
+        vTaskDelete(tasks[i]);
+    }
+    vPortFree(tasks);
+
+    uint32_t allocatedBefore = g_framesAllocated;
+    size_t bytesBefore = g_frameBytesTotal;
+    uint16_t spawned = 0;
+    for (uint16_t i = 0; i < activities; i++)
+    {
+        if (coroSpawn(benchSleeper(10)))
+            spawned++;
+    }
+    uint32_t frames = g_framesAllocated - allocatedBefore;
+    size_t frameBytes = frames ? (g_frameBytesTotal - bytesBefore) / frames : 0;
+
+    ESP_LOGI(TAG, "RAM per activity: native task %u bytes (%u tasks created), coroutine frame %u bytes (%u spawned, %d-byte pool blocks)",
+             created ? (unsigned)(taskBytes / created) : 0, created, (unsigned)frameBytes, spawned, CORO_FRAME_SIZE);
+    vTaskDelay(pdMS_TO_TICKS(100)); // let the sleepers finish and free their frames
+
+    // --- switch cost: two coroutines ping-ponging through channels ---
+    int64_t start = esp_timer_get_time();
+    coroSpawn(benchPonger(switches));
+    coroSpawn(benchPinger(switches));
+    xSemaphoreTake(g_benchDone, portMAX_DELAY);
+    int64_t coroUs = esp_timer_get_time() - start;
+
+    // --- same ping-pong between two native tasks on one core ---
+    g_nativeMain = xTaskGetCurrentTaskHandle();
+    g_nativeSwitches = switches;
+    xTaskCreatePinnedToCore(nativePongTask, "coroBenchPong", BENCH_TASK_STACK, NULL, uxTaskPriorityGet(NULL), &g_nativePeer,
+                            xTaskGetCoreID(NULL));
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < switches; i++)
+    {
+        xTaskNotifyGive(g_nativePeer);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    int64_t nativeUs = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "Switch cost: coroutine %.2f us, native task %.2f us (%lu round trips)",
+             switches ? coroUs / (2.0 * switches) : 0.0, switches ? nativeUs / (2.0 * switches) : 0.0,
+             (unsigned long)switches);
+}
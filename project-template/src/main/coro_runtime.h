@@ -0,0 +1,218 @@
+/**
+ * C++20 coroutine runtime on one FreeRTOS task
+ *
+ * blinkTask in Day 2 costs a whole FreeRTOS task and a 2048-byte stack just
+ * to toggle a pin and sleep. Written as a coroutine it keeps the same shape:
+ *
+ *   CoroTask blink(gpio_num_t pin, uint32_t delay_ms)
+ *   {
+ *       while (1)
+ *       {
+ *           gpio_set_level(pin, 1);
+ *           co_await coroSleepFor(delay_ms);
+ *           gpio_set_level(pin, 0);
+ *           co_await coroSleepFor(delay_ms);
+ *       }
+ *   }
+ *
+ *   coroSchedulerStart(4096, 5, 0);
+ *   coroSpawn(blink(GPIO_NUM_2, 200));
+ *
+ * but every co_await only saves the coroutine's live locals into its frame
+ * (typically tens of bytes) and returns to the scheduler task, which runs
+ * hundreds of such activities on its single stack.
+ *
+ * Rules:
+ *   - Never call vTaskDelay / blocking FreeRTOS calls inside a coroutine;
+ *     that blocks every activity. Use co_await coroSleepFor() and
+ *     co_await channel.receive() instead.
+ *   - Frames come from a fixed pool of CORO_POOL_SIZE blocks of
+ *     CORO_FRAME_SIZE bytes, never the heap. If the pool is empty or a
+ *     frame is too big, the CoroTask is invalid and coroSpawn() returns
+ *     false.
+ *   - A coroutine's frame is freed when it returns (co_return / end).
+ *
+ * Needs -std=gnu++20 or later (the ESP-IDF 5.x default).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <coroutine>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define CORO_POOL_SIZE 128  // coroutine frames available
+#define CORO_FRAME_SIZE 192 // bytes per frame block
+
+// --- frame pool / scheduler internals (see coro_runtime.cpp) ---------------
+
+struct CoroNode
+{
+    std::coroutine_handle<> handle;
+    TickType_t wakeTick;
+    CoroNode *next;
+};
+
+void *coroFrameAlloc(size_t size);
+void coroFrameFree(void *frame);
+
+portMUX_TYPE *coroLock(void);
+
+// Must be called with coroLock() held; follow with coroWakeScheduler()
+// once the lock is released.
+void coroMakeReadyLocked(CoroNode *node);
+void coroWakeScheduler(void);
+
+// Called from the scheduler task only (inside await_suspend).
+void coroSuspendFor(CoroNode *node, TickType_t ticks);
+
+// --- coroutine type --------------------------------------------------------
+
+class CoroTask
+{
+public:
+    struct promise_type
+    {
+        CoroNode node = {};
+
+        static void *operator new(size_t size) noexcept { return coroFrameAlloc(size); }
+        static void operator delete(void *frame) noexcept { coroFrameFree(frame); }
+        static CoroTask get_return_object_on_allocation_failure() noexcept { return CoroTask(nullptr); }
+
+        CoroTask get_return_object() noexcept
+        {
+            return CoroTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; } // runs once spawned
+        std::suspend_never final_suspend() noexcept { return {}; }    // frame freed on return
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    explicit CoroTask(handle_t handle) : m_handle(handle) {}
+    CoroTask(CoroTask &&other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+    CoroTask(const CoroTask &) = delete;
+    CoroTask &operator=(const CoroTask &) = delete;
+    ~CoroTask()
+    {
+        // Never spawned: nobody else will ever resume it
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    bool valid() const { return (bool)m_handle; }
+    handle_t release()
+    {
+        handle_t handle = m_handle;
+        m_handle = nullptr;
+        return handle;
+    }
+
+private:
+    handle_t m_handle;
+};
+
+// Queues a coroutine on the scheduler. Callable from any task.
+bool coroSpawn(CoroTask task);
+
+// Starts the scheduler task that runs every spawned coroutine.
+bool coroSchedulerStart(uint32_t stackSize, UBaseType_t priority, BaseType_t core);
+
+// --- awaitables ------------------------------------------------------------
+
+struct CoroSleepAwaiter
+{
+    TickType_t ticks;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(CoroTask::handle_t h) noexcept { coroSuspendFor(&h.promise().node, ticks); }
+    void await_resume() const noexcept {}
+};
+
+// co_await coroSleepFor(ms) - the coroutine form of vTaskDelay
+inline CoroSleepAwaiter coroSleepFor(uint32_t ms) { return CoroSleepAwaiter{pdMS_TO_TICKS(ms)}; }
+
+// co_await coroYield() - let every other ready coroutine run first
+inline CoroSleepAwaiter coroYield() { return CoroSleepAwaiter{0}; }
+
+// Fixed-size channel with one coroutine receiver and any number of senders
+// (coroutines, tasks or ISRs). Replaces xQueueReceive inside coroutines.
+template <typename T, size_t N>
+class CoroChannel
+{
+public:
+    // Non-blocking; returns false if the channel is full.
+    bool send(const T &item)
+    {
+        bool woke = false;
+        portENTER_CRITICAL_SAFE(coroLock());
+        bool ok = pushLocked(item, &woke);
+        portEXIT_CRITICAL_SAFE(coroLock());
+        if (woke)
+            coroWakeScheduler();
+        return ok;
+    }
+
+    struct ReceiveAwaiter
+    {
+        CoroChannel *channel;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(CoroTask::handle_t h) noexcept
+        {
+            portENTER_CRITICAL(coroLock());
+            bool wait = (channel->m_count == 0);
+            if (wait)
+                channel->m_waiter = &h.promise().node;
+            portEXIT_CRITICAL(coroLock());
+            return wait;
+        }
+        T await_resume() noexcept
+        {
+            portENTER_CRITICAL(coroLock());
+            T item = channel->m_items[channel->m_head];
+            channel->m_head = (channel->m_head + 1) % N;
+            channel->m_count--;
+            portEXIT_CRITICAL(coroLock());
+            return item;
+        }
+    };
+
+    // co_await channel.receive() - only one coroutine may wait at a time
+    ReceiveAwaiter receive() { return ReceiveAwaiter{this}; }
+
+    size_t count() const { return m_count; }
+
+private:
+    bool pushLocked(const T &item, bool *woke)
+    {
+        if (m_count == N)
+            return false;
+        m_items[(m_head + m_count) % N] = item;
+        m_count++;
+        if (m_waiter != nullptr)
+        {
+            coroMakeReadyLocked(m_waiter);
+            m_waiter = nullptr;
+            *woke = true;
+        }
+        return true;
+    }
+
+    T m_items[N] = {};
+    size_t m_head = 0;
+    size_t m_count = 0;
+    CoroNode *m_waiter = nullptr;
+};
+
+// Logs pool usage and scheduler counters.
+void coroReport(void);
+
+// Compares RAM per activity and switch cost of `activities` coroutines
+// against the same number of native tasks. The scheduler must be running.
+void coroBenchmark(uint16_t activities, uint32_t switches);
@@ -0,0 +1,267 @@
+#include "edf.h"
+
+#include <string.h>
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "EDF";
+
+#define EVENT_QUEUE_DEPTH 16
+
+typedef enum
+{
+    EDF_EV_ATTACH = 0,
+    EDF_EV_RELEASE,
+    EDF_EV_DONE,
+    EDF_EV_TIMER
+} edf_event_type_t;
+
+typedef struct
+{
+    edf_event_type_t type;
+    edf_task_t *task;
+    int64_t timeUs;
+} edf_event_t;
+
+static edf_task_t *g_tasks[EDF_MAX_TASKS];
+static uint8_t g_taskCount = 0;
+static QueueHandle_t g_events = NULL;
+static esp_timer_handle_t g_releaseTimer = NULL;
+
+static inline int64_t absoluteDeadline(const edf_task_t *t)
+{
+    return t->releases[t->head] + t->deadlineUs;
+}
+
+static void pushRelease(edf_task_t *t, int64_t releaseUs, uint32_t *notifyMask, int index)
+{
+    if (t->pending == EDF_MAX_BACKLOG)
+    {
+        t->stats.dropped++;
+        return;
+    }
+    t->releases[(t->head + t->pending) % EDF_MAX_BACKLOG] = releaseUs;
+    t->pending++;
+    *notifyMask |= 1u << index;
+}
+
+static void completeJob(edf_task_t *t, int64_t doneUs)
+{
+    if (t->pending == 0)
+        return; // edfJobDone without a job
+
+    int64_t release = t->releases[t->head];
+    uint32_t response = (uint32_t)(doneUs - release);
+    int32_t slack = (int32_t)(release + t->deadlineUs - doneUs);
+    edf_stats_t *s = &t->stats;
+    if (s->jobs == 0 || response < s->responseMinUs)
+        s->responseMinUs = response;
+    if (response > s->responseMaxUs)
+        s->responseMaxUs = response;
+    if (s->jobs == 0 || slack < s->slackMinUs)
+        s->slackMinUs = slack;
+    s->responseTotalUs += response;
+    s->jobs++;
+    if (slack < 0)
+        s->misses++;
+
+    t->head = (t->head + 1) % EDF_MAX_BACKLOG;
+    t->pending--;
+}
+
+// Earliest absolute deadline gets EDF_PRIORITY_TOP, the next one below,
+// idle tasks the base
+static void assignPriorities(void)
+{
+    edf_task_t *order[EDF_MAX_TASKS];
+    int active = 0;
+    for (int i = 0; i < g_taskCount; i++)
+    {
+        edf_task_t *t = g_tasks[i];
+        if (t->pending == 0)
+            continue;
+        int j = active++;
+        while (j > 0 && absoluteDeadline(order[j - 1]) > absoluteDeadline(t))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = t;
+    }
+
+    for (int i = 0; i < g_taskCount; i++)
+    {
+        edf_task_t *t = g_tasks[i];
+        UBaseType_t priority = EDF_PRIORITY_BASE;
+        for (int rank = 0; rank < active; rank++)
+        {
+            if (order[rank] == t)
+            {
+                int p = EDF_PRIORITY_TOP - rank;
+                priority = p > EDF_PRIORITY_BASE ? p : EDF_PRIORITY_BASE + 1;
+                break;
+            }
+        }
+        if (priority != t->priority)
+        {
+            vTaskPrioritySet(t->handle, priority);
+            t->priority = priority;
+        }
+    }
+}
+
+static void armReleaseTimer(int64_t now)
+{
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < g_taskCount; i++)
+    {
+        if (g_tasks[i]->periodUs > 0 && g_tasks[i]->nextReleaseUs < next)
+            next = g_tasks[i]->nextReleaseUs;
+    }
+    esp_timer_stop(g_releaseTimer);
+    if (next != INT64_MAX)
+        esp_timer_start_once(g_releaseTimer, next > now ? (uint64_t)(next - now) : 1);
+}
+
+static void releaseTimerCallback(void *arg)
+{
+    edf_event_t event = {EDF_EV_TIMER, NULL, 0};
+    xQueueSend(g_events, &event, 0);
+}
+
+static void edfSchedulerTask(void *pvParameter)
+{
+    edf_event_t event;
+    while (1)
+    {
+        xQueueReceive(g_events, &event, portMAX_DELAY);
+
+        uint32_t notifyMask = 0;
+        do
+        {
+            edf_task_t *t = event.task;
+            int index = -1;
+            for (int i = 0; i < g_taskCount; i++)
+            {
+                if (g_tasks[i] == t)
+                    index = i;
+            }
+
+            if (event.type == EDF_EV_ATTACH && index < 0 && g_taskCount < EDF_MAX_TASKS)
+            {
+                g_tasks[g_taskCount++] = t;
+                t->priority = EDF_PRIORITY_BASE;
+                vTaskPrioritySet(t->handle, EDF_PRIORITY_BASE);
+                t->nextReleaseUs = event.timeUs;
+            }
+            else if (event.type == EDF_EV_RELEASE && index >= 0)
+            {
+                pushRelease(t, event.timeUs, &notifyMask, index);
+            }
+            else if (event.type == EDF_EV_DONE && index >= 0)
+            {
+                completeJob(t, event.timeUs);
+            }
+        } while (xQueueReceive(g_events, &event, 0) == pdTRUE);
+
+        // Periodic releases that are due, catching up if we fell behind
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < g_taskCount; i++)
+        {
+            edf_task_t *t = g_tasks[i];
+            while (t->periodUs > 0 && t->nextReleaseUs <= now)
+            {
+                pushRelease(t, t->nextReleaseUs, &notifyMask, i);
+                t->nextReleaseUs += t->periodUs;
+            }
+        }
+
+        // Priorities first, so a released task wakes at the right level
+        assignPriorities();
+        for (int i = 0; i < g_taskCount; i++)
+        {
+            if (notifyMask & (1u << i))
+                xTaskNotifyGive(g_tasks[i]->handle);
+        }
+        armReleaseTimer(now);
+    }
+}
+
+bool edfStart(void)
+{
+    if (g_events != NULL)
+        return true;
+    g_events = xQueueCreate(EVENT_QUEUE_DEPTH, sizeof(edf_event_t));
+    if (g_events == NULL)
+        return false;
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = releaseTimerCallback;
+    timerArgs.name = "edfRelease";
+    if (esp_timer_create(&timerArgs, &g_releaseTimer) != ESP_OK)
+        return false;
+
+    return xTaskCreate(edfSchedulerTask, "edfScheduler", 3072, NULL, EDF_PRIORITY_TOP + 1, NULL) == pdPASS;
+}
+
+void edfTaskInit(edf_task_t *task, const char *name, uint32_t periodMs, uint32_t deadlineMs)
+{
+    memset(task, 0, sizeof(*task));
+    task->name = name;
+    task->periodUs = periodMs * 1000;
+    task->deadlineUs = deadlineMs * 1000;
+}
+
+bool edfAttach(edf_task_t *task)
+{
+    if (g_events == NULL)
+    {
+        ESP_LOGE(TAG, "edfStart() has not been called");
+        return false;
+    }
+    task->handle = xTaskGetCurrentTaskHandle();
+    edf_event_t event = {EDF_EV_ATTACH, task, esp_timer_get_time()};
+    return xQueueSend(g_events, &event, portMAX_DELAY) == pdTRUE;
+}
+
+int64_t edfWaitForJob(edf_task_t *task)
+{
+    // One notification per released job
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    return absoluteDeadline(task);
+}
+
+void edfJobDone(edf_task_t *task)
+{
+    edf_event_t event = {EDF_EV_DONE, task, esp_timer_get_time()};
+    xQueueSend(g_events, &event, portMAX_DELAY);
+}
+
+void edfRelease(edf_task_t *task)
+{
+    edf_event_t event = {EDF_EV_RELEASE, task, esp_timer_get_time()};
+    xQueueSend(g_events, &event, portMAX_DELAY);
+}
+
+void edfReleaseFromISR(edf_task_t *task, BaseType_t *higherPriorityTaskWoken)
+{
+    edf_event_t event = {EDF_EV_RELEASE, task, esp_timer_get_time()};
+    xQueueSendFromISR(g_events, &event, higherPriorityTaskWoken);
+}
+
+void edfReport(void)
+{
+    ESP_LOGI(TAG, "%-14s %7s %7s %5s %6s %8s %8s %8s %9s %4s", "task", "period", "dline", "jobs", "miss", "resp min",
+             "resp avg", "resp max", "slack min", "prio");
+    for (int i = 0; i < g_taskCount; i++)
+    {
+        const edf_task_t *t = g_tasks[i];
+        const edf_stats_t *s = &t->stats;
+        ESP_LOGI(TAG, "%-14s %5lums %5lums %5lu %6lu %6luus %6luus %6luus %7ldus %4u%s", t->name,
+                 (unsigned long)(t->periodUs / 1000), (unsigned long)(t->deadlineUs / 1000), (unsigned long)s->jobs,
+                 (unsigned long)s->misses, (unsigned long)s->responseMinUs,
+                 (unsigned long)(s->jobs > 0 ? s->responseTotalUs / s->jobs : 0), (unsigned long)s->responseMaxUs,
+                 (long)s->slackMinUs, (unsigned)t->priority, s->dropped > 0 ? " DROPPED RELEASES" : "");
+    }
+}
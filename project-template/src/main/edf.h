@@ -0,0 +1,90 @@
+/**
+ * Earliest-deadline-first layer over FreeRTOS priorities
+ *
+ * day3-ex2 shows vTaskPrioritySet reshaping the schedule at runtime, while
+ * the controller's tasks keep hand-picked static priorities (5, 3, 2, 1).
+ * Here a task states its timing instead:
+ *
+ *   periodic   released every periodMs, must finish within deadlineMs
+ *   sporadic   periodMs = 0, released by edfRelease() (e.g. from an ISR
+ *              or another task), must finish within deadlineMs
+ *
+ * and a scheduler task hands out priorities inside a band
+ * [EDF_PRIORITY_BASE, EDF_PRIORITY_TOP]: the job with the earliest
+ * absolute deadline gets the top, the next one below it, and so on.
+ * Tasks without a pending job drop to the base. Priorities are only
+ * reassigned when a job is released or completes, which is when the EDF
+ * order can change. Releases are timed with esp_timer, not the 10 ms
+ * tick.
+ *
+ *   static edf_task_t g_patternEdf;
+ *   edfTaskInit(&g_patternEdf, "pattern", 400, 50);
+ *   edfAttach(&g_patternEdf);               // from the task itself
+ *   while (1) { edfWaitForJob(&g_patternEdf); knightRider(); edfJobDone(&g_patternEdf); }
+ *
+ * For every task the scheduler tracks jobs, deadline misses, response time
+ * (release to done) and slack (deadline minus done). edfReport() logs
+ * them. Other tasks should sit outside the band; the scheduler itself
+ * runs at EDF_PRIORITY_TOP + 1.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define EDF_MAX_TASKS 8
+#define EDF_MAX_BACKLOG 4 // releases a task may fall behind before some are dropped
+#define EDF_PRIORITY_BASE 2
+#define EDF_PRIORITY_TOP 10
+
+typedef struct
+{
+    uint32_t jobs;
+    uint32_t misses;
+    uint32_t dropped; // released while EDF_MAX_BACKLOG jobs were pending
+    uint32_t responseMinUs;
+    uint32_t responseMaxUs;
+    uint64_t responseTotalUs;
+    int32_t slackMinUs; // negative = the worst miss
+} edf_stats_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t periodUs; // 0 = sporadic
+    uint32_t deadlineUs;
+    TaskHandle_t handle;
+
+    // Owned by the scheduler task
+    int64_t releases[EDF_MAX_BACKLOG]; // release times of pending jobs
+    uint8_t head;
+    uint8_t pending;
+    int64_t nextReleaseUs;
+    UBaseType_t priority;
+    edf_stats_t stats;
+} edf_task_t;
+
+// Starts the scheduler task. Called once, before any edfAttach().
+bool edfStart(void);
+
+void edfTaskInit(edf_task_t *task, const char *name, uint32_t periodMs, uint32_t deadlineMs);
+
+// Registers the calling task. Periodic tasks get their first release now.
+bool edfAttach(edf_task_t *task);
+
+// Blocks until the next job is released. Returns its absolute deadline
+// (esp_timer us).
+int64_t edfWaitForJob(edf_task_t *task);
+
+// Marks the current job done.
+void edfJobDone(edf_task_t *task);
+
+// Releases one job of a sporadic task.
+void edfRelease(edf_task_t *task);
+void edfReleaseFromISR(edf_task_t *task, BaseType_t *higherPriorityTaskWoken);
+
+// Logs per-task jobs, misses, response times and slack.
+void edfReport(void);
@@ -0,0 +1,249 @@
+#include "event_bus.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+
+static const char *TAG = "EventBus";
+
+static event_msg_t g_pool[EVENT_BUS_POOL_SIZE];
+static uint8_t g_freeList[EVENT_BUS_POOL_SIZE];
+static uint8_t g_freeCount = 0;
+static bool g_poolReady = false;
+
+static event_topic_t *g_topics[EVENT_BUS_MAX_TOPICS];
+static uint8_t g_topicCount = 0;
+static int64_t g_lastReportUs = 0;
+
+// Guards the free list, reference counts and topic stats. Every hold is a
+// few loads and stores, and publish/release may run in an ISR, so this is
+// a spinlock rather than a mutex.
+static portMUX_TYPE g_busLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Must be called with g_busLock held
+static void poolInitLocked(void)
+{
+    for (uint8_t i = 0; i < EVENT_BUS_POOL_SIZE; i++)
+    {
+        g_pool[i].index = i;
+        g_freeList[i] = i;
+    }
+    g_freeCount = EVENT_BUS_POOL_SIZE;
+    g_poolReady = true;
+}
+
+bool eventBusRegisterTopic(event_topic_t *topic)
+{
+    bool ok = false;
+    portENTER_CRITICAL(&g_busLock);
+    if (g_topicCount < EVENT_BUS_MAX_TOPICS)
+    {
+        g_topics[g_topicCount++] = topic;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&g_busLock);
+
+    if (!ok)
+        ESP_LOGE(TAG, "Topic registry full, %s not registered", topic->name);
+    return ok;
+}
+
+bool eventBusSubscriberInit(event_subscriber_t *sub, const char *name, UBaseType_t depth)
+{
+    sub->name = name;
+    sub->queue = xQueueCreate(depth, sizeof(event_msg_t *));
+    if (sub->queue == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create queue for subscriber %s", name);
+        return false;
+    }
+    return true;
+}
+
+bool eventBusSubscribe(event_topic_t *topic, event_subscriber_t *sub)
+{
+    if (topic->subscriberCount >= EVENT_BUS_MAX_SUBSCRIBERS)
+    {
+        ESP_LOGE(TAG, "Topic %s already has %d subscribers", topic->name, EVENT_BUS_MAX_SUBSCRIBERS);
+        return false;
+    }
+    topic->subscribers[topic->subscriberCount++] = sub;
+    return true;
+}
+
+// Drops `refs` references; the last one returns the block to the pool.
+// Must be called with g_busLock held.
+static void IRAM_ATTR dropRefsLocked(event_msg_t *msg, uint8_t refs)
+{
+    msg->refCount -= refs;
+    if (msg->refCount == 0)
+        g_freeList[g_freeCount++] = msg->index;
+}
+
+static bool IRAM_ATTR publish(event_topic_t *topic, const void *payload, size_t size, BaseType_t *higherPriorityTaskWoken)
+{
+    bool fromISR = (higherPriorityTaskWoken != NULL);
+
+    if (size != topic->payloadSize || size > EVENT_BUS_MAX_PAYLOAD)
+        return false;
+
+    portENTER_CRITICAL_SAFE(&g_busLock);
+    if (!g_poolReady)
+        poolInitLocked();
+    if (g_freeCount == 0)
+    {
+        topic->stats.poolExhausted++;
+        portEXIT_CRITICAL_SAFE(&g_busLock);
+        return false;
+    }
+    event_msg_t *msg = &g_pool[g_freeList[--g_freeCount]];
+
+    // One reference per subscriber plus one held by us while fanning out,
+    // so a fast subscriber cannot free the block before the last send
+    uint8_t subscribers = topic->subscriberCount;
+    msg->refCount = subscribers + 1;
+    topic->stats.published++;
+    topic->stats.backlog += subscribers;
+    portEXIT_CRITICAL_SAFE(&g_busLock);
+
+    // The only payload copy, whatever the subscriber count
+    msg->topic = topic;
+    msg->size = (uint16_t)size;
+    msg->timeStamp = (uint32_t)(esp_timer_get_time() / 1000);
+    memcpy(msg->payload, payload, size);
+
+    uint8_t failed = 0;
+    for (uint8_t i = 0; i < subscribers; i++)
+    {
+        QueueHandle_t queue = topic->subscribers[i]->queue;
+        BaseType_t sent = fromISR ? xQueueSendFromISR(queue, &msg, higherPriorityTaskWoken)
+                                  : xQueueSend(queue, &msg, 0);
+        if (sent != pdTRUE)
+            failed++;
+    }
+
+    portENTER_CRITICAL_SAFE(&g_busLock);
+    topic->stats.delivered += subscribers - failed;
+    topic->stats.dropped += failed;
+    topic->stats.backlog -= failed;
+    if (topic->stats.backlog > topic->stats.backlogPeak)
+        topic->stats.backlogPeak = topic->stats.backlog;
+    dropRefsLocked(msg, failed + 1);
+    portEXIT_CRITICAL_SAFE(&g_busLock);
+
+    return true;
+}
+
+bool eventBusPublish(event_topic_t *topic, const void *payload, size_t size)
+{
+    return publish(topic, payload, size, NULL);
+}
+
+bool IRAM_ATTR eventBusPublishFromISR(event_topic_t *topic, const void *payload, size_t size, BaseType_t *higherPriorityTaskWoken)
+{
+    BaseType_t unused = pdFALSE;
+    return publish(topic, payload, size, higherPriorityTaskWoken != NULL ? higherPriorityTaskWoken : &unused);
+}
+
+event_msg_t *eventBusReceive(event_subscriber_t *sub, TickType_t timeout)
+{
+    event_msg_t *msg = NULL;
+    if (xQueueReceive(sub->queue, &msg, timeout) != pdTRUE)
+        return NULL;
+    return msg;
+}
+
+void eventBusRelease(event_msg_t *msg)
+{
+    if (msg == NULL)
+        return;
+
+    portENTER_CRITICAL(&g_busLock);
+    msg->topic->stats.backlog--;
+    dropRefsLocked(msg, 1);
+    portEXIT_CRITICAL(&g_busLock);
+}
+
+void eventBusReport(void)
+{
+    int64_t now = esp_timer_get_time();
+    float seconds = (g_lastReportUs != 0) ? (now - g_lastReportUs) / 1e6f : 0.0f;
+    g_lastReportUs = now;
+
+    ESP_LOGI(TAG, "========== Event Bus (%u/%d blocks free) ==========", g_freeCount, EVENT_BUS_POOL_SIZE);
+    for (uint8_t i = 0; i < g_topicCount; i++)
+    {
+        event_topic_t *topic = g_topics[i];
+
+        portENTER_CRITICAL(&g_busLock);
+        event_topic_stats_t stats = topic->stats;
+        portEXIT_CRITICAL(&g_busLock);
+
+        uint32_t recent = stats.published - topic->publishedAtLastReport;
+        topic->publishedAtLastReport = stats.published;
+
+        ESP_LOGI(TAG, "%-16s subs=%u pub=%lu (%.1f/s) delivered=%lu dropped=%lu noBlock=%lu backlog=%lu peak=%lu",
+                 topic->name, topic->subscriberCount, (unsigned long)stats.published,
+                 seconds > 0.0f ? recent / seconds : 0.0f,
+                 (unsigned long)stats.delivered, (unsigned long)stats.dropped,
+                 (unsigned long)stats.poolExhausted, (unsigned long)stats.backlog,
+                 (unsigned long)stats.backlogPeak);
+    }
+}
+
+void eventBusBenchmark(void)
+{
+    static const uint8_t subscriberCounts[] = {1, 4, 8};
+    static const uint16_t payloadSizes[] = {4, 32, 128};
+    const uint32_t iterations = 2000;
+
+    event_subscriber_t subs[EVENT_BUS_MAX_SUBSCRIBERS];
+    for (int i = 0; i < EVENT_BUS_MAX_SUBSCRIBERS; i++)
+    {
+        if (!eventBusSubscriberInit(&subs[i], "bench", 2))
+        {
+            ESP_LOGE(TAG, "Benchmark needs %d subscriber queues, got %d", EVENT_BUS_MAX_SUBSCRIBERS, i);
+            while (i-- > 0)
+            {
+                vQueueDelete(subs[i].queue);
+            }
+            return;
+        }
+    }
+
+    uint8_t payload[EVENT_BUS_MAX_PAYLOAD] = {0};
+    ESP_LOGI(TAG, "Publish+receive+release cost (ns/publish):");
+    for (size_t s = 0; s < sizeof(subscriberCounts); s++)
+    {
+        for (size_t p = 0; p < sizeof(payloadSizes) / sizeof(payloadSizes[0]); p++)
+        {
+            event_topic_t topic = {};
+            topic.name = "bench";
+            topic.payloadSize = payloadSizes[p];
+            for (uint8_t i = 0; i < subscriberCounts[s]; i++)
+            {
+                eventBusSubscribe(&topic, &subs[i]);
+            }
+
+            int64_t start = esp_timer_get_time();
+            for (uint32_t n = 0; n < iterations; n++)
+            {
+                eventBusPublish(&topic, payload, payloadSizes[p]);
+                for (uint8_t i = 0; i < subscriberCounts[s]; i++)
+                {
+                    eventBusRelease(eventBusReceive(&subs[i], 0));
+                }
+            }
+            int64_t elapsedUs = esp_timer_get_time() - start;
+
+            ESP_LOGI(TAG, "  %u subscribers, %3u byte payload: %.0f ns", subscriberCounts[s], payloadSizes[p],
+                     elapsedUs * 1000.0 / iterations);
+        }
+    }
+
+    for (int i = 0; i < EVENT_BUS_MAX_SUBSCRIBERS; i++)
+    {
+        vQueueDelete(subs[i].queue);
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * Publish/subscribe event bus
+ *
+ * Replaces hand-wired queue structs like g_serialHandle in the Day 6-7
+ * controller. Instead of one queue per (producer, consumer) pair:
+ *
+ *   - Components publish to a TOPIC (declared with its payload type)
+ *   - Any number of subscribers subscribe to a topic
+ *   - Each subscriber owns ONE queue, no matter how many topics it follows,
+ *     so patternSequencer polls one queue instead of one per feature
+ *
+ * Fan-out without N copies:
+ *   publish copies the payload ONCE into a reference-counted block taken
+ *   from a fixed pool, then sends only the block POINTER to every
+ *   subscriber queue. Each subscriber calls eventBusRelease() when done;
+ *   the last release returns the block to the pool. Publish cost therefore
+ *   grows with the subscriber count, not payload size x subscribers.
+ *
+ * Example (controller speed changes):
+ *
+ *   EVENT_BUS_TOPIC(g_speedTopic, uint16_t);
+ *   event_subscriber_t g_sequencerSub;
+ *
+ *   eventBusRegisterTopic(&g_speedTopic);
+ *   eventBusSubscriberInit(&g_sequencerSub, "pattern", 10);
+ *   eventBusSubscribe(&g_speedTopic, &g_sequencerSub);
+ *
+ *   serialTask:       eventBusPublish(&g_speedTopic, &rxdSpeed, sizeof(rxdSpeed));
+ *   patternSequencer: event_msg_t *msg = eventBusReceive(&g_sequencerSub, 0);
+ *                     if (msg && msg->topic == &g_speedTopic) ...
+ *                     eventBusRelease(msg);
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define EVENT_BUS_MAX_TOPICS 16
+#define EVENT_BUS_MAX_SUBSCRIBERS 8 // per topic
+#define EVENT_BUS_POOL_SIZE 32      // messages in flight across all topics
+#define EVENT_BUS_MAX_PAYLOAD 128   // bytes
+
+typedef struct
+{
+    const char *name;
+    QueueHandle_t queue; // holds event_msg_t pointers
+} event_subscriber_t;
+
+typedef struct
+{
+    uint32_t published;
+    uint32_t delivered;     // successful sends to subscriber queues
+    uint32_t dropped;       // subscriber queue was full
+    uint32_t poolExhausted; // no free message block
+    uint32_t backlog;       // delivered but not yet released
+    uint32_t backlogPeak;
+} event_topic_stats_t;
+
+typedef struct
+{
+    const char *name;
+    uint16_t payloadSize;
+    event_subscriber_t *subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+    uint8_t subscriberCount;
+    event_topic_stats_t stats;
+    uint32_t publishedAtLastReport;
+} event_topic_t;
+
+// Declares a topic whose payload is exactly one `type`
+#define EVENT_BUS_TOPIC(var, type)                                              \
+    event_topic_t var = {.name = #var, .payloadSize = (uint16_t)sizeof(type), \
+                         .subscribers = {}, .subscriberCount = 0, .stats = {}, .publishedAtLastReport = 0}
+
+typedef struct
+{
+    event_topic_t *topic;
+    uint32_t timeStamp; // ms since boot at publish
+    uint16_t size;
+    uint8_t refCount;   // owned by the bus, do not touch
+    uint8_t index;      // position in the pool
+    uint8_t payload[EVENT_BUS_MAX_PAYLOAD];
+} event_msg_t;
+
+// Adds the topic to the registry used by eventBusReport().
+bool eventBusRegisterTopic(event_topic_t *topic);
+
+// Creates the subscriber's queue. Returns false if it could not be created.
+bool eventBusSubscriberInit(event_subscriber_t *sub, const char *name, UBaseType_t depth);
+
+// Subscribe before the first publish; the subscriber list is not locked
+// against concurrent publishers.
+bool eventBusSubscribe(event_topic_t *topic, event_subscriber_t *sub);
+
+// Copies the payload once and fans the block out to every subscriber.
+// Never blocks: a full subscriber queue counts as a drop for that topic.
+// size must equal the topic's payload size. Returns false if the payload
+// was rejected or no block was free.
+bool eventBusPublish(event_topic_t *topic, const void *payload, size_t size);
+bool eventBusPublishFromISR(event_topic_t *topic, const void *payload, size_t size, BaseType_t *higherPriorityTaskWoken);
+
+// Waits for the next message on any of the subscriber's topics.
+// Returns NULL on timeout. Every non-NULL message MUST be released.
+event_msg_t *eventBusReceive(event_subscriber_t *sub, TickType_t timeout);
+void eventBusRelease(event_msg_t *msg);
+
+// Logs per-topic throughput (since the previous report) and backlog.
+void eventBusReport(void);
+
+// Measures publish + receive + release cost for 1/4/8 subscribers and
+// 4/32/128 byte payloads.
+void eventBusBenchmark(void);
@@ -0,0 +1,275 @@
+#include "fanin_merge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "host_test.h"
+
+// --- min-heap on timeStamp -------------------------------------------------
+
+static void heapPush(fanin_merger_t *m, const sensor_data_t *record)
+{
+    uint16_t i = m->heapSize++;
+    while (i > 0)
+    {
+        uint16_t parent = (i - 1) / 2;
+        if (m->heap[parent].timeStamp <= record->timeStamp)
+            break;
+        m->heap[i] = m->heap[parent];
+        i = parent;
+    }
+    m->heap[i] = *record;
+}
+
+static sensor_data_t heapPop(fanin_merger_t *m)
+{
+    sensor_data_t top = m->heap[0];
+    sensor_data_t last = m->heap[--m->heapSize];
+    uint16_t i = 0;
+
+    while (1)
+    {
+        uint16_t child = 2 * i + 1;
+        if (child >= m->heapSize)
+            break;
+        if (child + 1 < m->heapSize && m->heap[child + 1].timeStamp < m->heap[child].timeStamp)
+            child++;
+        if (last.timeStamp <= m->heap[child].timeStamp)
+            break;
+        m->heap[i] = m->heap[child];
+        i = child;
+    }
+    if (m->heapSize > 0)
+        m->heap[i] = last;
+    return top;
+}
+
+// --- merge -----------------------------------------------------------------
+
+static void emitRow(fanin_merger_t *m)
+{
+    m->row.timeStamp = m->nextFrameMs;
+    if (m->onFrame != NULL)
+        m->onFrame(&m->row, m->ctx);
+    m->stats.framesOut++;
+    m->rowPending = false;
+}
+
+static void release(fanin_merger_t *m, const sensor_data_t *record)
+{
+    if (!m->anyReleased)
+    {
+        m->nextFrameMs = (record->timeStamp / m->frameMs + 1) * m->frameMs;
+        m->anyReleased = true;
+    }
+    else if (record->timeStamp >= m->nextFrameMs)
+    {
+        // The row currently holds the latest values as of the boundary;
+        // emit it before this record moves it forward. Idle gaps produce
+        // one frame, not one per empty period.
+        if (m->rowPending)
+            emitRow(m);
+        m->nextFrameMs = (record->timeStamp / m->frameMs + 1) * m->frameMs;
+    }
+
+    m->row.values[record->sensorID] = record->sensorVal;
+    m->row.validMask |= (1UL << record->sensorID);
+    m->rowPending = true;
+    m->lastReleased = record->timeStamp;
+    m->stats.recordsMerged++;
+}
+
+void faninInit(fanin_merger_t *m, uint32_t reorderMs, uint32_t frameMs, fanin_frame_cb_t onFrame, void *ctx)
+{
+    memset(m, 0, sizeof(*m));
+    m->reorderMs = reorderMs;
+    m->frameMs = (frameMs > 0) ? frameMs : 1;
+    m->onFrame = onFrame;
+    m->ctx = ctx;
+}
+
+void faninPush(fanin_merger_t *m, const sensor_data_t *record)
+{
+    m->stats.recordsIn++;
+
+    if (record->sensorID >= FANIN_MAX_SENSORS)
+    {
+        m->stats.badSensorID++;
+        return;
+    }
+    if (m->anyReleased && record->timeStamp < m->lastReleased)
+    {
+        m->stats.lateDrops++;
+        return;
+    }
+
+    if (m->heapSize == FANIN_WINDOW_DEPTH)
+    {
+        sensor_data_t oldest = heapPop(m);
+        release(m, &oldest);
+        m->stats.forcedReleases++;
+        // The forced release may have moved past the new record
+        if (record->timeStamp < m->lastReleased)
+        {
+            m->stats.lateDrops++;
+            return;
+        }
+    }
+
+    heapPush(m, record);
+    if (record->timeStamp > m->newestSeen)
+        m->newestSeen = record->timeStamp;
+
+    if (m->newestSeen < m->reorderMs)
+        return;
+    uint32_t watermark = m->newestSeen - m->reorderMs;
+    while (m->heapSize > 0 && m->heap[0].timeStamp <= watermark)
+    {
+        sensor_data_t next = heapPop(m);
+        release(m, &next);
+    }
+}
+
+void faninFlush(fanin_merger_t *m)
+{
+    while (m->heapSize > 0)
+    {
+        sensor_data_t next = heapPop(m);
+        release(m, &next);
+    }
+    // Without this the last partial frame would wait for the next record.
+    // Later records in the same period go into the following frame.
+    if (m->rowPending)
+    {
+        emitRow(m);
+        m->nextFrameMs += m->frameMs;
+    }
+}
+
+// --- self test -------------------------------------------------------------
+
+typedef struct
+{
+    uint32_t count;
+    fanin_frame_t first;
+    fanin_frame_t last;
+} frame_log_t;
+
+static void logFrame(const fanin_frame_t *frame, void *ctx)
+{
+    frame_log_t *log = (frame_log_t *)ctx;
+    if (log->count++ == 0)
+        log->first = *frame;
+    log->last = *frame;
+}
+
+static void push(fanin_merger_t *m, uint8_t id, uint32_t timeStamp, float value)
+{
+    sensor_data_t record = {timeStamp, id, value};
+    faninPush(m, &record);
+}
+
+bool faninSelfTest(void)
+{
+    printf("Fan-in merger self test\n");
+    bool ok = true;
+    static fanin_merger_t m;
+    frame_log_t log = {};
+    faninInit(&m, 20, 10, logFrame, &log);
+
+    // Out of order within the window
+    push(&m, 1, 5, 1.0f);
+    push(&m, 0, 3, 0.5f);
+    push(&m, 2, 8, 2.0f);
+    ok &= testCheck("held inside the reorder window", m.stats.recordsMerged == 0 && log.count == 0);
+    push(&m, 0, 30, 3.0f); // watermark 10 releases 3, 5, 8
+    ok &= testCheck("released in timestamp order", m.stats.recordsMerged == 3 && m.lastReleased == 8);
+    push(&m, 1, 4, 9.0f);
+    ok &= testCheck("late record dropped", m.stats.lateDrops == 1);
+
+    // Producers go quiet: the flush releases 30, which closes the frame at
+    // 10, and then emits the partial row instead of holding it
+    faninFlush(&m);
+    ok &= testCheck("flush closes the boundary frame", log.count == 2 && log.first.timeStamp == 10 &&
+                                                       log.first.validMask == 0x7 && log.first.values[2] == 2.0f);
+    ok &= testCheck("flush emits the pending partial row", log.last.timeStamp == 40 && log.last.values[0] == 3.0f);
+    faninFlush(&m);
+    ok &= testCheck("nothing new, no frame", log.count == 2);
+    push(&m, 3, 35, 4.0f);
+    push(&m, 3, 90, 5.0f);
+    faninFlush(&m);
+    ok &= testCheck("frames continue after a flush", log.count == 4 && log.first.timeStamp == 10 &&
+                                                     log.last.timeStamp == 100 && log.last.values[3] == 5.0f);
+    push(&m, 40, 100, 0.0f);
+    ok &= testCheck("bad sensor id counted", m.stats.badSensorID == 1);
+
+    return testSummary(ok);
+}
+
+// --- benchmark -------------------------------------------------------------
+
+static void countFrame(const fanin_frame_t *frame, void *ctx)
+{
+    (void)frame;
+    (*(uint32_t *)ctx)++;
+}
+
+void faninBenchmark(uint8_t sensors, uint32_t records)
+{
+    if (sensors == 0 || sensors > FANIN_MAX_SENSORS)
+    {
+        printf("Benchmark needs 1..%d sensors\n", FANIN_MAX_SENSORS);
+        return;
+    }
+
+    fanin_merger_t *merger = (fanin_merger_t *)malloc(sizeof(fanin_merger_t));
+    if (merger == NULL)
+        return;
+    uint32_t frames = 0;
+    faninInit(merger, 20, 10, countFrame, &frames);
+
+    // Sensor n samples every (n + 1) ms. Each record reaches the merger up
+    // to 7 ms after it was taken, which is well inside the 20 ms window.
+    uint32_t jitter = 12345;
+    uint32_t pushed = 0;
+    sensor_data_t record = {};
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t now = 0; pushed < records; now++)
+    {
+        for (uint8_t id = 0; id < sensors && pushed < records; id++)
+        {
+            if (now % (id + 1) != 0)
+                continue;
+            jitter = jitter * 1103515245 + 12345;
+            uint32_t delay = (jitter >> 16) % 8;
+
+            record.sensorID = id;
+            record.timeStamp = (now > delay) ? now - delay : 0;
+            record.sensorVal = (float)pushed;
+            faninPush(merger, &record);
+            pushed++;
+        }
+    }
+    faninFlush(merger);
+    double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%u sensors: merged %lu of %lu records in %.0f us (%.0f records/sec), %lu frames, %lu late, %lu forced\n",
+           sensors, (unsigned long)merger->stats.recordsMerged, (unsigned long)records, elapsedUs,
+           elapsedUs > 0 ? merger->stats.recordsMerged * 1e6 / elapsedUs : 0.0, (unsigned long)frames,
+           (unsigned long)merger->stats.lateDrops, (unsigned long)merger->stats.forcedReleases);
+
+    free(merger);
+}
+
+#ifdef FANIN_HOST_MAIN
+int main(void)
+{
+    bool ok = faninSelfTest();
+    static const uint8_t sensorCounts[] = {1, 4, 16, 32};
+    for (uint8_t sensors : sensorCounts)
+        faninBenchmark(sensors, 2000000);
+    return ok ? 0 : 1;
+}
+#endif
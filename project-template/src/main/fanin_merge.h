@@ -0,0 +1,94 @@
+/**
+ * Multi-sensor fan-in merger
+ *
+ * Many producer tasks, each sampling at its own rate, send sensor_data_t
+ * into ONE shared input queue (FreeRTOS queues are multi-producer). A
+ * single fan-in task drains it, so adding sensors does not add consumer
+ * tasks.
+ *
+ * Producers run at different rates and get preempted, so records reach the
+ * queue slightly out of timestamp order. The merger holds them in a bounded
+ * reorder window (a min-heap on timeStamp) and only releases a record once
+ * nothing older can still arrive:
+ *
+ *   watermark = newest timestamp seen - reorderMs
+ *   release every record with timeStamp <= watermark
+ *
+ * If the window fills up the oldest record is released early. Records older
+ * than the last released one are counted as late and dropped.
+ *
+ * Released records update a "latest value" row. Every frameMs of sensor
+ * time an aligned frame is emitted: one row holding the most recent value
+ * of every sensor (sample-and-hold), plus a mask of sensors seen so far.
+ *
+ * The merger only uses the C++ standard library, so it is checked and
+ * benchmarked on a PC as well:
+ *
+ *   g++ -std=c++17 -O2 -DFANIN_HOST_MAIN fanin_merge.cpp -o fanin && ./fanin
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_data.h"
+
+#define FANIN_MAX_SENSORS 32   // sensorID 0..31, one bit each in validMask
+#define FANIN_WINDOW_DEPTH 128 // records held; >= total rate x reorderMs
+
+typedef struct
+{
+    uint32_t timeStamp; // frame boundary this row is aligned to
+    uint32_t validMask; // bit n set = values[n] holds a real reading
+    float values[FANIN_MAX_SENSORS];
+} fanin_frame_t;
+
+typedef void (*fanin_frame_cb_t)(const fanin_frame_t *frame, void *ctx);
+
+typedef struct
+{
+    uint32_t recordsIn;
+    uint32_t recordsMerged;
+    uint32_t lateDrops;      // arrived after the window had moved past them
+    uint32_t forcedReleases; // released early because the window was full
+    uint32_t badSensorID;
+    uint32_t framesOut;
+} fanin_stats_t;
+
+typedef struct
+{
+    // Configuration
+    uint32_t reorderMs;
+    uint32_t frameMs;
+    fanin_frame_cb_t onFrame;
+    void *ctx;
+
+    // Reorder window, min-heap on timeStamp
+    sensor_data_t heap[FANIN_WINDOW_DEPTH];
+    uint16_t heapSize;
+
+    uint32_t newestSeen;
+    uint32_t lastReleased;
+    bool anyReleased;
+
+    uint32_t nextFrameMs;
+    fanin_frame_t row; // latest value of every sensor
+    bool rowPending;   // row changed since the last frame went out
+
+    fanin_stats_t stats;
+} fanin_merger_t;
+
+void faninInit(fanin_merger_t *m, uint32_t reorderMs, uint32_t frameMs, fanin_frame_cb_t onFrame, void *ctx);
+
+// Adds one record and releases whatever the new watermark allows.
+void faninPush(fanin_merger_t *m, const sensor_data_t *record);
+
+// Releases everything still in the window and emits the pending row,
+// stamped with the next frame boundary (idle producers / shutdown).
+void faninFlush(fanin_merger_t *m);
+
+bool faninSelfTest(void);
+
+// Merges synthetic jittered streams from `sensors` producers through one
+// merger and prints merged records/sec.
+void faninBenchmark(uint8_t sensors, uint32_t records);
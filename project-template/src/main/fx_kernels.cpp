@@ -0,0 +1,440 @@
+#include "fx_kernels.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "host_test.h"
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+#define FX_VECTOR 1
+typedef uint32_t fx_vec_t __attribute__((vector_size(16))); // four pixels
+#endif
+
+#define RB_MASK 0x00FF00FFu
+#define G_MASK 0x0000FF00u
+
+// --- gamma table, computed by the compiler ---------------------------------
+
+// x^(1/5) by Newton's method, x in [0, 1]
+static constexpr double fifthRoot(double x)
+{
+    double r = 1.0;
+    for (int i = 0; i < 40; i++)
+    {
+        r = r - (r * r * r * r * r - x) / (5.0 * r * r * r * r);
+    }
+    return r;
+}
+
+struct GammaTable
+{
+    uint8_t values[256];
+
+    constexpr GammaTable() : values()
+    {
+        for (int i = 1; i < 256; i++)
+        {
+            double x = i / 255.0;
+            values[i] = (uint8_t)(255.0 * x * x * fifthRoot(x) + 0.5); // x^2.2
+        }
+    }
+};
+
+static constexpr GammaTable GAMMA;
+static_assert(GAMMA.values[0] == 0 && GAMMA.values[255] == 255, "gamma table endpoints");
+
+// --- SWAR kernels ----------------------------------------------------------
+
+static inline uint32_t blendPixel(uint32_t a, uint32_t b, uint32_t alpha)
+{
+    uint32_t inverse = 256 - alpha;
+    uint32_t rb = (((a & RB_MASK) * inverse + (b & RB_MASK) * alpha) >> 8) & RB_MASK;
+    uint32_t g = (((a & G_MASK) * inverse + (b & G_MASK) * alpha) >> 8) & G_MASK;
+    return rb | g;
+}
+
+static inline uint32_t scalePixel(uint32_t p, uint32_t scale)
+{
+    return ((((p & RB_MASK) * scale) >> 8) & RB_MASK) | ((((p & G_MASK) * scale) >> 8) & G_MASK);
+}
+
+void fxBlend(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n, uint16_t alpha)
+{
+    if (alpha > 256)
+        alpha = 256;
+    size_t i = 0;
+#ifdef FX_VECTOR
+    uint32_t inverse = 256 - alpha;
+    for (; i + 4 <= n; i += 4)
+    {
+        fx_vec_t va, vb;
+        memcpy(&va, &a[i], sizeof(va));
+        memcpy(&vb, &b[i], sizeof(vb));
+        fx_vec_t rb = (((va & RB_MASK) * inverse + (vb & RB_MASK) * (uint32_t)alpha) >> 8) & RB_MASK;
+        fx_vec_t g = (((va & G_MASK) * inverse + (vb & G_MASK) * (uint32_t)alpha) >> 8) & G_MASK;
+        fx_vec_t out = rb | g;
+        memcpy(&dst[i], &out, sizeof(out));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = blendPixel(a[i], b[i], alpha);
+    }
+}
+
+void fxScale(uint32_t *pixels, size_t n, uint16_t scale)
+{
+    if (scale > 256)
+        scale = 256;
+    size_t i = 0;
+#ifdef FX_VECTOR
+    for (; i + 4 <= n; i += 4)
+    {
+        fx_vec_t v;
+        memcpy(&v, &pixels[i], sizeof(v));
+        v = ((((v & RB_MASK) * (uint32_t)scale) >> 8) & RB_MASK) | ((((v & G_MASK) * (uint32_t)scale) >> 8) & G_MASK);
+        memcpy(&pixels[i], &v, sizeof(v));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        pixels[i] = scalePixel(pixels[i], scale);
+    }
+}
+
+void fxFadeToBlack(uint32_t *pixels, size_t n, uint8_t amount)
+{
+    fxScale(pixels, n, (uint16_t)(256 - amount));
+}
+
+void fxGamma(uint32_t *pixels, size_t n)
+{
+    const uint8_t *lut = GAMMA.values;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t p = pixels[i];
+        pixels[i] = ((uint32_t)lut[(p >> 16) & 0xFF] << 16) | ((uint32_t)lut[(p >> 8) & 0xFF] << 8) | lut[p & 0xFF];
+    }
+}
+
+void fxPalette(uint32_t *dst, const uint8_t *index, size_t n, const fx_palette_t *palette)
+{
+    const uint32_t *entries = palette->entries;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint8_t hi = index[i] >> 4;
+        uint8_t lo = index[i] & 0x0F;
+        dst[i] = blendPixel(entries[hi], entries[(hi + 1) & (FX_PALETTE_ENTRIES - 1)], (uint32_t)lo << 4);
+    }
+}
+
+void fxShift(uint32_t *pixels, size_t n, int offset, uint32_t fill)
+{
+    size_t distance = (size_t)(offset < 0 ? -offset : offset);
+    if (distance >= n)
+    {
+        std::fill(pixels, pixels + n, fill);
+        return;
+    }
+    if (offset > 0)
+    {
+        memmove(&pixels[distance], pixels, (n - distance) * sizeof(uint32_t));
+        std::fill(pixels, pixels + distance, fill);
+    }
+    else if (offset < 0)
+    {
+        memmove(pixels, &pixels[distance], (n - distance) * sizeof(uint32_t));
+        std::fill(pixels + n - distance, pixels + n, fill);
+    }
+}
+
+void fxRotate(uint32_t *pixels, size_t n, int offset)
+{
+    if (n == 0)
+        return;
+    int k = offset % (int)n;
+    if (k < 0)
+        k += (int)n;
+    if (k != 0)
+        std::rotate(pixels, pixels + n - k, pixels + n);
+}
+
+// --- per-channel references ------------------------------------------------
+
+typedef struct
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} fx_rgb_t;
+
+static inline fx_rgb_t unpack(uint32_t p)
+{
+    fx_rgb_t c = {(uint8_t)(p >> 16), (uint8_t)(p >> 8), (uint8_t)p};
+    return c;
+}
+
+static inline uint32_t pack(fx_rgb_t c)
+{
+    return ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+}
+
+static inline uint8_t mixChannel(uint8_t x, uint8_t y, uint32_t alpha)
+{
+    return (uint8_t)((x * (256 - alpha) + y * alpha) >> 8);
+}
+
+static void refBlend(uint32_t *dst, const uint32_t *a, const uint32_t *b, size_t n, uint16_t alpha)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        fx_rgb_t x = unpack(a[i]);
+        fx_rgb_t y = unpack(b[i]);
+        fx_rgb_t out = {mixChannel(x.r, y.r, alpha), mixChannel(x.g, y.g, alpha), mixChannel(x.b, y.b, alpha)};
+        dst[i] = pack(out);
+    }
+}
+
+static void refScale(uint32_t *pixels, size_t n, uint16_t scale)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        fx_rgb_t c = unpack(pixels[i]);
+        c.r = (uint8_t)((c.r * scale) >> 8);
+        c.g = (uint8_t)((c.g * scale) >> 8);
+        c.b = (uint8_t)((c.b * scale) >> 8);
+        pixels[i] = pack(c);
+    }
+}
+
+static uint8_t gammaChannel(uint8_t v)
+{
+    return (uint8_t)(255.0f * powf(v / 255.0f, 2.2f) + 0.5f);
+}
+
+static void refGamma(uint32_t *pixels, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        fx_rgb_t c = unpack(pixels[i]);
+        c.r = gammaChannel(c.r);
+        c.g = gammaChannel(c.g);
+        c.b = gammaChannel(c.b);
+        pixels[i] = pack(c);
+    }
+}
+
+static void refPalette(uint32_t *dst, const uint8_t *index, size_t n, const fx_palette_t *palette)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        int hi = index[i] / 16;
+        uint32_t alpha = (index[i] % 16) * 16;
+        fx_rgb_t x = unpack(palette->entries[hi]);
+        fx_rgb_t y = unpack(palette->entries[(hi + 1) % FX_PALETTE_ENTRIES]);
+        fx_rgb_t out = {mixChannel(x.r, y.r, alpha), mixChannel(x.g, y.g, alpha), mixChannel(x.b, y.b, alpha)};
+        dst[i] = pack(out);
+    }
+}
+
+static void refRotate(uint32_t *pixels, size_t n, int offset, uint32_t *scratch)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        int from = ((int)i - offset) % (int)n;
+        if (from < 0)
+            from += (int)n;
+        scratch[i] = pixels[from];
+    }
+    memcpy(pixels, scratch, n * sizeof(uint32_t));
+}
+
+// --- self test -------------------------------------------------------------
+
+#define TEST_PIXELS 203 // not a multiple of 4, so vector tails are covered
+
+static uint32_t g_seed = 1;
+
+static uint32_t nextRandom(void)
+{
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return g_seed;
+}
+
+static void randomFrame(uint32_t *pixels, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        pixels[i] = nextRandom() >> 8;
+    }
+}
+
+static bool sameFrame(const uint32_t *x, const uint32_t *y, size_t n, int tolerance)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            int a = (int)((x[i] >> shift) & 0xFF);
+            int b = (int)((y[i] >> shift) & 0xFF);
+            if (abs(a - b) > tolerance || (x[i] >> 24) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool fxSelfTest(void)
+{
+    static uint32_t a[TEST_PIXELS], b[TEST_PIXELS], fast[TEST_PIXELS], slow[TEST_PIXELS];
+    static uint8_t index[TEST_PIXELS];
+    bool blendOk = true, scaleOk = true, gammaOk = true, paletteOk = true, shiftOk = true, rotateOk = true;
+
+    printf("framebuffer kernel self test\n");
+    g_seed = 1;
+    fx_palette_t palette;
+    for (int i = 0; i < FX_PALETTE_ENTRIES; i++)
+    {
+        palette.entries[i] = nextRandom() >> 8;
+    }
+
+    for (int round = 0; round < 50; round++)
+    {
+        randomFrame(a, TEST_PIXELS);
+        randomFrame(b, TEST_PIXELS);
+        uint16_t alpha = (uint16_t)(round == 0 ? 0 : round == 1 ? 256 : nextRandom() % 257);
+
+        fxBlend(fast, a, b, TEST_PIXELS, alpha);
+        refBlend(slow, a, b, TEST_PIXELS, alpha);
+        blendOk &= sameFrame(fast, slow, TEST_PIXELS, 0);
+
+        memcpy(fast, a, sizeof(a));
+        memcpy(slow, a, sizeof(a));
+        fxScale(fast, TEST_PIXELS, alpha);
+        refScale(slow, TEST_PIXELS, alpha);
+        scaleOk &= sameFrame(fast, slow, TEST_PIXELS, 0);
+
+        memcpy(fast, a, sizeof(a));
+        memcpy(slow, a, sizeof(a));
+        fxGamma(fast, TEST_PIXELS);
+        refGamma(slow, TEST_PIXELS);
+        gammaOk &= sameFrame(fast, slow, TEST_PIXELS, 1); // constexpr root vs powf rounding
+
+        for (int i = 0; i < TEST_PIXELS; i++)
+        {
+            index[i] = (uint8_t)nextRandom();
+        }
+        fxPalette(fast, index, TEST_PIXELS, &palette);
+        refPalette(slow, index, TEST_PIXELS, &palette);
+        paletteOk &= sameFrame(fast, slow, TEST_PIXELS, 0);
+
+        int offset = (int)(nextRandom() % (2 * TEST_PIXELS + 1)) - TEST_PIXELS;
+        memcpy(fast, a, sizeof(a));
+        memcpy(slow, a, sizeof(a));
+        fxRotate(fast, TEST_PIXELS, offset);
+        refRotate(slow, TEST_PIXELS, offset, b);
+        rotateOk &= memcmp(fast, slow, sizeof(a)) == 0;
+
+        memcpy(fast, a, sizeof(a));
+        fxShift(fast, TEST_PIXELS, offset, 0x123456);
+        for (int i = 0; i < TEST_PIXELS; i++)
+        {
+            int from = i - offset;
+            uint32_t expected = (from >= 0 && from < TEST_PIXELS) ? a[from] : 0x123456;
+            shiftOk &= fast[i] == expected;
+        }
+    }
+
+    bool ok = true;
+    ok &= testCheck("blend matches per-channel reference", blendOk);
+    ok &= testCheck("scale matches per-channel reference", scaleOk);
+    ok &= testCheck("gamma LUT within 1 of powf", gammaOk);
+    ok &= testCheck("palette matches per-channel reference", paletteOk);
+    ok &= testCheck("rotate matches modulo reference", rotateOk);
+    ok &= testCheck("shift moves and fills", shiftOk);
+    printf("%s\n", ok ? "all framebuffer kernel checks passed" : "FRAMEBUFFER KERNEL CHECKS FAILED");
+    return ok;
+}
+
+// --- benchmark -------------------------------------------------------------
+
+template <typename Kernel>
+static double mpixelsPerSec(Kernel kernel, size_t pixels)
+{
+    const int rounds = 50;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+    {
+        kernel();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    return us > 0 ? (double)pixels * rounds / us : 0.0;
+}
+
+static void report(const char *name, double fast, double reference)
+{
+    printf("  %-8s %8.1f Mpix/s  reference %8.1f Mpix/s  x%.1f\n", name, fast, reference,
+           reference > 0 ? fast / reference : 0.0);
+}
+
+void fxBenchmark(uint16_t pixels)
+{
+    uint32_t *a = (uint32_t *)malloc(pixels * sizeof(uint32_t));
+    uint32_t *b = (uint32_t *)malloc(pixels * sizeof(uint32_t));
+    uint32_t *out = (uint32_t *)malloc(pixels * sizeof(uint32_t));
+    uint8_t *index = (uint8_t *)malloc(pixels);
+    if (a == NULL || b == NULL || out == NULL || index == NULL)
+    {
+        printf("fx benchmark: out of memory\n");
+        free(a);
+        free(b);
+        free(out);
+        free(index);
+        return;
+    }
+    g_seed = 7;
+    randomFrame(a, pixels);
+    randomFrame(b, pixels);
+    for (uint16_t i = 0; i < pixels; i++)
+    {
+        index[i] = (uint8_t)nextRandom();
+    }
+    fx_palette_t palette;
+    for (int i = 0; i < FX_PALETTE_ENTRIES; i++)
+    {
+        palette.entries[i] = nextRandom() >> 8;
+    }
+
+#ifdef FX_VECTOR
+    printf("framebuffer kernels, %u pixels (SWAR + vector)\n", pixels);
+#else
+    printf("framebuffer kernels, %u pixels (SWAR)\n", pixels);
+#endif
+    report("blend", mpixelsPerSec([&]() { fxBlend(out, a, b, pixels, 100); }, pixels),
+           mpixelsPerSec([&]() { refBlend(out, a, b, pixels, 100); }, pixels));
+    report("fade", mpixelsPerSec([&]() { fxFadeToBlack(out, pixels, 20); }, pixels),
+           mpixelsPerSec([&]() { refScale(out, pixels, 236); }, pixels));
+    report("gamma", mpixelsPerSec([&]() { fxGamma(out, pixels); }, pixels),
+           mpixelsPerSec([&]() { refGamma(out, pixels); }, pixels));
+    report("palette", mpixelsPerSec([&]() { fxPalette(out, index, pixels, &palette); }, pixels),
+           mpixelsPerSec([&]() { refPalette(out, index, pixels, &palette); }, pixels));
+    report("rotate", mpixelsPerSec([&]() { fxRotate(out, pixels, 1); }, pixels),
+           mpixelsPerSec([&]() { refRotate(out, pixels, 1, b); }, pixels));
+
+    free(a);
+    free(b);
+    free(out);
+    free(index);
+}
+
+#ifdef FX_HOST_MAIN
+int main(void)
+{
+    bool ok = fxSelfTest();
+    fxBenchmark(1000);
+    return ok ? 0 : 1;
+}
+#endif
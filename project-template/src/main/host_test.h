@@ -0,0 +1,30 @@
+/**
+ * Self-test helpers shared by the standard-library-only modules
+ *
+ * acq_core, fanin_merge, fx_kernels, keypad_scan, led_encode, msg_channel,
+ * settings_store, slab and timer_wheel_core each carry a self test that
+ * prints one line per check, on the target console and in their
+ * -D*_HOST_MAIN builds alike (msg_channel's and slab's only in the host
+ * build).
+ * Header only, so every module still builds on its own with one g++ line.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// Prints "  <name> ok" or "  <name> FAILED" and returns ok, so results
+// can be collected with `ok &= testCheck(...)`.
+static inline bool testCheck(const char *name, bool ok)
+{
+    printf("  %-44s %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// Prints the closing line of a self test and returns ok.
+static inline bool testSummary(bool ok)
+{
+    printf("%s\n", ok ? "All passed" : "FAILURES");
+    return ok;
+}
@@ -0,0 +1,593 @@
+#include "ipc_bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/message_buffer.h"
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "event_bus.h"
+
+static const char *TAG = "IpcBench";
+
+#define BASE_PRIORITY 5
+#define CONSUMER_IDLE_MS 200 // consumer gives up after this long without data
+#define TASK_STACK 3072
+
+typedef struct ipc_ctx ipc_ctx_t;
+
+typedef struct
+{
+    const char *name;
+    uint16_t maxPayload;
+    bool (*create)(ipc_ctx_t *ctx);
+    void (*destroy)(ipc_ctx_t *ctx);
+    void (*send)(ipc_ctx_t *ctx, const uint8_t *msg); // blocks until accepted
+    bool (*sendFromISR)(ipc_ctx_t *ctx, const uint8_t *msg, BaseType_t *woken); // false = full
+    bool (*receive)(ipc_ctx_t *ctx, uint8_t *msg, TickType_t timeout);
+} ipc_transport_t;
+
+struct ipc_ctx
+{
+    const ipc_transport_t *transport;
+    uint16_t payload;
+    uint32_t messages;
+
+    // Transport state (only the fields of the transport under test are used)
+    QueueHandle_t queue;
+    StreamBufferHandle_t stream;
+    MessageBufferHandle_t messageBuffer;
+    SemaphoreHandle_t empty;
+    SemaphoreHandle_t full;
+    uint8_t *slots;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile bool producerWaiting;
+    event_topic_t topic;
+    event_subscriber_t subscriber;
+
+    // Run state
+    TaskHandle_t producer;
+    TaskHandle_t consumer;
+    SemaphoreHandle_t done; // given once by each side
+    volatile uint32_t sent;
+    volatile uint32_t lost;
+    uint32_t received;
+    int64_t firstSendUs;
+    int64_t lastReceiveUs;
+    uint32_t *latencies;
+    uint8_t isrMsg[IPC_BENCH_MAX_PAYLOAD]; // keeps the payload off the ISR stack
+};
+
+// --- queue -----------------------------------------------------------------
+
+static bool queueCreate(ipc_ctx_t *ctx)
+{
+    ctx->queue = xQueueCreate(IPC_BENCH_DEPTH, ctx->payload);
+    return ctx->queue != NULL;
+}
+
+static void queueDestroy(ipc_ctx_t *ctx)
+{
+    vQueueDelete(ctx->queue);
+}
+
+static void queueSend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    xQueueSend(ctx->queue, msg, portMAX_DELAY);
+}
+
+static bool IRAM_ATTR queueSendFromISR(ipc_ctx_t *ctx, const uint8_t *msg, BaseType_t *woken)
+{
+    return xQueueSendFromISR(ctx->queue, msg, woken) == pdTRUE;
+}
+
+static bool queueReceive(ipc_ctx_t *ctx, uint8_t *msg, TickType_t timeout)
+{
+    return xQueueReceive(ctx->queue, msg, timeout) == pdTRUE;
+}
+
+// --- stream buffer ---------------------------------------------------------
+
+static bool streamCreate(ipc_ctx_t *ctx)
+{
+    // Trigger level = one message, so the consumer wakes per message
+    ctx->stream = xStreamBufferCreate(IPC_BENCH_DEPTH * ctx->payload, ctx->payload);
+    return ctx->stream != NULL;
+}
+
+static void streamDestroy(ipc_ctx_t *ctx)
+{
+    vStreamBufferDelete(ctx->stream);
+}
+
+static void streamSend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    xStreamBufferSend(ctx->stream, msg, ctx->payload, portMAX_DELAY);
+}
+
+static bool IRAM_ATTR streamSendFromISR(ipc_ctx_t *ctx, const uint8_t *msg, BaseType_t *woken)
+{
+    // The ISR variant writes partial messages, so only send whole ones
+    if (xStreamBufferSpacesAvailable(ctx->stream) < ctx->payload)
+        return false;
+    return xStreamBufferSendFromISR(ctx->stream, msg, ctx->payload, woken) == ctx->payload;
+}
+
+static bool streamReceive(ipc_ctx_t *ctx, uint8_t *msg, TickType_t timeout)
+{
+    size_t got = 0;
+    while (got < ctx->payload)
+    {
+        size_t n = xStreamBufferReceive(ctx->stream, msg + got, ctx->payload - got, timeout);
+        if (n == 0)
+            return false;
+        got += n;
+    }
+    return true;
+}
+
+// --- message buffer --------------------------------------------------------
+
+static bool messageCreate(ipc_ctx_t *ctx)
+{
+    // Each message costs its length word as well
+    ctx->messageBuffer = xMessageBufferCreate(IPC_BENCH_DEPTH * (ctx->payload + sizeof(size_t)));
+    return ctx->messageBuffer != NULL;
+}
+
+static void messageDestroy(ipc_ctx_t *ctx)
+{
+    vMessageBufferDelete(ctx->messageBuffer);
+}
+
+static void messageSend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    xMessageBufferSend(ctx->messageBuffer, msg, ctx->payload, portMAX_DELAY);
+}
+
+static bool IRAM_ATTR messageSendFromISR(ipc_ctx_t *ctx, const uint8_t *msg, BaseType_t *woken)
+{
+    return xMessageBufferSendFromISR(ctx->messageBuffer, msg, ctx->payload, woken) == ctx->payload;
+}
+
+static bool messageReceive(ipc_ctx_t *ctx, uint8_t *msg, TickType_t timeout)
+{
+    return xMessageBufferReceive(ctx->messageBuffer, msg, ctx->payload, timeout) == ctx->payload;
+}
+
+// --- SPSC ring + task notification ----------------------------------------
+
+static bool ringCreate(ipc_ctx_t *ctx)
+{
+    ctx->slots = (uint8_t *)pvPortMalloc(IPC_BENCH_DEPTH * ctx->payload);
+    return ctx->slots != NULL;
+}
+
+static void ringDestroy(ipc_ctx_t *ctx)
+{
+    vPortFree(ctx->slots);
+}
+
+static void notifySend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    uint32_t head = ctx->head;
+    while (head - __atomic_load_n(&ctx->tail, __ATOMIC_ACQUIRE) >= IPC_BENCH_DEPTH)
+    {
+        // Full: the consumer notifies us after its next receive. The
+        // 1-tick timeout covers a notification that raced the flag.
+        ctx->producerWaiting = true;
+        if (head - __atomic_load_n(&ctx->tail, __ATOMIC_ACQUIRE) >= IPC_BENCH_DEPTH)
+            ulTaskNotifyTake(pdTRUE, 1);
+        ctx->producerWaiting = false;
+    }
+    memcpy(&ctx->slots[(head % IPC_BENCH_DEPTH) * ctx->payload], msg, ctx->payload);
+    __atomic_store_n(&ctx->head, head + 1, __ATOMIC_RELEASE);
+    xTaskNotifyGive(ctx->consumer);
+}
+
+static bool IRAM_ATTR notifySendFromISR(ipc_ctx_t *ctx, const uint8_t *msg, BaseType_t *woken)
+{
+    uint32_t head = ctx->head;
+    if (head - __atomic_load_n(&ctx->tail, __ATOMIC_ACQUIRE) >= IPC_BENCH_DEPTH)
+        return false;
+    memcpy(&ctx->slots[(head % IPC_BENCH_DEPTH) * ctx->payload], msg, ctx->payload);
+    __atomic_store_n(&ctx->head, head + 1, __ATOMIC_RELEASE);
+    vTaskNotifyGiveFromISR(ctx->consumer, woken);
+    return true;
+}
+
+static bool notifyReceive(ipc_ctx_t *ctx, uint8_t *msg, TickType_t timeout)
+{
+    uint32_t tail = ctx->tail;
+    while (__atomic_load_n(&ctx->head, __ATOMIC_ACQUIRE) == tail)
+    {
+        if (ulTaskNotifyTake(pdTRUE, timeout) == 0 && __atomic_load_n(&ctx->head, __ATOMIC_ACQUIRE) == tail)
+            return false;
+    }
+    memcpy(msg, &ctx->slots[(tail % IPC_BENCH_DEPTH) * ctx->payload], ctx->payload);
+    __atomic_store_n(&ctx->tail, tail + 1, __ATOMIC_RELEASE);
+    if (ctx->producerWaiting && ctx->producer != NULL)
+        xTaskNotifyGive(ctx->producer);
+    return true;
+}
+
+// --- SPSC ring + counting semaphores ---------------------------------------
+
+static bool slotCreate(ipc_ctx_t *ctx)
+{
+    ctx->empty = xSemaphoreCreateCounting(IPC_BENCH_DEPTH, IPC_BENCH_DEPTH);
+    ctx->full = xSemaphoreCreateCounting(IPC_BENCH_DEPTH, 0);
+    return ringCreate(ctx) && ctx->empty != NULL && ctx->full != NULL;
+}
+
+static void slotDestroy(ipc_ctx_t *ctx)
+{
+    if (ctx->empty != NULL)
+        vSemaphoreDelete(ctx->empty);
+    if (ctx->full != NULL)
+        vSemaphoreDelete(ctx->full);
+    ringDestroy(ctx);
+}
+
+static void slotSend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    xSemaphoreTake(ctx->empty, portMAX_DELAY);
+    memcpy(&ctx->slots[(ctx->head % IPC_BENCH_DEPTH) * ctx->payload], msg, ctx->payload);
+    ctx->head = ctx->head + 1;
+    xSemaphoreGive(ctx->full);
+}
+
+static bool IRAM_ATTR slotSendFromISR(ipc_ctx_t *ctx, const uint8_t *msg, BaseType_t *woken)
+{
+    if (xSemaphoreTakeFromISR(ctx->empty, woken) != pdTRUE)
+        return false;
+    memcpy(&ctx->slots[(ctx->head % IPC_BENCH_DEPTH) * ctx->payload], msg, ctx->payload);
+    ctx->head = ctx->head + 1;
+    xSemaphoreGiveFromISR(ctx->full, woken);
+    return true;
+}
+
+static bool slotReceive(ipc_ctx_t *ctx, uint8_t *msg, TickType_t timeout)
+{
+    if (xSemaphoreTake(ctx->full, timeout) != pdTRUE)
+        return false;
+    memcpy(msg, &ctx->slots[(ctx->tail % IPC_BENCH_DEPTH) * ctx->payload], ctx->payload);
+    ctx->tail = ctx->tail + 1;
+    xSemaphoreGive(ctx->empty);
+    return true;
+}
+
+// --- event bus -------------------------------------------------------------
+
+static bool busCreate(ipc_ctx_t *ctx)
+{
+    // A private topic, not registered, so it leaves no trace in reports
+    ctx->topic.name = "ipcBench";
+    ctx->topic.payloadSize = ctx->payload;
+    return eventBusSubscriberInit(&ctx->subscriber, "ipcBench", IPC_BENCH_DEPTH) &&
+           eventBusSubscribe(&ctx->topic, &ctx->subscriber);
+}
+
+static void busDestroy(ipc_ctx_t *ctx)
+{
+    if (ctx->subscriber.queue == NULL)
+        return;
+    event_msg_t *msg;
+    while ((msg = eventBusReceive(&ctx->subscriber, 0)) != NULL)
+    {
+        eventBusRelease(msg);
+    }
+    vQueueDelete(ctx->subscriber.queue);
+}
+
+static void busSend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    // Publishing never blocks and drops on a full subscriber, so hold back
+    // while the subscriber is full (or the block pool is empty)
+    while (ctx->topic.stats.backlog >= IPC_BENCH_DEPTH || !eventBusPublish(&ctx->topic, msg, ctx->payload))
+    {
+        vTaskDelay(1);
+    }
+}
+
+static bool IRAM_ATTR busSendFromISR(ipc_ctx_t *ctx, const uint8_t *msg, BaseType_t *woken)
+{
+    if (ctx->topic.stats.backlog >= IPC_BENCH_DEPTH)
+        return false;
+    return eventBusPublishFromISR(&ctx->topic, msg, ctx->payload, woken);
+}
+
+static bool busReceive(ipc_ctx_t *ctx, uint8_t *msg, TickType_t timeout)
+{
+    event_msg_t *event = eventBusReceive(&ctx->subscriber, timeout);
+    if (event == NULL)
+        return false;
+    memcpy(msg, event->payload, ctx->payload);
+    eventBusRelease(event);
+    return true;
+}
+
+static const ipc_transport_t g_transports[IPC_TRANSPORT_COUNT] = {
+    {"queue", IPC_BENCH_MAX_PAYLOAD, queueCreate, queueDestroy, queueSend, queueSendFromISR, queueReceive},
+    {"stream_buffer", IPC_BENCH_MAX_PAYLOAD, streamCreate, streamDestroy, streamSend, streamSendFromISR, streamReceive},
+    {"message_buffer", IPC_BENCH_MAX_PAYLOAD, messageCreate, messageDestroy, messageSend, messageSendFromISR, messageReceive},
+    {"notify_ring", IPC_BENCH_MAX_PAYLOAD, ringCreate, ringDestroy, notifySend, notifySendFromISR, notifyReceive},
+    {"semaphore_slot", IPC_BENCH_MAX_PAYLOAD, slotCreate, slotDestroy, slotSend, slotSendFromISR, slotReceive},
+    {"event_bus", EVENT_BUS_MAX_PAYLOAD, busCreate, busDestroy, busSend, busSendFromISR, busReceive},
+};
+
+// --- producer / consumer ---------------------------------------------------
+
+static inline void stamp(uint8_t *msg)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    memcpy(msg, &now, sizeof(now));
+}
+
+static void producerTask(void *pvParameter)
+{
+    ipc_ctx_t *ctx = (ipc_ctx_t *)pvParameter;
+    uint8_t msg[IPC_BENCH_MAX_PAYLOAD];
+    memset(msg, 0xA5, ctx->payload);
+
+    ctx->firstSendUs = esp_timer_get_time();
+    for (uint32_t i = 0; i < ctx->messages; i++)
+    {
+        stamp(msg);
+        ctx->transport->send(ctx, msg);
+        ctx->sent = ctx->sent + 1;
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static bool IRAM_ATTR isrProducer(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *userCtx)
+{
+    ipc_ctx_t *ctx = (ipc_ctx_t *)userCtx;
+    if (ctx->sent + ctx->lost >= ctx->messages)
+        return false;
+
+    BaseType_t woken = pdFALSE;
+    stamp(ctx->isrMsg);
+    if (ctx->transport->sendFromISR(ctx, ctx->isrMsg, &woken))
+        ctx->sent = ctx->sent + 1;
+    else
+        ctx->lost = ctx->lost + 1;
+    return woken == pdTRUE;
+}
+
+// Owns the timer; runs on the producer core so the ISR lands there too
+static void isrStarterTask(void *pvParameter)
+{
+    ipc_ctx_t *ctx = (ipc_ctx_t *)pvParameter;
+    gptimer_handle_t timer = NULL;
+
+    gptimer_config_t config = {};
+    config.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+    config.direction = GPTIMER_COUNT_UP;
+    config.resolution_hz = 1000000;
+
+    gptimer_event_callbacks_t callbacks = {};
+    callbacks.on_alarm = isrProducer;
+
+    gptimer_alarm_config_t alarm = {};
+    alarm.alarm_count = IPC_BENCH_ISR_PERIOD_US;
+    alarm.reload_count = 0;
+    alarm.flags.auto_reload_on_alarm = true;
+
+    if (gptimer_new_timer(&config, &timer) == ESP_OK)
+    {
+        gptimer_register_event_callbacks(timer, &callbacks, ctx);
+        gptimer_set_alarm_action(timer, &alarm);
+        gptimer_enable(timer);
+
+        ctx->firstSendUs = esp_timer_get_time();
+        gptimer_start(timer);
+        while (ctx->sent + ctx->lost < ctx->messages)
+        {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        gptimer_stop(timer);
+        gptimer_disable(timer);
+        gptimer_del_timer(timer);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "No free hardware timer for the ISR sender");
+        ctx->lost = ctx->messages;
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void consumerTask(void *pvParameter)
+{
+    ipc_ctx_t *ctx = (ipc_ctx_t *)pvParameter;
+    uint8_t msg[IPC_BENCH_MAX_PAYLOAD];
+
+    while (ctx->received < ctx->messages)
+    {
+        if (!ctx->transport->receive(ctx, msg, pdMS_TO_TICKS(CONSUMER_IDLE_MS)))
+            break;
+        uint32_t sentAt;
+        memcpy(&sentAt, msg, sizeof(sentAt));
+        ctx->lastReceiveUs = esp_timer_get_time();
+        ctx->latencies[ctx->received++] = (uint32_t)ctx->lastReceiveUs - sentAt;
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+// --- runner ----------------------------------------------------------------
+
+static int compareU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+const char *ipcTransportName(ipc_transport_kind_t transport)
+{
+    return transport < IPC_TRANSPORT_COUNT ? g_transports[transport].name : "?";
+}
+
+// Only once neither task can touch ctx any more
+static void freeRun(ipc_ctx_t *ctx)
+{
+    ctx->transport->destroy(ctx);
+    vSemaphoreDelete(ctx->done);
+    vPortFree(ctx->latencies);
+    vPortFree(ctx);
+}
+
+bool ipcBenchRun(const ipc_bench_config_t *config, ipc_bench_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    if (config->transport >= IPC_TRANSPORT_COUNT || config->messages == 0)
+        return false;
+    const ipc_transport_t *transport = &g_transports[config->transport];
+    if (config->payload < sizeof(uint32_t) || config->payload > transport->maxPayload)
+        return false;
+    if (config->placement == IPC_CROSS_CORE && portNUM_PROCESSORS < 2)
+        return false;
+
+    ipc_ctx_t *ctx = (ipc_ctx_t *)pvPortMalloc(sizeof(ipc_ctx_t));
+    uint32_t *latencies = (uint32_t *)pvPortMalloc(sizeof(uint32_t) * config->messages);
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(2, 0);
+    if (ctx == NULL || latencies == NULL || done == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate run state!");
+        vPortFree(ctx);
+        vPortFree(latencies);
+        if (done != NULL)
+            vSemaphoreDelete(done);
+        return false;
+    }
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->transport = transport;
+    ctx->payload = config->payload;
+    ctx->messages = config->messages;
+    ctx->latencies = latencies;
+    ctx->done = done;
+
+    size_t heapBefore = esp_get_free_heap_size();
+    bool created = transport->create(ctx);
+    result->ramBytes = heapBefore - esp_get_free_heap_size();
+    if (!created)
+    {
+        ESP_LOGE(TAG, "Failed to create %s", transport->name);
+        freeRun(ctx);
+        return false;
+    }
+
+    BaseType_t producerCore = 0;
+    BaseType_t consumerCore = (config->placement == IPC_CROSS_CORE) ? 1 : 0;
+    UBaseType_t producerPriority = BASE_PRIORITY + (config->producerHigher ? 1 : 0);
+    UBaseType_t consumerPriority = BASE_PRIORITY + (config->producerHigher ? 0 : 1);
+
+    // Consumer first, so its handle exists before anything is sent
+    if (xTaskCreatePinnedToCore(consumerTask, "ipcConsumer", TASK_STACK, ctx, consumerPriority, &ctx->consumer,
+                                consumerCore) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create the consumer task!");
+        freeRun(ctx);
+        return false;
+    }
+    BaseType_t producerCreated;
+    if (config->sender == IPC_SENDER_TASK)
+        producerCreated = xTaskCreatePinnedToCore(producerTask, "ipcProducer", TASK_STACK, ctx, producerPriority,
+                                                  &ctx->producer, producerCore);
+    else
+        producerCreated = xTaskCreatePinnedToCore(isrStarterTask, "ipcIsrStart", TASK_STACK, ctx, producerPriority,
+                                                  NULL, producerCore);
+    if (producerCreated != pdPASS)
+    {
+        // Nothing will arrive, so the consumer leaves after CONSUMER_IDLE_MS
+        ESP_LOGE(TAG, "Failed to create the producer task!");
+        xSemaphoreTake(done, portMAX_DELAY);
+        freeRun(ctx);
+        return false;
+    }
+
+    TickType_t limit = pdMS_TO_TICKS(5000 + config->messages);
+    if (xSemaphoreTake(done, limit) != pdTRUE || xSemaphoreTake(done, limit) != pdTRUE)
+    {
+        // A task may still be using ctx, so it is deliberately leaked
+        ESP_LOGE(TAG, "%s run timed out", transport->name);
+        return false;
+    }
+
+    result->sent = ctx->sent;
+    result->received = ctx->received;
+    result->lost = ctx->lost;
+    if (ctx->received > 0)
+    {
+        qsort(latencies, ctx->received, sizeof(uint32_t), compareU32);
+        result->p50Us = latencies[ctx->received / 2];
+        result->p99Us = latencies[(ctx->received * 99) / 100];
+        result->maxUs = latencies[ctx->received - 1];
+        int64_t elapsed = ctx->lastReceiveUs - ctx->firstSendUs;
+        result->opsPerSec = elapsed > 0 ? (uint32_t)((int64_t)ctx->received * 1000000 / elapsed) : 0;
+    }
+
+    freeRun(ctx);
+    return true;
+}
+
+void ipcBenchMatrix(uint32_t messages)
+{
+    static const uint16_t payloads[] = {4, 32, 128, 512};
+    uint32_t rows = 0;
+
+    ESP_LOGI(TAG, "Running IPC matrix, %lu messages per combination", (unsigned long)messages);
+
+    // Plain printf: the rows are meant to be cut out of the log as CSV
+    printf("ipc,transport,payload,placement,priority,sender,sent,received,lost,ops_per_sec,p50_us,p99_us,max_us,"
+           "ram_bytes\n");
+    for (int t = 0; t < IPC_TRANSPORT_COUNT; t++)
+    {
+        for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++)
+        {
+            for (int placement = IPC_SAME_CORE; placement <= IPC_CROSS_CORE; placement++)
+            {
+                // Three variants: task sender above/below the consumer, ISR sender
+                for (int variant = 0; variant < 3; variant++)
+                {
+                    ipc_bench_config_t config = {};
+                    config.transport = (ipc_transport_kind_t)t;
+                    config.payload = payloads[p];
+                    config.placement = (ipc_placement_t)placement;
+                    config.producerHigher = (variant == 0);
+                    config.sender = (variant == 2) ? IPC_SENDER_ISR : IPC_SENDER_TASK;
+                    config.messages = messages;
+
+                    ipc_bench_result_t r;
+                    if (!ipcBenchRun(&config, &r))
+                        continue;
+
+                    printf("ipc,%s,%u,%s,%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", ipcTransportName(config.transport),
+                           config.payload, placement == IPC_SAME_CORE ? "same_core" : "cross_core",
+                           variant == 2 ? "isr" : (config.producerHigher ? "producer_high" : "consumer_high"),
+                           variant == 2 ? "isr" : "task", (unsigned long)r.sent, (unsigned long)r.received,
+                           (unsigned long)r.lost, (unsigned long)r.opsPerSec, (unsigned long)r.p50Us,
+                           (unsigned long)r.p99Us, (unsigned long)r.maxUs, (unsigned long)r.ramBytes);
+                    rows++;
+                }
+            }
+        }
+    }
+    ESP_LOGI(TAG, "IPC matrix done: %lu rows", (unsigned long)rows);
+}
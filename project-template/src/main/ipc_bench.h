@@ -0,0 +1,96 @@
+/**
+ * IPC benchmark matrix
+ *
+ * The exercises pick xQueueCreate (Day 4), xSemaphoreCreateBinary (Day 5)
+ * and mutexes by habit. This measures every transport between a producer
+ * and a consumer so the choice can be made from data:
+ *
+ *   queue            xQueueSend / xQueueReceive, payload copied twice
+ *   stream buffer    xStreamBufferSend / Receive, byte stream
+ *   message buffer   xMessageBufferSend / Receive, length-prefixed
+ *   notify ring      SPSC ring + xTaskNotifyGive, no kernel object
+ *   semaphore slot   SPSC ring guarded by empty/full counting semaphores
+ *   event bus        eventBusPublish / Receive (event_bus.h), one subscriber
+ *
+ * across payload sizes, same-core vs cross-core placement, producer above
+ * or below the consumer in priority, and a task or a timer ISR as sender.
+ *
+ * Every message carries its send time (esp_timer, 1 us resolution, shared
+ * by both cores), so latency is measured one way. A task sender pushes
+ * messages as fast as the transport accepts them, so ops/s is the
+ * saturated throughput. An ISR sender fires every IPC_BENCH_ISR_PERIOD_US
+ * and drops messages when the transport is full, so its ops/s is capped
+ * and `lost` is the interesting figure.
+ *
+ * ipcBenchMatrix() prints one CSV row per combination, prefixed with
+ * "ipc," so the table can be cut out of a monitor log:
+ *
+ *   pio device monitor | grep '^ipc,' > ipc.csv
+ *
+ * ipc_bench_host.cpp produces the same table on a PC for the transports
+ * that need no FreeRTOS object (the notify ring). Its header lists the
+ * rows that have no host result and why.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define IPC_BENCH_DEPTH 8 // messages each transport can hold
+#define IPC_BENCH_MAX_PAYLOAD 512
+#define IPC_BENCH_ISR_PERIOD_US 50
+
+typedef enum
+{
+    IPC_QUEUE = 0,
+    IPC_STREAM_BUFFER,
+    IPC_MESSAGE_BUFFER,
+    IPC_NOTIFY_RING,
+    IPC_SEMAPHORE_SLOT,
+    IPC_EVENT_BUS,
+    IPC_TRANSPORT_COUNT
+} ipc_transport_kind_t;
+
+typedef enum
+{
+    IPC_SAME_CORE = 0,
+    IPC_CROSS_CORE
+} ipc_placement_t;
+
+typedef enum
+{
+    IPC_SENDER_TASK = 0,
+    IPC_SENDER_ISR
+} ipc_sender_t;
+
+typedef struct
+{
+    ipc_transport_kind_t transport;
+    uint16_t payload; // bytes, 4..IPC_BENCH_MAX_PAYLOAD
+    ipc_placement_t placement;
+    bool producerHigher; // producer priority above the consumer's
+    ipc_sender_t sender;
+    uint32_t messages;
+} ipc_bench_config_t;
+
+typedef struct
+{
+    uint32_t sent;
+    uint32_t received;
+    uint32_t lost; // ISR sender only: transport was full
+    uint32_t opsPerSec;
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+    uint32_t ramBytes; // heap taken by the transport itself
+} ipc_bench_result_t;
+
+const char *ipcTransportName(ipc_transport_kind_t transport);
+
+// Runs one combination. Returns false if it is not supported (payload too
+// big for the transport, cross-core on a single-core chip) or failed.
+bool ipcBenchRun(const ipc_bench_config_t *config, ipc_bench_result_t *result);
+
+// Runs every combination and prints the CSV table.
+void ipcBenchMatrix(uint32_t messages);
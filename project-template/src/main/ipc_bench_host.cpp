@@ -0,0 +1,265 @@
+/**
+ * IPC benchmark matrix, host build
+ *
+ * Runs the transports of ipc_bench.h that do not need a FreeRTOS kernel
+ * object, with the same producer and consumer loop and the same CSV
+ * columns as ipcBenchMatrix(). Host-only: the whole file is under
+ * IPC_HOST_MAIN, so the firmware build (which compiles everything under
+ * src/) gets nothing from it.
+ *
+ *   notify ring      the target's SPSC ring, with a mutex/condvar counting
+ *                    notification standing in for the task notification
+ *   std queue        std::mutex + std::condition_variable bounded queue,
+ *                    the nearest host equivalent of xQueue (reference only)
+ *
+ *   g++ -std=c++17 -O2 -pthread -DIPC_HOST_MAIN ipc_bench_host.cpp -o ipc && ./ipc | grep '^ipc,'
+ *
+ * Rows that have no host result, and why:
+ *
+ *   queue, stream buffer, message buffer, semaphore slot, event bus
+ *                    FreeRTOS kernel objects; a host number would measure
+ *                    whatever stands in for them, not the objects
+ *   msg_channel      its ring is plain C, but reserve/receive block on
+ *                    FreeRTOS binary semaphores and read the tick count
+ *   cross_core       the host scheduler places the threads
+ *   priorities       both threads run at the default priority (setting
+ *                    real-time priorities needs root), reported as "equal"
+ *   isr sender       there is no interrupt on the host
+ *
+ * Latencies are printed in microseconds with two decimals; host figures
+ * are too small for the target's whole microseconds.
+ */
+
+#ifdef IPC_HOST_MAIN
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ipc_bench.h"
+
+#define CONSUMER_IDLE_MS 200 // as ipc_bench.cpp
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+// ulTaskNotifyTake(pdTRUE, timeout) / xTaskNotifyGive
+typedef struct
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t count;
+} host_notify_t;
+
+static void notifyGive(host_notify_t *n)
+{
+    {
+        std::lock_guard<std::mutex> guard(n->lock);
+        n->count++;
+    }
+    n->cv.notify_one();
+}
+
+static uint32_t notifyTake(host_notify_t *n, uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> guard(n->lock);
+    n->cv.wait_for(guard, std::chrono::milliseconds(timeoutMs), [n] { return n->count > 0; });
+    uint32_t count = n->count;
+    n->count = 0;
+    return count;
+}
+
+typedef struct ipc_ctx ipc_ctx_t;
+
+typedef struct
+{
+    const char *name;
+    void (*send)(ipc_ctx_t *ctx, const uint8_t *msg);
+    bool (*receive)(ipc_ctx_t *ctx, uint8_t *msg, uint32_t timeoutMs);
+} ipc_transport_t;
+
+struct ipc_ctx
+{
+    const ipc_transport_t *transport;
+    uint16_t payload;
+    uint32_t messages;
+    uint8_t slots[IPC_BENCH_DEPTH * IPC_BENCH_MAX_PAYLOAD];
+
+    // notify ring
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<bool> producerWaiting;
+    host_notify_t producerNotify;
+    host_notify_t consumerNotify;
+
+    // std queue
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    uint32_t count;
+
+    uint32_t sent;
+    uint32_t received;
+    bench_clock_t::time_point firstSend;
+    bench_clock_t::time_point lastReceive;
+    std::vector<uint32_t> latenciesNs;
+};
+
+// --- SPSC ring + notification ----------------------------------------------
+
+static void notifySend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    uint32_t head = ctx->head.load(std::memory_order_relaxed);
+    while (head - ctx->tail.load(std::memory_order_acquire) >= IPC_BENCH_DEPTH)
+    {
+        ctx->producerWaiting = true;
+        if (head - ctx->tail.load(std::memory_order_acquire) >= IPC_BENCH_DEPTH)
+            notifyTake(&ctx->producerNotify, 1);
+        ctx->producerWaiting = false;
+    }
+    memcpy(&ctx->slots[(head % IPC_BENCH_DEPTH) * ctx->payload], msg, ctx->payload);
+    ctx->head.store(head + 1, std::memory_order_release);
+    notifyGive(&ctx->consumerNotify);
+}
+
+static bool notifyReceive(ipc_ctx_t *ctx, uint8_t *msg, uint32_t timeoutMs)
+{
+    uint32_t tail = ctx->tail.load(std::memory_order_relaxed);
+    while (ctx->head.load(std::memory_order_acquire) == tail)
+    {
+        if (notifyTake(&ctx->consumerNotify, timeoutMs) == 0 && ctx->head.load(std::memory_order_acquire) == tail)
+            return false;
+    }
+    memcpy(msg, &ctx->slots[(tail % IPC_BENCH_DEPTH) * ctx->payload], ctx->payload);
+    ctx->tail.store(tail + 1, std::memory_order_release);
+    if (ctx->producerWaiting)
+        notifyGive(&ctx->producerNotify);
+    return true;
+}
+
+// --- mutex/condvar queue ---------------------------------------------------
+
+static void queueSend(ipc_ctx_t *ctx, const uint8_t *msg)
+{
+    std::unique_lock<std::mutex> guard(ctx->lock);
+    ctx->notFull.wait(guard, [ctx] { return ctx->count < IPC_BENCH_DEPTH; });
+    uint32_t head = ctx->head.load(std::memory_order_relaxed);
+    memcpy(&ctx->slots[(head % IPC_BENCH_DEPTH) * ctx->payload], msg, ctx->payload);
+    ctx->head.store(head + 1, std::memory_order_relaxed);
+    ctx->count++;
+    guard.unlock();
+    ctx->notEmpty.notify_one();
+}
+
+static bool queueReceive(ipc_ctx_t *ctx, uint8_t *msg, uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> guard(ctx->lock);
+    if (!ctx->notEmpty.wait_for(guard, std::chrono::milliseconds(timeoutMs), [ctx] { return ctx->count > 0; }))
+        return false;
+    uint32_t tail = ctx->tail.load(std::memory_order_relaxed);
+    memcpy(msg, &ctx->slots[(tail % IPC_BENCH_DEPTH) * ctx->payload], ctx->payload);
+    ctx->tail.store(tail + 1, std::memory_order_relaxed);
+    ctx->count--;
+    guard.unlock();
+    ctx->notFull.notify_one();
+    return true;
+}
+
+static const ipc_transport_t g_transports[] = {
+    {"notify ring", notifySend, notifyReceive},
+    {"std queue", queueSend, queueReceive},
+};
+
+// --- producer / consumer ---------------------------------------------------
+
+static uint32_t nowNs(void)
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock_t::now().time_since_epoch())
+        .count();
+}
+
+static void producer(ipc_ctx_t *ctx)
+{
+    uint8_t msg[IPC_BENCH_MAX_PAYLOAD];
+    memset(msg, 0xA5, ctx->payload);
+
+    ctx->firstSend = bench_clock_t::now();
+    for (uint32_t i = 0; i < ctx->messages; i++)
+    {
+        uint32_t now = nowNs();
+        memcpy(msg, &now, sizeof(now));
+        ctx->transport->send(ctx, msg);
+        ctx->sent++;
+    }
+}
+
+static void consumer(ipc_ctx_t *ctx)
+{
+    uint8_t msg[IPC_BENCH_MAX_PAYLOAD];
+    while (ctx->received < ctx->messages)
+    {
+        if (!ctx->transport->receive(ctx, msg, CONSUMER_IDLE_MS))
+            break;
+        uint32_t sentAt;
+        memcpy(&sentAt, msg, sizeof(sentAt));
+        ctx->latenciesNs[ctx->received++] = nowNs() - sentAt;
+    }
+    ctx->lastReceive = bench_clock_t::now();
+}
+
+static void runOne(const ipc_transport_t *transport, uint16_t payload, uint32_t messages)
+{
+    ipc_ctx_t *ctx = new ipc_ctx_t();
+    ctx->transport = transport;
+    ctx->payload = payload;
+    ctx->messages = messages;
+    ctx->latenciesNs.resize(messages);
+
+    std::thread consumerThread(consumer, ctx);
+    std::thread producerThread(producer, ctx);
+    producerThread.join();
+    consumerThread.join();
+
+    double p50 = 0, p99 = 0, maxUs = 0, opsPerSec = 0;
+    if (ctx->received > 0)
+    {
+        std::sort(ctx->latenciesNs.begin(), ctx->latenciesNs.begin() + ctx->received);
+        p50 = ctx->latenciesNs[ctx->received / 2] / 1000.0;
+        p99 = ctx->latenciesNs[(ctx->received * 99) / 100] / 1000.0;
+        maxUs = ctx->latenciesNs[ctx->received - 1] / 1000.0;
+        double seconds = std::chrono::duration<double>(ctx->lastReceive - ctx->firstSend).count();
+        opsPerSec = seconds > 0 ? ctx->received / seconds : 0;
+    }
+
+    // RAM: the slots; the std queue adds its mutex and two condvars
+    size_t ram = IPC_BENCH_DEPTH * payload;
+    if (transport->send == queueSend)
+        ram += sizeof(std::mutex) + 2 * sizeof(std::condition_variable);
+
+    printf("ipc,%s,%u,host,equal,task,%lu,%lu,0,%.0f,%.2f,%.2f,%.2f,%lu\n", transport->name, payload,
+           (unsigned long)ctx->sent, (unsigned long)ctx->received, opsPerSec, p50, p99, maxUs, (unsigned long)ram);
+    delete ctx;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint16_t payloads[] = {4, 32, 128, 512};
+    uint32_t messages = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+
+    printf("ipc,transport,payload,placement,priority,sender,sent,received,lost,ops_per_sec,p50_us,p99_us,max_us,"
+           "ram_bytes\n");
+    for (const ipc_transport_t &transport : g_transports)
+    {
+        for (uint16_t payload : payloads)
+            runOne(&transport, payload, messages);
+    }
+    return 0;
+}
+
+#endif // IPC_HOST_MAIN
@@ -0,0 +1,668 @@
+#include "job_system.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static const char *TAG = "Jobs";
+
+// --- platform --------------------------------------------------------------
+
+#ifdef JOB_HOST_MAIN
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define ESP_LOGI(tag, format, ...) printf("%s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE ESP_LOGI
+
+// Counting wakeup with the same semantics as a task notification: a give
+// before the take is kept
+struct job_waiter
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t count;
+};
+
+static job_waiter_t g_workerWaiters[JOB_MAX_WORKERS];
+static std::thread g_threads[JOB_MAX_WORKERS];
+static thread_local job_waiter_t t_ownWaiter;
+static thread_local job_waiter_t *t_self = NULL;
+static std::mutex g_injectLock;
+
+static job_waiter_t *selfWaiter(void)
+{
+    return t_self != NULL ? t_self : &t_ownWaiter;
+}
+
+static void notify(job_waiter_t *waiter)
+{
+    std::lock_guard<std::mutex> guard(waiter->lock);
+    waiter->count++;
+    waiter->cv.notify_one();
+}
+
+static void sleepUntilNotified(void)
+{
+    job_waiter_t *self = selfWaiter();
+    std::unique_lock<std::mutex> guard(self->lock);
+    self->cv.wait(guard, [self] { return self->count > 0; });
+    self->count = 0;
+}
+
+static void injectLock(void)
+{
+    g_injectLock.lock();
+}
+
+static void injectUnlock(void)
+{
+    g_injectLock.unlock();
+}
+
+static int64_t nowUs(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static uint8_t coreCount(void)
+{
+    return JOB_MAX_WORKERS;
+}
+#else
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static portMUX_TYPE g_injectLock = portMUX_INITIALIZER_UNLOCKED;
+
+static job_waiter_t *selfWaiter(void)
+{
+    return (job_waiter_t *)xTaskGetCurrentTaskHandle();
+}
+
+static void notify(job_waiter_t *waiter)
+{
+    xTaskNotifyGive((TaskHandle_t)waiter);
+}
+
+static void sleepUntilNotified(void)
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+static void injectLock(void)
+{
+    portENTER_CRITICAL(&g_injectLock);
+}
+
+static void injectUnlock(void)
+{
+    portEXIT_CRITICAL(&g_injectLock);
+}
+
+static int64_t nowUs(void)
+{
+    return esp_timer_get_time();
+}
+
+static uint8_t coreCount(void)
+{
+    // One core: a worker could only time-slice with the submitter
+    return portNUM_PROCESSORS > 1 ? portNUM_PROCESSORS : 0;
+}
+#endif
+
+#define DEQUE_MASK (JOB_DEQUE_SIZE - 1)
+#define PARALLEL_MAX_BLOCKS 32 // range descriptors kept on the caller's stack
+
+typedef struct
+{
+    job_fn_t fn;
+    void *arg;
+    job_counter_t *counter;
+} job_t;
+
+// Bounded Chase-Lev deque: the owner pushes/pops at bottom, thieves CAS top
+typedef struct
+{
+    std::atomic<int32_t> top;
+    std::atomic<int32_t> bottom;
+    job_t jobs[JOB_DEQUE_SIZE];
+} job_deque_t;
+
+typedef struct
+{
+    job_waiter_t *waiter; // the worker's task or thread
+    job_deque_t deque;
+    uint32_t executed;
+    uint32_t stolen;
+} job_worker_t;
+
+static job_worker_t g_workers[JOB_MAX_WORKERS];
+static uint8_t g_workerCount = 0;
+static std::atomic<bool> g_stopping(false);
+static std::atomic<uint8_t> g_exited(0);
+static std::atomic<uint32_t> g_helperStolen(0); // steals by tasks in jobWait() that are not workers
+static job_waiter_t *g_shutdownWaiter = NULL;
+
+// jobWait() moves a counter's waiter to this once the last job has
+// finished with the counter
+#define WAIT_DONE ((job_waiter_t *)(uintptr_t)1)
+
+// Jobs from tasks that are not workers
+static job_t g_inject[JOB_INJECT_SIZE];
+static uint8_t g_injectHead = 0;
+static uint8_t g_injectCount = 0;
+
+// --- deque -----------------------------------------------------------------
+
+static bool dequePush(job_deque_t *d, const job_t *job)
+{
+    int32_t b = d->bottom.load(std::memory_order_relaxed);
+    int32_t t = d->top.load(std::memory_order_acquire);
+    if (b - t >= JOB_DEQUE_SIZE)
+        return false;
+    d->jobs[b & DEQUE_MASK] = *job;
+    std::atomic_thread_fence(std::memory_order_release);
+    d->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+static bool dequePop(job_deque_t *d, job_t *out)
+{
+    int32_t b = d->bottom.load(std::memory_order_relaxed) - 1;
+    d->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int32_t t = d->top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        d->bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    *out = d->jobs[b & DEQUE_MASK];
+    if (t == b)
+    {
+        // Last job: race any thief for it
+        bool won = d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        d->bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+static bool dequeSteal(job_deque_t *d, job_t *out)
+{
+    int32_t t = d->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int32_t b = d->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return false;
+
+    job_t job = d->jobs[t & DEQUE_MASK];
+    if (!d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return false;
+    *out = job;
+    return true;
+}
+
+// --- scheduling ------------------------------------------------------------
+
+static int8_t currentWorker(void)
+{
+    job_waiter_t *self = selfWaiter();
+    for (uint8_t i = 0; i < g_workerCount; i++)
+    {
+        if (g_workers[i].waiter == self)
+            return (int8_t)i;
+    }
+    return -1;
+}
+
+static void runJob(const job_t *job)
+{
+    job->fn(job->arg);
+    // The waiter is read after the decrement, so a waiter that registered
+    // before it is always seen. The exchange is the last access to the
+    // counter: jobWait() returns as soon as it sees WAIT_DONE, and the
+    // counter may live on its stack.
+    if (job->counter != NULL && job->counter->pending.fetch_sub(1) == 1)
+    {
+        job_waiter_t *waiter = job->counter->waiter.exchange(WAIT_DONE);
+        if (waiter != NULL)
+            notify(waiter);
+    }
+}
+
+// Own deque first, then the injection ring, then the other workers
+static bool findJob(int8_t self, job_t *out)
+{
+    if (self >= 0 && dequePop(&g_workers[self].deque, out))
+        return true;
+
+    bool injected = false;
+    injectLock();
+    if (g_injectCount > 0)
+    {
+        *out = g_inject[g_injectHead];
+        g_injectHead = (g_injectHead + 1) % JOB_INJECT_SIZE;
+        g_injectCount--;
+        injected = true;
+    }
+    injectUnlock();
+    if (injected)
+        return true;
+
+    for (uint8_t i = 0; i < g_workerCount; i++)
+    {
+        if ((int8_t)i != self && dequeSteal(&g_workers[i].deque, out))
+        {
+            if (self >= 0)
+                g_workers[self].stolen++;
+            else
+                g_helperStolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void wakeWorkers(int8_t self)
+{
+    for (uint8_t i = 0; i < g_workerCount; i++)
+    {
+        if ((int8_t)i != self)
+            notify(g_workers[i].waiter);
+    }
+}
+
+static void workerLoop(job_worker_t *worker)
+{
+    int8_t self = (int8_t)(worker - g_workers);
+    job_t job;
+
+    while (!g_stopping.load())
+    {
+        if (findJob(self, &job))
+        {
+            runJob(&job);
+            worker->executed++;
+        }
+        else
+        {
+            // Every submit notifies, and a notification that arrives
+            // before we sleep is kept, so no wakeup is lost
+            sleepUntilNotified();
+        }
+    }
+    if (g_exited.fetch_add(1) + 1 == g_workerCount)
+        notify(g_shutdownWaiter);
+}
+
+#ifndef JOB_HOST_MAIN
+static void workerTask(void *pvParameter)
+{
+    workerLoop((job_worker_t *)pvParameter);
+    vTaskDelete(NULL);
+}
+#endif
+
+static bool startWorker(uint8_t i, uint8_t priority)
+{
+#ifdef JOB_HOST_MAIN
+    (void)priority;
+    g_workers[i].waiter = &g_workerWaiters[i];
+    g_threads[i] = std::thread([i]() {
+        t_self = &g_workerWaiters[i];
+        workerLoop(&g_workers[i]);
+    });
+    return true;
+#else
+    // The handle is written before the task can run
+    return xTaskCreatePinnedToCore(workerTask, "jobWorker", JOB_WORKER_STACK, &g_workers[i], priority,
+                                   (TaskHandle_t *)&g_workers[i].waiter, i) == pdPASS;
+#endif
+}
+
+// --- public API ------------------------------------------------------------
+
+void jobSystemInit(uint8_t workers, uint8_t priority)
+{
+    if (g_workerCount > 0)
+        return;
+    if (workers > coreCount())
+        workers = coreCount();
+    if (workers > JOB_MAX_WORKERS)
+        workers = JOB_MAX_WORKERS;
+
+    g_stopping.store(false);
+    g_exited.store(0);
+    g_helperStolen.store(0);
+    for (uint8_t i = 0; i < workers; i++)
+    {
+        g_workers[i].executed = 0;
+        g_workers[i].stolen = 0;
+        g_workers[i].deque.top.store(0);
+        g_workers[i].deque.bottom.store(0);
+    }
+    // Workers look each other up by index, so publish the count before
+    // the first one starts and trim it if one fails
+    g_workerCount = workers;
+    for (uint8_t i = 0; i < workers; i++)
+    {
+        if (!startWorker(i, priority))
+        {
+            ESP_LOGE(TAG, "Failed to create worker %u", i);
+            g_workerCount = i;
+            break;
+        }
+    }
+    ESP_LOGI(TAG, "Job system: %u workers%s", g_workerCount, g_workerCount == 0 ? " (inline mode)" : "");
+}
+
+void jobSystemShutdown(void)
+{
+    if (g_workerCount == 0)
+        return;
+    g_shutdownWaiter = selfWaiter();
+    g_stopping.store(true);
+    wakeWorkers(-1);
+    while (g_exited.load() < g_workerCount)
+        sleepUntilNotified();
+#ifdef JOB_HOST_MAIN
+    for (uint8_t i = 0; i < g_workerCount; i++)
+        g_threads[i].join();
+#endif
+    g_workerCount = 0;
+}
+
+uint8_t jobWorkerCount(void)
+{
+    return g_workerCount;
+}
+
+void jobCounterInit(job_counter_t *counter)
+{
+    counter->pending.store(1); // jobWait's share, so 0 means waited and done
+    counter->waiter.store(NULL);
+}
+
+void jobSubmit(job_counter_t *counter, job_fn_t fn, void *arg)
+{
+    job_t job = {fn, arg, counter};
+    if (counter != NULL)
+        counter->pending.fetch_add(1);
+
+    if (g_workerCount == 0)
+    {
+        runJob(&job);
+        return;
+    }
+
+    int8_t self = currentWorker();
+    bool queued = false;
+    if (self >= 0)
+    {
+        queued = dequePush(&g_workers[self].deque, &job);
+    }
+    else
+    {
+        injectLock();
+        if (g_injectCount < JOB_INJECT_SIZE)
+        {
+            g_inject[(g_injectHead + g_injectCount) % JOB_INJECT_SIZE] = job;
+            g_injectCount++;
+            queued = true;
+        }
+        injectUnlock();
+    }
+
+    if (queued)
+        wakeWorkers(self);
+    else
+        runJob(&job);
+}
+
+void jobWait(job_counter_t *counter)
+{
+    int8_t self = currentWorker();
+    job_t job;
+
+    // Help with anything queued rather than sit idle
+    while (counter->pending.load() > 1)
+    {
+        if (!findJob(self, &job))
+            break;
+        runJob(&job);
+        if (self >= 0)
+            g_workers[self].executed++;
+    }
+
+    // Register before dropping our share: whichever job then brings
+    // pending to 0 is guaranteed to see the waiter
+    counter->waiter.store(selfWaiter());
+    if (counter->pending.fetch_sub(1) == 1)
+        return;
+
+    // The rest is already running elsewhere; sleep until the last one ends
+    while (counter->waiter.load() != WAIT_DONE)
+    {
+        sleepUntilNotified();
+    }
+}
+
+typedef struct
+{
+    job_range_fn_t fn;
+    void *ctx;
+    uint32_t begin;
+    uint32_t end;
+} range_job_t;
+
+static void runRange(void *arg)
+{
+    range_job_t *range = (range_job_t *)arg;
+    range->fn(range->ctx, range->begin, range->end);
+}
+
+void jobParallelFor(uint32_t count, uint32_t blockSize, job_range_fn_t fn, void *ctx)
+{
+    if (count == 0)
+        return;
+    if (blockSize == 0)
+        blockSize = 1;
+    if ((count + blockSize - 1) / blockSize > PARALLEL_MAX_BLOCKS)
+        blockSize = (count + PARALLEL_MAX_BLOCKS - 1) / PARALLEL_MAX_BLOCKS;
+
+    if (g_workerCount == 0)
+    {
+        fn(ctx, 0, count);
+        return;
+    }
+
+    range_job_t ranges[PARALLEL_MAX_BLOCKS];
+    job_counter_t counter;
+    jobCounterInit(&counter);
+
+    uint32_t blocks = 0;
+    for (uint32_t begin = 0; begin < count; begin += blockSize)
+    {
+        range_job_t *range = &ranges[blocks++];
+        range->fn = fn;
+        range->ctx = ctx;
+        range->begin = begin;
+        range->end = (begin + blockSize < count) ? begin + blockSize : count;
+        jobSubmit(&counter, runRange, range);
+    }
+    jobWait(&counter);
+}
+
+void jobReport(void)
+{
+    ESP_LOGI(TAG, "========== Job system (%u workers) ==========", g_workerCount);
+    for (uint8_t i = 0; i < g_workerCount; i++)
+    {
+        ESP_LOGI(TAG, "  worker %u: executed=%lu stolen=%lu", i,
+                 (unsigned long)g_workers[i].executed, (unsigned long)g_workers[i].stolen);
+    }
+    ESP_LOGI(TAG, "  waiting callers: stolen=%lu", (unsigned long)g_helperStolen.load());
+}
+
+static uint32_t totalStolen(void)
+{
+    uint32_t total = g_helperStolen.load();
+    for (uint8_t i = 0; i < g_workerCount; i++)
+        total += g_workers[i].stolen;
+    return total;
+}
+
+// --- benchmark -------------------------------------------------------------
+
+typedef struct
+{
+    const float *in;
+    float *out;
+} batch_ctx_t;
+
+// Stand-in for per-sample sensor processing: a short FIR + magnitude
+static void processBatch(void *ctx, uint32_t begin, uint32_t end)
+{
+    batch_ctx_t *batch = (batch_ctx_t *)ctx;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        float acc = batch->in[i];
+        for (uint32_t k = 1; k < 8 && k <= i; k++)
+        {
+            acc += batch->in[i - k] * (1.0f / (k + 1));
+        }
+        batch->out[i] = sqrtf(acc * acc + 1.0f);
+    }
+}
+
+typedef struct
+{
+    batch_ctx_t *batch;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t grain;
+} split_job_t;
+
+// Fork/join inside the workers: a job halves its range, pushes one half on
+// its own deque and carries on with the other. The other workers can only
+// get at those halves by stealing them.
+static void splitRange(void *arg)
+{
+    split_job_t *job = (split_job_t *)arg;
+    if (job->end - job->begin <= job->grain)
+    {
+        processBatch(job->batch, job->begin, job->end);
+        return;
+    }
+    uint32_t mid = job->begin + (job->end - job->begin) / 2;
+    split_job_t left = {job->batch, job->begin, mid, job->grain};
+    split_job_t right = {job->batch, mid, job->end, job->grain};
+    job_counter_t counter;
+    jobCounterInit(&counter);
+    jobSubmit(&counter, splitRange, &left);
+    splitRange(&right);
+    jobWait(&counter);
+}
+
+typedef enum
+{
+    RUN_SERIAL = 0,
+    RUN_PARALLEL_FOR,
+    RUN_NESTED
+} run_kind_t;
+
+static void runNested(batch_ctx_t *batch, uint32_t samples)
+{
+    // At most 64 leaves keeps the recursion (and worker stack) shallow
+    split_job_t root = {batch, 0, samples, samples / 64 > 256 ? samples / 64 : 256};
+    job_counter_t counter;
+    jobCounterInit(&counter);
+    jobSubmit(&counter, splitRange, &root);
+    jobWait(&counter);
+}
+
+// Best of a few runs, so one descheduled run does not decide the result
+static int64_t timeRun(batch_ctx_t *batch, uint32_t samples, run_kind_t kind)
+{
+    int64_t best = INT64_MAX;
+    for (int run = 0; run < 5; run++)
+    {
+        int64_t start = nowUs();
+        if (kind == RUN_PARALLEL_FOR)
+            jobParallelFor(samples, 256, processBatch, batch);
+        else if (kind == RUN_NESTED)
+            runNested(batch, samples);
+        else
+            processBatch(batch, 0, samples);
+        int64_t elapsed = nowUs() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+void jobBenchmark(uint32_t samples, uint8_t maxWorkers, uint8_t priority)
+{
+    float *in = (float *)malloc(sizeof(float) * samples);
+    float *out = (float *)malloc(sizeof(float) * samples);
+    if (in == NULL || out == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate benchmark buffers!");
+        free(in);
+        free(out);
+        return;
+    }
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        in[i] = (float)(i % 100) * 0.01f;
+    }
+    batch_ctx_t batch = {in, out};
+
+    int64_t serialUs = timeRun(&batch, samples, RUN_SERIAL);
+    ESP_LOGI(TAG, "%lu samples: serial %lld us", (unsigned long)samples, (long long)serialUs);
+
+    // The waiting caller helps run blocks, so n workers means n + 1
+    // threads of execution
+    for (uint8_t workers = 1; workers <= maxWorkers; workers++)
+    {
+        jobSystemShutdown();
+        jobSystemInit(workers, priority);
+        if (jobWorkerCount() < workers)
+            break;
+        int64_t parallelUs = timeRun(&batch, samples, RUN_PARALLEL_FOR);
+        ESP_LOGI(TAG, "  %u workers + caller: %lld us, speedup %.2fx", workers, (long long)parallelUs,
+                 parallelUs > 0 ? (double)serialUs / parallelUs : 0.0);
+        uint32_t stolenBefore = totalStolen();
+        int64_t nestedUs = timeRun(&batch, samples, RUN_NESTED);
+        ESP_LOGI(TAG, "  %u workers + caller, nested: %lld us, speedup %.2fx, %lu steals", workers,
+                 (long long)nestedUs, nestedUs > 0 ? (double)serialUs / nestedUs : 0.0,
+                 (unsigned long)(totalStolen() - stolenBefore));
+    }
+
+    free(in);
+    free(out);
+}
+
+#ifdef JOB_HOST_MAIN
+int main(int argc, char **argv)
+{
+    unsigned cores = std::thread::hardware_concurrency();
+    printf("%u hardware threads\n", cores);
+    uint32_t samples = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 4000000;
+    jobBenchmark(samples, JOB_MAX_WORKERS, 0);
+    jobReport();
+    jobSystemShutdown();
+    return 0;
+}
+#endif
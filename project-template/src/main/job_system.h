@@ -0,0 +1,91 @@
+/**
+ * Work-stealing job system for both ESP32 cores
+ *
+ * Every exercise computes inline in whichever task owns the data, so on a
+ * dual-core esp32dev one core often idles while the other crunches sensor
+ * batches. This runs small JOBS (function + argument) on one worker task
+ * per core:
+ *
+ *   - each worker owns a deque: it pushes and pops its own jobs at the
+ *     bottom (LIFO, cache friendly), idle workers STEAL from the top
+ *   - tasks that are not workers submit through a shared injection ring
+ *   - fork/join: jobs carry a job_counter_t; jobWait() helps run pending
+ *     jobs instead of just blocking, then sleeps until the counter hits 0
+ *   - jobParallelFor() splits an index range into blocks (e.g. one sensor
+ *     batch) and waits for all of them
+ *
+ * On single-core targets (esp32c3) or with 0 workers, jobs simply run
+ * inline in the submitting task, so callers need no #ifdefs.
+ *
+ * Jobs must not block on each other except through jobWait().
+ *
+ * Workers sleep on FreeRTOS task notifications on the target. Built with
+ * -DJOB_HOST_MAIN the same scheduler runs on std::thread workers, and
+ * main() sweeps the benchmark over 1..JOB_MAX_WORKERS workers:
+ *
+ *   g++ -std=c++17 -O2 -pthread -DJOB_HOST_MAIN job_system.cpp -o jobs && ./jobs
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+
+#ifdef JOB_HOST_MAIN
+#define JOB_MAX_WORKERS 8
+#else
+#define JOB_MAX_WORKERS 2
+#endif
+#define JOB_DEQUE_SIZE 64 // per worker, power of two
+#define JOB_INJECT_SIZE 32
+#define JOB_WORKER_STACK 3072
+
+typedef void (*job_fn_t)(void *arg);
+typedef void (*job_range_fn_t)(void *ctx, uint32_t begin, uint32_t end);
+
+// A task on the target, a thread on a PC
+typedef struct job_waiter job_waiter_t;
+
+typedef struct
+{
+    std::atomic<int32_t> pending; // jobs not finished, plus one for jobWait()
+    std::atomic<job_waiter_t *> waiter; // set by jobWait(), notified by the last job
+} job_counter_t;
+
+// Starts `workers` worker tasks (clamped to the core count). Pass 0, or
+// run on a single-core chip, for inline execution.
+void jobSystemInit(uint8_t workers, uint8_t priority);
+
+// Stops the workers so jobSystemInit can start a different number. Only
+// call it with no jobs queued or running.
+void jobSystemShutdown(void);
+
+// Number of workers actually running (0 = inline mode).
+uint8_t jobWorkerCount(void);
+
+// A counter is good for one jobWait(); initialise it again to reuse it.
+void jobCounterInit(job_counter_t *counter);
+
+// Queues fn(arg) and adds one to counter (which may be NULL). Runs the job
+// inline if every queue is full or the system is in inline mode.
+void jobSubmit(job_counter_t *counter, job_fn_t fn, void *arg);
+
+// Runs queued jobs until only running ones are left, then sleeps on the
+// task notification until the last one finishes.
+void jobWait(job_counter_t *counter);
+
+// Calls fn(ctx, begin, end) over [0, count) in blocks of blockSize and
+// waits for every block.
+void jobParallelFor(uint32_t count, uint32_t blockSize, job_range_fn_t fn, void *ctx);
+
+// Logs executed/stolen counts per worker, and the steals of waiting
+// tasks that are not workers.
+void jobReport(void);
+
+// Times one sensor-batch workload serially, through jobParallelFor and as
+// nested fork/join jobs that split inside the workers (so the other
+// workers have to steal), with 1..maxWorkers workers (restarting the pool
+// for each). Logs the speedup of each and the steals of the nested runs.
+// The pool is left with maxWorkers workers.
+void jobBenchmark(uint32_t samples, uint8_t maxWorkers, uint8_t priority);
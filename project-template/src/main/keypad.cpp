@@ -0,0 +1,243 @@
+#include "keypad.h"
+
+#include <string.h>
+#include "freertos/task.h"
+#include "driver/gptimer.h"
+#include "soc/gpio_reg.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "Keypad";
+
+typedef struct
+{
+    keypad_config_t config;
+    gpio_num_t rowPins[KEYPAD_MAX_ROWS];
+    uint64_t colMask[KEYPAD_MAX_COLS]; // GPIO bit of each column
+
+    // ISR side
+    uint8_t currentRow;
+    uint64_t building;
+    uint64_t frame; // last complete frame, guarded by lock
+    bool framePending;
+    uint32_t overruns; // frames replaced before the task took them
+
+    TaskHandle_t task;
+    gptimer_handle_t timer;
+    keypad_scanner_t scanner;
+    uint32_t droppedEvents;
+    bool running;
+} keypad_state_t;
+
+static keypad_state_t g_keypad;
+static portMUX_TYPE g_keypadLock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint64_t IRAM_ATTR readInputs(void)
+{
+    return (uint64_t)REG_READ(GPIO_IN_REG) | ((uint64_t)REG_READ(GPIO_IN1_REG) << 32);
+}
+
+static inline void IRAM_ATTR driveRow(gpio_num_t pin, bool low)
+{
+    if (pin < 32)
+        REG_WRITE(low ? GPIO_OUT_W1TC_REG : GPIO_OUT_W1TS_REG, 1u << pin);
+    else
+        REG_WRITE(low ? GPIO_OUT1_W1TC_REG : GPIO_OUT1_W1TS_REG, 1u << (pin - 32));
+}
+
+static bool IRAM_ATTR keypadTimerISR(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *userCtx)
+{
+    keypad_state_t *k = &g_keypad;
+    uint64_t closed = ~readInputs(); // active low
+
+    if (k->config.mode == KEYPAD_MODE_BANK)
+    {
+        k->building = closed & k->config.bankMask;
+    }
+    else
+    {
+        uint8_t row = k->currentRow;
+        uint64_t rowBits = 0;
+        for (uint8_t c = 0; c < k->config.colCount; c++)
+        {
+            if (closed & k->colMask[c])
+                rowBits |= 1ULL << c;
+        }
+        k->building |= rowBits << (row * KEYPAD_MAX_COLS);
+
+        driveRow(k->rowPins[row], false);
+        row = (row + 1 == k->config.rowCount) ? 0 : row + 1;
+        driveRow(k->rowPins[row], true);
+        k->currentRow = row;
+        if (row != 0)
+            return false; // frame not complete yet
+    }
+
+    portENTER_CRITICAL_ISR(&g_keypadLock);
+    if (k->framePending)
+        k->overruns++;
+    k->frame = k->building;
+    k->framePending = true;
+    portEXIT_CRITICAL_ISR(&g_keypadLock);
+    k->building = 0;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(k->task, &woken);
+    return woken == pdTRUE;
+}
+
+static void keypadEvent(const key_event_t *event, void *ctx)
+{
+    keypad_state_t *k = (keypad_state_t *)ctx;
+    if (xQueueSend(k->config.events, event, 0) != pdTRUE)
+        k->droppedEvents++;
+}
+
+static void keypadTask(void *pvParameter)
+{
+    keypad_state_t *k = (keypad_state_t *)pvParameter;
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        portENTER_CRITICAL(&g_keypadLock);
+        uint64_t frame = k->frame;
+        bool pending = k->framePending;
+        k->framePending = false;
+        portEXIT_CRITICAL(&g_keypadLock);
+
+        if (pending)
+            keypadScanFrame(&k->scanner, frame, (uint32_t)(esp_timer_get_time() / 1000));
+    }
+}
+
+bool keypadStart(const keypad_config_t *config)
+{
+    keypad_state_t *k = &g_keypad;
+    if (k->running)
+    {
+        ESP_LOGE(TAG, "Already running");
+        return false;
+    }
+    if (config->events == NULL || config->stepUs == 0)
+        return false;
+
+    memset(k, 0, sizeof(*k));
+    k->config = *config;
+
+    if (config->mode == KEYPAD_MODE_MATRIX)
+    {
+        if (config->rowCount == 0 || config->rowCount > KEYPAD_MAX_ROWS || config->colCount == 0 ||
+            config->colCount > KEYPAD_MAX_COLS)
+        {
+            ESP_LOGE(TAG, "Matrix must be 1-%d rows by 1-%d columns", KEYPAD_MAX_ROWS, KEYPAD_MAX_COLS);
+            return false;
+        }
+
+        uint64_t rowMask = 0;
+        uint64_t colMask = 0;
+        for (uint8_t r = 0; r < config->rowCount; r++)
+        {
+            k->rowPins[r] = config->rowPins[r];
+            rowMask |= 1ULL << config->rowPins[r];
+        }
+        for (uint8_t c = 0; c < config->colCount; c++)
+        {
+            k->colMask[c] = 1ULL << config->colPins[c];
+            colMask |= k->colMask[c];
+        }
+
+        gpio_config_t rows = {
+            .pin_bit_mask = rowMask,
+            .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+            .pull_up_en = GPIO_PULLUP_ENABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        gpio_config_t cols = {
+            .pin_bit_mask = colMask,
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_ENABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        if (gpio_config(&rows) != ESP_OK || gpio_config(&cols) != ESP_OK)
+            return false;
+        for (uint8_t r = 0; r < config->rowCount; r++)
+        {
+            gpio_set_level(k->rowPins[r], r == 0 ? 0 : 1); // row 0 is read on the first tick
+        }
+        keypadScanInit(&k->scanner, config->rowCount, keypadEvent, k);
+    }
+    else
+    {
+        gpio_config_t bank = {
+            .pin_bit_mask = config->bankMask,
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_ENABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        if (config->bankMask == 0 || gpio_config(&bank) != ESP_OK)
+            return false;
+        keypadScanInit(&k->scanner, 0, keypadEvent, k);
+    }
+
+    if (xTaskCreate(keypadTask, "keypadTask", 2048, k, 6, &k->task) != pdPASS)
+        return false;
+
+    gptimer_config_t timerConfig = {};
+    timerConfig.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+    timerConfig.direction = GPTIMER_COUNT_UP;
+    timerConfig.resolution_hz = 1000000;
+
+    gptimer_event_callbacks_t callbacks = {};
+    callbacks.on_alarm = keypadTimerISR;
+
+    gptimer_alarm_config_t alarm = {};
+    alarm.alarm_count = config->stepUs;
+    alarm.reload_count = 0;
+    alarm.flags.auto_reload_on_alarm = true;
+
+    if (gptimer_new_timer(&timerConfig, &k->timer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "No free hardware timer");
+        vTaskDelete(k->task);
+        return false;
+    }
+    gptimer_register_event_callbacks(k->timer, &callbacks, NULL);
+    gptimer_set_alarm_action(k->timer, &alarm);
+    gptimer_enable(k->timer);
+    gptimer_start(k->timer);
+    k->running = true;
+
+    uint32_t frameUs = config->stepUs * (config->mode == KEYPAD_MODE_MATRIX ? config->rowCount : 1);
+    ESP_LOGI(TAG, "Scanning %s, frame every %lu us, debounce %lu us",
+             config->mode == KEYPAD_MODE_MATRIX ? "matrix" : "bank", (unsigned long)frameUs,
+             (unsigned long)(frameUs * KEYPAD_DEBOUNCE_FRAMES));
+    return true;
+}
+
+void keypadStop(void)
+{
+    keypad_state_t *k = &g_keypad;
+    if (!k->running)
+        return;
+    gptimer_stop(k->timer);
+    gptimer_disable(k->timer);
+    gptimer_del_timer(k->timer);
+    vTaskDelete(k->task);
+    if (k->config.mode == KEYPAD_MODE_MATRIX)
+        driveRow(k->rowPins[k->currentRow], false);
+    k->running = false;
+}
+
+void keypadReport(void)
+{
+    const keypad_state_t *k = &g_keypad;
+    const keypad_stats_t *s = &k->scanner.stats;
+    ESP_LOGI(TAG, "%lu frames, %lu presses, %lu releases, %lu ghosted, %lu overruns, %lu events dropped",
+             (unsigned long)s->frames, (unsigned long)s->presses, (unsigned long)s->releases,
+             (unsigned long)s->ghostFrames, (unsigned long)k->overruns, (unsigned long)k->droppedEvents);
+}
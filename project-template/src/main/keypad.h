@@ -0,0 +1,57 @@
+/**
+ * Key matrix / GPIO bank scanner
+ *
+ * One gptimer ISR does all the hardware work, however many keys there
+ * are:
+ *
+ *   matrix  rows are open-drain outputs, columns inputs with pull-ups.
+ *           Each timer tick reads GPIO_IN for the row driven low on the
+ *           previous tick (so the lines had a whole period to settle),
+ *           releases it and drives the next row. A frame completes every
+ *           rowCount ticks.
+ *   bank    every tick reads the whole bank (GPIO_IN + GPIO_IN1) and
+ *           masks it with bankMask, one frame per tick. Key n = GPIO n.
+ *
+ * Inputs are active low. The ISR only assembles the 64-bit frame and
+ * notifies the keypad task, which runs the bit-parallel debounce and
+ * ghost check from keypad_scan.h and sends key_event_t to config.events.
+ *
+ * Debounce time is KEYPAD_DEBOUNCE_FRAMES frames, e.g. 4 rows at 500 us
+ * per step = 2 ms per frame = 8 ms.
+ *
+ * GPIO 34-39 have no internal pull-ups; use external ones for inputs there.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+#include "keypad_scan.h"
+
+typedef enum
+{
+    KEYPAD_MODE_MATRIX = 0,
+    KEYPAD_MODE_BANK
+} keypad_mode_t;
+
+typedef struct
+{
+    keypad_mode_t mode;
+    const gpio_num_t *rowPins; // matrix only
+    uint8_t rowCount;
+    const gpio_num_t *colPins; // matrix only
+    uint8_t colCount;
+    uint64_t bankMask;     // bank only: one bit per GPIO
+    uint32_t stepUs;       // timer period
+    QueueHandle_t events;  // receives key_event_t
+} keypad_config_t;
+
+// Configures the pins and starts scanning. Only one keypad at a time.
+bool keypadStart(const keypad_config_t *config);
+void keypadStop(void);
+
+// Logs frame, press/release, ghost and overrun counts.
+void keypadReport(void);
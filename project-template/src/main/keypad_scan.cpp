@@ -0,0 +1,194 @@
+#include "keypad_scan.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "host_test.h"
+
+void keypadScanInit(keypad_scanner_t *s, uint8_t rows, keypad_event_cb_t onEvent, void *ctx)
+{
+    memset(s, 0, sizeof(*s));
+    s->rows = rows > KEYPAD_MAX_ROWS ? KEYPAD_MAX_ROWS : rows;
+    s->onEvent = onEvent;
+    s->ctx = ctx;
+}
+
+bool keypadIsGhosted(uint64_t raw, uint8_t rows)
+{
+    for (uint8_t r1 = 0; r1 + 1 < rows; r1++)
+    {
+        uint8_t row1 = (uint8_t)(raw >> (r1 * KEYPAD_MAX_COLS));
+        if ((row1 & (row1 - 1)) == 0)
+            continue; // fewer than two columns, cannot form a square
+        for (uint8_t r2 = r1 + 1; r2 < rows; r2++)
+        {
+            uint8_t common = row1 & (uint8_t)(raw >> (r2 * KEYPAD_MAX_COLS));
+            if ((common & (common - 1)) != 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+void keypadScanFrame(keypad_scanner_t *s, uint64_t raw, uint32_t timeMs)
+{
+    s->stats.frames++;
+
+    if (s->rows > 1 && keypadIsGhosted(raw, s->rows))
+    {
+        // Keep what is already down, allow releases, hold back new presses
+        raw &= s->debounced;
+        s->stats.ghostFrames++;
+    }
+
+    // Vertical counter: keys that agree with their debounced state are
+    // reset to 0, the rest count up and flip when they wrap to 0
+    uint64_t delta = raw ^ s->debounced;
+    s->count1 = (s->count1 ^ s->count0) & delta;
+    s->count0 = ~s->count0 & delta;
+    uint64_t toggled = delta & ~(s->count0 | s->count1);
+    s->debounced ^= toggled;
+
+    // Cost follows the number of changes, not the number of keys
+    while (toggled != 0)
+    {
+        uint8_t key = (uint8_t)__builtin_ctzll(toggled);
+        toggled &= toggled - 1;
+
+        key_event_t event;
+        event.timeMs = timeMs;
+        event.key = key;
+        if (s->debounced & (1ULL << key))
+        {
+            event.type = KEY_EVENT_DOWN;
+            s->stats.presses++;
+        }
+        else
+        {
+            event.type = KEY_EVENT_UP;
+            s->stats.releases++;
+        }
+        if (s->onEvent != NULL)
+            s->onEvent(&event, s->ctx);
+    }
+}
+
+// --- self test against a simulated matrix ----------------------------------
+
+#define TEST_MAX_EVENTS 256
+
+typedef struct
+{
+    key_event_t events[TEST_MAX_EVENTS];
+    int count;
+} test_log_t;
+
+static void testRecord(const key_event_t *event, void *ctx)
+{
+    test_log_t *log = (test_log_t *)ctx;
+    if (log->count < TEST_MAX_EVENTS)
+        log->events[log->count] = *event;
+    log->count++;
+}
+
+// What the column inputs read for a set of physically closed switches in
+// a matrix without diodes: current also flows backwards through a closed
+// switch, so (r, c) reads closed if (r, c2), (r2, c2) and (r2, c) are.
+static uint64_t simulateMatrix(uint64_t closed, uint8_t rows)
+{
+    uint64_t seen = closed;
+    for (uint8_t r = 0; r < rows; r++)
+    {
+        uint8_t row = (uint8_t)(closed >> (r * KEYPAD_MAX_COLS));
+        for (uint8_t r2 = 0; r2 < rows; r2++)
+        {
+            uint8_t other = (uint8_t)(closed >> (r2 * KEYPAD_MAX_COLS));
+            if (r2 != r && (row & other) != 0)
+                seen |= (uint64_t)other << (r * KEYPAD_MAX_COLS);
+        }
+    }
+    return seen;
+}
+
+bool keypadSelfTest(void)
+{
+    keypad_scanner_t s;
+    test_log_t log;
+    uint32_t t = 0;
+    bool ok = true;
+
+    printf("keypad scanner self test\n");
+
+    // 1. A bouncing press, then a bouncing release
+    memset(&log, 0, sizeof(log));
+    keypadScanInit(&s, 4, testRecord, &log);
+    const uint8_t key = KEYPAD_KEY(2, 1);
+    const uint8_t pressBounce[] = {1, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1};
+    const uint8_t releaseBounce[] = {0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0};
+    for (uint8_t level : pressBounce)
+        keypadScanFrame(&s, simulateMatrix(level ? 1ULL << key : 0, 4), t++);
+    for (uint8_t level : releaseBounce)
+        keypadScanFrame(&s, simulateMatrix(level ? 1ULL << key : 0, 4), t++);
+    ok &= testCheck("bouncing press gives one down, one up",
+                log.count == 2 && log.events[0].key == key && log.events[0].type == KEY_EVENT_DOWN &&
+                    log.events[1].key == key && log.events[1].type == KEY_EVENT_UP);
+    ok &= testCheck("down reported after 4 stable frames", log.count >= 1 && log.events[0].timeMs == 8);
+
+    // 2. Glitches shorter than the debounce window
+    memset(&log, 0, sizeof(log));
+    keypadScanInit(&s, 4, testRecord, &log);
+    for (int run = 1; run < KEYPAD_DEBOUNCE_FRAMES; run++)
+    {
+        for (int i = 0; i < run; i++)
+            keypadScanFrame(&s, 1ULL << KEYPAD_KEY(0, 0), t++);
+        keypadScanFrame(&s, 0, t++);
+    }
+    ok &= testCheck("glitches of 1-3 frames are ignored", log.count == 0);
+
+    // 3. Three keys in an L: the fourth corner must never be reported
+    memset(&log, 0, sizeof(log));
+    keypadScanInit(&s, 4, testRecord, &log);
+    uint64_t closed = 0;
+    const uint8_t lShape[] = {KEYPAD_KEY(0, 0), KEYPAD_KEY(0, 3), KEYPAD_KEY(2, 0)};
+    for (uint8_t k : lShape)
+    {
+        closed |= 1ULL << k;
+        for (int i = 0; i < 6; i++)
+            keypadScanFrame(&s, simulateMatrix(closed, 4), t++);
+    }
+    bool phantom = false;
+    for (int i = 0; i < log.count && i < TEST_MAX_EVENTS; i++)
+        phantom |= log.events[i].key == KEYPAD_KEY(2, 3);
+    ok &= testCheck("ghost corner of an L is not reported", !phantom && (s.debounced & (1ULL << KEYPAD_KEY(2, 3))) == 0);
+    ok &= testCheck("first two keys of the L are reported", log.count == 2);
+    ok &= testCheck("ghosted frames are counted", s.stats.ghostFrames == 6);
+    for (int i = 0; i < 6; i++)
+        keypadScanFrame(&s, 0, t++);
+    ok &= testCheck("releases go through after a ghost", s.debounced == 0 && s.stats.releases == 2);
+
+    // 4. Bank mode: all 64 inputs at once, no ghost logic
+    memset(&log, 0, sizeof(log));
+    keypadScanInit(&s, 0, testRecord, &log);
+    for (int i = 0; i < 6; i++)
+        keypadScanFrame(&s, ~0ULL, t++);
+    ok &= testCheck("64 simultaneous bank inputs all reported", log.count == 64 && s.debounced == ~0ULL);
+
+    // 5. Independent keys debounce independently
+    memset(&log, 0, sizeof(log));
+    keypadScanInit(&s, 0, testRecord, &log);
+    for (int i = 0; i < 8; i++)
+    {
+        uint64_t raw = (1ULL << 5) | ((i & 1) ? (1ULL << 40) : 0); // 40 chatters
+        keypadScanFrame(&s, raw, t++);
+    }
+    ok &= testCheck("chattering key does not disturb a stable one", log.count == 1 && log.events[0].key == 5);
+
+    printf("%s\n", ok ? "all keypad checks passed" : "KEYPAD CHECKS FAILED");
+    return ok;
+}
+
+#ifdef KEYPAD_HOST_MAIN
+int main(void)
+{
+    return keypadSelfTest() ? 0 : 1;
+}
+#endif
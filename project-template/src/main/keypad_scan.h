@@ -0,0 +1,87 @@
+/**
+ * Bit-parallel key scanning logic
+ *
+ * The Day 8 exercise gives one button its own ISR and debounces it with a
+ * vTaskDelay. With 16-64 keys that does not scale, so every key here is
+ * one bit of a 64-bit frame and all keys are processed together:
+ *
+ *   matrix  bit (row * 8 + col), up to 8 x 8
+ *   bank    bit n = input n, up to 64 independent inputs
+ *
+ * Debouncing is a 2-bit vertical counter per key, stored as two words
+ * (count0 holds bit 0 of every key's counter, count1 bit 1). A key's
+ * debounced state flips only after KEYPAD_DEBOUNCE_FRAMES consecutive
+ * frames disagree with it; one disagreeing frame resets its count. That
+ * is about ten word operations per frame whether 1 or 64 keys are wired.
+ *
+ * A matrix without diodes cannot tell three keys in an L shape from four
+ * in a square: the fourth corner reads as pressed. Any two rows sharing
+ * two or more pressed columns are ambiguous, so while that holds new
+ * presses are held back (releases still go through) and the frame is
+ * counted as ghosted.
+ *
+ * Only the C++ standard library is used, so the same code can be checked
+ * on a PC against a simulated matrix (keypadSelfTest):
+ *
+ *   g++ -std=c++17 -DKEYPAD_HOST_MAIN keypad_scan.cpp -o keypad && ./keypad
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define KEYPAD_MAX_ROWS 8
+#define KEYPAD_MAX_COLS 8
+#define KEYPAD_MAX_KEYS 64
+#define KEYPAD_DEBOUNCE_FRAMES 4 // fixed by the 2-bit counter
+
+#define KEYPAD_KEY(row, col) ((uint8_t)((row) * KEYPAD_MAX_COLS + (col)))
+
+typedef enum
+{
+    KEY_EVENT_DOWN = 0,
+    KEY_EVENT_UP
+} key_event_type_t;
+
+typedef struct
+{
+    uint32_t timeMs;
+    uint8_t key; // KEYPAD_KEY(row, col), or the input number in bank mode
+    uint8_t type; // key_event_type_t
+} key_event_t;
+
+typedef void (*keypad_event_cb_t)(const key_event_t *event, void *ctx);
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t presses;
+    uint32_t releases;
+    uint32_t ghostFrames; // frames where presses were held back
+} keypad_stats_t;
+
+typedef struct
+{
+    uint8_t rows; // 0 = bank mode, no ghost detection
+    uint64_t debounced;
+    uint64_t count0;
+    uint64_t count1;
+    keypad_event_cb_t onEvent;
+    void *ctx;
+    keypad_stats_t stats;
+} keypad_scanner_t;
+
+void keypadScanInit(keypad_scanner_t *s, uint8_t rows, keypad_event_cb_t onEvent, void *ctx);
+
+// Feeds one complete frame (bit set = contact closed). Calls onEvent once
+// per debounced change.
+void keypadScanFrame(keypad_scanner_t *s, uint64_t raw, uint32_t timeMs);
+
+// True if two of the first `rows` rows share two or more pressed columns.
+bool keypadIsGhosted(uint64_t raw, uint8_t rows);
+
+// Runs the scanner against a simulated diode-less matrix (bounce, glitches,
+// ghost corners, all keys at once) and prints each check. Returns true if
+// all pass.
+bool keypadSelfTest(void);
@@ -0,0 +1,218 @@
+#include "led_encode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "host_test.h"
+
+#define T0H 3 // ticks of 0.1 us
+#define T0L 9
+#define T1H 9
+#define T1L 3
+#define RESET_TICKS 1500 // each half, 2 x 150 us
+
+static constexpr led_symbol_t symbol(uint32_t duration0, uint32_t level0, uint32_t duration1, uint32_t level1)
+{
+    return duration0 | (level0 << 15) | (duration1 << 16) | (level1 << 31);
+}
+
+static constexpr led_symbol_t SYMBOL_0 = symbol(T0H, 1, T0L, 0);
+static constexpr led_symbol_t SYMBOL_1 = symbol(T1H, 1, T1L, 0);
+static constexpr led_symbol_t SYMBOL_RESET = symbol(RESET_TICKS, 0, RESET_TICKS, 0);
+
+// Four symbols per nibble, most significant bit first
+struct NibbleTable
+{
+    led_symbol_t symbols[16][4];
+
+    constexpr NibbleTable() : symbols()
+    {
+        for (int n = 0; n < 16; n++)
+        {
+            for (int bit = 0; bit < 4; bit++)
+            {
+                symbols[n][bit] = (n & (8 >> bit)) ? SYMBOL_1 : SYMBOL_0;
+            }
+        }
+    }
+};
+
+static constexpr NibbleTable NIBBLES;
+
+static inline led_symbol_t *encodeByte(uint8_t value, led_symbol_t *out)
+{
+    memcpy(out, NIBBLES.symbols[value >> 4], sizeof(NIBBLES.symbols[0]));
+    memcpy(out + 4, NIBBLES.symbols[value & 0x0F], sizeof(NIBBLES.symbols[0]));
+    return out + 8;
+}
+
+size_t ledEncodeFrame(const uint32_t *pixels, size_t count, led_symbol_t *out)
+{
+    led_symbol_t *p = out;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t rgb = pixels[i];
+        p = encodeByte((uint8_t)(rgb >> 8), p);  // G
+        p = encodeByte((uint8_t)(rgb >> 16), p); // R
+        p = encodeByte((uint8_t)rgb, p);         // B
+    }
+    *p++ = SYMBOL_RESET;
+    return (size_t)(p - out);
+}
+
+size_t ledEncodeFrameReference(const uint32_t *pixels, size_t count, led_symbol_t *out)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t g = (uint8_t)(pixels[i] >> 8);
+        uint8_t r = (uint8_t)(pixels[i] >> 16);
+        uint8_t b = (uint8_t)pixels[i];
+        uint32_t grb = ((uint32_t)g << 16) | ((uint32_t)r << 8) | b;
+        for (int bit = 23; bit >= 0; bit--)
+        {
+            out[n++] = ((grb >> bit) & 1) ? SYMBOL_1 : SYMBOL_0;
+        }
+    }
+    out[n++] = SYMBOL_RESET;
+    return n;
+}
+
+// --- self test -------------------------------------------------------------
+
+// Written out by hand from the WS2812 datasheet, not generated, so they
+// also catch a wrong table or byte order
+#define Z 0x00098003u // 0.3 us high, 0.9 us low
+#define O 0x00038009u // 0.9 us high, 0.3 us low
+#define R 0x05DC05DCu // 300 us low
+
+static const uint32_t GOLDEN_RED_PIXEL[] = {
+    0x00FF0000,
+};
+static const led_symbol_t GOLDEN_RED[] = {
+    Z, Z, Z, Z, Z, Z, Z, Z, // G 0x00
+    O, O, O, O, O, O, O, O, // R 0xFF
+    Z, Z, Z, Z, Z, Z, Z, Z, // B 0x00
+    R,
+};
+
+static const uint32_t GOLDEN_MIXED_PIXELS[] = {
+    0x000180A5, // R 0x01, G 0x80, B 0xA5
+    0x00000F00, // G 0x0F
+};
+static const led_symbol_t GOLDEN_MIXED[] = {
+    O, Z, Z, Z, Z, Z, Z, Z, // G 0x80
+    Z, Z, Z, Z, Z, Z, Z, O, // R 0x01
+    O, Z, O, Z, Z, O, Z, O, // B 0xA5
+    Z, Z, Z, Z, O, O, O, O, // G 0x0F
+    Z, Z, Z, Z, Z, Z, Z, Z, // R 0x00
+    Z, Z, Z, Z, Z, Z, Z, Z, // B 0x00
+    R,
+};
+
+#undef Z
+#undef O
+#undef R
+
+static bool matchesGolden(size_t (*encode)(const uint32_t *, size_t, led_symbol_t *), const uint32_t *pixels,
+                          size_t count, const led_symbol_t *golden, size_t goldenLen)
+{
+    led_symbol_t out[LED_FRAME_SYMBOLS(2)];
+    size_t n = encode(pixels, count, out);
+    return n == goldenLen && memcmp(out, golden, goldenLen * sizeof(led_symbol_t)) == 0;
+}
+
+bool ledEncodeSelfTest(void)
+{
+    bool ok = true;
+    printf("LED encoder self test\n");
+
+    ok &= testCheck("reference: one red pixel", matchesGolden(ledEncodeFrameReference, GOLDEN_RED_PIXEL, 1, GOLDEN_RED,
+                                                          sizeof(GOLDEN_RED) / sizeof(GOLDEN_RED[0])));
+    ok &= testCheck("table: one red pixel",
+                matchesGolden(ledEncodeFrame, GOLDEN_RED_PIXEL, 1, GOLDEN_RED, sizeof(GOLDEN_RED) / sizeof(GOLDEN_RED[0])));
+    ok &= testCheck("reference: mixed bits, two pixels", matchesGolden(ledEncodeFrameReference, GOLDEN_MIXED_PIXELS, 2,
+                                                                   GOLDEN_MIXED, sizeof(GOLDEN_MIXED) / sizeof(GOLDEN_MIXED[0])));
+    ok &= testCheck("table: mixed bits, two pixels", matchesGolden(ledEncodeFrame, GOLDEN_MIXED_PIXELS, 2, GOLDEN_MIXED,
+                                                               sizeof(GOLDEN_MIXED) / sizeof(GOLDEN_MIXED[0])));
+
+    led_symbol_t reset[LED_FRAME_SYMBOLS(0)];
+    ok &= testCheck("empty frame is just the reset", ledEncodeFrame(NULL, 0, reset) == 1 && reset[0] == 0x05DC05DCu);
+
+    // Both encoders agree on random frames
+    static uint32_t pixels[300];
+    static led_symbol_t fast[LED_FRAME_SYMBOLS(300)];
+    static led_symbol_t slow[LED_FRAME_SYMBOLS(300)];
+    uint32_t seed = 12345;
+    bool same = true;
+    for (int round = 0; round < 20 && same; round++)
+    {
+        for (int i = 0; i < 300; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            pixels[i] = seed >> 8;
+        }
+        size_t a = ledEncodeFrame(pixels, 300, fast);
+        size_t b = ledEncodeFrameReference(pixels, 300, slow);
+        same = a == b && memcmp(fast, slow, a * sizeof(led_symbol_t)) == 0;
+    }
+    ok &= testCheck("table matches reference on random frames", same);
+
+    printf("%s\n", ok ? "all LED encoder checks passed" : "LED ENCODER CHECKS FAILED");
+    return ok;
+}
+
+// --- benchmark -------------------------------------------------------------
+
+static double timeEncodeUs(size_t (*encode)(const uint32_t *, size_t, led_symbol_t *), const uint32_t *pixels,
+                           size_t count, led_symbol_t *out)
+{
+    const int rounds = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+    {
+        encode(pixels, count, out);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / rounds;
+}
+
+void ledEncodeBenchmark(void)
+{
+    static const size_t sizes[] = {60, 300, 1000};
+    uint32_t *pixels = (uint32_t *)malloc(1000 * sizeof(uint32_t));
+    led_symbol_t *out = (led_symbol_t *)malloc(LED_FRAME_SYMBOLS(1000) * sizeof(led_symbol_t));
+    if (pixels == NULL || out == NULL)
+    {
+        printf("LED encode benchmark: out of memory\n");
+        free(pixels);
+        free(out);
+        return;
+    }
+    for (size_t i = 0; i < 1000; i++)
+    {
+        pixels[i] = (uint32_t)(i * 0x010307u) & 0x00FFFFFFu;
+    }
+
+    printf("LED encode, us per frame (wire time in brackets)\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        double table = timeEncodeUs(ledEncodeFrame, pixels, sizes[s], out);
+        double reference = timeEncodeUs(ledEncodeFrameReference, pixels, sizes[s], out);
+        printf("  %4u pixels: table %8.1f us, reference %8.1f us  [%u us]\n", (unsigned)sizes[s], table, reference,
+               (unsigned)(sizes[s] * 30 + 300));
+    }
+
+    free(pixels);
+    free(out);
+}
+
+#ifdef LED_ENCODE_HOST_MAIN
+int main(void)
+{
+    bool ok = ledEncodeSelfTest();
+    ledEncodeBenchmark();
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,155 @@
+#include "led_strip.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "soc/soc_caps.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "LedStrip";
+
+#define TX_WAIT_MS 100 // longest frame (1000 pixels) is ~30 ms on the wire
+
+bool ledStripInit(led_strip_t *strip, gpio_num_t gpio, uint16_t pixels, uint16_t maxFps)
+{
+    memset(strip, 0, sizeof(*strip));
+    strip->pixels = pixels;
+    strip->framePeriodUs = maxFps > 0 ? 1000000u / maxFps : 0;
+
+    size_t frameBytes = (size_t)pixels * sizeof(uint32_t);
+    size_t symbolBytes = LED_FRAME_SYMBOLS(pixels) * sizeof(led_symbol_t);
+    strip->framebuffers[0] = (uint32_t *)heap_caps_malloc(frameBytes, MALLOC_CAP_8BIT);
+    strip->framebuffers[1] = (uint32_t *)heap_caps_malloc(frameBytes, MALLOC_CAP_8BIT);
+    strip->symbols = (led_symbol_t *)heap_caps_malloc(symbolBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    if (strip->framebuffers[0] == NULL || strip->framebuffers[1] == NULL || strip->symbols == NULL)
+    {
+        ESP_LOGE(TAG, "Not enough RAM for %u pixels (%u bytes)", pixels, (unsigned)(2 * frameBytes + symbolBytes));
+        ledStripDeinit(strip);
+        return false;
+    }
+    memset(strip->framebuffers[0], 0, frameBytes);
+    memset(strip->framebuffers[1], 0, frameBytes);
+
+    rmt_tx_channel_config_t channelConfig = {};
+    channelConfig.gpio_num = gpio;
+    channelConfig.clk_src = RMT_CLK_SRC_DEFAULT;
+    channelConfig.resolution_hz = LED_RMT_RESOLUTION_HZ;
+    channelConfig.trans_queue_depth = 1; // one frame in flight
+#if SOC_RMT_SUPPORT_DMA
+    channelConfig.mem_block_symbols = 1024;
+    channelConfig.flags.with_dma = true;
+#else
+    channelConfig.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+#endif
+
+    rmt_copy_encoder_config_t encoderConfig = {};
+    if (rmt_new_tx_channel(&channelConfig, &strip->channel) != ESP_OK ||
+        rmt_new_copy_encoder(&encoderConfig, &strip->encoder) != ESP_OK || rmt_enable(strip->channel) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to set up RMT on GPIO %d", gpio);
+        ledStripDeinit(strip);
+        return false;
+    }
+
+    strip->nextFrameUs = esp_timer_get_time();
+    ESP_LOGI(TAG, "%u pixels on GPIO %d, %u bytes, max %u fps", pixels, gpio, (unsigned)(2 * frameBytes + symbolBytes),
+             maxFps);
+    return true;
+}
+
+void ledStripDeinit(led_strip_t *strip)
+{
+    if (strip->channel != NULL)
+    {
+        if (strip->transmitting)
+            rmt_tx_wait_all_done(strip->channel, TX_WAIT_MS);
+        rmt_disable(strip->channel);
+        rmt_del_channel(strip->channel);
+    }
+    if (strip->encoder != NULL)
+        rmt_del_encoder(strip->encoder);
+    heap_caps_free(strip->framebuffers[0]);
+    heap_caps_free(strip->framebuffers[1]);
+    heap_caps_free(strip->symbols);
+    memset(strip, 0, sizeof(*strip));
+}
+
+uint32_t *ledStripBackBuffer(led_strip_t *strip)
+{
+    return strip->framebuffers[strip->back];
+}
+
+const uint32_t *ledStripFrontBuffer(const led_strip_t *strip)
+{
+    return strip->framebuffers[strip->back ^ 1];
+}
+
+void ledStripCopyFront(led_strip_t *strip)
+{
+    memcpy(strip->framebuffers[strip->back], strip->framebuffers[strip->back ^ 1], strip->pixels * sizeof(uint32_t));
+}
+
+bool ledStripPresent(led_strip_t *strip)
+{
+    // Frame limiter: sleep whole ticks, the RMT wait below absorbs the rest
+    if (strip->framePeriodUs > 0)
+    {
+        int64_t now = esp_timer_get_time();
+        if (now < strip->nextFrameUs)
+        {
+            TickType_t ticks = (TickType_t)((strip->nextFrameUs - now) / (1000 * portTICK_PERIOD_MS));
+            if (ticks > 0)
+                vTaskDelay(ticks);
+            strip->nextFrameUs += strip->framePeriodUs;
+        }
+        else
+        {
+            // Late: restart the schedule from now instead of bursting
+            if (now - strip->nextFrameUs > strip->framePeriodUs)
+                strip->stats.lateFrames++;
+            strip->nextFrameUs = now + strip->framePeriodUs;
+        }
+    }
+
+    // The symbol buffer is still being read until the previous frame ends
+    if (strip->transmitting)
+    {
+        int64_t waitStart = esp_timer_get_time();
+        if (rmt_tx_wait_all_done(strip->channel, TX_WAIT_MS) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Previous frame did not finish");
+            return false;
+        }
+        uint32_t waited = (uint32_t)(esp_timer_get_time() - waitStart);
+        if (waited > strip->stats.txWaitUsMax)
+            strip->stats.txWaitUsMax = waited;
+        strip->transmitting = false;
+    }
+
+    int64_t encodeStart = esp_timer_get_time();
+    size_t symbols = ledEncodeFrame(strip->framebuffers[strip->back], strip->pixels, strip->symbols);
+    uint32_t encodeUs = (uint32_t)(esp_timer_get_time() - encodeStart);
+    strip->stats.encodeUsTotal += encodeUs;
+    if (encodeUs > strip->stats.encodeUsMax)
+        strip->stats.encodeUsMax = encodeUs;
+
+    strip->back ^= 1;
+
+    rmt_transmit_config_t txConfig = {};
+    txConfig.loop_count = 0;
+    if (rmt_transmit(strip->channel, strip->encoder, strip->symbols, symbols * sizeof(led_symbol_t), &txConfig) != ESP_OK)
+        return false;
+    strip->transmitting = true;
+    strip->stats.frames++;
+    return true;
+}
+
+void ledStripReport(const led_strip_t *strip)
+{
+    const led_strip_stats_t *s = &strip->stats;
+    ESP_LOGI(TAG, "%lu frames, %lu late, encode avg %lu us max %lu us, tx wait max %lu us", (unsigned long)s->frames,
+             (unsigned long)s->lateFrames, (unsigned long)(s->frames > 0 ? s->encodeUsTotal / s->frames : 0),
+             (unsigned long)s->encodeUsMax, (unsigned long)s->txWaitUsMax);
+}
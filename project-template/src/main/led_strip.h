@@ -0,0 +1,73 @@
+/**
+ * WS2812 strip output over RMT, double buffered
+ *
+ * The controller drives LED[4] with gpio_set_level. For strips of hundreds
+ * of pixels the bits have to be clocked out with 0.1 us timing, which the
+ * RMT peripheral does from a symbol buffer (led_encode.h).
+ *
+ * Two pixel framebuffers (0x00RRGGBB per pixel):
+ *
+ *   back   the caller renders frame N+1 here...
+ *   front  ...while frame N, already encoded, is on the wire
+ *
+ * ledStripPresent() waits for the frame-rate limit, waits until the
+ * previous transmission has finished, encodes the back buffer into the
+ * symbol buffer, swaps the buffers and starts the RMT transfer without
+ * waiting for it. The symbol buffer is never rewritten while the RMT
+ * reads it, so frames cannot tear. After a swap the back buffer holds the
+ * frame before last; call ledStripCopyFront() first for effects that
+ * build on the previous frame.
+ *
+ * Where the chip has RMT DMA (SOC_RMT_SUPPORT_DMA, e.g. ESP32-S3) the
+ * transfer uses it. The original ESP32 has none, so the driver refills
+ * the channel's RAM from its ISR in ping-pong halves.
+ *
+ * RAM: 8 bytes per pixel for the framebuffers + 96 bytes per pixel of
+ * symbols, about 100 KB for 1000 pixels.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/gpio.h"
+#include "driver/rmt_tx.h"
+#include "led_encode.h"
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t lateFrames; // present() called after the frame was due
+    uint32_t encodeUsMax;
+    uint64_t encodeUsTotal;
+    uint32_t txWaitUsMax; // previous frame still on the wire
+} led_strip_stats_t;
+
+typedef struct
+{
+    uint16_t pixels;
+    uint32_t framePeriodUs; // 0 = no limit
+    int64_t nextFrameUs;
+
+    rmt_channel_handle_t channel;
+    rmt_encoder_handle_t encoder;
+    uint32_t *framebuffers[2];
+    uint8_t back; // index into framebuffers
+    led_symbol_t *symbols;
+    bool transmitting;
+
+    led_strip_stats_t stats;
+} led_strip_t;
+
+bool ledStripInit(led_strip_t *strip, gpio_num_t gpio, uint16_t pixels, uint16_t maxFps);
+void ledStripDeinit(led_strip_t *strip);
+
+uint32_t *ledStripBackBuffer(led_strip_t *strip);
+const uint32_t *ledStripFrontBuffer(const led_strip_t *strip);
+void ledStripCopyFront(led_strip_t *strip);
+
+// Shows the back buffer. Blocks only for the frame limiter and for the
+// previous frame to finish.
+bool ledStripPresent(led_strip_t *strip);
+
+void ledStripReport(const led_strip_t *strip);
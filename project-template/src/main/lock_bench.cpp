@@ -0,0 +1,527 @@
+#include "lock_bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "LockBench";
+
+static const char *kindNames[LOCK_KIND_COUNT] = {"mutex", "recursive", "binary-sem", "spinlock", "lock-free"};
+static const char *placementNames[] = {"same-core", "split-cores", "any-core"};
+
+#define RUN_TIMEOUT_MS 30000
+#define MIXED_YIELD_EVERY 16 // iterations between the mixed-priority workers' 1-tick sleeps
+
+// Shared by the workers of the current run. File scope rather than on the
+// caller's stack so a timed-out run never leaves workers pointing at a dead
+// stack frame; runs are sequential anyway.
+static portMUX_TYPE g_benchMux = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<uint32_t> g_casWord(0);
+static volatile uint32_t g_protectedCounter = 0;
+static volatile bool g_benchCancelled = false; // workers leave without running
+
+typedef struct
+{
+    const lock_bench_config_t *config;
+    SemaphoreHandle_t lock;
+    portMUX_TYPE *mux;
+    std::atomic<uint32_t> *casWord;
+    volatile uint32_t *protectedCounter;
+
+    uint32_t *acquire; // this worker's slice of the sample buffer
+    uint32_t acquireCapacity;
+    uint32_t acquireCount;
+    uint32_t holdHistogram[LOCKBENCH_HOLD_BUCKETS];
+    uint32_t casRetries;
+
+    SemaphoreHandle_t startSem;
+    SemaphoreHandle_t doneSem;
+} worker_ctx_t;
+
+static inline void spinCycles(uint32_t cycles)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    while (esp_cpu_get_cycle_count() - start < cycles)
+    {
+    }
+}
+
+// Burns `us` of this task's own CPU time. The cycle counter keeps running
+// while the task is preempted, so steps longer than 10 us (another task or
+// an interrupt ran in between) are not counted.
+static void cpuWorkUs(uint32_t us)
+{
+    const uint32_t mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    const uint32_t target = us * mhz;
+    uint32_t done = 0;
+    uint32_t last = esp_cpu_get_cycle_count();
+    while (done < target)
+    {
+        uint32_t now = esp_cpu_get_cycle_count();
+        if (now - last < 10 * mhz)
+            done += now - last;
+        last = now;
+    }
+}
+
+static inline uint8_t log2Bucket(uint32_t cycles)
+{
+    uint8_t bucket = 0;
+    while (cycles > 1 && bucket < LOCKBENCH_HOLD_BUCKETS - 1)
+    {
+        cycles >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void acquireLock(worker_ctx_t *w)
+{
+    switch (w->config->kind)
+    {
+    case LOCK_KIND_MUTEX:
+    case LOCK_KIND_BINARY_SEMAPHORE:
+        xSemaphoreTake(w->lock, portMAX_DELAY);
+        break;
+    case LOCK_KIND_RECURSIVE_MUTEX:
+        xSemaphoreTakeRecursive(w->lock, portMAX_DELAY);
+        break;
+    case LOCK_KIND_SPINLOCK:
+        portENTER_CRITICAL(w->mux);
+        break;
+    default:
+        break;
+    }
+}
+
+static void releaseLock(worker_ctx_t *w)
+{
+    switch (w->config->kind)
+    {
+    case LOCK_KIND_MUTEX:
+    case LOCK_KIND_BINARY_SEMAPHORE:
+        xSemaphoreGive(w->lock);
+        break;
+    case LOCK_KIND_RECURSIVE_MUTEX:
+        xSemaphoreGiveRecursive(w->lock);
+        break;
+    case LOCK_KIND_SPINLOCK:
+        portEXIT_CRITICAL(w->mux);
+        break;
+    default:
+        break;
+    }
+}
+
+static void recordAcquire(worker_ctx_t *w, uint32_t cycles)
+{
+    if (w->acquireCount < w->acquireCapacity)
+        w->acquire[w->acquireCount++] = cycles;
+}
+
+static void workerTask(void *pvParameter)
+{
+    worker_ctx_t *w = (worker_ctx_t *)pvParameter;
+    const lock_bench_config_t *config = w->config;
+
+    xSemaphoreTake(w->startSem, portMAX_DELAY);
+
+    for (uint32_t i = 0; i < config->iterations && !g_benchCancelled; i++)
+    {
+        if (config->kind == LOCK_KIND_LOCK_FREE)
+        {
+            // The "work" is done outside, only publishing the result races
+            spinCycles(config->holdCycles);
+            uint32_t t0 = esp_cpu_get_cycle_count();
+            uint32_t expected = w->casWord->load(std::memory_order_relaxed);
+            while (!w->casWord->compare_exchange_weak(expected, expected + 1, std::memory_order_acq_rel))
+            {
+                w->casRetries++;
+            }
+            recordAcquire(w, esp_cpu_get_cycle_count() - t0);
+        }
+        else
+        {
+            uint32_t t0 = esp_cpu_get_cycle_count();
+            acquireLock(w);
+            uint32_t t1 = esp_cpu_get_cycle_count();
+            *w->protectedCounter = *w->protectedCounter + 1;
+            spinCycles(config->holdCycles);
+            uint32_t t2 = esp_cpu_get_cycle_count();
+            releaseLock(w);
+
+            recordAcquire(w, t1 - t0);
+            w->holdHistogram[log2Bucket(t2 - t1)]++;
+        }
+        spinCycles(config->gapCycles);
+
+        // The gap is a busy spin, so without a sleep a higher-priority
+        // worker would never leave the CPU and the row would time the
+        // starvation of the lower ones instead of the lock. Sleeping off
+        // the lock lets every priority contend; it is outside the samples.
+        if (config->mixedPriorities && (i % MIXED_YIELD_EVERY) == MIXED_YIELD_EVERY - 1)
+            vTaskDelay(1);
+    }
+
+    xSemaphoreGive(w->doneSem);
+    vTaskDelete(NULL);
+}
+
+static int compareU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t pct)
+{
+    if (n == 0)
+        return 0;
+    return sorted[(uint64_t)(n - 1) * pct / 100];
+}
+
+static SemaphoreHandle_t createLock(lock_kind_t kind)
+{
+    SemaphoreHandle_t lock = NULL;
+    switch (kind)
+    {
+    case LOCK_KIND_MUTEX:
+        lock = xSemaphoreCreateMutex();
+        break;
+    case LOCK_KIND_RECURSIVE_MUTEX:
+        lock = xSemaphoreCreateRecursiveMutex();
+        break;
+    case LOCK_KIND_BINARY_SEMAPHORE:
+        // Binary semaphores start empty; give once so it acts as a lock
+        lock = xSemaphoreCreateBinary();
+        if (lock != NULL)
+            xSemaphoreGive(lock);
+        break;
+    default:
+        break;
+    }
+    return lock;
+}
+
+bool lockBenchRun(const lock_bench_config_t *config, lock_bench_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    if (config->taskCount == 0 || config->taskCount > LOCKBENCH_MAX_TASKS)
+    {
+        ESP_LOGE(TAG, "taskCount must be 1..%d", LOCKBENCH_MAX_TASKS);
+        return false;
+    }
+
+    bool needsHandle = config->kind != LOCK_KIND_SPINLOCK && config->kind != LOCK_KIND_LOCK_FREE;
+    SemaphoreHandle_t lock = needsHandle ? createLock(config->kind) : NULL;
+    SemaphoreHandle_t startSem = xSemaphoreCreateCounting(config->taskCount, 0);
+    SemaphoreHandle_t doneSem = xSemaphoreCreateCounting(config->taskCount, 0);
+    worker_ctx_t *workers = (worker_ctx_t *)pvPortMalloc(sizeof(worker_ctx_t) * config->taskCount);
+    uint32_t *samples = (uint32_t *)pvPortMalloc(sizeof(uint32_t) * LOCKBENCH_MAX_SAMPLES);
+
+    if ((needsHandle && lock == NULL) || startSem == NULL || doneSem == NULL || workers == NULL || samples == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate benchmark resources!");
+        if (lock != NULL)
+            vSemaphoreDelete(lock);
+        if (startSem != NULL)
+            vSemaphoreDelete(startSem);
+        if (doneSem != NULL)
+            vSemaphoreDelete(doneSem);
+        vPortFree(workers);
+        vPortFree(samples);
+        return false;
+    }
+
+    g_casWord.store(0);
+    g_protectedCounter = 0;
+    g_benchCancelled = false;
+    uint32_t slice = LOCKBENCH_MAX_SAMPLES / config->taskCount;
+
+    uint8_t created = 0;
+    for (uint8_t i = 0; i < config->taskCount; i++)
+    {
+        worker_ctx_t *w = &workers[i];
+        memset(w, 0, sizeof(*w));
+        w->config = config;
+        w->lock = lock;
+        w->mux = &g_benchMux;
+        w->casWord = &g_casWord;
+        w->protectedCounter = &g_protectedCounter;
+        w->acquire = &samples[i * slice];
+        w->acquireCapacity = slice;
+        w->startSem = startSem;
+        w->doneSem = doneSem;
+
+        UBaseType_t priority = config->basePriority + (config->mixedPriorities ? (i % 3) : 0);
+        BaseType_t core = tskNO_AFFINITY;
+        if (config->placement == LOCK_PLACE_SAME_CORE)
+            core = 0;
+        else if (config->placement == LOCK_PLACE_SPLIT_CORES)
+            core = i % portNUM_PROCESSORS;
+
+        if (xTaskCreatePinnedToCore(workerTask, "lockWorker", 2048, w, priority, NULL, core) != pdPASS)
+            break;
+        created++;
+    }
+    if (created < config->taskCount)
+    {
+        // Release the workers that exist without running them, then free
+        ESP_LOGE(TAG, "Failed to create worker %u of %u!", created + 1, config->taskCount);
+        g_benchCancelled = true;
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (uint8_t i = 0; i < created; i++)
+    {
+        xSemaphoreGive(startSem);
+    }
+
+    for (uint8_t i = 0; i < created; i++)
+    {
+        if (xSemaphoreTake(doneSem, pdMS_TO_TICKS(RUN_TIMEOUT_MS)) != pdTRUE)
+        {
+            // Workers still reference the buffers; leak them rather than
+            // free memory that is in use.
+            ESP_LOGE(TAG, "Run timed out waiting for workers (%s)", kindNames[config->kind]);
+            return false;
+        }
+    }
+    result->elapsedUs = esp_timer_get_time() - start;
+
+    if (g_benchCancelled)
+    {
+        if (lock != NULL)
+            vSemaphoreDelete(lock);
+        vSemaphoreDelete(startSem);
+        vSemaphoreDelete(doneSem);
+        vPortFree(workers);
+        vPortFree(samples);
+        return false;
+    }
+
+    // Compact every worker's slice into one array for the percentiles
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < config->taskCount; i++)
+    {
+        worker_ctx_t *w = &workers[i];
+        memmove(&samples[n], w->acquire, w->acquireCount * sizeof(uint32_t));
+        n += w->acquireCount;
+        for (int b = 0; b < LOCKBENCH_HOLD_BUCKETS; b++)
+        {
+            result->holdHistogram[b] += w->holdHistogram[b];
+        }
+        result->casRetries += w->casRetries;
+    }
+    qsort(samples, n, sizeof(uint32_t), compareU32);
+
+    result->samples = n;
+    result->acquireP50 = percentile(samples, n, 50);
+    result->acquireP90 = percentile(samples, n, 90);
+    result->acquireP99 = percentile(samples, n, 99);
+    result->acquireMax = (n > 0) ? samples[n - 1] : 0;
+
+    if (lock != NULL)
+        vSemaphoreDelete(lock);
+    vSemaphoreDelete(startSem);
+    vSemaphoreDelete(doneSem);
+    vPortFree(workers);
+    vPortFree(samples);
+    return true;
+}
+
+void lockBenchReport(const lock_bench_config_t *config, const lock_bench_result_t *result)
+{
+    const uint32_t mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+
+    ESP_LOGI(TAG, "%-10s %u tasks %-11s%s  acquire cycles p50=%lu p90=%lu p99=%lu max=%lu (p99 %.2f us)  %lld us total",
+             kindNames[config->kind], config->taskCount, placementNames[config->placement],
+             config->mixedPriorities ? " mixed-prio" : "",
+             (unsigned long)result->acquireP50, (unsigned long)result->acquireP90,
+             (unsigned long)result->acquireP99, (unsigned long)result->acquireMax,
+             (double)result->acquireP99 / mhz, (long long)result->elapsedUs);
+
+    if (config->kind == LOCK_KIND_LOCK_FREE)
+    {
+        ESP_LOGI(TAG, "           CAS retries: %lu", (unsigned long)result->casRetries);
+        return;
+    }
+
+    char line[LOCKBENCH_HOLD_BUCKETS * 12] = {0};
+    int pos = 0;
+    for (int b = 0; b < LOCKBENCH_HOLD_BUCKETS && pos < (int)sizeof(line); b++)
+    {
+        if (result->holdHistogram[b] != 0)
+            pos += snprintf(&line[pos], sizeof(line) - pos, " 2^%d:%lu", b, (unsigned long)result->holdHistogram[b]);
+    }
+    ESP_LOGI(TAG, "           hold cycles:%s", line);
+}
+
+// --- priority inversion ----------------------------------------------------
+
+#define INVERSION_BASE_PRIORITY 5
+#define INVERSION_LOW_HOLD_US 20000
+#define INVERSION_MEDIUM_BUSY_US 100000
+
+typedef struct
+{
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t lockedSem;
+    SemaphoreHandle_t doneSem;
+    int64_t highWaitUs;
+} inversion_ctx_t;
+
+static void inversionLowTask(void *pvParameter)
+{
+    inversion_ctx_t *ctx = (inversion_ctx_t *)pvParameter;
+    xSemaphoreTake(ctx->lock, portMAX_DELAY);
+    xSemaphoreGive(ctx->lockedSem);
+    cpuWorkUs(INVERSION_LOW_HOLD_US);
+    xSemaphoreGive(ctx->lock);
+    xSemaphoreGive(ctx->doneSem);
+    vTaskDelete(NULL);
+}
+
+static void inversionMediumTask(void *pvParameter)
+{
+    inversion_ctx_t *ctx = (inversion_ctx_t *)pvParameter;
+    cpuWorkUs(INVERSION_MEDIUM_BUSY_US);
+    xSemaphoreGive(ctx->doneSem);
+    vTaskDelete(NULL);
+}
+
+static void inversionHighTask(void *pvParameter)
+{
+    inversion_ctx_t *ctx = (inversion_ctx_t *)pvParameter;
+    int64_t start = esp_timer_get_time();
+    xSemaphoreTake(ctx->lock, portMAX_DELAY);
+    ctx->highWaitUs = esp_timer_get_time() - start;
+    xSemaphoreGive(ctx->lock);
+    xSemaphoreGive(ctx->doneSem);
+    vTaskDelete(NULL);
+}
+
+int64_t lockBenchPriorityInversion(bool withInheritance)
+{
+    // Static for the same reason as g_benchMux: a timed-out test must not
+    // leave its tasks pointing into this stack frame.
+    static inversion_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.lock = createLock(withInheritance ? LOCK_KIND_MUTEX : LOCK_KIND_BINARY_SEMAPHORE);
+    ctx.lockedSem = xSemaphoreCreateBinary();
+    ctx.doneSem = xSemaphoreCreateCounting(3, 0);
+    if (ctx.lock == NULL || ctx.lockedSem == NULL || ctx.doneSem == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create inversion test semaphores!");
+        return -1;
+    }
+
+    // Outrank all three test tasks so we can set the scene before they run
+    UBaseType_t oldPriority = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, INVERSION_BASE_PRIORITY + 4);
+
+    // Every task that was created finishes on its own, so a failed create
+    // only shortens the wait
+    int created = 0;
+    if (xTaskCreatePinnedToCore(inversionLowTask, "invLow", 2048, &ctx, INVERSION_BASE_PRIORITY + 1, NULL, 0) ==
+        pdPASS)
+    {
+        created++;
+        xSemaphoreTake(ctx.lockedSem, portMAX_DELAY);
+        if (xTaskCreatePinnedToCore(inversionHighTask, "invHigh", 2048, &ctx, INVERSION_BASE_PRIORITY + 3, NULL, 0) ==
+            pdPASS)
+            created++;
+        if (xTaskCreatePinnedToCore(inversionMediumTask, "invMed", 2048, &ctx, INVERSION_BASE_PRIORITY + 2, NULL,
+                                    0) == pdPASS)
+            created++;
+    }
+
+    bool finished = true;
+    for (int i = 0; i < created; i++)
+    {
+        if (xSemaphoreTake(ctx.doneSem, pdMS_TO_TICKS(RUN_TIMEOUT_MS)) != pdTRUE)
+            finished = false;
+    }
+    vTaskPrioritySet(NULL, oldPriority);
+
+    if (!finished)
+    {
+        ESP_LOGE(TAG, "Inversion test timed out");
+        return -1;
+    }
+
+    vSemaphoreDelete(ctx.lock);
+    vSemaphoreDelete(ctx.lockedSem);
+    vSemaphoreDelete(ctx.doneSem);
+    if (created < 3)
+    {
+        ESP_LOGE(TAG, "Failed to create inversion test tasks!");
+        return -1;
+    }
+    return ctx.highWaitUs;
+}
+
+// --- suite -----------------------------------------------------------------
+
+void lockBenchSuite(void)
+{
+    static const uint8_t taskCounts[] = {1, 2, 4};
+    lock_bench_config_t config = {};
+    lock_bench_result_t result;
+
+    config.basePriority = 5;
+    config.iterations = 500;
+    config.holdCycles = 200;
+    config.gapCycles = 200;
+
+    ESP_LOGI(TAG, "========== Lock contention benchmark ==========");
+    for (int kind = 0; kind < LOCK_KIND_COUNT; kind++)
+    {
+        config.kind = (lock_kind_t)kind;
+        for (int placement = LOCK_PLACE_SAME_CORE; placement <= LOCK_PLACE_SPLIT_CORES; placement++)
+        {
+            if (placement == LOCK_PLACE_SPLIT_CORES && portNUM_PROCESSORS == 1)
+                continue;
+            config.placement = (lock_placement_t)placement;
+            for (size_t t = 0; t < sizeof(taskCounts); t++)
+            {
+                config.taskCount = taskCounts[t];
+                config.mixedPriorities = false;
+                if (lockBenchRun(&config, &result))
+                    lockBenchReport(&config, &result);
+            }
+        }
+
+        // Mixed priorities on one core: the workers sleep a tick every
+        // MIXED_YIELD_EVERY iterations, so a waking higher-priority worker
+        // preempts lower ones mid-hold and waits on them. The elapsed total
+        // includes those sleeps.
+        config.placement = LOCK_PLACE_SAME_CORE;
+        config.taskCount = 4;
+        config.mixedPriorities = true;
+        if (lockBenchRun(&config, &result))
+            lockBenchReport(&config, &result);
+    }
+
+    int64_t withPi = lockBenchPriorityInversion(true);
+    int64_t withoutPi = lockBenchPriorityInversion(false);
+    ESP_LOGI(TAG, "Priority inversion: High waited %lld us with inheritance (mutex), %lld us without (binary semaphore)",
+             (long long)withPi, (long long)withoutPi);
+    ESP_LOGI(TAG, "Expected: ~%d us vs ~%d us", INVERSION_LOW_HOLD_US, INVERSION_LOW_HOLD_US + INVERSION_MEDIUM_BUSY_US);
+    ESP_LOGI(TAG, "===============================================");
+}
+
+void lockBenchTask(void *pvParameter)
+{
+    (void)pvParameter;
+    lockBenchSuite();
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,96 @@
+/**
+ * Lock contention benchmark suite
+ *
+ * Day 5 showed that UART contention is real; this measures what the
+ * different ways of protecting shared data actually cost. Every run starts
+ * taskCount worker tasks that hammer one shared lock:
+ *
+ *   t0 = cycles; acquire; t1 = cycles; <hold work>; t2 = cycles; release
+ *
+ *   acquire latency = t1 - t0   (p50 / p90 / p99 / max)
+ *   hold time       = t2 - t1   (log2 histogram)
+ *
+ * Lock kinds:
+ *   MUTEX            xSemaphoreCreateMutex (priority inheritance)
+ *   RECURSIVE_MUTEX  xSemaphoreCreateRecursiveMutex
+ *   BINARY_SEMAPHORE xSemaphoreCreateBinary (NO priority inheritance)
+ *   SPINLOCK         portENTER_CRITICAL on a portMUX_TYPE
+ *   LOCK_FREE        compare-and-swap retry loop, no lock at all
+ *
+ * The priority-inversion test runs the classic Low/Medium/High scenario on
+ * one core and reports how long High waited, once with a mutex and once
+ * with a binary semaphore, so the effect of priority inheritance is visible.
+ *
+ * Cycle counters are per core: acquire/hold times are only exact when the
+ * worker stays on one core, so LOCK_PLACE_ANY_CORE results are indicative.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#define LOCKBENCH_MAX_TASKS 8
+#define LOCKBENCH_MAX_SAMPLES 4096 // acquire samples kept per run (all tasks)
+#define LOCKBENCH_HOLD_BUCKETS 16  // log2(cycles) histogram buckets
+
+typedef enum
+{
+    LOCK_KIND_MUTEX = 0,
+    LOCK_KIND_RECURSIVE_MUTEX,
+    LOCK_KIND_BINARY_SEMAPHORE,
+    LOCK_KIND_SPINLOCK,
+    LOCK_KIND_LOCK_FREE,
+    LOCK_KIND_COUNT
+} lock_kind_t;
+
+typedef enum
+{
+    LOCK_PLACE_SAME_CORE = 0, // every worker pinned to core 0
+    LOCK_PLACE_SPLIT_CORES,   // worker i pinned to core i % portNUM_PROCESSORS
+    LOCK_PLACE_ANY_CORE       // tskNO_AFFINITY
+} lock_placement_t;
+
+typedef struct
+{
+    lock_kind_t kind;
+    lock_placement_t placement;
+    uint8_t taskCount;
+    UBaseType_t basePriority;
+    bool mixedPriorities; // worker i runs at basePriority + (i % 3) and sleeps a tick now and then
+    uint32_t iterations;  // per worker
+    uint32_t holdCycles;  // busy work inside the lock
+    uint32_t gapCycles;   // busy work between releases and the next acquire
+} lock_bench_config_t;
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t acquireP50;
+    uint32_t acquireP90;
+    uint32_t acquireP99;
+    uint32_t acquireMax;
+    uint32_t holdHistogram[LOCKBENCH_HOLD_BUCKETS]; // bucket n: [2^n, 2^(n+1)) cycles
+    uint32_t casRetries;                            // LOCK_FREE only
+    int64_t elapsedUs;
+} lock_bench_result_t;
+
+// Runs one configuration. Blocks the calling task until every worker has
+// finished (or a 30 s timeout). Returns false if resources could not be
+// created or the run timed out.
+bool lockBenchRun(const lock_bench_config_t *config, lock_bench_result_t *result);
+
+void lockBenchReport(const lock_bench_config_t *config, const lock_bench_result_t *result);
+
+// Low/Medium/High inversion on one core. Returns how long High waited for
+// the lock in microseconds, or -1 on failure.
+int64_t lockBenchPriorityInversion(bool withInheritance);
+
+// Runs the full matrix (every lock kind x 1/2/4 tasks x placements, plus
+// the inversion test) and logs a table.
+void lockBenchSuite(void);
+
+// Task wrapper so the suite can be started from app_main:
+//   xTaskCreate(lockBenchTask, "lockBench", 4096, NULL, 10, NULL);
+void lockBenchTask(void *pvParameter);
@@ -0,0 +1,161 @@
+#include "log_tag.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
+
+LOG_TAG(TAG, "LogTag", ESP_LOG_INFO);
+
+// Only used by the benchmark: the same debug message under a tag whose
+// ceiling admits it and one whose ceiling does not
+LOG_TAG(BENCH_DEBUG_TAG, "logBenchDebug", ESP_LOG_DEBUG);
+LOG_TAG(BENCH_INFO_TAG, "logBenchInfo", ESP_LOG_INFO);
+
+static const char levelLetters[] = "NEWIDV";
+
+// Flash code and read-only data bounds from the ESP-IDF linker script
+extern "C" const char _text_start[], _text_end[], _rodata_start[], _rodata_end[];
+
+static log_tag_t *g_tags = NULL; // built during static initialisation only
+
+bool logTagRegister(log_tag_t *tag)
+{
+    tag->next = g_tags;
+    g_tags = tag;
+    return true;
+}
+
+static void applyLevel(log_tag_t *tag, esp_log_level_t level, int *clamped)
+{
+    if (level > tag->maxLevel)
+    {
+        level = tag->maxLevel;
+        (*clamped)++;
+    }
+    tag->level = level;
+    esp_log_level_set(tag->name, level);
+}
+
+int logSetLevel(const char *tag, esp_log_level_t level)
+{
+    int clamped = 0;
+    bool all = strcmp(tag, "*") == 0;
+    bool found = false;
+    for (log_tag_t *t = g_tags; t != NULL; t = t->next)
+    {
+        if (all || strcmp(t->name, tag) == 0)
+        {
+            applyLevel(t, level, &clamped);
+            found = true;
+        }
+    }
+
+    // Plain ESP_LOGx users; "*" is applied first so the tags set above are
+    // not overridden by the new default
+    if (all)
+    {
+        esp_log_level_set("*", level);
+        for (log_tag_t *t = g_tags; t != NULL; t = t->next)
+            esp_log_level_set(t->name, t->level);
+    }
+    else if (!found)
+    {
+        esp_log_level_set(tag, level);
+    }
+    return clamped;
+}
+
+void logTagReport(void)
+{
+    for (log_tag_t *t = g_tags; t != NULL; t = t->next)
+    {
+        LOGI(TAG, "%-16s ceiling %c  level %c", t->name, levelLetters[t->maxLevel], levelLetters[t->level]);
+    }
+}
+
+bool logCommand(const char *line)
+{
+    char cmd[8] = {0};
+    char tag[24] = {0};
+    char levelText[8] = {0};
+    int n = sscanf(line, "%7s %23s %7s", cmd, tag, levelText);
+    if (n < 1 || strcmp(cmd, "log") != 0)
+        return false;
+
+    if (n == 1)
+    {
+        logTagReport();
+        return true;
+    }
+
+    const char *letter = (n == 3 && levelText[0] != '\0') ? strchr(levelLetters, levelText[0] & ~0x20) : NULL;
+    if (strcmp(levelText, "none") == 0)
+        letter = levelLetters;
+    if (letter == NULL)
+    {
+        LOGW(TAG, "Usage: log <tag|*> <none|E|W|I|D|V>");
+        return true;
+    }
+
+    if (logSetLevel(tag, (esp_log_level_t)(letter - levelLetters)) > 0)
+        LOGW(TAG, "Some tags are compiled with a lower ceiling, see \"log\"");
+    return true;
+}
+
+// noinline so each loop is measured as a caller would see it
+static __attribute__((noinline)) uint32_t espLogLoop(uint32_t calls)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        // What ESP_LOGD expands to once CONFIG_LOG_MAXIMUM_LEVEL is DEBUG
+        ESP_LOG_LEVEL(ESP_LOG_DEBUG, BENCH_DEBUG_TAG, "Counter : %d", (int)i);
+    }
+    return esp_cpu_get_cycle_count() - start;
+}
+
+static __attribute__((noinline)) uint32_t runtimeOffLoop(uint32_t calls)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        LOGD(BENCH_DEBUG_TAG, "Counter : %d", (int)i);
+    }
+    return esp_cpu_get_cycle_count() - start;
+}
+
+static __attribute__((noinline)) uint32_t compiledOutLoop(uint32_t calls)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        LOGD(BENCH_INFO_TAG, "Counter : %d", (int)i);
+        __asm__ __volatile__("" ::: "memory"); // keep the empty loop
+    }
+    return esp_cpu_get_cycle_count() - start;
+}
+
+void logTagBenchmark(uint32_t calls)
+{
+    if (calls == 0)
+        return;
+
+    // Debug compiled in for BENCH_DEBUG_TAG but switched off at runtime
+    logSetLevel(BENCH_DEBUG_TAG, ESP_LOG_INFO);
+
+    uint32_t esp = espLogLoop(calls);
+    uint32_t runtimeOff = runtimeOffLoop(calls);
+    uint32_t compiledOut = compiledOutLoop(calls);
+
+    LOGI(TAG, "Disabled debug message, cycles per call over %lu calls:", (unsigned long)calls);
+    LOGI(TAG, "  ESP_LOGD, runtime level INFO   %6lu", (unsigned long)(esp / calls));
+    LOGI(TAG, "  LOGD, runtime level INFO       %6lu", (unsigned long)(runtimeOff / calls));
+    LOGI(TAG, "  LOGD, above the tag's ceiling  %6lu  (no code, %u bytes of format string not in flash)",
+         (unsigned long)(compiledOut / calls), (unsigned)sizeof(LOG_FORMAT(D, "Counter : %d")));
+
+    // The before/after record for a ceiling change: this line from a build
+    // with the tag at ESP_LOG_DEBUG and from one at ESP_LOG_INFO
+    LOGI(TAG, "Image: .text %lu bytes, .rodata %lu bytes", (unsigned long)(_text_end - _text_start),
+         (unsigned long)(_rodata_end - _rodata_start));
+}
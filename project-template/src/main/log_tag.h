@@ -0,0 +1,104 @@
+/**
+ * Per-tag log levels fixed at compile time
+ *
+ * platformio.ini passes -D CORE_DEBUG_LEVEL=5, but that is an Arduino
+ * setting; under framework = espidf the compile-time limit is
+ * CONFIG_LOG_MAXIMUM_LEVEL, which is one level for every file. Raising it to
+ * debug one module compiles every ESP_LOGD in the firmware back in. Each
+ * of those calls then costs a timestamp read and a call into
+ * esp_log_write() just to find out the tag is set to INFO, and its format
+ * string takes space in flash. The exercises only change verbosity at
+ * runtime with esp_log_level_set("*", ...).
+ *
+ * Here each tag carries its own ceiling, declared where TAG used to be:
+ *
+ *   LOG_TAG(TAG, "Counter", ESP_LOG_INFO);  // instead of static const char *TAG = "Counter";
+ *   LOGI(TAG, "Started");
+ *   LOGD(TAG, "Counter : %d", counter);     // above the ceiling: no code, no string
+ *
+ * A call above the tag's ceiling is discarded by `if constexpr`. A call
+ * within the ceiling first checks the tag's runtime level inline and only
+ * then goes through ESP_LOG_LEVEL, so a debug message that is switched
+ * off at runtime costs a load and a compare. The ceiling does not depend
+ * on CONFIG_LOG_MAXIMUM_LEVEL, so one module can log at DEBUG while the
+ * rest of the firmware stays compiled at INFO.
+ *
+ * logSetLevel() changes levels at runtime (also "log <tag|*> <level>" on
+ * the console), but never above a tag's ceiling.
+ *
+ * logTagBenchmark() shows the per-call cycles of each case and ends with
+ * the image's .text and .rodata sizes, read from the linker script's
+ * section bounds. Its log is therefore the size record too: run it once
+ * with a module's tag at ESP_LOG_DEBUG and once at ESP_LOG_INFO (e.g. the
+ * Day 1 logging exercise, .exercises/completed/day1-ex3-logging-levels.cpp)
+ * and compare the two "Image:" lines. Per call site, the three benchmark
+ * loops are separate noinline functions, so
+ *
+ *   xtensa-esp32-elf-nm -S -C .pio/build/esp32dev/firmware.elf | grep Loop
+ *
+ * gives the .text of an ESP_LOGD, a LOGD within its ceiling and a LOGD
+ * above it from a single build.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+typedef struct log_tag
+{
+    const char *name;
+    esp_log_level_t maxLevel;       // compile-time ceiling
+    volatile esp_log_level_t level; // runtime, never above maxLevel
+    struct log_tag *next;
+} log_tag_t;
+
+#define LOG_TAG_DEFAULT_LEVEL ((esp_log_level_t)CONFIG_LOG_DEFAULT_LEVEL)
+
+// Declares `var` (the tag string) together with its ceiling and runtime
+// level, and registers the tag for logSetLevel() before app_main runs.
+#define LOG_TAG(var, name, maxLevel)                                                                      \
+    static const char *var = name;                                                                        \
+    static constexpr esp_log_level_t var##_MAX_LEVEL = maxLevel;                                          \
+    static log_tag_t var##_INFO = {name, maxLevel,                                                        \
+                                   (maxLevel) < LOG_TAG_DEFAULT_LEVEL ? (maxLevel) : LOG_TAG_DEFAULT_LEVEL, \
+                                   NULL};                                                                 \
+    static __attribute__((unused)) const bool var##_REGISTERED = logTagRegister(&var##_INFO)
+
+#define LOG_TAG_WRITE(tag, lvl, format, ...)                          \
+    do                                                                \
+    {                                                                 \
+        if constexpr ((lvl) <= tag##_MAX_LEVEL)                       \
+        {                                                             \
+            if ((lvl) <= tag##_INFO.level)                            \
+                ESP_LOG_LEVEL((lvl), tag, format, ##__VA_ARGS__);     \
+        }                                                             \
+    } while (0)
+
+#define LOGE(tag, format, ...) LOG_TAG_WRITE(tag, ESP_LOG_ERROR, format, ##__VA_ARGS__)
+#define LOGW(tag, format, ...) LOG_TAG_WRITE(tag, ESP_LOG_WARN, format, ##__VA_ARGS__)
+#define LOGI(tag, format, ...) LOG_TAG_WRITE(tag, ESP_LOG_INFO, format, ##__VA_ARGS__)
+#define LOGD(tag, format, ...) LOG_TAG_WRITE(tag, ESP_LOG_DEBUG, format, ##__VA_ARGS__)
+#define LOGV(tag, format, ...) LOG_TAG_WRITE(tag, ESP_LOG_VERBOSE, format, ##__VA_ARGS__)
+
+// Used by LOG_TAG; runs during static initialisation.
+bool logTagRegister(log_tag_t *tag);
+
+// Sets the runtime level of one tag, or of every registered tag for "*",
+// clamped to each tag's ceiling. Tags not declared with LOG_TAG are
+// passed to esp_log_level_set() unchanged. Returns the number of
+// registered tags that were clamped.
+int logSetLevel(const char *tag, esp_log_level_t level);
+
+// Logs every registered tag with its ceiling and current level.
+void logTagReport(void);
+
+// Handles "log" (list) and "log <tag|*> <none|E|W|I|D|V>" lines from the
+// serial console; returns false for anything else.
+bool logCommand(const char *line);
+
+// Cycles per call for a debug message that is: an ESP_LOGD switched off at
+// runtime, a LOGD switched off at runtime, and a LOGD above its ceiling.
+void logTagBenchmark(uint32_t calls);
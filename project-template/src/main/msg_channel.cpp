@@ -0,0 +1,574 @@
+#include "msg_channel.h"
+
+#include <string.h>
+
+static const char *TAG = "MsgChannel";
+
+// --- platform --------------------------------------------------------------
+
+#ifdef MSG_HOST_MAIN
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "host_test.h"
+
+#define ESP_LOGE(tag, format, ...) printf("%s: " format "\n", tag, ##__VA_ARGS__)
+
+// Same semantics as a FreeRTOS binary semaphore: a give before the take
+// is kept, a second give is lost
+struct msg_host_sem
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    bool given;
+};
+
+static SemaphoreHandle_t semCreate(void)
+{
+    SemaphoreHandle_t sem = new msg_host_sem;
+    sem->given = false;
+    return sem;
+}
+
+static void semDelete(SemaphoreHandle_t sem)
+{
+    delete sem;
+}
+
+static void semGive(SemaphoreHandle_t sem)
+{
+    std::lock_guard<std::mutex> guard(sem->lock);
+    sem->given = true;
+    sem->cv.notify_one();
+}
+
+static void semTake(SemaphoreHandle_t sem, TickType_t timeout)
+{
+    std::unique_lock<std::mutex> guard(sem->lock);
+    if (timeout == portMAX_DELAY)
+        sem->cv.wait(guard, [sem] { return sem->given; });
+    else
+        sem->cv.wait_for(guard, std::chrono::milliseconds(timeout), [sem] { return sem->given; });
+    sem->given = false;
+}
+
+static TickType_t tickCount(void)
+{
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#else
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/message_buffer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static SemaphoreHandle_t semCreate(void)
+{
+    return xSemaphoreCreateBinary();
+}
+
+static void semDelete(SemaphoreHandle_t sem)
+{
+    vSemaphoreDelete(sem);
+}
+
+static void semGive(SemaphoreHandle_t sem)
+{
+    xSemaphoreGive(sem);
+}
+
+static void semTake(SemaphoreHandle_t sem, TickType_t timeout)
+{
+    xSemaphoreTake(sem, timeout);
+}
+
+static TickType_t tickCount(void)
+{
+    return xTaskGetTickCount();
+}
+#endif
+
+// --- ring ------------------------------------------------------------------
+
+#define WRAP_MARKER 0xFFFFFFFFu
+
+static inline uint32_t align4(size_t len)
+{
+    return ((uint32_t)len + 3u) & ~3u;
+}
+
+static inline uint32_t loadCounter(const volatile uint32_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_SEQ_CST);
+}
+
+bool msgChannelInit(msg_channel_t *ch, uint8_t *buffer, uint32_t size)
+{
+    if (buffer == NULL || size < 16 || (size & (size - 1)) != 0)
+    {
+        ESP_LOGE(TAG, "Size %lu is not a power of two >= 16", (unsigned long)size);
+        return false;
+    }
+
+    memset(ch, 0, sizeof(*ch));
+    ch->buffer = buffer;
+    ch->size = size;
+    ch->spaceAvailable = semCreate();
+    ch->dataAvailable = semCreate();
+    if (ch->spaceAvailable == NULL || ch->dataAvailable == NULL)
+    {
+        msgChannelDeinit(ch);
+        return false;
+    }
+    return true;
+}
+
+void msgChannelDeinit(msg_channel_t *ch)
+{
+    if (ch->spaceAvailable != NULL)
+        semDelete(ch->spaceAvailable);
+    if (ch->dataAvailable != NULL)
+        semDelete(ch->dataAvailable);
+    ch->spaceAvailable = NULL;
+    ch->dataAvailable = NULL;
+}
+
+// Waits on `sem` until ready() holds or the timeout runs out. The flag is
+// raised before the final check, and the other side gives the semaphore
+// only when it sees the flag, so no wakeup is lost.
+template <typename Ready>
+static bool waitUntil(Ready ready, volatile bool *waiting, SemaphoreHandle_t sem, TickType_t timeout)
+{
+    TickType_t start = tickCount();
+    while (!ready())
+    {
+        TickType_t waited = tickCount() - start;
+        if (waited >= timeout)
+            return false;
+        __atomic_store_n(waiting, true, __ATOMIC_SEQ_CST);
+        if (!ready())
+            semTake(sem, timeout == portMAX_DELAY ? portMAX_DELAY : timeout - waited);
+        __atomic_store_n(waiting, false, __ATOMIC_SEQ_CST);
+    }
+    return true;
+}
+
+uint8_t *msgChannelReserve(msg_channel_t *ch, size_t maxLen, TickType_t timeout)
+{
+    if (maxLen > MSG_CHANNEL_MAX_MESSAGE(ch->size))
+        return NULL;
+
+    uint32_t need = MSG_CHANNEL_HEADER + align4(maxLen);
+    uint32_t head = ch->head;
+    uint32_t pos = head & (ch->size - 1);
+    uint32_t skip = (ch->size - pos < need) ? ch->size - pos : 0;
+
+    auto fits = [&]() { return ch->size - (head - loadCounter(&ch->tail)) >= skip + need; };
+    if (!fits())
+    {
+        ch->stats.writerBlocked++;
+        if (!waitUntil(fits, &ch->writerWaiting, ch->spaceAvailable, timeout))
+            return NULL;
+    }
+
+    if (skip > 0)
+    {
+        // The reader jumps to offset 0 when it meets this
+        uint32_t marker = WRAP_MARKER;
+        memcpy(&ch->buffer[pos], &marker, sizeof(marker));
+        ch->stats.wraps++;
+    }
+    ch->reserveAt = head + skip;
+    ch->reserveMax = (uint32_t)maxLen;
+    return &ch->buffer[(ch->reserveAt & (ch->size - 1)) + MSG_CHANNEL_HEADER];
+}
+
+void msgChannelCommit(msg_channel_t *ch, size_t len)
+{
+    uint32_t length = (len > ch->reserveMax) ? ch->reserveMax : (uint32_t)len;
+    memcpy(&ch->buffer[ch->reserveAt & (ch->size - 1)], &length, sizeof(length));
+
+    uint32_t head = ch->reserveAt + MSG_CHANNEL_HEADER + align4(length);
+    __atomic_store_n(&ch->head, head, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ch->readerWaiting, __ATOMIC_SEQ_CST))
+        semGive(ch->dataAvailable);
+
+    ch->stats.messages++;
+    ch->stats.bytes += length;
+    uint32_t used = head - loadCounter(&ch->tail);
+    if (used > ch->stats.peakUsed)
+        ch->stats.peakUsed = used;
+}
+
+const uint8_t *msgChannelReceive(msg_channel_t *ch, size_t *len, TickType_t timeout)
+{
+    uint32_t tail = ch->tail;
+
+    auto hasData = [&]() { return loadCounter(&ch->head) != tail; };
+    if (!hasData())
+    {
+        ch->stats.readerBlocked++;
+        if (!waitUntil(hasData, &ch->readerWaiting, ch->dataAvailable, timeout))
+            return NULL;
+    }
+
+    uint32_t pos = tail & (ch->size - 1);
+    uint32_t header;
+    memcpy(&header, &ch->buffer[pos], sizeof(header));
+    if (header == WRAP_MARKER)
+    {
+        // Committed together with the message that follows it
+        tail += ch->size - pos;
+        pos = 0;
+        memcpy(&header, &ch->buffer[0], sizeof(header));
+    }
+
+    ch->readAt = tail;
+    ch->readLen = header;
+    *len = header;
+    return &ch->buffer[pos + MSG_CHANNEL_HEADER];
+}
+
+void msgChannelRelease(msg_channel_t *ch)
+{
+    __atomic_store_n(&ch->tail, ch->readAt + MSG_CHANNEL_HEADER + align4(ch->readLen), __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ch->writerWaiting, __ATOMIC_SEQ_CST))
+        semGive(ch->spaceAvailable);
+}
+
+bool msgChannelSend(msg_channel_t *ch, const void *data, size_t len, TickType_t timeout)
+{
+    uint8_t *slot = msgChannelReserve(ch, len, timeout);
+    if (slot == NULL)
+        return false;
+    memcpy(slot, data, len);
+    msgChannelCommit(ch, len);
+    return true;
+}
+
+size_t msgChannelRead(msg_channel_t *ch, void *data, size_t capacity, TickType_t timeout)
+{
+    size_t len;
+    const uint8_t *msg = msgChannelReceive(ch, &len, timeout);
+    if (msg == NULL)
+        return 0;
+    memcpy(data, msg, len < capacity ? len : capacity);
+    msgChannelRelease(ch);
+    return len;
+}
+
+uint32_t msgChannelUsed(const msg_channel_t *ch)
+{
+    return loadCounter(&ch->head) - loadCounter(&ch->tail);
+}
+
+#ifndef MSG_HOST_MAIN
+// --- benchmark -------------------------------------------------------------
+
+#define BENCH_RAM 4096
+#define BENCH_MAX_MESSAGE 256
+
+typedef enum
+{
+    BENCH_CHANNEL = 0,
+    BENCH_MESSAGE_BUFFER,
+    BENCH_PADDED_QUEUE,
+    BENCH_KIND_COUNT
+} bench_kind_t;
+
+typedef struct
+{
+    uint16_t len;
+    uint8_t data[BENCH_MAX_MESSAGE];
+} bench_item_t; // what a queue has to carry for every message
+
+typedef struct
+{
+    bench_kind_t kind;
+    uint32_t messages;
+    msg_channel_t channel;
+    MessageBufferHandle_t messageBuffer;
+    QueueHandle_t queue;
+    SemaphoreHandle_t done;
+    uint32_t bytes;
+    uint32_t errors;
+} bench_ctx_t;
+
+static uint8_t g_benchRing[BENCH_RAM];
+
+// Mostly short commands, some medium records, a few large payloads. Both
+// sides run the same sequence so the reader can check every length.
+static uint16_t nextSize(uint32_t *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    uint32_t r = *seed >> 8;
+    uint32_t pick = r % 100;
+    if (pick < 75)
+        return 1 + (r >> 8) % 32;
+    if (pick < 95)
+        return 33 + (r >> 8) % 96;
+    return 129 + (r >> 8) % 128;
+}
+
+static void benchProducer(void *pvParameter)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)pvParameter;
+    bench_item_t item;
+    uint32_t seed = 1;
+
+    for (uint32_t i = 0; i < ctx->messages; i++)
+    {
+        uint16_t len = nextSize(&seed);
+        if (ctx->kind == BENCH_CHANNEL)
+        {
+            // Built in place, no intermediate buffer
+            uint8_t *slot = msgChannelReserve(&ctx->channel, len, portMAX_DELAY);
+            memset(slot, (uint8_t)i, len);
+            msgChannelCommit(&ctx->channel, len);
+        }
+        else if (ctx->kind == BENCH_MESSAGE_BUFFER)
+        {
+            memset(item.data, (uint8_t)i, len);
+            xMessageBufferSend(ctx->messageBuffer, item.data, len, portMAX_DELAY);
+        }
+        else
+        {
+            item.len = len;
+            memset(item.data, (uint8_t)i, len);
+            xQueueSend(ctx->queue, &item, portMAX_DELAY);
+        }
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void benchConsumer(void *pvParameter)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)pvParameter;
+    bench_item_t item;
+    uint32_t seed = 1;
+
+    for (uint32_t i = 0; i < ctx->messages; i++)
+    {
+        uint16_t expected = nextSize(&seed);
+        size_t len = 0;
+        uint8_t first = 0;
+        if (ctx->kind == BENCH_CHANNEL)
+        {
+            const uint8_t *msg = msgChannelReceive(&ctx->channel, &len, portMAX_DELAY);
+            first = msg[0];
+            msgChannelRelease(&ctx->channel);
+        }
+        else if (ctx->kind == BENCH_MESSAGE_BUFFER)
+        {
+            len = xMessageBufferReceive(ctx->messageBuffer, item.data, sizeof(item.data), portMAX_DELAY);
+            first = item.data[0];
+        }
+        else
+        {
+            xQueueReceive(ctx->queue, &item, portMAX_DELAY);
+            len = item.len;
+            first = item.data[0];
+        }
+
+        if (len != expected || first != (uint8_t)i)
+            ctx->errors++;
+        ctx->bytes += len;
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+void msgChannelBenchmark(uint32_t messages)
+{
+    static const char *names[BENCH_KIND_COUNT] = {"msg channel", "message buffer", "padded queue"};
+    static bench_ctx_t ctx;
+
+    BaseType_t consumerCore = (portNUM_PROCESSORS > 1) ? 1 : 0;
+    ESP_LOGI(TAG, "%lu messages of 1-%d bytes, %d bytes of RAM each, core 0 -> core %d", (unsigned long)messages,
+             BENCH_MAX_MESSAGE, BENCH_RAM, (int)consumerCore);
+
+    for (int kind = 0; kind < BENCH_KIND_COUNT; kind++)
+    {
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.kind = (bench_kind_t)kind;
+        ctx.messages = messages;
+        ctx.done = xSemaphoreCreateCounting(2, 0);
+
+        uint32_t depth = 0;
+        bool ok = ctx.done != NULL;
+        if (ok && kind == BENCH_CHANNEL)
+            ok = msgChannelInit(&ctx.channel, g_benchRing, sizeof(g_benchRing));
+        else if (ok && kind == BENCH_MESSAGE_BUFFER)
+            ok = (ctx.messageBuffer = xMessageBufferCreate(BENCH_RAM)) != NULL;
+        else if (ok)
+        {
+            depth = BENCH_RAM / sizeof(bench_item_t);
+            ok = (ctx.queue = xQueueCreate(depth, sizeof(bench_item_t))) != NULL;
+        }
+        if (!ok)
+        {
+            ESP_LOGE(TAG, "%s: failed to allocate", names[kind]);
+            if (ctx.done != NULL)
+                vSemaphoreDelete(ctx.done);
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+        xTaskCreatePinnedToCore(benchConsumer, "mcConsumer", 3072, &ctx, 5, NULL, consumerCore);
+        xTaskCreatePinnedToCore(benchProducer, "mcProducer", 3072, &ctx, 5, NULL, 0);
+        xSemaphoreTake(ctx.done, portMAX_DELAY);
+        xSemaphoreTake(ctx.done, portMAX_DELAY);
+        int64_t elapsed = esp_timer_get_time() - start;
+        if (elapsed <= 0)
+            elapsed = 1;
+
+        ESP_LOGI(TAG, "%-15s %7lu msg/s %9lu B/s  errors %lu", names[kind],
+                 (unsigned long)((int64_t)messages * 1000000 / elapsed),
+                 (unsigned long)((int64_t)ctx.bytes * 1000000 / elapsed), (unsigned long)ctx.errors);
+        if (kind == BENCH_CHANNEL)
+        {
+            ESP_LOGI(TAG, "    peak %lu of %d bytes used, %lu wraps, writer blocked %lu, reader blocked %lu",
+                     (unsigned long)ctx.channel.stats.peakUsed, BENCH_RAM, (unsigned long)ctx.channel.stats.wraps,
+                     (unsigned long)ctx.channel.stats.writerBlocked, (unsigned long)ctx.channel.stats.readerBlocked);
+            msgChannelDeinit(&ctx.channel);
+        }
+        else if (kind == BENCH_MESSAGE_BUFFER)
+            vMessageBufferDelete(ctx.messageBuffer);
+        else
+        {
+            ESP_LOGI(TAG, "    holds only %lu messages of any size", (unsigned long)depth);
+            vQueueDelete(ctx.queue);
+        }
+        vSemaphoreDelete(ctx.done);
+    }
+}
+#else
+// --- self test -------------------------------------------------------------
+
+static uint8_t g_testRing[64];
+static uint8_t g_threadRing[256];
+
+// Writer and reader share this sequence, so the reader can check every
+// length; each message is filled with its index
+static uint32_t testSize(uint32_t *seed, uint32_t maxLen)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return 1 + (*seed >> 8) % maxLen;
+}
+
+static bool filledWith(const uint8_t *msg, size_t len, uint8_t value)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (msg[i] != value)
+            return false;
+    }
+    return true;
+}
+
+bool msgChannelSelfTest(void)
+{
+    printf("Message channel self test\n");
+    bool ok = true;
+    msg_channel_t ch;
+    uint8_t buf[32];
+    size_t len = 0;
+
+    ok &= testCheck("size must be a power of two >= 16",
+                    !msgChannelInit(&ch, g_testRing, 48) && !msgChannelInit(&ch, g_testRing, 8));
+    msgChannelInit(&ch, g_testRing, sizeof(g_testRing));
+
+    // Reserve the worst case, commit what was actually written
+    uint8_t *slot = msgChannelReserve(&ch, 20, 0);
+    memcpy(slot, "abc", 3);
+    msgChannelCommit(&ch, 3);
+    ok &= testCheck("short commit takes header + 4 bytes", msgChannelUsed(&ch) == MSG_CHANNEL_HEADER + 4);
+    const uint8_t *msg = msgChannelReceive(&ch, &len, 0);
+    ok &= testCheck("committed length and bytes received", msg != NULL && len == 3 && memcmp(msg, "abc", 3) == 0);
+    msgChannelRelease(&ch);
+    ok &= testCheck("release frees the ring", msgChannelUsed(&ch) == 0);
+
+    ok &= testCheck("oversize reservation rejected",
+                    msgChannelReserve(&ch, MSG_CHANNEL_MAX_MESSAGE(sizeof(g_testRing)) + 1, 0) == NULL);
+    slot = msgChannelReserve(&ch, 4, 0);
+    memset(slot, 7, 4);
+    msgChannelCommit(&ch, 10);
+    ok &= testCheck("commit clamped to the reservation", msgChannelRead(&ch, buf, sizeof(buf), 0) == 4);
+
+    TickType_t start = tickCount();
+    ok &= testCheck("empty receive times out", msgChannelReceive(&ch, &len, 20) == NULL &&
+                                                   tickCount() - start >= 20 && ch.stats.readerBlocked == 1);
+
+    // 16 bytes used so far. A 28-byte message fills 16..48; a 20-byte one
+    // (24 with its header) does not fit in the last 16 and starts at 0.
+    memset(buf, 1, 28);
+    msgChannelSend(&ch, buf, 28, 0);
+    msgChannelRead(&ch, buf, sizeof(buf), 0);
+    slot = msgChannelReserve(&ch, 20, 0);
+    memset(slot, 2, 20);
+    msgChannelCommit(&ch, 20);
+    ok &= testCheck("message that does not fit wraps to 0", ch.stats.wraps == 1 && slot == &g_testRing[MSG_CHANNEL_HEADER]);
+    msg = msgChannelReceive(&ch, &len, 0);
+    ok &= testCheck("reader follows the wrap marker", msg == slot && len == 20 && filledWith(msg, len, 2));
+    msgChannelRelease(&ch);
+    ok &= testCheck("wrap skip released with the message", msgChannelUsed(&ch) == 0);
+
+    // Now at offset 24: two 12-byte messages, a wrap skip of 8 and a
+    // third leave 8 bytes, too few for a fourth
+    int sent = 0;
+    memset(buf, 3, 12);
+    while (sent < 8 && msgChannelSend(&ch, buf, 12, 0))
+        sent++;
+    ok &= testCheck("full ring refuses without blocking", sent == 3 && ch.stats.writerBlocked == 1);
+    msgChannelRead(&ch, buf, sizeof(buf), 0);
+    ok &= testCheck("space returns once the reader releases", msgChannelSend(&ch, buf, 12, 0));
+    msgChannelDeinit(&ch);
+
+    // Writer and reader on their own threads, both blocking: sizes up to
+    // the maximum, so the ring fills and wraps constantly
+    const uint32_t messages = 200000;
+    const uint32_t maxLen = MSG_CHANNEL_MAX_MESSAGE(sizeof(g_threadRing));
+    msgChannelInit(&ch, g_threadRing, sizeof(g_threadRing));
+    std::thread writer([&ch, messages, maxLen]() {
+        uint32_t seed = 1;
+        for (uint32_t i = 0; i < messages; i++)
+        {
+            uint32_t size = testSize(&seed, maxLen);
+            uint8_t *out = msgChannelReserve(&ch, size, portMAX_DELAY);
+            memset(out, (uint8_t)i, size);
+            msgChannelCommit(&ch, size);
+        }
+    });
+    uint32_t seed = 1;
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < messages; i++)
+    {
+        uint32_t expected = testSize(&seed, maxLen);
+        msg = msgChannelReceive(&ch, &len, portMAX_DELAY);
+        if (len != expected || !filledWith(msg, len, (uint8_t)i))
+            errors++;
+        msgChannelRelease(&ch);
+    }
+    writer.join();
+    ok &= testCheck("threaded writer/reader: every message intact", errors == 0 && msgChannelUsed(&ch) == 0);
+    printf("    %lu wraps, writer blocked %lu, reader blocked %lu, peak %lu of %u bytes\n",
+           (unsigned long)ch.stats.wraps, (unsigned long)ch.stats.writerBlocked,
+           (unsigned long)ch.stats.readerBlocked, (unsigned long)ch.stats.peakUsed, (unsigned)sizeof(g_threadRing));
+    msgChannelDeinit(&ch);
+
+    return testSummary(ok);
+}
+
+int main(void)
+{
+    return msgChannelSelfTest() ? 0 : 1;
+}
+#endif // MSG_HOST_MAIN
@@ -0,0 +1,116 @@
+/**
+ * Variable-length message channel
+ *
+ * serialTask reads into a fixed char rxtext[50], and a FreeRTOS queue can
+ * only carry fixed-size items, so strings and arrays end up padded to the
+ * worst case. This channel stores each message as a 4-byte header plus the
+ * payload rounded up to 4 bytes, so a 3-byte command costs 8 bytes of ring,
+ * not 256.
+ *
+ * Messages never wrap. If a message does not fit before the end of the
+ * ring, the writer leaves a wrap marker and starts it at offset 0, so both
+ * sides always see one contiguous block:
+ *
+ *   writer:  p = msgChannelReserve(ch, max, timeout);  fill p;  msgChannelCommit(ch, used);
+ *   reader:  p = msgChannelReceive(ch, &len, timeout);  use p;  msgChannelRelease(ch);
+ *
+ * Nothing is copied by the channel itself. msgChannelSend/Read wrap the
+ * two calls for callers that do want a copy.
+ *
+ * One writer task and one reader task (they may be on different cores).
+ * Several writers need a mutex around reserve/commit. Neither side makes a
+ * kernel call unless the other side is blocked waiting for it.
+ *
+ * Built with -DMSG_HOST_MAIN the ring runs on std::thread primitives
+ * (ticks are milliseconds) and main() runs msgChannelSelfTest():
+ *
+ *   g++ -std=c++17 -O2 -pthread -DMSG_HOST_MAIN msg_channel.cpp -o msgch && ./msgch
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef MSG_HOST_MAIN
+typedef struct msg_host_sem *SemaphoreHandle_t; // binary semaphore, msg_channel.cpp
+typedef uint32_t TickType_t;
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#else
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#endif
+
+#define MSG_CHANNEL_HEADER 4
+
+// Largest message a channel of `size` bytes accepts
+#define MSG_CHANNEL_MAX_MESSAGE(size) ((size) / 2 - MSG_CHANNEL_HEADER)
+
+typedef struct
+{
+    uint32_t messages;
+    uint32_t bytes;         // payload bytes, excluding headers and padding
+    uint32_t wraps;         // wrap markers written
+    uint32_t writerBlocked; // reserve had to wait for space
+    uint32_t readerBlocked; // receive had to wait for data
+    uint32_t peakUsed;      // most ring bytes in use at once
+} msg_channel_stats_t;
+
+typedef struct
+{
+    uint8_t *buffer;
+    uint32_t size; // power of two
+    volatile uint32_t head; // free-running byte counters
+    volatile uint32_t tail;
+
+    // Writer side
+    uint32_t reserveAt; // head + wrap skip of the open reservation
+    uint32_t reserveMax;
+    volatile bool writerWaiting;
+    SemaphoreHandle_t spaceAvailable;
+
+    // Reader side
+    uint32_t readAt; // tail + wrap skip of the message being read
+    uint32_t readLen;
+    volatile bool readerWaiting;
+    SemaphoreHandle_t dataAvailable;
+
+    msg_channel_stats_t stats;
+} msg_channel_t;
+
+// `buffer` must stay valid for the life of the channel. `size` must be a
+// power of two, at least 16.
+bool msgChannelInit(msg_channel_t *ch, uint8_t *buffer, uint32_t size);
+void msgChannelDeinit(msg_channel_t *ch);
+
+// Returns a contiguous block of `maxLen` bytes, or NULL on timeout or if
+// maxLen exceeds MSG_CHANNEL_MAX_MESSAGE. Must be followed by one commit.
+uint8_t *msgChannelReserve(msg_channel_t *ch, size_t maxLen, TickType_t timeout);
+
+// Publishes the first `len` (<= maxLen) bytes of the reservation.
+void msgChannelCommit(msg_channel_t *ch, size_t len);
+
+// Returns the next message, valid until msgChannelRelease(), or NULL on
+// timeout.
+const uint8_t *msgChannelReceive(msg_channel_t *ch, size_t *len, TickType_t timeout);
+void msgChannelRelease(msg_channel_t *ch);
+
+bool msgChannelSend(msg_channel_t *ch, const void *data, size_t len, TickType_t timeout);
+
+// Copies up to `capacity` bytes. Returns the full message length (which
+// may exceed capacity), or 0 on timeout.
+size_t msgChannelRead(msg_channel_t *ch, void *data, size_t capacity, TickType_t timeout);
+
+// Bytes currently in use, headers and padding included.
+uint32_t msgChannelUsed(const msg_channel_t *ch);
+
+#ifdef MSG_HOST_MAIN
+// Reserve/commit, wrap markers, a full ring and a threaded writer/reader.
+bool msgChannelSelfTest(void);
+#else
+// Moves mixed-size messages between two cores through this channel, a
+// FreeRTOS message buffer and a queue padded to the largest message, all
+// given the same RAM, and logs bytes/s for each.
+void msgChannelBenchmark(uint32_t messages);
+#endif
@@ -0,0 +1,330 @@
+#include "pipe_channel.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "Pipe";
+
+static const char *policyNames[] = {"block", "block-timeout", "drop-newest", "drop-oldest", "sample-hold"};
+
+#define EVICT_RETRIES 4 // other producers may refill the freed slot first
+
+static pipe_channel_t *g_channels[PIPE_MAX_CHANNELS];
+static uint8_t g_channelCount = 0;
+static portMUX_TYPE g_registryLock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool channelCreate(pipe_channel_t *ch, const char *name, UBaseType_t length, size_t itemSize,
+                          const pipe_config_t *config)
+{
+    memset(ch, 0, sizeof(*ch));
+    ch->name = name;
+    ch->length = length;
+    ch->itemSize = itemSize;
+    ch->config = *config;
+    ch->lock = portMUX_INITIALIZER_UNLOCKED;
+    ch->queue = xQueueCreate(length, itemSize);
+    if (ch->queue == NULL)
+        return false;
+
+    if (config->policy == PIPE_DROP_OLDEST || config->policy == PIPE_SAMPLE_HOLD)
+    {
+        ch->evicted = malloc(itemSize);
+        if (ch->evicted == NULL)
+            return false;
+    }
+    if (config->policy == PIPE_SAMPLE_HOLD)
+    {
+        ch->held = malloc(itemSize);
+        if (ch->held == NULL)
+            return false;
+    }
+    ch->reportUs = esp_timer_get_time();
+    return true;
+}
+
+static void channelDelete(pipe_channel_t *ch)
+{
+    if (ch->queue != NULL)
+        vQueueDelete(ch->queue);
+    free(ch->evicted);
+    free(ch->held);
+    ch->queue = NULL;
+    ch->evicted = NULL;
+    ch->held = NULL;
+}
+
+bool pipeInit(pipe_channel_t *ch, const char *name, UBaseType_t length, size_t itemSize, const pipe_config_t *config)
+{
+    if (!channelCreate(ch, name, length, itemSize, config))
+    {
+        ESP_LOGE(TAG, "Cannot create channel %s", name);
+        channelDelete(ch);
+        return false;
+    }
+
+    portENTER_CRITICAL(&g_registryLock);
+    bool registered = g_channelCount < PIPE_MAX_CHANNELS;
+    if (registered)
+        g_channels[g_channelCount++] = ch;
+    portEXIT_CRITICAL(&g_registryLock);
+    if (!registered)
+        ESP_LOGW(TAG, "Channel %s works but is not reported (PIPE_MAX_CHANNELS)", name);
+    return true;
+}
+
+UBaseType_t pipeLag(const pipe_channel_t *ch)
+{
+    return uxQueueMessagesWaiting(ch->queue);
+}
+
+bool pipeSend(pipe_channel_t *ch, const void *item)
+{
+    const pipe_config_t *cfg = &ch->config;
+    uint32_t evictions = 0;
+    BaseType_t queued;
+
+    switch (cfg->policy)
+    {
+    case PIPE_BLOCK:
+        queued = xQueueSend(ch->queue, item, portMAX_DELAY);
+        break;
+    case PIPE_BLOCK_TIMEOUT:
+        queued = xQueueSend(ch->queue, item, pdMS_TO_TICKS(cfg->timeoutMs));
+        break;
+    case PIPE_DROP_OLDEST:
+    case PIPE_SAMPLE_HOLD:
+        queued = xQueueSend(ch->queue, item, 0);
+        for (int i = 0; queued != pdTRUE && i < EVICT_RETRIES; i++)
+        {
+            if (xQueueReceive(ch->queue, ch->evicted, 0) == pdTRUE)
+                evictions++;
+            queued = xQueueSend(ch->queue, item, 0);
+        }
+        break;
+    case PIPE_DROP_NEWEST:
+    default:
+        queued = xQueueSend(ch->queue, item, 0);
+        break;
+    }
+
+    UBaseType_t lag = uxQueueMessagesWaiting(ch->queue);
+    portENTER_CRITICAL(&ch->lock);
+    if (queued == pdTRUE)
+        ch->stats.sent++;
+    else
+        ch->stats.droppedNewest++;
+    ch->stats.droppedOldest += evictions;
+    if (lag > ch->stats.lagMax)
+        ch->stats.lagMax = lag;
+    if (lag * 100 >= ch->length * cfg->lagHighPercent)
+        ch->congested = true;
+    portEXIT_CRITICAL(&ch->lock);
+    return queued == pdTRUE;
+}
+
+bool pipeReceive(pipe_channel_t *ch, void *item, TickType_t timeout)
+{
+    if (ch->config.policy == PIPE_SAMPLE_HOLD && ch->hasHeld)
+    {
+        bool fresh = xQueueReceive(ch->queue, ch->held, 0) == pdTRUE;
+        memcpy(item, ch->held, ch->itemSize);
+        portENTER_CRITICAL(&ch->lock);
+        if (fresh)
+            ch->stats.received++;
+        else
+            ch->stats.held++;
+        portEXIT_CRITICAL(&ch->lock);
+        return true;
+    }
+
+    if (xQueueReceive(ch->queue, item, timeout) != pdTRUE)
+        return false;
+    if (ch->config.policy == PIPE_SAMPLE_HOLD)
+    {
+        memcpy(ch->held, item, ch->itemSize);
+        ch->hasHeld = true;
+    }
+    portENTER_CRITICAL(&ch->lock);
+    ch->stats.received++;
+    portEXIT_CRITICAL(&ch->lock);
+    return true;
+}
+
+static void setRate(pipe_channel_t *ch, float rateHz)
+{
+    ch->rateHz = rateHz;
+    TickType_t ticks = (TickType_t)(configTICK_RATE_HZ / rateHz + 0.5f);
+    ch->periodTicks = ticks > 0 ? ticks : 1;
+}
+
+// One AIMD step per control interval: any drop, or the channel reaching
+// lagHighPercent, counts as congestion
+static void controlStep(pipe_channel_t *ch)
+{
+    const pipe_config_t *cfg = &ch->config;
+    portENTER_CRITICAL(&ch->lock);
+    uint32_t drops = ch->stats.droppedNewest + ch->stats.droppedOldest;
+    bool congested = ch->congested || drops != ch->dropsAtControl;
+    ch->congested = false;
+    ch->dropsAtControl = drops;
+    if (congested)
+        ch->stats.rateCuts++;
+    portEXIT_CRITICAL(&ch->lock);
+
+    float rate = congested ? ch->rateHz * cfg->decreaseFactor : ch->rateHz + cfg->increaseHz;
+    if (rate < cfg->rateMinHz)
+        rate = cfg->rateMinHz;
+    if (rate > cfg->rateMaxHz)
+        rate = cfg->rateMaxHz;
+    if (rate != ch->rateHz)
+        setRate(ch, rate);
+}
+
+float pipePace(pipe_channel_t *ch)
+{
+    const pipe_config_t *cfg = &ch->config;
+    if (cfg->rateMaxHz <= 0)
+        return 0;
+
+    int64_t now = esp_timer_get_time();
+    if (ch->rateHz == 0)
+    {
+        // First call: start at full rate, the first sample is due now
+        setRate(ch, cfg->rateMaxHz);
+        ch->lastWake = xTaskGetTickCount();
+        ch->nextSampleUs = now;
+        ch->nextControlUs = now + (int64_t)cfg->controlMs * 1000;
+        return ch->rateHz;
+    }
+
+    if (now >= ch->nextControlUs)
+    {
+        controlStep(ch);
+        ch->nextControlUs = now + (int64_t)cfg->controlMs * 1000;
+    }
+
+    // A producer that was held up (blocked send, preemption) gets no sleep
+    // until it is back on schedule; the slip records how late it ran
+    vTaskDelayUntil(&ch->lastWake, ch->periodTicks);
+    ch->nextSampleUs += (int64_t)ch->periodTicks * portTICK_PERIOD_MS * 1000;
+    int64_t slip = esp_timer_get_time() - ch->nextSampleUs;
+    if (slip > 0 && slip > ch->stats.slipMaxUs)
+    {
+        portENTER_CRITICAL(&ch->lock);
+        ch->stats.slipMaxUs = (uint32_t)slip;
+        portEXIT_CRITICAL(&ch->lock);
+    }
+    return ch->rateHz;
+}
+
+static void logChannel(pipe_channel_t *ch, const char *label)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&ch->lock);
+    pipe_stats_t s = ch->stats;
+    portEXIT_CRITICAL(&ch->lock);
+
+    float seconds = (now - ch->reportUs) / 1e6f;
+    float sendHz = seconds > 0 ? (s.sent - ch->reportSent) / seconds : 0;
+    float recvHz = seconds > 0 ? (s.received - ch->reportReceived) / seconds : 0;
+    ch->reportUs = now;
+    ch->reportSent = s.sent;
+    ch->reportReceived = s.received;
+
+    ESP_LOGI(TAG,
+             "%-12s %-13s in %6.1f/s out %6.1f/s  lag %u/%u max %lu  dropped new %lu old %lu  held %lu  "
+             "slip max %lu us  rate %.1f Hz (%lu cuts)",
+             label, policyNames[ch->config.policy], sendHz, recvHz, (unsigned)pipeLag(ch), (unsigned)ch->length,
+             (unsigned long)s.lagMax, (unsigned long)s.droppedNewest, (unsigned long)s.droppedOldest,
+             (unsigned long)s.held, (unsigned long)s.slipMaxUs, ch->rateHz, (unsigned long)s.rateCuts);
+}
+
+void pipeReportAll(void)
+{
+    for (uint8_t i = 0; i < g_channelCount; i++)
+    {
+        logChannel(g_channels[i], g_channels[i]->name);
+    }
+}
+
+// --- benchmark -------------------------------------------------------------
+
+#define BENCH_PRODUCER_HZ 50
+#define BENCH_CONSUMER_MS 50
+
+typedef struct
+{
+    pipe_channel_t *ch;
+    TaskHandle_t caller;
+    volatile bool stop;
+} bench_ctx_t;
+
+static void benchProducer(void *pvParameter)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)pvParameter;
+    uint32_t counter = 0;
+    while (!ctx->stop)
+    {
+        pipePace(ctx->ch);
+        pipeSend(ctx->ch, &counter);
+        counter++;
+    }
+    xTaskNotifyGive(ctx->caller);
+    vTaskDelete(NULL);
+}
+
+static void benchConsumer(void *pvParameter)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)pvParameter;
+    uint32_t value;
+    while (!ctx->stop)
+    {
+        pipeReceive(ctx->ch, &value, pdMS_TO_TICKS(100));
+        vTaskDelay(pdMS_TO_TICKS(BENCH_CONSUMER_MS)); // the slow part
+    }
+    xTaskNotifyGive(ctx->caller);
+    vTaskDelete(NULL);
+}
+
+void pipeBenchmark(uint32_t durationMs)
+{
+    ESP_LOGI(TAG, "%d Hz producer, %d Hz consumer, %lu ms per run", BENCH_PRODUCER_HZ, 1000 / BENCH_CONSUMER_MS,
+             (unsigned long)durationMs);
+
+    for (int aimd = 0; aimd < 2; aimd++)
+    {
+        for (int policy = PIPE_BLOCK; policy <= PIPE_SAMPLE_HOLD; policy++)
+        {
+            // Fixed pace (min = max) without AIMD, so the slip is measured
+            // the same way in both passes
+            pipe_config_t cfg = PIPE_CONFIG_DEFAULT((pipe_policy_t)policy);
+            cfg.rateMaxHz = BENCH_PRODUCER_HZ;
+            cfg.rateMinHz = aimd ? 5.0f : BENCH_PRODUCER_HZ;
+            cfg.increaseHz = 2.0f;
+
+            pipe_channel_t ch;
+            if (!channelCreate(&ch, "bench", 8, sizeof(uint32_t), &cfg))
+            {
+                ESP_LOGE(TAG, "Out of memory");
+                channelDelete(&ch);
+                return;
+            }
+
+            bench_ctx_t ctx = {&ch, xTaskGetCurrentTaskHandle(), false};
+            xTaskCreate(benchProducer, "pipeProducer", 2048, &ctx, 5, NULL);
+            xTaskCreate(benchConsumer, "pipeConsumer", 2048, &ctx, 4, NULL);
+            vTaskDelay(pdMS_TO_TICKS(durationMs));
+
+            ctx.stop = true;
+            ulTaskNotifyTake(pdFALSE, portMAX_DELAY); // consumer (the producer may be blocked)
+            xQueueReset(ch.queue);                    // unblocks a PIPE_BLOCK producer
+            ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+
+            logChannel(&ch, aimd ? "aimd" : "fixed");
+            channelDelete(&ch);
+        }
+    }
+}
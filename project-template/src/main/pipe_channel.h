@@ -0,0 +1,144 @@
+/**
+ * Pipeline channel with overload policies and AIMD rate control
+ *
+ * In the Day 4 producer/consumer exercise, producerTask calls
+ * xQueueSend(queue, &counter, portMAX_DELAY). When the consumer falls
+ * behind, the producer stalls inside the send, and the sampling clock
+ * stalls with it: samples are taken late, not at the intended period. A
+ * pipe channel wraps the queue and makes the overload behaviour a choice:
+ *
+ *   PIPE_BLOCK          wait for space (the old behaviour)
+ *   PIPE_BLOCK_TIMEOUT  wait up to timeoutMs, then drop the new item
+ *   PIPE_DROP_NEWEST    never wait; a full channel drops the new item
+ *   PIPE_DROP_OLDEST    never wait; a full channel drops its oldest item
+ *   PIPE_SAMPLE_HOLD    never wait; a full channel drops its oldest item,
+ *                       and a consumer finding it empty gets the last item
+ *                       again (for consumers that want "the current value"
+ *                       at their own pace)
+ *
+ * Optionally the producer paces itself with pipePace() instead of
+ * vTaskDelay(). The pace is AIMD controlled: every controlMs the rate goes
+ * up by increaseHz while the channel is below lagHighPercent full and
+ * nothing was dropped, and is multiplied by decreaseFactor otherwise. A
+ * producer that follows it slows down in step with the consumer, so it
+ * samples less often but each sample is still taken on time.
+ *
+ *   static pipe_channel_t g_samples;
+ *   pipe_config_t cfg = PIPE_CONFIG_DEFAULT(PIPE_DROP_OLDEST);
+ *   cfg.rateMaxHz = 100;  cfg.rateMinHz = 5;
+ *   pipeInit(&g_samples, "samples", 8, sizeof(sensor_data_t), &cfg);
+ *
+ *   producer:  while (1) { pipePace(&g_samples); sample(&d); pipeSend(&g_samples, &d); }
+ *   consumer:  while (1) { pipeReceive(&g_samples, &d, portMAX_DELAY); ... }
+ *
+ * Per channel the stats count drops, lag (items waiting) and the pace
+ * slip, i.e. how late pipePace() returned compared to the period it was
+ * asked for. pipeReportAll() logs every channel with effective send and
+ * receive rates since the previous report.
+ *
+ * Any number of producers and consumers, except that pipePace() belongs
+ * to one producer and a PIPE_SAMPLE_HOLD channel has one consumer.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define PIPE_MAX_CHANNELS 8
+
+typedef enum
+{
+    PIPE_BLOCK = 0,
+    PIPE_BLOCK_TIMEOUT,
+    PIPE_DROP_NEWEST,
+    PIPE_DROP_OLDEST,
+    PIPE_SAMPLE_HOLD
+} pipe_policy_t;
+
+typedef struct
+{
+    pipe_policy_t policy;
+    uint32_t timeoutMs; // PIPE_BLOCK_TIMEOUT
+
+    // AIMD pacing for pipePace(); rateMaxHz = 0 disables it
+    float rateMinHz;
+    float rateMaxHz;
+    float increaseHz;     // added per control interval without congestion
+    float decreaseFactor; // applied per control interval with congestion
+    uint8_t lagHighPercent;
+    uint32_t controlMs;
+} pipe_config_t;
+
+#define PIPE_CONFIG_DEFAULT(policy) {policy, 100, 1.0f, 0.0f, 1.0f, 0.5f, 75, 100}
+
+typedef struct
+{
+    uint32_t sent; // accepted into the channel
+    uint32_t received;
+    uint32_t droppedNewest; // rejected: full, or timed out
+    uint32_t droppedOldest; // evicted to make room
+    uint32_t held;          // sample-and-hold repeats
+    uint32_t lagMax;        // most items waiting, seen at send
+    uint32_t slipMaxUs;     // worst pipePace() lateness
+    uint32_t rateCuts;      // AIMD decreases
+} pipe_stats_t;
+
+typedef struct
+{
+    const char *name;
+    QueueHandle_t queue;
+    UBaseType_t length;
+    size_t itemSize;
+    pipe_config_t config;
+    portMUX_TYPE lock; // stats
+
+    // Sample-and-hold: copy of the last item handed to a consumer
+    void *held;
+    bool hasHeld;
+    void *evicted; // PIPE_DROP_OLDEST / PIPE_SAMPLE_HOLD scratch item
+
+    // AIMD state, owned by the pacing producer
+    float rateHz;
+    int64_t nextControlUs;
+    int64_t nextSampleUs; // when the current sample was due
+    TickType_t lastWake;
+    TickType_t periodTicks;
+    uint32_t dropsAtControl;
+    bool congested; // lag reached lagHighPercent since the last control step
+
+    pipe_stats_t stats;
+
+    // pipeReportAll() rate window
+    int64_t reportUs;
+    uint32_t reportSent;
+    uint32_t reportReceived;
+} pipe_channel_t;
+
+// Creates the queue (and the hold buffer for PIPE_SAMPLE_HOLD) and adds
+// the channel to the report list.
+bool pipeInit(pipe_channel_t *ch, const char *name, UBaseType_t length, size_t itemSize, const pipe_config_t *config);
+
+// Applies the channel policy. Returns false if the item was not queued.
+bool pipeSend(pipe_channel_t *ch, const void *item);
+
+// Returns false on timeout. Under PIPE_SAMPLE_HOLD an empty channel
+// returns the previous item at once (after the first one has arrived).
+bool pipeReceive(pipe_channel_t *ch, void *item, TickType_t timeout);
+
+// Waits until the next sample is due at the AIMD rate and returns the
+// rate. The period is rounded to whole ticks (10 ms on esp32dev), so keep
+// rateMaxHz at or below the tick rate.
+float pipePace(pipe_channel_t *ch);
+
+// Items currently waiting in the channel.
+UBaseType_t pipeLag(const pipe_channel_t *ch);
+
+void pipeReportAll(void);
+
+// Runs a 50 Hz producer against a 20 Hz consumer for each policy, with
+// and without AIMD pacing, and logs drops, lag and sampling slip.
+void pipeBenchmark(uint32_t durationMs);
@@ -0,0 +1,241 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "trace.h"
+
+static const char *TAG = "Profile";
+
+#define TASK_NAME_LEN 12
+
+typedef struct
+{
+    const profile_site_t *site;
+    uint32_t cycles;
+    uint32_t switches;
+    int64_t timeUs;
+    uint8_t core;
+    char task[TASK_NAME_LEN];
+} profile_outlier_t;
+
+static profile_site_t *g_sites[PROFILE_MAX_SITES];
+static uint8_t g_siteCount = 0;
+static uint32_t g_sitesLost = 0;
+
+static profile_outlier_t g_outliers[PROFILE_MAX_OUTLIERS];
+static uint32_t g_outlierCount = 0; // total; the log keeps the latest
+
+static volatile bool g_profiling = false;
+static uint32_t g_overheadCycles = 0;
+static portMUX_TYPE g_profileLock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint8_t bucketOf(uint32_t cycles)
+{
+    int b = (cycles < 32 ? 0 : 31 - __builtin_clz(cycles) - 4);
+    return (uint8_t)(b >= PROFILE_HIST_BUCKETS ? PROFILE_HIST_BUCKETS - 1 : b);
+}
+
+static void IRAM_ATTR recordOutlier(const profile_site_t *site, uint32_t cycles, uint32_t switches, uint8_t core)
+{
+    profile_outlier_t *o = &g_outliers[g_outlierCount % PROFILE_MAX_OUTLIERS];
+    g_outlierCount++;
+    o->site = site;
+    o->cycles = cycles;
+    o->switches = switches;
+    o->timeUs = esp_timer_get_time();
+    o->core = core;
+    const char *name = xPortInIsrContext() ? "(ISR)" : pcTaskGetName(NULL);
+    strncpy(o->task, name, TASK_NAME_LEN - 1);
+    o->task[TASK_NAME_LEN - 1] = '\0';
+}
+
+void IRAM_ATTR profileBegin(profile_probe_t *probe, profile_site_t *site)
+{
+    if (!g_profiling)
+    {
+        probe->site = NULL;
+        return;
+    }
+    probe->site = site;
+    probe->core = (uint8_t)esp_cpu_get_core_id();
+    probe->startSwitches = traceSwitchCount(probe->core);
+    probe->startCycles = esp_cpu_get_cycle_count();
+}
+
+void IRAM_ATTR profileEnd(profile_probe_t *probe)
+{
+    uint32_t end = esp_cpu_get_cycle_count();
+    profile_site_t *site = probe->site;
+    if (site == NULL)
+        return;
+
+    // Each core has its own cycle counter; a task that moved cores while
+    // the probe was open has no meaningful duration
+    uint8_t core = (uint8_t)esp_cpu_get_core_id();
+    if (core != probe->core)
+        return;
+    uint32_t cycles = end - probe->startCycles;
+    cycles = cycles > g_overheadCycles ? cycles - g_overheadCycles : 0;
+    uint32_t switches = traceSwitchCount(core) - probe->startSwitches;
+
+    portENTER_CRITICAL_SAFE(&g_profileLock);
+    if (!site->registered)
+    {
+        if (g_siteCount < PROFILE_MAX_SITES)
+        {
+            g_sites[g_siteCount++] = site;
+            site->registered = true;
+        }
+        else
+        {
+            g_sitesLost++;
+            portEXIT_CRITICAL_SAFE(&g_profileLock);
+            return;
+        }
+    }
+
+    if (site->count >= PROFILE_WARMUP && (uint64_t)cycles * site->count > PROFILE_OUTLIER_FACTOR * site->totalCycles)
+    {
+        site->outliers++;
+        recordOutlier(site, cycles, switches, core);
+    }
+    if (site->count == 0 || cycles < site->minCycles)
+        site->minCycles = cycles;
+    if (cycles > site->maxCycles)
+        site->maxCycles = cycles;
+    site->totalCycles += cycles;
+    site->count++;
+    site->histogram[bucketOf(cycles)]++;
+    portEXIT_CRITICAL_SAFE(&g_profileLock);
+}
+
+void profileInit(void)
+{
+    // An empty probe on a private site; its minimum is the fixed cost of
+    // begin/end that every measurement carries
+    static profile_site_t calibration = PROFILE_SITE_INIT("calibration");
+    g_overheadCycles = 0;
+    g_profiling = true;
+    for (int i = 0; i < 64; i++)
+    {
+        profile_probe_t probe;
+        profileBegin(&probe, &calibration);
+        profileEnd(&probe);
+    }
+    g_overheadCycles = calibration.minCycles;
+
+    portENTER_CRITICAL(&g_profileLock);
+    for (uint8_t i = 0; i < g_siteCount; i++)
+    {
+        if (g_sites[i] == &calibration)
+        {
+            g_sites[i] = g_sites[--g_siteCount];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&g_profileLock);
+    ESP_LOGI(TAG, "Probe overhead %lu cycles, subtracted from every sample", (unsigned long)g_overheadCycles);
+}
+
+void profileEnable(bool enable)
+{
+    g_profiling = enable;
+}
+
+void profileReset(void)
+{
+    portENTER_CRITICAL(&g_profileLock);
+    for (uint8_t i = 0; i < g_siteCount; i++)
+    {
+        profile_site_t *site = g_sites[i];
+        site->count = 0;
+        site->minCycles = 0;
+        site->maxCycles = 0;
+        site->totalCycles = 0;
+        site->outliers = 0;
+        memset(site->histogram, 0, sizeof(site->histogram));
+    }
+    g_outlierCount = 0;
+    portEXIT_CRITICAL(&g_profileLock);
+}
+
+void profileReport(void)
+{
+    const uint32_t mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    profile_site_t snapshot;
+    char histText[PROFILE_HIST_BUCKETS * 7 + 1];
+
+    ESP_LOGI(TAG, "%-20s %8s %9s %9s %9s %9s %5s", "site", "count", "min cyc", "mean cyc", "max cyc", "max us",
+             "outl");
+    for (uint8_t i = 0; i < g_siteCount; i++)
+    {
+        // Copy under the lock so a site being updated is not printed half-way
+        portENTER_CRITICAL(&g_profileLock);
+        snapshot = *g_sites[i];
+        portEXIT_CRITICAL(&g_profileLock);
+        if (snapshot.count == 0)
+            continue;
+
+        uint32_t mean = (uint32_t)(snapshot.totalCycles / snapshot.count);
+        ESP_LOGI(TAG, "%-20s %8lu %9lu %9lu %9lu %9.2f %5lu", snapshot.label, (unsigned long)snapshot.count,
+                 (unsigned long)snapshot.minCycles, (unsigned long)mean, (unsigned long)snapshot.maxCycles,
+                 (double)snapshot.maxCycles / mhz, (unsigned long)snapshot.outliers);
+
+        // Only the populated range of the histogram
+        int first = 0, last = PROFILE_HIST_BUCKETS - 1;
+        while (snapshot.histogram[first] == 0)
+            first++;
+        while (snapshot.histogram[last] == 0)
+            last--;
+        int len = 0;
+        for (int b = first; b <= last; b++)
+            len += snprintf(histText + len, sizeof(histText) - len, " %lu", (unsigned long)snapshot.histogram[b]);
+        ESP_LOGI(TAG, "%-20s cycles %lu..%lu:%s", "", first == 0 ? 0UL : 1UL << (first + 4),
+                 1UL << (last + 5), histText);
+    }
+    if (g_sitesLost > 0)
+        ESP_LOGW(TAG, "%lu samples from sites beyond PROFILE_MAX_SITES were dropped", (unsigned long)g_sitesLost);
+
+    profile_outlier_t outliers[PROFILE_MAX_OUTLIERS];
+    portENTER_CRITICAL(&g_profileLock);
+    uint32_t total = g_outlierCount;
+    memcpy(outliers, g_outliers, sizeof(outliers));
+    portEXIT_CRITICAL(&g_profileLock);
+    if (total == 0)
+        return;
+
+    uint32_t shown = total < PROFILE_MAX_OUTLIERS ? total : PROFILE_MAX_OUTLIERS;
+    ESP_LOGI(TAG, "Outliers (> %dx mean), latest %lu of %lu:", PROFILE_OUTLIER_FACTOR, (unsigned long)shown,
+             (unsigned long)total);
+    for (uint32_t n = total - shown; n < total; n++)
+    {
+        const profile_outlier_t *o = &outliers[n % PROFILE_MAX_OUTLIERS];
+        ESP_LOGI(TAG, "  %10lld us  %-20s %9lu cyc  task %-11s core %u  %lu switches", (long long)o->timeUs,
+                 o->site->label, (unsigned long)o->cycles, o->task, o->core, (unsigned long)o->switches);
+    }
+}
+
+bool profileCommand(const char *line)
+{
+    char cmd[12] = {0};
+    char arg[12] = {0};
+    if (sscanf(line, "%11s %11s", cmd, arg) < 1 || strcmp(cmd, "profile") != 0)
+        return false;
+
+    if (arg[0] == '\0')
+        profileReport();
+    else if (strcmp(arg, "reset") == 0)
+        profileReset();
+    else if (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0)
+        profileEnable(strcmp(arg, "on") == 0);
+    else
+        ESP_LOGW(TAG, "Usage: profile [reset|on|off]");
+    return true;
+}
@@ -0,0 +1,107 @@
+/**
+ * Cycle-counter profiler for worst-case execution times
+ *
+ * The periods in the controller (patternSequencer at g_speed_ms, the 10 ms
+ * button poll) were picked without knowing how long a step takes:
+ * knightRider() is four gpio_set_level() calls, randomPattern() adds four
+ * rand() calls, and neither has ever been measured. A probe around the code
+ * in question answers that:
+ *
+ *   void knightRider(void)
+ *   {
+ *       PROFILE_SCOPE("knightRider");
+ *       ...
+ *   }
+ *
+ * Each probe site keeps count, min/mean/max and a log2 histogram of CPU
+ * cycles. A run slower than PROFILE_OUTLIER_FACTOR x the site's mean is
+ * also kept in an outlier log with the task, core and the number of task
+ * switches on that core while the probe was open. That tells an expensive
+ * run apart from one that was preempted (or blocked). The switch count
+ * comes from the tracer's kernel hooks, so use the esp32dev_profile
+ * environment; elsewhere it reads 0.
+ *
+ * Probes only exist when PROFILE_ENABLED is defined (esp32dev_profile in
+ * platformio.ini). Otherwise PROFILE_SCOPE expands to nothing and costs
+ * nothing. When compiled in, profileEnable(false) reduces a probe to a
+ * flag test. The probes' own overhead is measured once and subtracted.
+ * Probes work in ISRs; the bookkeeping is a short spinlock section.
+ *
+ * profileReport() (or "profile" on the serial console, see
+ * profileCommand()) prints the table. The max column is the measured WCET
+ * to use in schedulability checks.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROFILE_MAX_SITES 32
+#define PROFILE_HIST_BUCKETS 16 // bucket b: cycles in [2^(b+4), 2^(b+5)), first and last open-ended
+#define PROFILE_MAX_OUTLIERS 16
+#define PROFILE_OUTLIER_FACTOR 4
+#define PROFILE_WARMUP 16 // samples before outliers are judged against the mean
+
+typedef struct
+{
+    const char *label; // string literal
+    bool registered;
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[PROFILE_HIST_BUCKETS];
+    uint32_t outliers;
+} profile_site_t;
+
+typedef struct
+{
+    profile_site_t *site; // NULL when profiling was off at begin
+    uint32_t startCycles;
+    uint32_t startSwitches;
+    uint8_t core;
+} profile_probe_t;
+
+#define PROFILE_SITE_INIT(label) {label, false, 0, 0, 0, 0, {}, 0}
+
+void profileBegin(profile_probe_t *probe, profile_site_t *site);
+void profileEnd(profile_probe_t *probe);
+
+#ifdef PROFILE_ENABLED
+
+struct ProfileScope
+{
+    profile_probe_t probe;
+    explicit ProfileScope(profile_site_t *site) { profileBegin(&probe, site); }
+    ~ProfileScope() { profileEnd(&probe); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Times the rest of the enclosing block
+#define PROFILE_SCOPE(label)                                                               \
+    static profile_site_t PROFILE_CONCAT(s_profileSite, __LINE__) = PROFILE_SITE_INIT(label); \
+    ProfileScope PROFILE_CONCAT(s_profileScope, __LINE__)(&PROFILE_CONCAT(s_profileSite, __LINE__))
+
+#else
+
+#define PROFILE_SCOPE(label)
+
+#endif
+
+// Calibrates the probe overhead and turns profiling on.
+void profileInit(void);
+
+void profileEnable(bool enable);
+
+// Clears every site and the outlier log.
+void profileReset(void);
+
+// Logs per-site statistics, histograms and the outlier log.
+void profileReport(void);
+
+// Handles "profile" and "profile reset" lines from the serial console;
+// returns false for anything else.
+bool profileCommand(const char *line);
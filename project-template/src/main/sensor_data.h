@@ -0,0 +1,18 @@
+/**
+ * Shared sensor sample type
+ *
+ * The same struct the Day 4 struct-queue exercise sends through its queue,
+ * pulled out here so the pipeline modules (history, fan-in, acquisition)
+ * all agree on one layout.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t timeStamp; // milliseconds since boot
+    uint8_t sensorID;
+    float sensorVal;
+} sensor_data_t;
@@ -0,0 +1,46 @@
+#include "sensor_fanin.h"
+
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "FanIn";
+
+// --- task wrapper ----------------------------------------------------------
+
+static void sendFrame(const fanin_frame_t *frame, void *ctx)
+{
+    QueueHandle_t frameQueue = (QueueHandle_t)ctx;
+    if (xQueueSend(frameQueue, frame, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "Frame queue full, dropped frame at %lu ms", (unsigned long)frame->timeStamp);
+    }
+}
+
+void faninTask(void *pvParameter)
+{
+    fanin_task_config_t *config = (fanin_task_config_t *)pvParameter;
+
+    // ~1.7 KB; kept off the task stack
+    fanin_merger_t *merger = (fanin_merger_t *)pvPortMalloc(sizeof(fanin_merger_t));
+    if (merger == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate merger!");
+        vTaskDelete(NULL);
+        return;
+    }
+    faninInit(merger, config->reorderMs, config->frameMs, sendFrame, (void *)config->frameQueue);
+
+    sensor_data_t rxData;
+    TickType_t idleTimeout = pdMS_TO_TICKS(config->reorderMs > 0 ? config->reorderMs : 1);
+    while (1)
+    {
+        if (xQueueReceive(config->inputQueue, &rxData, idleTimeout) == pdTRUE)
+        {
+            faninPush(merger, &rxData);
+        }
+        else
+        {
+            faninFlush(merger);
+        }
+    }
+}
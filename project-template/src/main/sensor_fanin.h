@@ -0,0 +1,29 @@
+/**
+ * Multi-sensor fan-in task
+ *
+ * Many producer tasks, each sampling at its own rate, send sensor_data_t
+ * into ONE shared input queue (FreeRTOS queues are multi-producer). A
+ * single fan-in task drains it through a fanin_merger_t (fanin_merge.h)
+ * and forwards the aligned frames, so adding sensors does not add
+ * consumer tasks.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "fanin_merge.h"
+
+typedef struct
+{
+    QueueHandle_t inputQueue; // sensor_data_t from all producers
+    QueueHandle_t frameQueue; // fanin_frame_t to the next stage
+    uint32_t reorderMs;
+    uint32_t frameMs;
+} fanin_task_config_t;
+
+// Fan-in task; pvParameter is a fanin_task_config_t that must outlive it.
+// If no record arrives for reorderMs the window is flushed so the last
+// records are not held back forever when producers go quiet.
+void faninTask(void *pvParameter);
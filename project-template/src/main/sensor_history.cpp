@@ -0,0 +1,329 @@
+#include "sensor_history.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "History";
+
+static const uint32_t tierPeriodMs[HISTORY_TIER_COUNT] = {0, 1000, 60000, 3600000};
+static const char *tierNames[HISTORY_TIER_COUNT] = {"raw", "1s", "1m", "1h"};
+
+typedef struct
+{
+    // Ingest runs on the consumer task, dumps on the serial task. Every
+    // hold is a handful of stores, so a spinlock is cheaper than a mutex.
+    portMUX_TYPE lock;
+    history_sensor_t sensors[HISTORY_MAX_SENSORS];
+    uint8_t slotForId[256]; // sensorID -> slot + 1, 0 = not seen yet
+    uint8_t slotsUsed;
+} history_store_t;
+
+// The live store behind the public API; the benchmark uses its own
+static history_store_t g_store = {portMUX_INITIALIZER_UNLOCKED, {}, {}, 0};
+
+static history_bucket_t *ringFor(history_sensor_t *s, history_tier_t tier, uint16_t *depth)
+{
+    switch (tier)
+    {
+    case HISTORY_TIER_1S:
+        *depth = HISTORY_SEC_DEPTH;
+        return s->sec;
+    case HISTORY_TIER_1M:
+        *depth = HISTORY_MIN_DEPTH;
+        return s->min;
+    case HISTORY_TIER_1H:
+        *depth = HISTORY_HOUR_DEPTH;
+        return s->hour;
+    default:
+        *depth = 0;
+        return NULL;
+    }
+}
+
+static void mergeInto(history_bucket_t *dst, const history_bucket_t *src)
+{
+    if (dst->count == 0)
+    {
+        dst->min = src->min;
+        dst->max = src->max;
+    }
+    else
+    {
+        if (src->min < dst->min)
+            dst->min = src->min;
+        if (src->max > dst->max)
+            dst->max = src->max;
+    }
+    dst->sum += src->sum;
+    dst->count += src->count;
+}
+
+static void foldBucket(history_sensor_t *s, history_tier_t tier, const history_bucket_t *bucket);
+
+// Pushes the open bucket of a tier into its ring and folds it upwards.
+static void closeBucket(history_sensor_t *s, history_tier_t tier)
+{
+    uint16_t depth = 0;
+    history_bucket_t *ring = ringFor(s, tier, &depth);
+    history_bucket_t closed = s->open[tier];
+
+    ring[s->head[tier]] = closed;
+    s->head[tier] = (s->head[tier] + 1) % depth;
+    if (s->used[tier] < depth)
+        s->used[tier]++;
+
+    memset(&s->open[tier], 0, sizeof(history_bucket_t));
+
+    if (tier + 1 < HISTORY_TIER_COUNT)
+        foldBucket(s, (history_tier_t)(tier + 1), &closed);
+}
+
+// Adds a (possibly single-sample) bucket to the open bucket of a tier,
+// closing the open one first if the new data belongs to a later period.
+static void foldBucket(history_sensor_t *s, history_tier_t tier, const history_bucket_t *bucket)
+{
+    uint32_t period = tierPeriodMs[tier];
+    uint32_t start = (bucket->startMs / period) * period;
+    history_bucket_t *open = &s->open[tier];
+
+    if (open->count != 0 && open->startMs != start)
+        closeBucket(s, tier);
+
+    if (open->count == 0)
+        open->startMs = start;
+    mergeInto(open, bucket);
+}
+
+static history_sensor_t *slotFor(history_store_t *store, uint8_t sensorID, bool create)
+{
+    uint8_t slot = store->slotForId[sensorID];
+    if (slot != 0)
+        return &store->sensors[slot - 1];
+    if (!create || store->slotsUsed >= HISTORY_MAX_SENSORS)
+        return NULL;
+
+    slot = store->slotsUsed++;
+    store->slotForId[sensorID] = slot + 1;
+    store->sensors[slot].sensorID = sensorID;
+    return &store->sensors[slot];
+}
+
+static void clearStore(history_store_t *store)
+{
+    portENTER_CRITICAL(&store->lock);
+    memset(store->sensors, 0, sizeof(store->sensors));
+    memset(store->slotForId, 0, sizeof(store->slotForId));
+    store->slotsUsed = 0;
+    portEXIT_CRITICAL(&store->lock);
+}
+
+static bool ingestInto(history_store_t *store, const sensor_data_t *sample)
+{
+    history_bucket_t one = {
+        .startMs = sample->timeStamp,
+        .count = 1,
+        .min = sample->sensorVal,
+        .max = sample->sensorVal,
+        .sum = sample->sensorVal,
+    };
+
+    portENTER_CRITICAL(&store->lock);
+    history_sensor_t *s = slotFor(store, sample->sensorID, true);
+    if (s == NULL)
+    {
+        portEXIT_CRITICAL(&store->lock);
+        return false;
+    }
+
+    s->raw[s->head[HISTORY_TIER_RAW]].timeStamp = sample->timeStamp;
+    s->raw[s->head[HISTORY_TIER_RAW]].sensorVal = sample->sensorVal;
+    s->head[HISTORY_TIER_RAW] = (s->head[HISTORY_TIER_RAW] + 1) % HISTORY_RAW_DEPTH;
+    if (s->used[HISTORY_TIER_RAW] < HISTORY_RAW_DEPTH)
+        s->used[HISTORY_TIER_RAW]++;
+
+    foldBucket(s, HISTORY_TIER_1S, &one);
+    portEXIT_CRITICAL(&store->lock);
+    return true;
+}
+
+void historyInit(void)
+{
+    clearStore(&g_store);
+}
+
+bool historyIngest(const sensor_data_t *sample)
+{
+    return ingestInto(&g_store, sample);
+}
+
+size_t historyCopyBuckets(uint8_t sensorID, history_tier_t tier, history_bucket_t *out, size_t maxOut)
+{
+    size_t copied = 0;
+
+    portENTER_CRITICAL(&g_store.lock);
+    history_sensor_t *s = slotFor(&g_store, sensorID, false);
+    uint16_t depth = 0;
+    history_bucket_t *ring = (s != NULL) ? ringFor(s, tier, &depth) : NULL;
+    if (ring != NULL)
+    {
+        uint16_t used = s->used[tier];
+        uint16_t first = (s->head[tier] + depth - used) % depth;
+        for (; copied < used && copied < maxOut; copied++)
+        {
+            out[copied] = ring[(first + copied) % depth];
+        }
+    }
+    portEXIT_CRITICAL(&g_store.lock);
+    return copied;
+}
+
+size_t historyCopyRaw(uint8_t sensorID, history_raw_t *out, size_t maxOut)
+{
+    size_t copied = 0;
+
+    portENTER_CRITICAL(&g_store.lock);
+    history_sensor_t *s = slotFor(&g_store, sensorID, false);
+    if (s != NULL)
+    {
+        uint16_t used = s->used[HISTORY_TIER_RAW];
+        uint16_t first = (s->head[HISTORY_TIER_RAW] + HISTORY_RAW_DEPTH - used) % HISTORY_RAW_DEPTH;
+        for (; copied < used && copied < maxOut; copied++)
+        {
+            out[copied] = s->raw[(first + copied) % HISTORY_RAW_DEPTH];
+        }
+    }
+    portEXIT_CRITICAL(&g_store.lock);
+    return copied;
+}
+
+static void logBucket(const history_bucket_t *b, const char *suffix)
+{
+    ESP_LOGI(TAG, "  t=%lu ms  n=%lu  min=%.2f  max=%.2f  mean=%.2f%s",
+             (unsigned long)b->startMs, (unsigned long)b->count,
+             b->min, b->max, b->sum / (float)b->count, suffix);
+}
+
+// Dump copies go through one static buffer instead of the caller's stack
+// (a raw ring alone is HISTORY_RAW_DEPTH * 8 bytes). Dumps come from the
+// console task only, so one buffer is enough.
+#define DUMP_BUCKETS (HISTORY_SEC_DEPTH > HISTORY_MIN_DEPTH ? HISTORY_SEC_DEPTH : HISTORY_MIN_DEPTH)
+static union
+{
+    history_raw_t raw[HISTORY_RAW_DEPTH];
+    history_bucket_t buckets[DUMP_BUCKETS];
+} g_dump;
+
+void historyDump(uint8_t sensorID, history_tier_t tier)
+{
+    history_bucket_t open = {};
+    portENTER_CRITICAL(&g_store.lock);
+    history_sensor_t *s = slotFor(&g_store, sensorID, false);
+    if (s != NULL && tier != HISTORY_TIER_RAW)
+        open = s->open[tier];
+    portEXIT_CRITICAL(&g_store.lock);
+
+    if (s == NULL)
+    {
+        ESP_LOGE(TAG, "Unknown sensor %u", sensorID);
+        return;
+    }
+
+    if (tier == HISTORY_TIER_RAW)
+    {
+        size_t n = historyCopyRaw(sensorID, g_dump.raw, HISTORY_RAW_DEPTH);
+        ESP_LOGI(TAG, "Sensor %u, tier raw: %u samples", sensorID, (unsigned)n);
+        for (size_t i = 0; i < n; i++)
+        {
+            ESP_LOGI(TAG, "  t=%lu ms  value=%.2f", (unsigned long)g_dump.raw[i].timeStamp, g_dump.raw[i].sensorVal);
+        }
+        return;
+    }
+
+    size_t n = historyCopyBuckets(sensorID, tier, g_dump.buckets, DUMP_BUCKETS);
+    ESP_LOGI(TAG, "Sensor %u, tier %s: %u closed buckets", sensorID, tierNames[tier], (unsigned)n);
+    for (size_t i = 0; i < n; i++)
+    {
+        logBucket(&g_dump.buckets[i], "");
+    }
+    if (open.count != 0)
+        logBucket(&open, "  (open)");
+}
+
+bool historyCommand(const char *line)
+{
+    char cmd[20] = {0};
+    char tierText[8] = {0};
+    int sensorID = 0;
+
+    if (sscanf(line, "%19s %d %7s", cmd, &sensorID, tierText) < 1 || strcmp(cmd, "history") != 0)
+        return false;
+
+    if (sensorID < 0 || sensorID > 255)
+    {
+        ESP_LOGW(TAG, "Usage: history <id 0-255> <raw|1s|1m|1h>");
+        return true;
+    }
+
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++)
+    {
+        if (strcmp(tierText, tierNames[t]) == 0)
+        {
+            historyDump((uint8_t)sensorID, (history_tier_t)t);
+            return true;
+        }
+    }
+
+    ESP_LOGW(TAG, "Usage: history <id 0-255> <raw|1s|1m|1h>");
+    return true;
+}
+
+void historyConsumerTask(void *pvParameter)
+{
+    QueueHandle_t handle = (QueueHandle_t)pvParameter;
+    sensor_data_t rxData;
+    uint32_t rejected = 0;
+
+    while (1)
+    {
+        xQueueReceive(handle, &rxData, portMAX_DELAY);
+        if (!historyIngest(&rxData) && (rejected++ % 1000) == 0)
+        {
+            ESP_LOGW(TAG, "No history slot for sensor %u (max %d sensors)", rxData.sensorID, HISTORY_MAX_SENSORS);
+        }
+    }
+}
+
+void historyBenchmark(uint32_t samples)
+{
+    // A store of its own, so the recorded history survives the run
+    history_store_t *store = (history_store_t *)malloc(sizeof(history_store_t));
+    if (store == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate the benchmark store!");
+        return;
+    }
+    store->lock = portMUX_INITIALIZER_UNLOCKED;
+    clearStore(store);
+
+    // 1 kHz per sensor, spread across every slot so all tiers roll over
+    sensor_data_t sample = {};
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        sample.timeStamp = i / HISTORY_MAX_SENSORS;
+        sample.sensorID = (uint8_t)(i % HISTORY_MAX_SENSORS);
+        sample.sensorVal = (float)(i & 0xFF) * 0.1f;
+        ingestInto(store, &sample);
+    }
+    int64_t elapsedUs = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "Ingested %lu samples in %lld us (%.1f ns/sample)",
+             (unsigned long)samples, (long long)elapsedUs,
+             samples ? (double)elapsedUs * 1000.0 / samples : 0.0);
+    ESP_LOGI(TAG, "Fixed RAM: %u bytes for %d sensors", (unsigned)HISTORY_RAM_BYTES, HISTORY_MAX_SENSORS);
+
+    free(store);
+}
@@ -0,0 +1,108 @@
+/**
+ * Multi-resolution sensor history
+ *
+ * Keeps recent history per sensorID without storing every raw sample:
+ *
+ *   raw  - the last HISTORY_RAW_DEPTH samples as received
+ *   1s   - one min/max/mean/count bucket per second
+ *   1m   - one bucket per minute
+ *   1h   - one bucket per hour
+ *
+ * Ingestion is O(1): a sample goes into the raw ring and the open 1 s
+ * bucket. When a bucket's period ends it is pushed into its ring and folded
+ * into the open bucket of the next tier, so the coarser tiers only do work
+ * once per second / minute / hour.
+ *
+ * All storage is a static array sized by the HISTORY_* constants below,
+ * so the RAM cost is fixed at compile time (see HISTORY_RAM_BYTES).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "sensor_data.h"
+
+#define HISTORY_MAX_SENSORS 4
+#define HISTORY_RAW_DEPTH 64
+#define HISTORY_SEC_DEPTH 60  // 1 minute of 1 s buckets
+#define HISTORY_MIN_DEPTH 60  // 1 hour of 1 min buckets
+#define HISTORY_HOUR_DEPTH 24 // 1 day of 1 h buckets
+
+typedef enum
+{
+    HISTORY_TIER_RAW = 0,
+    HISTORY_TIER_1S,
+    HISTORY_TIER_1M,
+    HISTORY_TIER_1H,
+    HISTORY_TIER_COUNT
+} history_tier_t;
+
+typedef struct
+{
+    uint32_t startMs; // start of the period this bucket covers
+    uint32_t count;
+    float min;
+    float max;
+    float sum; // mean = sum / count
+} history_bucket_t;
+
+typedef struct
+{
+    uint32_t timeStamp;
+    float sensorVal;
+} history_raw_t;
+
+typedef struct
+{
+    history_raw_t raw[HISTORY_RAW_DEPTH];
+    history_bucket_t sec[HISTORY_SEC_DEPTH];
+    history_bucket_t min[HISTORY_MIN_DEPTH];
+    history_bucket_t hour[HISTORY_HOUR_DEPTH];
+
+    // Next write index and number of valid entries per ring
+    uint16_t head[HISTORY_TIER_COUNT];
+    uint16_t used[HISTORY_TIER_COUNT];
+
+    // Bucket currently being filled for each aggregate tier
+    history_bucket_t open[HISTORY_TIER_COUNT];
+
+    uint8_t sensorID;
+} history_sensor_t;
+
+#define HISTORY_RAM_BYTES (sizeof(history_sensor_t) * HISTORY_MAX_SENSORS)
+
+// Clears all history and sensor slot assignments. The store starts out
+// empty, so calling this at boot is optional.
+void historyInit(void);
+
+// Records one sample. The first HISTORY_MAX_SENSORS distinct sensorIDs get a
+// slot; samples from any further sensor are rejected and false is returned.
+// Timestamps are expected to be non-decreasing per sensor.
+bool historyIngest(const sensor_data_t *sample);
+
+// Copies up to maxOut closed buckets of an aggregate tier, oldest first.
+// Returns the number copied (0 for an unknown sensor or the raw tier).
+size_t historyCopyBuckets(uint8_t sensorID, history_tier_t tier, history_bucket_t *out, size_t maxOut);
+
+// Copies up to maxOut raw samples, oldest first.
+size_t historyCopyRaw(uint8_t sensorID, history_raw_t *out, size_t maxOut);
+
+// Logs one tier of one sensor (closed buckets plus the open one), or an
+// error for a sensor that has never been ingested. Console task only.
+void historyDump(uint8_t sensorID, history_tier_t tier);
+
+// Parses "history <id> <raw|1s|1m|1h>" and dumps it. Returns false if the
+// line is not a history command, so serialTask can try its other commands.
+bool historyCommand(const char *line);
+
+// Consumer task that drains a sensor_data_t queue into the history store.
+// pvParameter is the QueueHandle_t, as in the Day 4 consumerTask.
+void historyConsumerTask(void *pvParameter);
+
+// Measures ingestion cost with synthetic samples and logs ns/sample. Runs
+// on a separate heap-allocated store; the live history is left alone.
+void historyBenchmark(uint32_t samples);
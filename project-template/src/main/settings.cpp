@@ -0,0 +1,245 @@
+#include "settings.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+static const char *TAG = "Settings";
+
+// One namespace handle at a time; keys are registered grouped by
+// component, so the boot load opens each namespace once
+typedef struct
+{
+    nvs_handle_t handle;
+    char component[SETTINGS_NAME_MAX + 1];
+    nvs_open_mode_t mode;
+    bool open;
+} nvs_backend_t;
+
+static settings_store_t g_store;
+static nvs_backend_t g_nvs;
+static SemaphoreHandle_t g_settingsLock = NULL;
+static TaskHandle_t g_commitTask = NULL;
+
+static inline uint32_t nowMs(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void nvsClose(nvs_backend_t *nvs)
+{
+    if (nvs->open)
+        nvs_close(nvs->handle);
+    nvs->open = false;
+}
+
+static bool nvsSelect(nvs_backend_t *nvs, const char *component, nvs_open_mode_t mode)
+{
+    if (nvs->open && nvs->mode == mode && strcmp(nvs->component, component) == 0)
+        return true;
+    if (nvs->open && nvs->mode == NVS_READWRITE && nvs_commit(nvs->handle) != ESP_OK)
+        return false;
+    nvsClose(nvs);
+
+    // NOT_FOUND on a read-only open just means nothing was saved yet
+    if (nvs_open(component, mode, &nvs->handle) != ESP_OK)
+        return false;
+    strncpy(nvs->component, component, SETTINGS_NAME_MAX);
+    nvs->component[SETTINGS_NAME_MAX] = '\0';
+    nvs->mode = mode;
+    nvs->open = true;
+    return true;
+}
+
+static bool nvsLoad(void *ctx, const setting_t *setting, uint32_t *value)
+{
+    nvs_backend_t *nvs = (nvs_backend_t *)ctx;
+    if (!nvsSelect(nvs, setting->component, NVS_READONLY))
+        return false;
+
+    esp_err_t err = ESP_FAIL;
+    switch (setting->type)
+    {
+    case SETTING_U8:
+    {
+        uint8_t v;
+        err = nvs_get_u8(nvs->handle, setting->name, &v);
+        *value = v;
+        break;
+    }
+    case SETTING_U16:
+    {
+        uint16_t v;
+        err = nvs_get_u16(nvs->handle, setting->name, &v);
+        *value = v;
+        break;
+    }
+    case SETTING_U32:
+        err = nvs_get_u32(nvs->handle, setting->name, value);
+        break;
+    case SETTING_I32:
+    {
+        int32_t v;
+        err = nvs_get_i32(nvs->handle, setting->name, &v);
+        *value = (uint32_t)v;
+        break;
+    }
+    }
+    return err == ESP_OK;
+}
+
+static bool nvsStore(void *ctx, const setting_t *setting)
+{
+    nvs_backend_t *nvs = (nvs_backend_t *)ctx;
+    if (!nvsSelect(nvs, setting->component, NVS_READWRITE))
+        return false;
+
+    esp_err_t err = ESP_FAIL;
+    switch (setting->type)
+    {
+    case SETTING_U8:
+        err = nvs_set_u8(nvs->handle, setting->name, (uint8_t)setting->value);
+        break;
+    case SETTING_U16:
+        err = nvs_set_u16(nvs->handle, setting->name, (uint16_t)setting->value);
+        break;
+    case SETTING_U32:
+        err = nvs_set_u32(nvs->handle, setting->name, setting->value);
+        break;
+    case SETTING_I32:
+        err = nvs_set_i32(nvs->handle, setting->name, (int32_t)setting->value);
+        break;
+    }
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Writing %s.%s failed: %s", setting->component, setting->name, esp_err_to_name(err));
+    return err == ESP_OK;
+}
+
+static bool nvsCommit(void *ctx)
+{
+    nvs_backend_t *nvs = (nvs_backend_t *)ctx;
+    bool ok = !nvs->open || nvs->mode != NVS_READWRITE || nvs_commit(nvs->handle) == ESP_OK;
+    nvsClose(nvs);
+    return ok;
+}
+
+static void commitLocked(void)
+{
+    int64_t start = esp_timer_get_time();
+    int written = settingsCommit(&g_store, nowMs());
+    if (written > 0)
+        ESP_LOGI(TAG, "Committed %d keys in %lu us", written, (unsigned long)(esp_timer_get_time() - start));
+    else if (written < 0)
+        ESP_LOGE(TAG, "Commit failed, will retry");
+}
+
+static void settingsCommitTask(void *pvParameter)
+{
+    while (1)
+    {
+        xSemaphoreTake(g_settingsLock, portMAX_DELAY);
+        uint32_t waitMs = settingsMsUntilCommit(&g_store, nowMs());
+        if (waitMs == 0)
+        {
+            commitLocked();
+            waitMs = settingsMsUntilCommit(&g_store, nowMs());
+        }
+        xSemaphoreGive(g_settingsLock);
+
+        // Woken early by settingsUpdate() so a new deadline is picked up
+        ulTaskNotifyTake(pdTRUE, waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs) + 1);
+    }
+}
+
+static void settingsShutdownHandler(void)
+{
+    settingsFlush();
+}
+
+bool settingsInit(uint32_t quietMs, uint32_t maxDelayMs)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_LOGW(TAG, "NVS layout changed, erasing");
+        nvs_flash_erase();
+        err = nvs_flash_init();
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "NVS init failed: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    settings_backend_t backend = {nvsLoad, nvsStore, nvsCommit, &g_nvs};
+    settingsStoreInit(&g_store, &backend, quietMs, maxDelayMs);
+    g_settingsLock = xSemaphoreCreateMutex();
+    if (g_settingsLock == NULL)
+        return false;
+    if (xTaskCreate(settingsCommitTask, "settingsCommit", 3072, NULL, 2, &g_commitTask) != pdPASS)
+        return false;
+    esp_register_shutdown_handler(settingsShutdownHandler);
+    return true;
+}
+
+bool settingsAdd(setting_t *setting)
+{
+    xSemaphoreTake(g_settingsLock, portMAX_DELAY);
+    bool ok = settingsRegister(&g_store, setting);
+    xSemaphoreGive(g_settingsLock);
+    if (!ok)
+        ESP_LOGE(TAG, "Cannot register %s.%s", setting->component, setting->name);
+    return ok;
+}
+
+void settingsBoot(void)
+{
+    int64_t start = esp_timer_get_time();
+    xSemaphoreTake(g_settingsLock, portMAX_DELAY);
+    settingsLoadAll(&g_store);
+    nvsClose(&g_nvs);
+    uint32_t loaded = g_store.stats.loaded;
+    xSemaphoreGive(g_settingsLock);
+    ESP_LOGI(TAG, "Loaded %lu saved settings in %lu us", (unsigned long)loaded,
+             (unsigned long)(esp_timer_get_time() - start));
+}
+
+bool settingsUpdate(setting_t *setting, uint32_t value)
+{
+    xSemaphoreTake(g_settingsLock, portMAX_DELAY);
+    bool changed = settingsSet(&g_store, setting, value, nowMs());
+    xSemaphoreGive(g_settingsLock);
+    if (changed)
+        xTaskNotifyGive(g_commitTask);
+    return changed;
+}
+
+void settingsFlush(void)
+{
+    if (g_settingsLock == NULL)
+        return;
+    if (xSemaphoreTake(g_settingsLock, pdMS_TO_TICKS(500)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Flush timed out, changes may be lost");
+        return;
+    }
+    commitLocked();
+    xSemaphoreGive(g_settingsLock);
+}
+
+void settingsReport(void)
+{
+    xSemaphoreTake(g_settingsLock, portMAX_DELAY);
+    settings_stats_t s = g_store.stats;
+    uint16_t dirty = g_store.dirtyCount;
+    xSemaphoreGive(g_settingsLock);
+    ESP_LOGI(TAG, "%lu changes, %lu coalesced, %lu commits, %lu keys written, %u dirty, %lu errors",
+             (unsigned long)s.sets, (unsigned long)s.coalesced, (unsigned long)s.commits, (unsigned long)s.writes,
+             dirty, (unsigned long)s.errors);
+}
@@ -0,0 +1,44 @@
+/**
+ * Persistent settings service
+ *
+ * The settings_store.h store bound to NVS, with a mutex around it and a
+ * commit task that writes dirty keys once they are due:
+ *
+ *   boot     settingsInit(), every component calls settingsAdd() for its
+ *            keys, then settingsBoot() loads them all in one pass
+ *   run      settingsGet() reads the RAM shadow, settingsUpdate() changes
+ *            it; neither touches flash
+ *   reboot   settingsFlush() commits immediately. It is also registered
+ *            as a shutdown handler, so esp_restart() does not lose changes
+ *
+ * The commit task holds the mutex while it writes, so an update that
+ * lands during a commit waits for it; with a quiet period of seconds that
+ * is rare, and every other update is a RAM write.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "settings_store.h"
+
+#define SETTINGS_QUIET_MS 3000
+#define SETTINGS_MAX_DELAY_MS 30000
+
+// Initialises NVS (erasing it if the layout is incompatible) and starts
+// the commit task.
+bool settingsInit(uint32_t quietMs, uint32_t maxDelayMs);
+
+// Registers a key. Must be called before settingsBoot().
+bool settingsAdd(setting_t *setting);
+
+// Loads every registered key and logs how long it took.
+void settingsBoot(void);
+
+// Thread-safe settingsSet() that schedules the deferred commit.
+bool settingsUpdate(setting_t *setting, uint32_t value);
+
+// Commits now. Call before a planned reboot or power-down.
+void settingsFlush(void);
+
+void settingsReport(void);
@@ -0,0 +1,353 @@
+#include "settings_store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+
+static uint32_t cutToWidth(setting_type_t type, uint32_t value)
+{
+    if (type == SETTING_U8)
+        return value & 0xFFu;
+    if (type == SETTING_U16)
+        return value & 0xFFFFu;
+    return value;
+}
+
+void settingsStoreInit(settings_store_t *store, const settings_backend_t *backend, uint32_t quietMs,
+                       uint32_t maxDelayMs)
+{
+    memset(store, 0, sizeof(*store));
+    store->backend = *backend;
+    store->quietMs = quietMs;
+    store->maxDelayMs = maxDelayMs < quietMs ? quietMs : maxDelayMs;
+}
+
+bool settingsRegister(settings_store_t *store, setting_t *setting)
+{
+    if (strlen(setting->component) > SETTINGS_NAME_MAX || strlen(setting->name) > SETTINGS_NAME_MAX)
+        return false;
+    for (setting_t *s = store->keys; s != NULL; s = s->next)
+    {
+        if (s == setting || (strcmp(s->component, setting->component) == 0 && strcmp(s->name, setting->name) == 0))
+            return false;
+    }
+
+    // Appended, so keys of one component stay together for the boot load
+    setting->value = cutToWidth(setting->type, setting->defaultValue);
+    setting->dirty = false;
+    setting->next = NULL;
+    setting_t **tail = &store->keys;
+    while (*tail != NULL)
+    {
+        tail = &(*tail)->next;
+    }
+    *tail = setting;
+    return true;
+}
+
+void settingsLoadAll(settings_store_t *store)
+{
+    for (setting_t *s = store->keys; s != NULL; s = s->next)
+    {
+        uint32_t value;
+        if (store->backend.load(store->backend.ctx, s, &value))
+        {
+            s->value = cutToWidth(s->type, value);
+            store->stats.loaded++;
+        }
+    }
+}
+
+bool settingsSet(settings_store_t *store, setting_t *setting, uint32_t value, uint32_t nowMs)
+{
+    value = cutToWidth(setting->type, value);
+    if (value == setting->value)
+        return false;
+
+    setting->value = value;
+    store->stats.sets++;
+    if (setting->dirty)
+    {
+        store->stats.coalesced++;
+    }
+    else
+    {
+        setting->dirty = true;
+        if (store->dirtyCount++ == 0)
+            store->firstDirtyMs = nowMs;
+    }
+    store->lastChangeMs = nowMs;
+    return true;
+}
+
+uint32_t settingsMsUntilCommit(const settings_store_t *store, uint32_t nowMs)
+{
+    if (store->dirtyCount == 0)
+        return UINT32_MAX;
+
+    int32_t quietLeft = (int32_t)(store->lastChangeMs + store->quietMs - nowMs);
+    int32_t maxLeft = (int32_t)(store->firstDirtyMs + store->maxDelayMs - nowMs);
+    int32_t left = quietLeft < maxLeft ? quietLeft : maxLeft;
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+int settingsCommit(settings_store_t *store, uint32_t nowMs)
+{
+    if (store->dirtyCount == 0)
+        return 0;
+
+    int written = 0;
+    bool ok = true;
+    for (setting_t *s = store->keys; s != NULL; s = s->next)
+    {
+        if (!s->dirty)
+            continue;
+        if (!store->backend.store(store->backend.ctx, s))
+        {
+            ok = false;
+            break;
+        }
+        written++;
+    }
+    ok = ok && store->backend.commit(store->backend.ctx);
+
+    if (!ok)
+    {
+        // Keep everything dirty and retry after another quiet period
+        store->stats.errors++;
+        store->firstDirtyMs = nowMs;
+        store->lastChangeMs = nowMs;
+        return -1;
+    }
+
+    for (setting_t *s = store->keys; s != NULL; s = s->next)
+    {
+        s->dirty = false;
+    }
+    store->dirtyCount = 0;
+    store->stats.commits++;
+    store->stats.writes += written;
+    return written;
+}
+
+// --- text-file backend -----------------------------------------------------
+
+static void fileKey(const setting_t *setting, char *key, size_t size)
+{
+    snprintf(key, size, "%s.%s", setting->component, setting->name);
+}
+
+static int fileFind(settings_file_t *file, const char *key)
+{
+    for (int i = 0; i < file->count; i++)
+    {
+        if (strcmp(file->entries[i].key, key) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void fileRead(settings_file_t *file)
+{
+    file->read = true;
+    file->count = 0;
+    FILE *f = fopen(file->path, "r");
+    if (f == NULL)
+        return; // first boot
+
+    char line[80];
+    while (fgets(line, sizeof(line), f) != NULL && file->count < 64)
+    {
+        char *eq = strchr(line, '=');
+        if (eq == NULL || eq - line >= (int)sizeof(file->entries[0].key))
+            continue;
+        *eq = '\0';
+        strcpy(file->entries[file->count].key, line);
+        file->entries[file->count].value = (uint32_t)strtoul(eq + 1, NULL, 0);
+        file->count++;
+    }
+    fclose(f);
+}
+
+static bool fileLoad(void *ctx, const setting_t *setting, uint32_t *value)
+{
+    settings_file_t *file = (settings_file_t *)ctx;
+    if (!file->read)
+        fileRead(file);
+
+    char key[sizeof(file->entries[0].key)];
+    fileKey(setting, key, sizeof(key));
+    int i = fileFind(file, key);
+    if (i < 0)
+        return false;
+    *value = file->entries[i].value;
+    return true;
+}
+
+static bool fileStore(void *ctx, const setting_t *setting)
+{
+    settings_file_t *file = (settings_file_t *)ctx;
+    if (!file->read)
+        fileRead(file);
+
+    char key[sizeof(file->entries[0].key)];
+    fileKey(setting, key, sizeof(key));
+    int i = fileFind(file, key);
+    if (i < 0)
+    {
+        if (file->count == 64)
+            return false;
+        i = file->count++;
+        strcpy(file->entries[i].key, key);
+    }
+    file->entries[i].value = setting->value;
+    return true;
+}
+
+static bool fileCommit(void *ctx)
+{
+    settings_file_t *file = (settings_file_t *)ctx;
+
+    // Written aside and renamed, so a crash leaves the old file intact
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file->path);
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL)
+        return false;
+    for (int i = 0; i < file->count; i++)
+    {
+        fprintf(f, "%s=%lu\n", file->entries[i].key, (unsigned long)file->entries[i].value);
+    }
+    bool ok = fclose(f) == 0;
+    return ok && rename(tmp, file->path) == 0;
+}
+
+void settingsFileBackend(settings_backend_t *backend, settings_file_t *file, const char *path)
+{
+    memset(file, 0, sizeof(*file));
+    file->path = path;
+    backend->load = fileLoad;
+    backend->store = fileStore;
+    backend->commit = fileCommit;
+    backend->ctx = file;
+}
+
+// --- self test -------------------------------------------------------------
+
+typedef struct
+{
+    settings_backend_t inner;
+    uint32_t stores;
+    uint32_t commits;
+} counting_backend_t;
+
+static bool countLoad(void *ctx, const setting_t *setting, uint32_t *value)
+{
+    counting_backend_t *c = (counting_backend_t *)ctx;
+    return c->inner.load(c->inner.ctx, setting, value);
+}
+
+static bool countStore(void *ctx, const setting_t *setting)
+{
+    counting_backend_t *c = (counting_backend_t *)ctx;
+    c->stores++;
+    return c->inner.store(c->inner.ctx, setting);
+}
+
+static bool countCommit(void *ctx)
+{
+    counting_backend_t *c = (counting_backend_t *)ctx;
+    c->commits++;
+    return c->inner.commit(c->inner.ctx);
+}
+
+bool settingsSelfTest(const char *path)
+{
+    static settings_file_t file;
+    static settings_store_t store;
+    counting_backend_t counting;
+    settings_backend_t backend = {countLoad, countStore, countCommit, &counting};
+    bool ok = true;
+
+    printf("settings store self test (%s)\n", path);
+    remove(path);
+
+    // First boot: nothing stored, defaults apply
+    SETTING_DEFINE(speed, "ledctrl", "speed", SETTING_U16, 400);
+    SETTING_DEFINE(pattern, "ledctrl", "pattern", SETTING_U8, 0);
+    SETTING_DEFINE(offset, "sensor", "offset", SETTING_I32, -5);
+    memset(&counting, 0, sizeof(counting));
+    settingsFileBackend(&counting.inner, &file, path);
+    settingsStoreInit(&store, &backend, 2000, 10000);
+    ok &= testCheck("register three keys", settingsRegister(&store, &speed) && settingsRegister(&store, &pattern) &&
+                                           settingsRegister(&store, &offset));
+    SETTING_DEFINE(duplicate, "ledctrl", "speed", SETTING_U16, 1);
+    ok &= testCheck("duplicate key rejected", !settingsRegister(&store, &duplicate));
+    settingsLoadAll(&store);
+    ok &= testCheck("first boot uses defaults", settingsGet(&speed) == 400 && settingsGet(&pattern) == 0 &&
+                                                (int32_t)settingsGet(&offset) == -5 && store.stats.loaded == 0);
+
+    // A burst of commands within the quiet period
+    uint32_t now = 1000;
+    static const uint16_t speeds[] = {300, 250, 200, 150, 100, 50, 75, 90, 110, 120};
+    for (uint16_t v : speeds)
+    {
+        settingsSet(&store, &speed, v, now);
+        now += 500;
+    }
+    settingsSet(&store, &pattern, 3, now);
+    ok &= testCheck("unchanged value is not dirty", !settingsSet(&store, &pattern, 3, now));
+    ok &= testCheck("nothing written during the burst", counting.stores == 0 && counting.commits == 0);
+    ok &= testCheck("commit due one quiet period after the burst", settingsMsUntilCommit(&store, now) == 2000 &&
+                                                               settingsMsUntilCommit(&store, now + 2000) == 0);
+    int written = settingsCommit(&store, now + 2000);
+    ok &= testCheck("burst of 11 changes costs 2 writes, 1 commit",
+                written == 2 && counting.stores == 2 && counting.commits == 1 && store.stats.coalesced == 9);
+    ok &= testCheck("nothing due after commit", settingsMsUntilCommit(&store, now + 5000) == UINT32_MAX);
+
+    // A steady trickle never goes quiet, maxDelayMs bounds it
+    now += 10000;
+    uint32_t start = now;
+    uint32_t due = UINT32_MAX;
+    for (int i = 0; i < 30 && due != 0; i++)
+    {
+        settingsSet(&store, &speed, 500 + i, now);
+        now += 1000;
+        due = settingsMsUntilCommit(&store, now);
+    }
+    ok &= testCheck("trickle commits after maxDelayMs", due == 0 && now - start == 10000);
+    settingsCommit(&store, now);
+
+    settingsSet(&store, &offset, (uint32_t)-42, now);
+    settingsCommit(&store, now);
+
+    // Reboot: a fresh store and file backend read the values back
+    SETTING_DEFINE(speed2, "ledctrl", "speed", SETTING_U16, 400);
+    SETTING_DEFINE(pattern2, "ledctrl", "pattern", SETTING_U8, 0);
+    SETTING_DEFINE(offset2, "sensor", "offset", SETTING_I32, -5);
+    SETTING_DEFINE(added, "ledctrl", "bright", SETTING_U8, 128);
+    memset(&counting, 0, sizeof(counting));
+    settingsFileBackend(&counting.inner, &file, path);
+    settingsStoreInit(&store, &backend, 2000, 10000);
+    settingsRegister(&store, &speed2);
+    settingsRegister(&store, &pattern2);
+    settingsRegister(&store, &offset2);
+    settingsRegister(&store, &added);
+    settingsLoadAll(&store);
+    ok &= testCheck("reboot restores saved values", settingsGet(&speed2) == speed.value && settingsGet(&pattern2) == 3 &&
+                                                    (int32_t)settingsGet(&offset2) == -42 && store.stats.loaded == 3);
+    ok &= testCheck("new key keeps its default", settingsGet(&added) == 128);
+    ok &= testCheck("U8 values are cut to width", settingsSet(&store, &added, 0x1FF, now) && settingsGet(&added) == 0xFF);
+
+    remove(path);
+    printf("%s\n", ok ? "all settings checks passed" : "SETTINGS CHECKS FAILED");
+    return ok;
+}
+
+#ifdef SETTINGS_HOST_MAIN
+int main(int argc, char **argv)
+{
+    return settingsSelfTest(argc > 1 ? argv[1] : "settings_test.txt") ? 0 : 1;
+}
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Write-coalescing settings store
+ *
+ * g_speed_ms and g_selectedPattern in the day 6-7 controller are back to
+ * 400 ms / pattern 0 after every reboot. Writing them to flash on every
+ * `speed` command would wear the flash and put an NVS commit (tens of ms)
+ * on the command path, so settings live in a RAM shadow instead:
+ *
+ *   settingsSet()  updates the shadow and marks the key dirty. Nothing
+ *                  touches flash.
+ *   commit due     once nothing has changed for quietMs, or maxDelayMs
+ *                  after the first unsaved change, whichever comes first.
+ *   settingsCommit writes only the dirty keys, then commits once.
+ *
+ * Ten `speed` commands typed within the quiet period cost one flash write.
+ *
+ * Each component defines its typed keys and registers them before boot
+ * load; settingsLoadAll() then reads every key in one pass (missing keys
+ * keep their defaults):
+ *
+ *   SETTING_DEFINE(g_speedSetting, "ledctrl", "speed", SETTING_U16, 400);
+ *   settingsRegister(store, &g_speedSetting);
+ *
+ * Storage is a backend vtable. settings.cpp provides NVS (component =
+ * namespace, name = key, both <= 15 characters); this file provides a
+ * text-file stand-in so the store runs on a PC. Only the C++ standard
+ * library is used, and the store itself is not thread-safe (settings.h
+ * adds the lock and the commit task):
+ *
+ *   g++ -std=c++17 -DSETTINGS_HOST_MAIN settings_store.cpp -o settings && ./settings
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SETTINGS_NAME_MAX 15 // NVS namespace and key limit
+
+typedef enum
+{
+    SETTING_U8 = 0,
+    SETTING_U16,
+    SETTING_U32,
+    SETTING_I32
+} setting_type_t;
+
+typedef struct setting
+{
+    const char *component;
+    const char *name;
+    setting_type_t type;
+    uint32_t defaultValue;
+    uint32_t value; // RAM shadow, I32 stored as its bit pattern
+    bool dirty;
+    struct setting *next;
+} setting_t;
+
+#define SETTING_DEFINE(var, component, name, type, defaultValue) \
+    setting_t var = {component, name, type, (uint32_t)(defaultValue), (uint32_t)(defaultValue), false, NULL}
+
+typedef struct
+{
+    // Returns false if the key does not exist (or has another type)
+    bool (*load)(void *ctx, const setting_t *setting, uint32_t *value);
+    bool (*store)(void *ctx, const setting_t *setting);
+    bool (*commit)(void *ctx);
+    void *ctx;
+} settings_backend_t;
+
+typedef struct
+{
+    uint32_t loaded;    // keys found in storage at boot
+    uint32_t sets;      // settingsSet calls that changed a value
+    uint32_t commits;
+    uint32_t writes;    // keys written to storage
+    uint32_t coalesced; // changes absorbed by a later change before commit
+    uint32_t errors;
+} settings_stats_t;
+
+typedef struct
+{
+    settings_backend_t backend;
+    setting_t *keys;
+    uint32_t quietMs;
+    uint32_t maxDelayMs;
+    uint32_t lastChangeMs;
+    uint32_t firstDirtyMs;
+    uint16_t dirtyCount;
+    settings_stats_t stats;
+} settings_store_t;
+
+void settingsStoreInit(settings_store_t *store, const settings_backend_t *backend, uint32_t quietMs,
+                       uint32_t maxDelayMs);
+
+// Adds a key. Component and name must be <= SETTINGS_NAME_MAX characters
+// and the pair unique.
+bool settingsRegister(settings_store_t *store, setting_t *setting);
+
+// Reads every registered key from the backend. Call once at boot.
+void settingsLoadAll(settings_store_t *store);
+
+static inline uint32_t settingsGet(const setting_t *setting)
+{
+    return setting->value;
+}
+
+// Returns true if the value changed (and is now dirty). The value is cut
+// to the key's width.
+bool settingsSet(settings_store_t *store, setting_t *setting, uint32_t value, uint32_t nowMs);
+
+// Milliseconds until a commit is due: 0 = now, UINT32_MAX = nothing dirty.
+uint32_t settingsMsUntilCommit(const settings_store_t *store, uint32_t nowMs);
+
+// Writes every dirty key and commits. Returns the number of keys written,
+// or -1 if the backend failed (the keys stay dirty and the next attempt
+// is due after another quiet period).
+int settingsCommit(settings_store_t *store, uint32_t nowMs);
+
+// Text-file backend: one "component.name=value" line per key. The file
+// is read on the first load and rewritten on commit.
+typedef struct
+{
+    const char *path;
+    bool read;
+    uint16_t count;
+    struct
+    {
+        char key[2 * SETTINGS_NAME_MAX + 2];
+        uint32_t value;
+    } entries[64];
+} settings_file_t;
+
+void settingsFileBackend(settings_backend_t *backend, settings_file_t *file, const char *path);
+
+// Exercises boot load, coalescing, commit timing and reload against the
+// file backend, printing each check. Returns true if all pass.
+bool settingsSelfTest(const char *path);
@@ -0,0 +1,346 @@
+#include "sim_controller.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+static const uint8_t LED[4] = {4, 16, 17, 5};
+static const uint8_t BUTTON = 15;
+
+// The exercise publishes this through a snapshot_t. The sim tasks never
+// interleave inside a copy, so a plain struct assignment stands in for
+// snapshotWrite()/snapshotRead().
+typedef struct
+{
+    uint16_t pattern;
+    uint16_t speedMs;
+} controller_state_t;
+
+static controller_state_t g_state = {0, 400};
+
+static SimQueue<uint16_t, 10> g_patternQueue;
+static SimQueue<uint16_t, 10> g_speedQueue;
+static SimMutex g_uartMutex;
+
+static uint32_t g_statusReports = 0;
+static uint32_t g_buttonPresses = 0;
+
+// Pattern state lives here rather than in function statics so that every
+// run starts from the same place
+static int g_knightPos = 0;
+static int g_knightDirection = 1;
+static bool g_blinkOn = false;
+static bool g_pairNumber = false;
+
+// --- patterns (one step each, the caller delays) ----------------------------
+
+static void knightRider(void)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        simGpioWrite(LED[i], (i == g_knightPos) ? 0 : 1);
+    }
+
+    g_knightPos += g_knightDirection;
+    if (g_knightPos == 3 || g_knightPos == 0)
+    {
+        g_knightDirection = -g_knightDirection;
+    }
+}
+
+static void blinkAll(void)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        simGpioWrite(LED[i], g_blinkOn ? 0 : 1);
+    }
+    g_blinkOn = !g_blinkOn;
+}
+
+static void alternatingPair(void)
+{
+    simGpioWrite(LED[0], g_pairNumber ? 1 : 0);
+    simGpioWrite(LED[1], g_pairNumber ? 1 : 0);
+    simGpioWrite(LED[2], g_pairNumber ? 0 : 1);
+    simGpioWrite(LED[3], g_pairNumber ? 0 : 1);
+    g_pairNumber = !g_pairNumber;
+}
+
+static void randomPattern(void)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        simGpioWrite(LED[i], simRandom() % 2);
+    }
+}
+
+// --- tasks -----------------------------------------------------------------
+
+static SimTask patternSequencer(void)
+{
+    uint16_t newPattern = 0;
+    uint16_t newSpeed = 0;
+    controller_state_t state = g_state;
+    while (1)
+    {
+        if (g_speedQueue.tryReceive(&newSpeed))
+        {
+            state.speedMs = newSpeed;
+            g_state = state;
+            co_await g_uartMutex.take();
+            co_await simLogf("PATTERN_SEQUENCER", "SELECTED SPEED: %d", newSpeed);
+            g_uartMutex.give();
+        }
+
+        if (g_patternQueue.tryReceive(&newPattern))
+        {
+            state.pattern = newPattern;
+            g_state = state;
+            co_await g_uartMutex.take();
+            co_await simLogf("PATTERN_SEQUENCER", "SELECTED PATTERN: %d", newPattern);
+            g_uartMutex.give();
+        }
+
+        if (state.pattern == 0)
+            knightRider();
+        else if (state.pattern == 1)
+            blinkAll();
+        else if (state.pattern == 2)
+            alternatingPair();
+        else if (state.pattern == 3)
+            randomPattern();
+        co_await simDelay(state.speedMs);
+    }
+}
+
+static SimTask buttonTask(void)
+{
+    uint16_t buttonCounter = 0;
+    while (1)
+    {
+        if (simGpioRead(BUTTON) == 1)
+        {
+            g_buttonPresses++;
+            co_await simLogf("BUTTON_TASK", "BUTTON PRESSED");
+            buttonCounter = buttonCounter + 1;
+            if (buttonCounter == 4)
+                buttonCounter = 0;
+            co_await g_patternQueue.send(buttonCounter);
+            co_await g_uartMutex.take();
+            co_await simLogf("BUTTON_TASK", "BUTTON COUNTER VALUE: %d", buttonCounter);
+            g_uartMutex.give();
+        }
+        co_await simDelay(200);
+    }
+}
+
+static SimTask serialTask(void)
+{
+    co_await g_uartMutex.take();
+    co_await simLogf("SERIALTASK", "Entered Serial Task");
+    g_uartMutex.give();
+
+    while (1)
+    {
+        sim_line_t rx = co_await simSerialInput().receive();
+        co_await g_uartMutex.take();
+        co_await simLogf("SERIALTASK", "Received: %s", rx.text);
+        g_uartMutex.give();
+
+        char cmd[20] = {0};
+        int value = 0;
+        if (sscanf(rx.text, "%19s %d", cmd, &value) >= 1)
+        {
+            if (strcmp(cmd, "pattern") == 0 && value >= 0 && value <= 3)
+            {
+                g_patternQueue.trySend((uint16_t)value);
+                co_await g_uartMutex.take();
+                co_await simLogf("SERIALTASK", "Pattern changed to: %d", value);
+                g_uartMutex.give();
+            }
+            else if (strcmp(cmd, "speed") == 0 && value >= 50 && value <= 1000)
+            {
+                g_speedQueue.trySend((uint16_t)value);
+                co_await g_uartMutex.take();
+                co_await simLogf("SERIALTASK", "Speed changed to: %d", value);
+                g_uartMutex.give();
+            }
+            else if (strcmp(cmd, "status") == 0)
+            {
+                co_await g_uartMutex.take();
+                co_await simLogf("SERIALTASK", "Status requested");
+                g_uartMutex.give();
+            }
+        }
+        co_await simDelay(100);
+    }
+}
+
+static SimTask statusReporter(void)
+{
+    static const char *patternNames[] = {"Knight Rider", "Blink All", "Alternating Pair", "Random"};
+    const uint16_t patternCount = sizeof(patternNames) / sizeof(patternNames[0]);
+    uint32_t reportCount = 0;
+
+    while (1)
+    {
+        co_await simDelay(5000);
+
+        controller_state_t state = g_state;
+        const char *name = (state.pattern < patternCount) ? patternNames[state.pattern] : "Unknown";
+
+        co_await g_uartMutex.take();
+        co_await simLogf("STATUS_REPORTER", "========== System Status Report #%lu ==========",
+                         (unsigned long)reportCount++);
+        co_await simLogf("STATUS_REPORTER", "Current Pattern: %d (%s)", state.pattern, name);
+        co_await simLogf("STATUS_REPORTER", "Current Speed: %d ms", state.speedMs);
+        co_await simLogf("STATUS_REPORTER", "=============================================");
+        g_uartMutex.give();
+        g_statusReports++;
+    }
+}
+
+// --- runner ----------------------------------------------------------------
+
+const char *SIM_CONTROLLER_DAY_SCENARIO =
+    "0       serial status\n"
+    "1500ms  press 15 300ms\n"
+    "10m     storm 15 50 250ms 100ms   # faster than the 200 ms poll\n"
+    "1h      serial speed 50\n"
+    "2h      serial pattern 3\n"
+    "3h      storm 15 200 1s 400ms\n"
+    "6h      serial speed 1000\n"
+    "6h      serial pattern 1\n"
+    "9h      storm 15 30 100ms 50ms    # presses shorter than the poll\n"
+    "12h     serial speed 5000         # rejected, out of range\n"
+    "12h     serial bogus\n"
+    "18h     serial speed 200\n"
+    "1439m   serial status\n";
+
+static bool g_verbose = false;
+static uint32_t g_hash = 0;
+
+static void hashSink(uint64_t timeUs, const char *tag, const char *text)
+{
+    char line[200];
+    int len = snprintf(line, sizeof(line), "%llu %s: %s", (unsigned long long)timeUs, tag, text);
+    for (int i = 0; i < len && i < (int)sizeof(line); i++)
+    {
+        g_hash = (g_hash ^ (uint8_t)line[i]) * 16777619u;
+    }
+    if (g_verbose)
+        printf("[%7llu.%06llu] %s: %s\n", (unsigned long long)(timeUs / 1000000),
+               (unsigned long long)(timeUs % 1000000), tag, text);
+}
+
+bool simControllerRun(const char *script, uint64_t durationUs, bool verbose, sim_controller_result_t *result)
+{
+    auto wallStart = std::chrono::steady_clock::now();
+
+    simReset(1);
+    g_hash = 2166136261u;
+    simSetTraceSink(hashSink);
+
+    g_state = {0, 400};
+    g_patternQueue = SimQueue<uint16_t, 10>();
+    g_speedQueue = SimQueue<uint16_t, 10>();
+    g_uartMutex = SimMutex();
+    g_statusReports = 0;
+    g_buttonPresses = 0;
+    g_knightPos = 0;
+    g_knightDirection = 1;
+    g_blinkOn = false;
+    g_pairNumber = false;
+
+    // Errors are traced, so show them even when not verbose
+    g_verbose = true;
+    bool ok = simLoadScript(script) >= 0;
+    g_verbose = verbose;
+    if (ok)
+    {
+        // Same priorities as app_main() in the exercise
+        simSpawn(patternSequencer(), "pattern", 3);
+        simSpawn(buttonTask(), "buttonTask", 5);
+        simSpawn(serialTask(), "SerialTask", 2);
+        simSpawn(statusReporter(), "statusReporter", 1);
+        simRun(durationUs);
+    }
+
+    sim_stats_t stats;
+    simGetStats(&stats);
+    result->traceLines = stats.traceLines;
+    result->traceHash = g_hash;
+    result->statusReports = g_statusReports;
+    result->buttonPresses = g_buttonPresses;
+    result->mutexContended = g_uartMutex.contended();
+    result->virtualUs = stats.nowUs;
+    result->wallUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - wallStart)
+                         .count();
+
+    simReset(1);
+    simSetTraceSink(NULL);
+    return ok;
+}
+
+static void printResult(const char *label, const sim_controller_result_t *r)
+{
+    printf("%s: %.1f h simulated in %.2f s (%.0fx), %lu trace lines, hash %08lx\n", label,
+           r->virtualUs / 3600e6, r->wallUs / 1e6, r->wallUs > 0 ? (double)r->virtualUs / r->wallUs : 0.0,
+           (unsigned long)r->traceLines, (unsigned long)r->traceHash);
+    printf("    %lu status reports, %lu presses seen, %lu contended UART mutex takes\n",
+           (unsigned long)r->statusReports, (unsigned long)r->buttonPresses, (unsigned long)r->mutexContended);
+}
+
+void simControllerDemo(void)
+{
+    const uint64_t day = 86400ULL * 1000000ULL;
+    sim_controller_result_t first;
+    sim_controller_result_t second;
+
+    simControllerRun(SIM_CONTROLLER_DAY_SCENARIO, day, false, &first);
+    printResult("run 1", &first);
+    simControllerRun(SIM_CONTROLLER_DAY_SCENARIO, day, false, &second);
+    printResult("run 2", &second);
+    printf("%s\n", (first.traceHash == second.traceHash && first.traceLines == second.traceLines)
+                       ? "Traces identical: simulation is deterministic"
+                       : "TRACES DIFFER");
+}
+
+#ifdef SIM_HOST_MAIN
+// Host entry point: sim [script-file] [duration] [-v]
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        simControllerDemo();
+        return 0;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    static char script[64 * 1024];
+    size_t len = fread(script, 1, sizeof(script) - 1, file);
+    script[len] = '\0';
+    fclose(file);
+
+    uint64_t duration = 86400ULL * 1000000ULL;
+    if (argc > 2 && !simParseTime(argv[2], &duration))
+    {
+        fprintf(stderr, "bad duration %s\n", argv[2]);
+        return 1;
+    }
+    bool verbose = argc > 3 && strcmp(argv[3], "-v") == 0;
+
+    sim_controller_result_t result;
+    if (!simControllerRun(script, duration, verbose, &result))
+        return 1;
+    printResult(argv[1], &result);
+    return 0;
+}
+#endif
@@ -0,0 +1,48 @@
+/**
+ * Day 6-7 LED controller on the virtual-time simulation kernel
+ *
+ * The four tasks of .exercises/completed/day6-7-practice-multi-task-led-
+ * controller.cpp (patternSequencer, buttonTask, serialTask, statusReporter)
+ * rewritten as SimTasks with the same priorities, periods, queues and UART
+ * mutex. Every blocking call maps one-to-one:
+ *
+ *   vTaskDelay(pdMS_TO_TICKS(ms))      ->  co_await simDelay(ms)
+ *   xQueueSend(q, &v, portMAX_DELAY)   ->  co_await q.send(v)
+ *   xQueueReceive(q, &v, 0)            ->  q.tryReceive(&v)
+ *   xSemaphoreTake(g_uartMutex, ...)   ->  co_await g_uartMutex.take()
+ *   ESP_LOGI(TAG, ...)                 ->  co_await simLogf(TAG, ...)
+ *   fgets(rxtext, ..., stdin)          ->  co_await simSerialInput().receive()
+ *   snapshotWrite/Read(&g_state, &s)   ->  g_state = s / s = g_state
+ *
+ * so a behaviour seen in the simulation can be traced back to a line of
+ * the real controller.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim_kernel.h"
+
+typedef struct
+{
+    uint32_t traceLines;
+    uint32_t traceHash; // FNV-1a over every trace line, for regression checks
+    uint32_t statusReports;
+    uint32_t buttonPresses;
+    uint32_t mutexContended;
+    uint64_t virtualUs;
+    uint64_t wallUs;
+} sim_controller_result_t;
+
+// Built-in scenario: one day with speed/pattern changes and button storms.
+extern const char *SIM_CONTROLLER_DAY_SCENARIO;
+
+// Runs the controller against `script` for `durationUs` of virtual time.
+// With verbose set, every trace line is printed; otherwise only counted and
+// hashed. Returns false if the script does not parse.
+bool simControllerRun(const char *script, uint64_t durationUs, bool verbose, sim_controller_result_t *result);
+
+// Runs the built-in day twice, prints both summaries and checks that the
+// traces are identical.
+void simControllerDemo(void);
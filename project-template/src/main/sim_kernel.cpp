@@ -0,0 +1,548 @@
+#include "sim_kernel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+enum
+{
+    TASK_FREE = 0,
+    TASK_READY,
+    TASK_RUNNING,
+    TASK_SLEEPING,
+    TASK_BLOCKED
+};
+
+struct sim_task
+{
+    std::coroutine_handle<> handle;
+    const char *name;
+    uint8_t priority;
+    uint8_t state;
+    uint64_t wakeUs;
+    uint32_t readySeq; // FIFO order among equal priorities
+};
+
+enum
+{
+    INPUT_SERIAL = 0,
+    INPUT_GPIO,
+    INPUT_PRESS // press/storm: remaining presses, period, hold
+};
+
+typedef struct
+{
+    uint64_t timeUs;
+    uint32_t seq; // keeps same-time inputs in script order
+    uint8_t type;
+    uint8_t pin;
+    uint8_t level;
+    uint16_t remaining;
+    uint64_t periodUs;
+    uint64_t holdUs;
+    char text[SIM_LINE_LEN];
+} sim_input_t;
+
+static sim_task_t g_tasks[SIM_MAX_TASKS];
+static sim_task_t *g_current = NULL;
+static uint32_t g_readySeq = 0;
+
+static sim_input_t g_inputs[SIM_MAX_INPUTS]; // min-heap on (timeUs, seq)
+static uint16_t g_inputCount = 0;
+static uint32_t g_inputSeq = 0;
+
+static uint64_t g_nowUs = 0;
+static uint32_t g_random = 1;
+static int8_t g_gpio[SIM_GPIO_COUNT];
+static bool g_traceGpio = false;
+static sim_stats_t g_stats;
+
+static SimQueue<sim_line_t, SIM_SERIAL_DEPTH> g_serial;
+
+static void defaultSink(uint64_t timeUs, const char *tag, const char *text)
+{
+    printf("[%7llu.%06llu] %s: %s\n", (unsigned long long)(timeUs / 1000000),
+           (unsigned long long)(timeUs % 1000000), tag, text);
+}
+
+static sim_trace_sink_t g_sink = defaultSink;
+
+// --- scheduler -------------------------------------------------------------
+
+sim_task_t *simCurrentTask(void)
+{
+    return g_current;
+}
+
+uint8_t simTaskPriority(const sim_task_t *task)
+{
+    return task->priority;
+}
+
+void simSleepCurrent(uint64_t us)
+{
+    g_current->state = TASK_SLEEPING;
+    g_current->wakeUs = g_nowUs + us;
+}
+
+void simBlockCurrent(void)
+{
+    g_current->state = TASK_BLOCKED;
+}
+
+void simMakeReady(sim_task_t *task)
+{
+    task->state = TASK_READY;
+    task->readySeq = g_readySeq++;
+}
+
+void SimMutex::give()
+{
+    if (m_waiterCount == 0)
+    {
+        m_owner = nullptr;
+        return;
+    }
+
+    // Like FreeRTOS: the highest-priority waiter gets it, FIFO among equals
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < m_waiterCount; i++)
+    {
+        if (simTaskPriority(m_waiters[i]) > simTaskPriority(m_waiters[best]))
+            best = i;
+    }
+    m_owner = m_waiters[best];
+    for (uint8_t i = best; i + 1 < m_waiterCount; i++)
+    {
+        m_waiters[i] = m_waiters[i + 1];
+    }
+    m_waiterCount--;
+    simMakeReady(m_owner);
+}
+
+static sim_task_t *pickReady(void)
+{
+    sim_task_t *best = NULL;
+    for (uint8_t i = 0; i < SIM_MAX_TASKS; i++)
+    {
+        sim_task_t *task = &g_tasks[i];
+        if (task->state != TASK_READY)
+            continue;
+        if (best == NULL || task->priority > best->priority ||
+            (task->priority == best->priority && (int32_t)(task->readySeq - best->readySeq) < 0))
+            best = task;
+    }
+    return best;
+}
+
+// Earliest sleeper wakeup, or UINT64_MAX
+static uint64_t nextWakeUs(void)
+{
+    uint64_t next = UINT64_MAX;
+    for (uint8_t i = 0; i < SIM_MAX_TASKS; i++)
+    {
+        if (g_tasks[i].state == TASK_SLEEPING && g_tasks[i].wakeUs < next)
+            next = g_tasks[i].wakeUs;
+    }
+    return next;
+}
+
+static void wakeSleepers(void)
+{
+    // Readied in wakeup order so same-priority tasks keep FIFO fairness
+    while (1)
+    {
+        sim_task_t *first = NULL;
+        for (uint8_t i = 0; i < SIM_MAX_TASKS; i++)
+        {
+            sim_task_t *task = &g_tasks[i];
+            if (task->state == TASK_SLEEPING && task->wakeUs <= g_nowUs &&
+                (first == NULL || task->wakeUs < first->wakeUs))
+                first = task;
+        }
+        if (first == NULL)
+            return;
+        simMakeReady(first);
+    }
+}
+
+bool simSpawn(SimTask task, const char *name, uint8_t priority)
+{
+    for (uint8_t i = 0; i < SIM_MAX_TASKS; i++)
+    {
+        if (g_tasks[i].state == TASK_FREE)
+        {
+            g_tasks[i].handle = task.release();
+            g_tasks[i].name = name;
+            g_tasks[i].priority = priority;
+            simMakeReady(&g_tasks[i]);
+            return true;
+        }
+    }
+    simTrace("SIM", "Task table full, '%s' not started", name);
+    return false;
+}
+
+// --- inputs ----------------------------------------------------------------
+
+static bool inputBefore(const sim_input_t *a, const sim_input_t *b)
+{
+    return a->timeUs < b->timeUs || (a->timeUs == b->timeUs && (int32_t)(a->seq - b->seq) < 0);
+}
+
+static bool pushInput(const sim_input_t *input)
+{
+    if (g_inputCount == SIM_MAX_INPUTS)
+        return false;
+
+    uint16_t i = g_inputCount++;
+    g_inputs[i] = *input;
+    g_inputs[i].seq = g_inputSeq++;
+    while (i > 0)
+    {
+        uint16_t parent = (i - 1) / 2;
+        if (!inputBefore(&g_inputs[i], &g_inputs[parent]))
+            break;
+        sim_input_t tmp = g_inputs[i];
+        g_inputs[i] = g_inputs[parent];
+        g_inputs[parent] = tmp;
+        i = parent;
+    }
+    return true;
+}
+
+static void popInput(sim_input_t *out)
+{
+    *out = g_inputs[0];
+    g_inputs[0] = g_inputs[--g_inputCount];
+
+    uint16_t i = 0;
+    while (1)
+    {
+        uint16_t left = 2 * i + 1;
+        uint16_t right = left + 1;
+        uint16_t smallest = i;
+        if (left < g_inputCount && inputBefore(&g_inputs[left], &g_inputs[smallest]))
+            smallest = left;
+        if (right < g_inputCount && inputBefore(&g_inputs[right], &g_inputs[smallest]))
+            smallest = right;
+        if (smallest == i)
+            break;
+        sim_input_t tmp = g_inputs[i];
+        g_inputs[i] = g_inputs[smallest];
+        g_inputs[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void deliverInput(sim_input_t *input)
+{
+    g_stats.inputs++;
+    switch (input->type)
+    {
+    case INPUT_SERIAL:
+    {
+        sim_line_t line;
+        memcpy(line.text, input->text, SIM_LINE_LEN);
+        simTrace("INPUT", "serial \"%s\"", line.text);
+        if (!g_serial.trySend(line))
+            simTrace("INPUT", "serial buffer full, line lost");
+        break;
+    }
+    case INPUT_GPIO:
+        g_gpio[input->pin] = input->level;
+        simTrace("INPUT", "gpio %u = %u", input->pin, input->level);
+        break;
+    case INPUT_PRESS:
+    {
+        // Press now, schedule the release and then the next press
+        g_gpio[input->pin] = 1;
+        sim_input_t release = *input;
+        release.type = INPUT_GPIO;
+        release.level = 0;
+        release.timeUs = input->timeUs + input->holdUs;
+        pushInput(&release);
+        if (input->remaining > 1)
+        {
+            sim_input_t next = *input;
+            next.remaining--;
+            next.timeUs = input->timeUs + input->periodUs;
+            pushInput(&next);
+        }
+        simTrace("INPUT", "press gpio %u (%u left)", input->pin, input->remaining - 1);
+        break;
+    }
+    }
+}
+
+bool simParseTime(const char *text, uint64_t *us)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text)
+        return false;
+
+    uint64_t scale = 1000;
+    if (*end == '\0' || strcmp(end, "ms") == 0)
+        scale = 1000;
+    else if (strcmp(end, "s") == 0)
+        scale = 1000000ULL;
+    else if (strcmp(end, "m") == 0)
+        scale = 60 * 1000000ULL;
+    else if (strcmp(end, "h") == 0)
+        scale = 3600 * 1000000ULL;
+    else if (strcmp(end, "d") == 0)
+        scale = 86400 * 1000000ULL;
+    else
+        return false;
+
+    *us = value * scale;
+    return true;
+}
+
+// Splits off the next whitespace-separated word; returns NULL at the end
+static char *nextWord(char **cursor)
+{
+    char *p = *cursor;
+    while (*p != '\0' && isspace((unsigned char)*p))
+        p++;
+    if (*p == '\0')
+        return NULL;
+    char *word = p;
+    while (*p != '\0' && !isspace((unsigned char)*p))
+        p++;
+    if (*p != '\0')
+        *p++ = '\0';
+    *cursor = p;
+    return word;
+}
+
+static bool parseLine(char *line, sim_input_t *input)
+{
+    char *cursor = line;
+    char *timeText = nextWord(&cursor);
+    char *command = nextWord(&cursor);
+    if (timeText == NULL || command == NULL || !simParseTime(timeText, &input->timeUs))
+        return false;
+
+    memset(input->text, 0, sizeof(input->text));
+    if (strcmp(command, "serial") == 0)
+    {
+        while (*cursor != '\0' && isspace((unsigned char)*cursor))
+            cursor++;
+        input->type = INPUT_SERIAL;
+        strncpy(input->text, cursor, SIM_LINE_LEN - 1);
+        return true;
+    }
+
+    char *pin = nextWord(&cursor);
+    if (pin == NULL || atoi(pin) < 0 || atoi(pin) >= SIM_GPIO_COUNT)
+        return false;
+    input->pin = (uint8_t)atoi(pin);
+
+    if (strcmp(command, "gpio") == 0)
+    {
+        char *level = nextWord(&cursor);
+        input->type = INPUT_GPIO;
+        input->level = (level != NULL && atoi(level) != 0) ? 1 : 0;
+        return level != NULL;
+    }
+
+    char *count = (strcmp(command, "storm") == 0) ? nextWord(&cursor) : (char *)"1";
+    char *period = (strcmp(command, "storm") == 0) ? nextWord(&cursor) : (char *)"0";
+    char *hold = nextWord(&cursor);
+    if ((strcmp(command, "press") != 0 && strcmp(command, "storm") != 0) || count == NULL || period == NULL ||
+        hold == NULL || atoi(count) <= 0)
+        return false;
+
+    input->type = INPUT_PRESS;
+    input->remaining = (uint16_t)atoi(count);
+    return simParseTime(period, &input->periodUs) && simParseTime(hold, &input->holdUs);
+}
+
+int simLoadScript(const char *script)
+{
+    int added = 0;
+    int lineNumber = 0;
+    const char *p = script;
+
+    while (*p != '\0')
+    {
+        char line[128];
+        size_t len = strcspn(p, "\n");
+        size_t copy = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+        memcpy(line, p, copy);
+        line[copy] = '\0';
+        p += len;
+        if (*p == '\n')
+            p++;
+        lineNumber++;
+
+        // Strip comments and a trailing '\r'
+        line[strcspn(line, "#\r")] = '\0';
+        char *start = line;
+        while (isspace((unsigned char)*start))
+            start++;
+        if (*start == '\0')
+            continue;
+
+        sim_input_t input = {};
+        if (!parseLine(start, &input) || !pushInput(&input))
+        {
+            simTrace("SIM", "script line %d rejected", lineNumber);
+            return -1;
+        }
+        added++;
+    }
+    return added;
+}
+
+// --- clock -----------------------------------------------------------------
+
+void simReset(uint32_t seed)
+{
+    for (uint8_t i = 0; i < SIM_MAX_TASKS; i++)
+    {
+        if (g_tasks[i].state != TASK_FREE)
+            g_tasks[i].handle.destroy();
+        g_tasks[i] = sim_task_t{};
+    }
+    g_current = NULL;
+    g_readySeq = 0;
+    g_inputCount = 0;
+    g_inputSeq = 0;
+    g_nowUs = 0;
+    g_random = seed != 0 ? seed : 1;
+    memset(g_gpio, 0, sizeof(g_gpio));
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_serial = SimQueue<sim_line_t, SIM_SERIAL_DEPTH>();
+}
+
+void simRun(uint64_t endUs)
+{
+    while (1)
+    {
+        sim_task_t *task = pickReady();
+        if (task != NULL)
+        {
+            g_current = task;
+            task->state = TASK_RUNNING;
+            task->handle.resume();
+            g_stats.resumes++;
+            if (task->handle.done())
+            {
+                task->handle.destroy();
+                *task = sim_task_t{};
+            }
+            g_current = NULL;
+            continue;
+        }
+
+        // Nothing can run: jump to whatever happens next
+        uint64_t next = nextWakeUs();
+        if (g_inputCount > 0 && g_inputs[0].timeUs < next)
+            next = g_inputs[0].timeUs;
+        if (next == UINT64_MAX || next > endUs)
+            break;
+        if (next > g_nowUs)
+        {
+            g_nowUs = next;
+            g_stats.timeJumps++;
+        }
+
+        // Inputs first, as an ISR would run before the woken tasks
+        while (g_inputCount > 0 && g_inputs[0].timeUs <= g_nowUs)
+        {
+            sim_input_t input;
+            popInput(&input);
+            deliverInput(&input);
+        }
+        wakeSleepers();
+    }
+
+    if (g_nowUs < endUs)
+        g_nowUs = endUs;
+}
+
+uint64_t simNowUs(void)
+{
+    return g_nowUs;
+}
+
+uint32_t simRandom(void)
+{
+    // xorshift32: same sequence on every platform
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random;
+}
+
+// --- GPIO, serial, trace ---------------------------------------------------
+
+int simGpioRead(uint8_t pin)
+{
+    return pin < SIM_GPIO_COUNT ? g_gpio[pin] : 0;
+}
+
+void simGpioWrite(uint8_t pin, int level)
+{
+    if (pin >= SIM_GPIO_COUNT)
+        return;
+    g_gpio[pin] = level ? 1 : 0;
+    g_stats.gpioWrites++;
+    if (g_traceGpio)
+        simTrace("GPIO", "%u = %d", pin, g_gpio[pin]);
+}
+
+void simTraceGpio(bool enable)
+{
+    g_traceGpio = enable;
+}
+
+SimQueue<sim_line_t, SIM_SERIAL_DEPTH> &simSerialInput(void)
+{
+    return g_serial;
+}
+
+static int traceLine(const char *tag, const char *fmt, va_list args)
+{
+    char text[160];
+    int len = vsnprintf(text, sizeof(text), fmt, args);
+    g_stats.traceLines++;
+    g_sink(g_nowUs, tag, text);
+    return len < 0 ? 0 : len;
+}
+
+void simTrace(const char *tag, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    traceLine(tag, fmt, args);
+    va_end(args);
+}
+
+SimSleepAwaiter simLogf(const char *tag, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int len = traceLine(tag, fmt, args);
+    va_end(args);
+
+    // "I (12345) TAG: " prefix + text + "\r\n", 10 bits per byte
+    uint64_t bytes = 14 + strlen(tag) + (uint64_t)len;
+    return SimSleepAwaiter{bytes * 10 * 1000000ULL / SIM_UART_BAUD};
+}
+
+void simSetTraceSink(sim_trace_sink_t sink)
+{
+    g_sink = sink != NULL ? sink : defaultSink;
+}
+
+void simGetStats(sim_stats_t *stats)
+{
+    *stats = g_stats;
+    stats->nowUs = g_nowUs;
+}
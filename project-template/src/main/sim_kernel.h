@@ -0,0 +1,331 @@
+/**
+ * Virtual-time discrete-event simulation kernel
+ *
+ * Checking the Day 6-7 controller over hours (5 s status reports, speed
+ * changes, button storms) costs hours of wall-clock time on a board. This
+ * kernel runs the same task structure against a VIRTUAL clock instead:
+ *
+ *   - tasks are C++20 coroutines (SimTask) with a FreeRTOS-like priority
+ *   - co_await simDelay(ms), queue send/receive and mutex take are the
+ *     only points where a task gives up the CPU, exactly where the real
+ *     tasks call vTaskDelay / xQueueReceive / xSemaphoreTake
+ *   - when no task is ready, time jumps straight to the next wakeup or
+ *     scripted input, so a simulated day takes seconds
+ *   - the highest-priority ready task always runs next, ties in FIFO order,
+ *     and there is no other source of ordering: every run of the same
+ *     script produces the same interleaving and the same trace
+ *
+ * Inputs come from a script, one event per line:
+ *
+ *   # time   command
+ *   0        serial status
+ *   1500ms   press 15 300ms           # GPIO 15 high for 300 ms
+ *   10m      storm 15 50 250ms 100ms  # 50 presses, one every 250 ms
+ *   1h       serial speed 50
+ *   2h       gpio 15 1
+ *
+ * Times take ms (default), s, m, h or d. The output is a trace of
+ * timestamped lines from simLogf() (plus GPIO writes if enabled), sent to
+ * a sink that either prints them or folds them into a hash, so a long run
+ * can be checked against a known-good one.
+ *
+ * Tasks run in zero virtual time between blocking points, and output
+ * through simLogf() occupies the caller for the time the UART needs to
+ * send it. Preemption in the middle of a computation and CPU load are not
+ * modelled.
+ *
+ * Only the C++ standard library is used, so this also builds on a PC:
+ *
+ *   g++ -std=c++20 -O2 -DSIM_HOST_MAIN sim_kernel.cpp sim_controller.cpp -o sim
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <coroutine>
+
+#define SIM_MAX_TASKS 16
+#define SIM_MAX_INPUTS 256 // pending scripted input events
+#define SIM_LINE_LEN 48    // serial line length, including the terminator
+#define SIM_SERIAL_DEPTH 8
+#define SIM_GPIO_COUNT 40
+#define SIM_UART_BAUD 115200
+
+typedef struct sim_task sim_task_t;
+
+typedef struct
+{
+    char text[SIM_LINE_LEN];
+} sim_line_t;
+
+typedef void (*sim_trace_sink_t)(uint64_t timeUs, const char *tag, const char *text);
+
+typedef struct
+{
+    uint64_t nowUs;
+    uint32_t resumes;    // task steps executed
+    uint32_t timeJumps;  // idle gaps skipped
+    uint32_t inputs;     // scripted events delivered
+    uint32_t traceLines;
+    uint32_t gpioWrites;
+} sim_stats_t;
+
+// --- scheduler internals used by the awaitables ----------------------------
+
+sim_task_t *simCurrentTask(void);
+uint8_t simTaskPriority(const sim_task_t *task);
+void simSleepCurrent(uint64_t us);
+void simBlockCurrent(void);
+void simMakeReady(sim_task_t *task);
+
+// --- task type -------------------------------------------------------------
+
+class SimTask
+{
+public:
+    struct promise_type
+    {
+        SimTask get_return_object() noexcept
+        {
+            return SimTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; } // runs once spawned
+        std::suspend_always final_suspend() noexcept { return {}; }   // kernel frees it
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+
+    explicit SimTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+    SimTask(SimTask &&other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+    SimTask(const SimTask &) = delete;
+    SimTask &operator=(const SimTask &) = delete;
+    ~SimTask()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    std::coroutine_handle<> release()
+    {
+        std::coroutine_handle<> handle = m_handle;
+        m_handle = nullptr;
+        return handle;
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// --- awaitables ------------------------------------------------------------
+
+struct SimSleepAwaiter
+{
+    uint64_t us;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<>) noexcept { simSleepCurrent(us); }
+    void await_resume() const noexcept {}
+};
+
+// co_await simDelay(ms) - the virtual-time vTaskDelay
+inline SimSleepAwaiter simDelay(uint32_t ms) { return SimSleepAwaiter{(uint64_t)ms * 1000}; }
+
+// co_await simLogf(tag, fmt, ...) - traces one line, then holds the caller
+// for as long as the UART takes to send it
+SimSleepAwaiter simLogf(const char *tag, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Bounded queue. Blocked senders and receivers wait in line and, like
+// FreeRTOS, the highest-priority one is served first, FIFO among equals.
+// A waiter is handed its item (or gets its item into the freed slot)
+// before it is woken, so a blocked send or receive always completes.
+template <typename T, size_t N>
+class SimQueue
+{
+public:
+    struct SendAwaiter;
+    struct ReceiveAwaiter;
+
+    bool trySend(const T &item)
+    {
+        // Receivers only wait on an empty queue
+        ReceiveAwaiter *receiver = popWaiter(m_receivers, &m_receiverCount);
+        if (receiver != nullptr)
+        {
+            receiver->item = item;
+            receiver->done = true;
+            simMakeReady(receiver->task);
+            return true;
+        }
+        if (m_count == N)
+            return false;
+        m_items[(m_head + m_count) % N] = item;
+        m_count++;
+        return true;
+    }
+
+    bool tryReceive(T *item)
+    {
+        if (m_count == 0)
+            return false;
+        *item = m_items[m_head];
+        m_head = (m_head + 1) % N;
+        m_count--;
+
+        SendAwaiter *sender = popWaiter(m_senders, &m_senderCount);
+        if (sender != nullptr)
+        {
+            m_items[(m_head + m_count) % N] = sender->item;
+            m_count++;
+            sender->done = true;
+            simMakeReady(sender->task);
+        }
+        return true;
+    }
+
+    struct SendAwaiter
+    {
+        SimQueue *queue;
+        T item;
+        bool done;
+        sim_task_t *task;
+
+        bool await_ready() noexcept { return done = queue->trySend(item); }
+        void await_suspend(std::coroutine_handle<>) noexcept
+        {
+            task = simCurrentTask();
+            queue->m_senders[queue->m_senderCount++] = this;
+            simBlockCurrent();
+        }
+        bool await_resume() const noexcept { return done; }
+    };
+
+    struct ReceiveAwaiter
+    {
+        SimQueue *queue;
+        T item;
+        bool done;
+        sim_task_t *task;
+
+        bool await_ready() noexcept { return done = queue->tryReceive(&item); }
+        void await_suspend(std::coroutine_handle<>) noexcept
+        {
+            task = simCurrentTask();
+            queue->m_receivers[queue->m_receiverCount++] = this;
+            simBlockCurrent();
+        }
+        T await_resume() noexcept { return item; }
+    };
+
+    // co_await queue.send(item) - blocks while the queue is full
+    SendAwaiter send(const T &item) { return SendAwaiter{this, item, false, nullptr}; }
+
+    // co_await queue.receive() - blocks while the queue is empty
+    ReceiveAwaiter receive() { return ReceiveAwaiter{this, T{}, false, nullptr}; }
+
+    size_t count() const { return m_count; }
+
+private:
+    // Removes and returns the waiter to serve next, nullptr if none
+    template <typename W>
+    static W *popWaiter(W **waiters, uint8_t *count)
+    {
+        if (*count == 0)
+            return nullptr;
+        uint8_t best = 0;
+        for (uint8_t i = 1; i < *count; i++)
+        {
+            if (simTaskPriority(waiters[i]->task) > simTaskPriority(waiters[best]->task))
+                best = i;
+        }
+        W *waiter = waiters[best];
+        for (uint8_t i = best; i + 1 < *count; i++)
+        {
+            waiters[i] = waiters[i + 1];
+        }
+        (*count)--;
+        return waiter;
+    }
+
+    T m_items[N] = {};
+    size_t m_head = 0;
+    size_t m_count = 0;
+    SendAwaiter *m_senders[SIM_MAX_TASKS] = {};
+    uint8_t m_senderCount = 0;
+    ReceiveAwaiter *m_receivers[SIM_MAX_TASKS] = {};
+    uint8_t m_receiverCount = 0;
+};
+
+// Mutex that hands over to the highest-priority waiter on give().
+class SimMutex
+{
+public:
+    struct TakeAwaiter
+    {
+        SimMutex *mutex;
+
+        bool await_ready() noexcept
+        {
+            if (mutex->m_owner != nullptr)
+                return false;
+            mutex->m_owner = simCurrentTask();
+            return true;
+        }
+        void await_suspend(std::coroutine_handle<>) noexcept
+        {
+            mutex->m_waiters[mutex->m_waiterCount++] = simCurrentTask();
+            mutex->m_contended++;
+            simBlockCurrent();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    // co_await mutex.take()
+    TakeAwaiter take() { return TakeAwaiter{this}; }
+    void give();
+
+    uint32_t contended() const { return m_contended; }
+
+private:
+    sim_task_t *m_owner = nullptr;
+    sim_task_t *m_waiters[SIM_MAX_TASKS] = {};
+    uint8_t m_waiterCount = 0;
+    uint32_t m_contended = 0;
+};
+
+// --- kernel API ------------------------------------------------------------
+
+// Destroys every task, clears inputs and GPIOs, and restarts time at 0.
+void simReset(uint32_t seed);
+
+// Adds a coroutine as a task; returns false if the task table is full.
+bool simSpawn(SimTask task, const char *name, uint8_t priority);
+
+// Parses a script (see above) into pending inputs. Returns the number of
+// events added, or -1 with a trace line naming the bad line.
+int simLoadScript(const char *script);
+
+// Runs until virtual time endUs, or until nothing is left to happen.
+void simRun(uint64_t endUs);
+
+uint64_t simNowUs(void);
+uint32_t simRandom(void); // deterministic rand() replacement
+
+int simGpioRead(uint8_t pin);
+void simGpioWrite(uint8_t pin, int level);
+void simTraceGpio(bool enable); // trace every GPIO write (large traces!)
+
+// Serial lines scripted with "serial ..." arrive here.
+SimQueue<sim_line_t, SIM_SERIAL_DEPTH> &simSerialInput(void);
+
+// Emits one trace line without holding the caller.
+void simTrace(const char *tag, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// NULL restores the default sink, which prints every line.
+void simSetTraceSink(sim_trace_sink_t sink);
+
+// Parses "250", "250ms", "5s", "10m", "2h" or "1d" into microseconds.
+bool simParseTime(const char *text, uint64_t *us);
+
+void simGetStats(sim_stats_t *stats);
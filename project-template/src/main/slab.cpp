@@ -0,0 +1,584 @@
+#include "slab.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef SLAB_HOST_MAIN
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "host_test.h"
+#endif
+
+#define EMPTY 0xFFFF
+#define POISON_FREE 0xDE
+#define POISON_ALLOC 0xA5
+
+static constexpr uint16_t kSizes[] = {SLAB_CLASS_SIZES};
+static constexpr uint16_t kBlocks[] = {SLAB_CLASS_BLOCKS};
+static constexpr uint8_t kClasses = sizeof(kSizes) / sizeof(kSizes[0]);
+static_assert(sizeof(kBlocks) == sizeof(kSizes), "one block count per size class");
+
+static constexpr size_t arenaBytes()
+{
+    size_t total = 0;
+    for (uint8_t c = 0; c < kClasses; c++)
+        total += (size_t)kSizes[c] * kBlocks[c];
+    return total;
+}
+
+static constexpr uint32_t totalBlocks()
+{
+    uint32_t total = 0;
+    for (uint8_t c = 0; c < kClasses; c++)
+        total += kBlocks[c];
+    return total;
+}
+
+static constexpr bool classesValid()
+{
+    for (uint8_t c = 0; c < kClasses; c++)
+    {
+        if (kSizes[c] == 0 || kSizes[c] % 8 != 0 || kBlocks[c] == 0 || kBlocks[c] >= EMPTY)
+            return false;
+        if (c > 0 && kSizes[c] <= kSizes[c - 1])
+            return false;
+    }
+    return true;
+}
+static_assert(classesValid(), "size classes must ascend in multiples of 8 with 1..65534 blocks");
+
+typedef struct
+{
+    uint8_t *base;
+    uint16_t *next;      // free-list link per block
+    uint8_t *allocated;  // 1 while a block is handed out
+    volatile uint32_t head; // tag << 16 | (first free block + 1), 0 = empty
+    volatile uint32_t inUse;
+    volatile uint32_t highWater;
+    volatile uint32_t allocs;
+    volatile uint32_t failures;
+    volatile uint32_t largest;
+    volatile uint32_t corrupt;
+} slab_class_t;
+
+alignas(8) static uint8_t g_arena[arenaBytes()];
+static uint16_t g_next[totalBlocks()];
+static uint8_t g_allocated[totalBlocks()];
+// Zero-filled, so every class reads as empty until slabInit()
+static slab_class_t g_classes[kClasses];
+static volatile uint32_t g_badFrees;
+
+static inline uint32_t atomicAdd(volatile uint32_t *counter, int32_t delta)
+{
+    return __atomic_add_fetch(counter, (uint32_t)delta, __ATOMIC_RELAXED);
+}
+
+static void raiseMax(volatile uint32_t *max, uint32_t value)
+{
+    uint32_t seen = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (value > seen && !__atomic_compare_exchange_n(max, &seen, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+// --- free lists ------------------------------------------------------------
+
+// The head holds the first free block + 1, so a zeroed class is empty.
+// Links hold plain indexes; EMPTY + 1 wraps to 0 in 16 bits and back.
+
+static uint16_t popBlock(slab_class_t *c)
+{
+    uint32_t head = __atomic_load_n(&c->head, __ATOMIC_ACQUIRE);
+    while (1)
+    {
+        uint16_t index = (uint16_t)((head & 0xFFFF) - 1);
+        if (index == EMPTY)
+            return EMPTY;
+        // May read a link that another core is changing; the tag then no
+        // longer matches and the exchange fails.
+        uint16_t next = __atomic_load_n(&c->next[index], __ATOMIC_RELAXED);
+        uint32_t newHead = ((head & 0xFFFF0000u) + 0x10000u) | (uint16_t)(next + 1);
+        if (__atomic_compare_exchange_n(&c->head, &head, newHead, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+            return index;
+    }
+}
+
+static void pushBlock(slab_class_t *c, uint16_t index)
+{
+    uint32_t head = __atomic_load_n(&c->head, __ATOMIC_RELAXED);
+    while (1)
+    {
+        __atomic_store_n(&c->next[index], (uint16_t)((head & 0xFFFF) - 1), __ATOMIC_RELAXED);
+        uint32_t newHead = ((head & 0xFFFF0000u) + 0x10000u) | (uint16_t)(index + 1);
+        if (__atomic_compare_exchange_n(&c->head, &head, newHead, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return;
+    }
+}
+
+// --- allocator -------------------------------------------------------------
+
+void slabInit(void)
+{
+    uint8_t *base = g_arena;
+    uint32_t first = 0;
+    for (uint8_t i = 0; i < kClasses; i++)
+    {
+        slab_class_t *c = &g_classes[i];
+        memset(c, 0, sizeof(*c));
+        c->base = base;
+        c->next = &g_next[first];
+        c->allocated = &g_allocated[first];
+        for (uint16_t b = 0; b < kBlocks[i]; b++)
+        {
+            c->next[b] = b + 1 < kBlocks[i] ? b + 1 : EMPTY;
+            c->allocated[b] = 0;
+        }
+        c->head = 1; // block 0
+        base += (size_t)kSizes[i] * kBlocks[i];
+        first += kBlocks[i];
+    }
+#ifdef SLAB_POISON
+    memset(g_arena, POISON_FREE, sizeof(g_arena));
+#endif
+    g_badFrees = 0;
+}
+
+void *slabAlloc(size_t size)
+{
+    if (size == 0 || size > kSizes[kClasses - 1])
+        return NULL;
+    uint8_t i = 0;
+    while (kSizes[i] < size)
+        i++;
+
+    slab_class_t *c = &g_classes[i];
+    uint16_t index = popBlock(c);
+    if (index == EMPTY)
+    {
+        atomicAdd(&c->failures, 1);
+        return NULL;
+    }
+    __atomic_store_n(&c->allocated[index], 1, __ATOMIC_RELAXED);
+    raiseMax(&c->highWater, atomicAdd(&c->inUse, 1));
+    raiseMax(&c->largest, (uint32_t)size);
+    atomicAdd(&c->allocs, 1);
+
+    uint8_t *block = c->base + (size_t)index * kSizes[i];
+#ifdef SLAB_POISON
+    for (uint16_t b = 0; b < kSizes[i]; b++)
+    {
+        if (block[b] != POISON_FREE)
+        {
+            atomicAdd(&c->corrupt, 1);
+            break;
+        }
+    }
+    memset(block, POISON_ALLOC, kSizes[i]);
+#endif
+    return block;
+}
+
+// Class and block index of a pointer returned by slabAlloc, or false.
+static bool locate(const void *ptr, uint8_t *cls, uint16_t *index)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    if (p < g_arena || p >= g_arena + sizeof(g_arena))
+        return false;
+    for (uint8_t i = 0; i < kClasses; i++)
+    {
+        const slab_class_t *c = &g_classes[i];
+        if (c->base == NULL)
+            return false; // before slabInit()
+        size_t offset = (size_t)(p - c->base);
+        if (p >= c->base && offset < (size_t)kSizes[i] * kBlocks[i])
+        {
+            size_t block = offset / kSizes[i];
+            *cls = i;
+            *index = (uint16_t)block;
+            return block * kSizes[i] == offset;
+        }
+    }
+    return false;
+}
+
+void slabFree(void *ptr)
+{
+    if (ptr == NULL)
+        return;
+    uint8_t i;
+    uint16_t index;
+    if (!locate(ptr, &i, &index))
+    {
+        atomicAdd(&g_badFrees, 1);
+        return;
+    }
+    slab_class_t *c = &g_classes[i];
+    // Only one of two racing frees of the same block gets it back
+    if (__atomic_exchange_n(&c->allocated[index], 0, __ATOMIC_RELAXED) == 0)
+    {
+        atomicAdd(&g_badFrees, 1);
+        return;
+    }
+#ifdef SLAB_POISON
+    memset(ptr, POISON_FREE, kSizes[i]);
+#endif
+    atomicAdd(&c->inUse, -1);
+    pushBlock(c, index);
+}
+
+size_t slabBlockSize(const void *ptr)
+{
+    uint8_t i;
+    uint16_t index;
+    return locate(ptr, &i, &index) ? kSizes[i] : 0;
+}
+
+uint8_t slabClassCount(void)
+{
+    return kClasses;
+}
+
+bool slabClassStats(uint8_t cls, slab_class_stats_t *stats)
+{
+    if (cls >= kClasses)
+        return false;
+    const slab_class_t *c = &g_classes[cls];
+    stats->size = kSizes[cls];
+    stats->blocks = kBlocks[cls];
+    stats->inUse = (uint16_t)c->inUse;
+    stats->highWater = (uint16_t)c->highWater;
+    stats->allocs = c->allocs;
+    stats->failures = c->failures;
+    stats->largest = (uint16_t)c->largest;
+    stats->corrupt = c->corrupt;
+    return true;
+}
+
+uint32_t slabBadFrees(void)
+{
+    return g_badFrees;
+}
+
+void slabReport(void)
+{
+    printf("Slab allocator, %u bytes in %u classes\n", (unsigned)sizeof(g_arena), kClasses);
+    printf("  %5s %6s %6s %6s %10s %8s %8s %8s\n", "size", "blocks", "used", "peak", "allocs", "full", "largest",
+           "corrupt");
+    for (uint8_t i = 0; i < kClasses; i++)
+    {
+        slab_class_stats_t s;
+        slabClassStats(i, &s);
+        printf("  %5u %6u %6u %6u %10lu %8lu %8u %8lu\n", s.size, s.blocks, s.inUse, s.highWater,
+               (unsigned long)s.allocs, (unsigned long)s.failures, s.largest, (unsigned long)s.corrupt);
+    }
+    printf("  bad frees: %lu\n", (unsigned long)g_badFrees);
+}
+
+bool slabCommand(const char *line)
+{
+    if (strcmp(line, "slab") != 0)
+        return false;
+    slabReport();
+    return true;
+}
+
+#ifdef SLAB_HOST_MAIN
+// The self test and benchmark reset the pools and need threads and
+// megabytes of heap, so the target only gets the allocator above.
+
+// --- self test -------------------------------------------------------------
+
+static uint32_t inUseTotal(void)
+{
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < kClasses; i++)
+        total += g_classes[i].inUse;
+    return total;
+}
+
+bool slabSelfTest(void)
+{
+    printf("Slab allocator self test\n");
+    bool ok = true;
+
+    // As at boot, before slabInit()
+    memset((void *)g_classes, 0, sizeof(g_classes));
+    ok &= testCheck("alloc before slabInit fails", slabAlloc(1) == NULL && g_classes[0].failures == 1);
+    slabFree(g_arena);
+    ok &= testCheck("free before slabInit counted as bad", slabBadFrees() == 1);
+    slabInit();
+
+    void *small = slabAlloc(1);
+    void *exact = slabAlloc(kSizes[0]);
+    void *next = slabAlloc(kSizes[0] + 1);
+    ok &= testCheck("smallest class that fits", slabBlockSize(small) == kSizes[0] &&
+                                                slabBlockSize(exact) == kSizes[0] &&
+                                                slabBlockSize(next) == kSizes[1]);
+    ok &= testCheck("zero and oversize requests fail",
+                slabAlloc(0) == NULL && slabAlloc(kSizes[kClasses - 1] + 1) == NULL);
+    ok &= testCheck("blocks are 8-byte aligned", ((uintptr_t)small % 8) == 0 && ((uintptr_t)next % 8) == 0);
+    slabFree(small);
+    slabFree(exact);
+    slabFree(next);
+
+    // Exhaust the smallest class; it must not borrow from the next one
+    std::vector<void *> blocks;
+    void *p;
+    while ((p = slabAlloc(kSizes[0])) != NULL)
+        blocks.push_back(p);
+    slab_class_stats_t s0, s1;
+    slabClassStats(0, &s0);
+    slabClassStats(1, &s1);
+    ok &= testCheck("full class fails, next class untouched",
+                blocks.size() == kBlocks[0] && s0.failures == 1 && s1.inUse == 0);
+    std::sort(blocks.begin(), blocks.end());
+    ok &= testCheck("no block handed out twice", std::adjacent_find(blocks.begin(), blocks.end()) == blocks.end());
+    for (void *b : blocks)
+        slabFree(b);
+    slabClassStats(0, &s0);
+    ok &= testCheck("usage and high water", s0.inUse == 0 && s0.highWater == kBlocks[0]);
+
+    // Misuse is counted, not acted on
+    uint32_t local;
+    p = slabAlloc(kSizes[1]);
+    slabFree(p);
+    slabFree(p);
+    slabFree(&local);
+    slabFree((uint8_t *)slabAlloc(kSizes[1]) + 4);
+    ok &= testCheck("double, foreign and interior frees counted", slabBadFrees() == 3);
+    ok &= testCheck("free list intact after bad frees", inUseTotal() == 1);
+
+#ifdef SLAB_POISON
+    p = slabAlloc(kSizes[2]);
+    ok &= testCheck("fresh blocks are poisoned", ((uint8_t *)p)[kSizes[2] - 1] == POISON_ALLOC);
+    slabFree(p);
+    ((uint8_t *)p)[3] = 0; // write after free
+    slabClassStats(2, &s0);
+    uint32_t before = s0.corrupt;
+    void *again = slabAlloc(kSizes[2]);
+    slabClassStats(2, &s0);
+    ok &= testCheck("write after free detected", again == p && s0.corrupt == before + 1);
+    slabFree(again);
+#endif
+
+    // Threads allocate and free concurrently, stamping each block with
+    // their id; a block handed to two owners at once shows up as a
+    // changed stamp.
+    slabInit();
+    const int threads = 4;
+    volatile uint32_t clashes = 0;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([t, &clashes]() {
+            std::mt19937 rng(t);
+            void *held[16] = {};
+            for (int n = 0; n < 200000; n++)
+            {
+                int slot = rng() % 16;
+                if (held[slot] != NULL)
+                {
+                    if (*(volatile uint32_t *)held[slot] != (uint32_t)(t << 24 | slot))
+                        __atomic_add_fetch(&clashes, 1, __ATOMIC_RELAXED);
+                    slabFree(held[slot]);
+                    held[slot] = NULL;
+                }
+                else if ((held[slot] = slabAlloc(4 + rng() % kSizes[kClasses - 1])) != NULL)
+                {
+                    *(volatile uint32_t *)held[slot] = t << 24 | slot;
+                }
+            }
+            for (void *h : held)
+                slabFree(h);
+        });
+    }
+    for (std::thread &w : workers)
+        w.join();
+    ok &= testCheck("concurrent alloc/free keeps owners apart", clashes == 0 && slabBadFrees() == 0);
+    ok &= testCheck("everything returned", inUseTotal() == 0);
+
+    slabInit();
+    return testSummary(ok);
+}
+
+// --- benchmark -------------------------------------------------------------
+
+typedef struct
+{
+    uint16_t slot;
+    uint16_t size; // 0: free the slot
+} bench_op_t;
+
+typedef struct
+{
+    double meanNs;
+    double p99Ns;
+    double maxNs;
+    uint32_t failures;
+    uint64_t liveRequested; // at the end of the run
+    uint64_t liveGranted;
+} bench_result_t;
+
+// Picks a class in proportion to its block count, then any size that
+// lands in it, so the workload matches what the pools were sized for.
+static uint16_t benchSize(std::mt19937 &rng)
+{
+    uint32_t r = rng() % totalBlocks();
+    uint8_t c = 0;
+    while (r >= kBlocks[c])
+        r -= kBlocks[c++];
+    uint16_t low = c > 0 ? kSizes[c - 1] + 1 : 1;
+    return (uint16_t)(low + rng() % (kSizes[c] - low + 1));
+}
+
+static size_t heapBlockSize(void *ptr)
+{
+#if defined(__GLIBC__)
+    return malloc_usable_size(ptr);
+#else
+    (void)ptr;
+    return 0;
+#endif
+}
+
+// Runs the workload and leaves its final live set in `live` so the
+// caller can look at the allocator before freeing it.
+template <typename Alloc, typename Free, typename BlockSize>
+static bench_result_t runWorkload(const std::vector<bench_op_t> &ops, std::vector<void *> &live,
+                                  std::vector<float> &ns, Alloc alloc, Free release, BlockSize blockSize)
+{
+    bench_result_t result = {0, 0, 0, 0, 0, 0};
+    std::vector<uint16_t> sizes(live.size(), 0);
+    double total = 0;
+    for (size_t n = 0; n < ops.size(); n++)
+    {
+        const bench_op_t &op = ops[n];
+        auto start = std::chrono::steady_clock::now();
+        if (op.size == 0)
+        {
+            release(live[op.slot]); // NULL if the allocation had failed
+            live[op.slot] = nullptr;
+        }
+        else
+        {
+            live[op.slot] = alloc(op.size);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        ns[n] = (float)std::chrono::duration<double, std::nano>(end - start).count();
+        total += ns[n];
+        if (op.size != 0 && live[op.slot] == nullptr)
+            result.failures++;
+        if (live[op.slot] != nullptr)
+            memset(live[op.slot], 0x55, op.size); // touch it like a real user
+        sizes[op.slot] = live[op.slot] != nullptr ? op.size : 0;
+    }
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        if (live[i] != nullptr)
+        {
+            result.liveRequested += sizes[i];
+            result.liveGranted += blockSize(live[i]);
+        }
+    }
+    std::sort(ns.begin(), ns.end());
+    result.meanNs = total / ops.size();
+    result.p99Ns = ns[ns.size() * 99 / 100];
+    result.maxNs = ns.back();
+    return result;
+}
+
+static void releaseAll(std::vector<void *> &live, void (*release)(void *))
+{
+    for (void *&p : live)
+    {
+        release(p);
+        p = nullptr;
+    }
+}
+
+static void printLatency(const char *name, const bench_result_t *r)
+{
+    printf("  %-8s %9.1f %9.1f %9.1f %9lu %7.1f%%\n", name, r->meanNs, r->p99Ns, r->maxNs,
+           (unsigned long)r->failures, r->liveGranted ? 100.0 * r->liveRequested / r->liveGranted : 0.0);
+}
+
+void slabBenchmark(uint32_t ops, uint32_t seed)
+{
+    if (ops == 0)
+        return;
+
+    // Each slot alternates between allocating and freeing, so on average
+    // half of them are live: well within the pools, with bursts that can
+    // still fill a class
+    const uint16_t slots = (uint16_t)(totalBlocks() * 3 / 4);
+    std::mt19937 rng(seed);
+    std::vector<bench_op_t> workload(ops);
+    std::vector<bool> occupied(slots, false);
+    for (bench_op_t &op : workload)
+    {
+        op.slot = (uint16_t)(rng() % slots);
+        op.size = occupied[op.slot] ? 0 : benchSize(rng);
+        occupied[op.slot] = !occupied[op.slot];
+    }
+    // Allocated up front so they do not share the heap with the workload
+    std::vector<void *> live(slots, nullptr);
+    std::vector<float> ns(ops);
+
+    double timerNs = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto end = std::chrono::steady_clock::now();
+        timerNs += std::chrono::duration<double, std::nano>(end - start).count();
+    }
+    timerNs /= 100000;
+
+    printf("Randomised workload: %lu operations on %u slots, 1..%u bytes\n", (unsigned long)ops, slots,
+           kSizes[kClasses - 1]);
+    printf("  %-8s %9s %9s %9s %9s %8s\n", "", "mean ns", "p99 ns", "max ns", "failed", "fill");
+
+    slabInit();
+    bench_result_t slab = runWorkload(workload, live, ns, slabAlloc, slabFree, slabBlockSize);
+    printLatency("slab", &slab);
+    releaseAll(live, slabFree);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 before = mallinfo2();
+#endif
+    bench_result_t heap = runWorkload(workload, live, ns, malloc, free, heapBlockSize);
+    printLatency("malloc", &heap);
+    printf("  (includes %.1f ns of timer overhead; fill: requested / granted bytes at the end)\n", timerNs);
+
+    // The slab loses only the rounding up to its class. The heap also
+    // keeps freed memory that is split into pieces between live blocks.
+    printf("Memory at the end of the run\n");
+    printf("  slab: %llu bytes live in %u reserved, no free memory outside the pools\n",
+           (unsigned long long)slab.liveGranted, (unsigned)sizeof(g_arena));
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 after = mallinfo2();
+    printf("  heap: %llu bytes live, arena grew %lld bytes, %zu bytes free in %zu pieces\n",
+           (unsigned long long)heap.liveGranted, (long long)after.arena - (long long)before.arena,
+           after.fordblks, after.ordblks);
+#else
+    printf("  heap: %llu bytes live (free-space figures need glibc's mallinfo2)\n",
+           (unsigned long long)heap.liveGranted);
+#endif
+    releaseAll(live, free);
+    slabReport();
+    slabInit();
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = slabSelfTest();
+    slabBenchmark(argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000000, 1);
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,102 @@
+/**
+ * Fixed-size slab allocator with size classes
+ *
+ * Queue items are fixed size. Anything variable (command lines, log
+ * records, event payloads) would have to come from the general heap,
+ * which cannot be called from an ISR and fragments over a long uptime.
+ * The slab allocator hands out blocks from a few static pools instead,
+ * one per size class:
+ *
+ *   void *p = slabAlloc(40);     // a 64-byte block
+ *   ...
+ *   slabFree(p);
+ *
+ * A request goes to the smallest class that fits it, and never to a
+ * larger one. A full class fails the allocation (NULL) rather than eating
+ * into the next, so one burst cannot starve another user. The classes and
+ * block counts are fixed at compile time (SLAB_CLASS_SIZES and
+ * SLAB_CLASS_BLOCKS, overridable with -D), so all memory is reserved at
+ * link time and there is no external fragmentation.
+ *
+ * Each class keeps its free blocks on a lock-free stack. The head is one
+ * 32-bit word, a block index plus a tag that changes on every push and
+ * pop, so a stale compare-and-swap fails instead of corrupting the list.
+ * The links live beside the blocks, not in them. slabAlloc and slabFree
+ * take no lock and never block, so they are safe from tasks on either
+ * core and from ISRs. (On single-core RISC-V chips without atomic
+ * instructions the compiler's atomics briefly mask interrupts instead.)
+ * Both run from flash; for an ISR that runs while the flash cache is off,
+ * list them in the --hot input of tools/placement.py to move them to IRAM.
+ *
+ * Build with SLAB_POISON (the esp32dev_debug environment) to fill freed
+ * blocks with 0xDE and check the pattern on the next allocation: a write
+ * after free is counted as corrupt. Double and foreign frees are counted
+ * in every build.
+ *
+ * Only the C++ standard library is used, so the allocator runs on a PC
+ * too. The self test and the benchmark against malloc are built only
+ * there: both end by resetting every pool, and they use threads and
+ * megabytes of heap.
+ *
+ *   g++ -std=c++17 -O2 -pthread -DSLAB_HOST_MAIN slab.cpp -o slab && ./slab
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef SLAB_CLASS_SIZES
+#define SLAB_CLASS_SIZES 16, 32, 64, 128, 256 // bytes, ascending, multiples of 8
+#endif
+#ifndef SLAB_CLASS_BLOCKS
+#define SLAB_CLASS_BLOCKS 64, 48, 32, 16, 8 // per class
+#endif
+
+typedef struct
+{
+    uint16_t size;
+    uint16_t blocks;
+    uint16_t inUse;
+    uint16_t highWater;
+    uint16_t largest;    // biggest request served
+    uint32_t allocs;
+    uint32_t failures;   // class was full
+    uint32_t corrupt;    // poisoned blocks found modified (SLAB_POISON)
+} slab_class_stats_t;
+
+// Resets the pools. Not thread safe; call before any slabAlloc. Until
+// then every class is empty: slabAlloc returns NULL and slabFree counts a
+// bad free.
+void slabInit(void);
+
+// NULL if size is 0, larger than the largest class or the class is full.
+void *slabAlloc(size_t size);
+
+// NULL is ignored. Pointers not from slabAlloc, and blocks already free,
+// are counted and otherwise ignored.
+void slabFree(void *ptr);
+
+// Usable size of an allocated block, 0 for a foreign pointer.
+size_t slabBlockSize(const void *ptr);
+
+uint8_t slabClassCount(void);
+bool slabClassStats(uint8_t cls, slab_class_stats_t *stats);
+uint32_t slabBadFrees(void);
+
+// Per-class usage table on stdout.
+void slabReport(void);
+
+// Console: "slab" prints the report.
+bool slabCommand(const char *line);
+
+#ifdef SLAB_HOST_MAIN
+// Both leave the pools reset (slabInit).
+bool slabSelfTest(void);
+
+// Randomised alloc/free workload of `ops` operations against the slab
+// and against malloc/free: latency per operation, internal waste and the
+// heap's free-space fragmentation.
+void slabBenchmark(uint32_t ops, uint32_t seed);
+#endif
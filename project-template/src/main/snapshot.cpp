@@ -0,0 +1,254 @@
+#include "snapshot.h"
+
+#include <string.h>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "Snapshot";
+
+bool snapshotInit(snapshot_t *snap, void *data, size_t size)
+{
+    if (size == 0 || (size & 3) != 0 || ((uintptr_t)data & 3) != 0)
+    {
+        ESP_LOGE(TAG, "State must be a non-empty, 4-byte aligned multiple of 4 bytes (got %u)", (unsigned)size);
+        return false;
+    }
+    snap->seq = 0;
+    snap->data = data;
+    snap->size = size;
+    snap->writeLock = portMUX_INITIALIZER_UNLOCKED;
+    return true;
+}
+
+void *IRAM_ATTR snapshotWriteBegin(snapshot_t *snap)
+{
+    portENTER_CRITICAL_SAFE(&snap->writeLock);
+    __atomic_store_n(&snap->seq, snap->seq + 1, __ATOMIC_RELAXED);
+    // Odd sequence must be visible before any of the new data
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return snap->data;
+}
+
+void IRAM_ATTR snapshotWriteEnd(snapshot_t *snap)
+{
+    __atomic_store_n(&snap->seq, snap->seq + 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL_SAFE(&snap->writeLock);
+}
+
+void IRAM_ATTR snapshotWrite(snapshot_t *snap, const void *state)
+{
+    volatile uint32_t *dst = (volatile uint32_t *)snapshotWriteBegin(snap);
+    const uint8_t *src = (const uint8_t *)state;
+    for (size_t i = 0; i < snap->size / 4; i++)
+    {
+        // The caller's struct may have any alignment and field types
+        uint32_t word;
+        memcpy(&word, &src[i * 4], 4);
+        dst[i] = word;
+    }
+    snapshotWriteEnd(snap);
+}
+
+uint32_t IRAM_ATTR snapshotRead(snapshot_t *snap, void *state)
+{
+    const volatile uint32_t *src = (const volatile uint32_t *)snap->data;
+    uint8_t *dst = (uint8_t *)state;
+    while (1)
+    {
+        uint32_t before = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+        if ((before & 1) == 0)
+        {
+            for (size_t i = 0; i < snap->size / 4; i++)
+            {
+                uint32_t word = src[i];
+                memcpy(&dst[i * 4], &word, 4);
+            }
+            // The copy must be complete before the sequence is checked again
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&snap->seq, __ATOMIC_RELAXED) == before)
+                return before >> 1;
+        }
+    }
+}
+
+uint32_t snapshotVersion(const snapshot_t *snap)
+{
+    return __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE) >> 1;
+}
+
+// --- benchmark -------------------------------------------------------------
+
+#define BENCH_WORDS 8 // 32-byte state, word i = version * (i + 1)
+#define BENCH_MAX_READERS 8
+
+typedef struct
+{
+    uint32_t words[BENCH_WORDS];
+} bench_state_t;
+
+typedef struct
+{
+    uint32_t ops;
+    uint32_t maxCycles;
+    uint32_t torn;
+} bench_result_t;
+
+typedef struct
+{
+    bool useMutex;
+    snapshot_t snap;
+    bench_state_t snapData;
+    SemaphoreHandle_t mutex;
+    bench_state_t mutexData;
+    volatile bool stop;
+    SemaphoreHandle_t done;
+    bench_result_t writer;
+    bench_result_t readers[BENCH_MAX_READERS];
+} bench_ctx_t;
+
+typedef struct
+{
+    bench_ctx_t *ctx;
+    bench_result_t *result;
+} bench_task_arg_t;
+
+static void benchWriter(void *pvParameter)
+{
+    bench_task_arg_t *arg = (bench_task_arg_t *)pvParameter;
+    bench_ctx_t *ctx = arg->ctx;
+    bench_state_t next;
+    uint32_t version = 0;
+    while (!ctx->stop)
+    {
+        version++;
+        for (int i = 0; i < BENCH_WORDS; i++)
+            next.words[i] = version * (i + 1);
+
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        if (ctx->useMutex)
+        {
+            xSemaphoreTake(ctx->mutex, portMAX_DELAY);
+            memcpy(&ctx->mutexData, &next, sizeof(next));
+            xSemaphoreGive(ctx->mutex);
+        }
+        else
+        {
+            snapshotWrite(&ctx->snap, &next);
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+
+        if (cycles > arg->result->maxCycles)
+            arg->result->maxCycles = cycles;
+        arg->result->ops++;
+        if ((version & 63) == 0)
+            vTaskDelay(1); // let the idle task feed the watchdog
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void benchReader(void *pvParameter)
+{
+    bench_task_arg_t *arg = (bench_task_arg_t *)pvParameter;
+    bench_ctx_t *ctx = arg->ctx;
+    bench_state_t copy;
+    while (!ctx->stop)
+    {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        if (ctx->useMutex)
+        {
+            xSemaphoreTake(ctx->mutex, portMAX_DELAY);
+            memcpy(&copy, &ctx->mutexData, sizeof(copy));
+            xSemaphoreGive(ctx->mutex);
+        }
+        else
+        {
+            snapshotRead(&ctx->snap, &copy);
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+
+        for (int i = 1; i < BENCH_WORDS; i++)
+        {
+            if (copy.words[i] != copy.words[0] * (i + 1))
+            {
+                arg->result->torn++;
+                break;
+            }
+        }
+        if (cycles > arg->result->maxCycles)
+            arg->result->maxCycles = cycles;
+        if ((++arg->result->ops & 255) == 0)
+            vTaskDelay(1);
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void runOnce(bench_ctx_t *ctx, uint8_t readersPerCore, uint32_t durationMs)
+{
+    static bench_task_arg_t args[BENCH_MAX_READERS + 1];
+    uint8_t readers = readersPerCore * portNUM_PROCESSORS;
+
+    memset(&ctx->writer, 0, sizeof(ctx->writer));
+    memset(ctx->readers, 0, sizeof(ctx->readers));
+    memset(&ctx->snapData, 0, sizeof(ctx->snapData));
+    memset(&ctx->mutexData, 0, sizeof(ctx->mutexData));
+    snapshotInit(&ctx->snap, &ctx->snapData, sizeof(ctx->snapData));
+    ctx->stop = false;
+
+    // Writer above the readers, as patternSequencer is above statusReporter
+    args[0] = {ctx, &ctx->writer};
+    xTaskCreatePinnedToCore(benchWriter, "snapWriter", 2048, &args[0], 5, NULL, 0);
+    for (uint8_t r = 0; r < readers; r++)
+    {
+        args[r + 1] = {ctx, &ctx->readers[r]};
+        xTaskCreatePinnedToCore(benchReader, "snapReader", 2048, &args[r + 1], 4, NULL, r % portNUM_PROCESSORS);
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(durationMs));
+    ctx->stop = true;
+    for (uint8_t i = 0; i < readers + 1; i++)
+        xSemaphoreTake(ctx->done, portMAX_DELAY);
+
+    bench_result_t total = {0, 0, 0};
+    for (uint8_t r = 0; r < readers; r++)
+    {
+        total.ops += ctx->readers[r].ops;
+        total.torn += ctx->readers[r].torn;
+        if (ctx->readers[r].maxCycles > total.maxCycles)
+            total.maxCycles = ctx->readers[r].maxCycles;
+    }
+
+    const uint32_t mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    float seconds = durationMs / 1000.0f;
+    ESP_LOGI(TAG, "%-8s %u readers  reads %8.0f/s (worst %6.1f us)  writes %8.0f/s (worst %6.1f us)  torn %lu",
+             ctx->useMutex ? "mutex" : "seqlock", readers, total.ops / seconds, (float)total.maxCycles / mhz,
+             ctx->writer.ops / seconds, (float)ctx->writer.maxCycles / mhz, (unsigned long)total.torn);
+}
+
+void snapshotBenchmark(uint8_t readersPerCore, uint32_t durationMs)
+{
+    if (readersPerCore * portNUM_PROCESSORS > BENCH_MAX_READERS)
+        readersPerCore = BENCH_MAX_READERS / portNUM_PROCESSORS;
+
+    static bench_ctx_t ctx;
+    ctx.mutex = xSemaphoreCreateMutex();
+    ctx.done = xSemaphoreCreateCounting(BENCH_MAX_READERS + 1, 0);
+    if (ctx.mutex == NULL || ctx.done == NULL)
+    {
+        ESP_LOGE(TAG, "Out of memory");
+        return;
+    }
+
+    ctx.useMutex = false;
+    runOnce(&ctx, readersPerCore, durationMs);
+    ctx.useMutex = true;
+    runOnce(&ctx, readersPerCore, durationMs);
+
+    vSemaphoreDelete(ctx.mutex);
+    vSemaphoreDelete(ctx.done);
+}
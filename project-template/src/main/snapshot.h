@@ -0,0 +1,79 @@
+/**
+ * Consistent snapshots of shared state (sequence lock)
+ *
+ * statusReporter reads g_selectedPattern and g_speed_ms while
+ * patternSequencer writes them, then indexes patternNames[] with the
+ * pattern it read. Nothing stops it from seeing the new pattern with the
+ * old speed, or a half-written value. A mutex would fix that but make
+ * patternSequencer wait for the UART-bound reporter.
+ *
+ * A snapshot keeps the state in one struct guarded by a sequence counter:
+ *
+ *   writer:  seq++ (odd: write in progress); copy in; seq++ (even again)
+ *   reader:  s = seq; copy out; retry if s was odd or seq changed
+ *
+ * Readers never block the writer and never write shared memory, so any
+ * number of them can read on either core or from an ISR. A reader that
+ * overlaps a write retries, and the retry is a copy of a few words.
+ *
+ * A write runs inside a spinlock critical section. That serialises
+ * writers, and it stops a reader on the writer's core from preempting a
+ * half-done write and spinning until the writer gets the CPU back. Keep
+ * the state small (tens of bytes) so the write stays short.
+ *
+ *   typedef struct alignas(4) { uint16_t pattern; uint16_t speedMs; } controller_state_t;
+ *   static controller_state_t g_stateData;
+ *   static snapshot_t g_state;
+ *   if (!snapshotInit(&g_state, &g_stateData, sizeof(g_stateData))) ...
+ *
+ *   patternSequencer:  controller_state_t next = {...};  snapshotWrite(&g_state, &next);
+ *   statusReporter:    controller_state_t now;  snapshotRead(&g_state, &now);
+ *
+ * snapshotBenchmark() compares reader and writer throughput and latency
+ * against a mutex-protected copy of the same struct.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct
+{
+    volatile uint32_t seq; // odd while a write is in progress
+    void *data;
+    size_t size; // multiple of 4, checked by snapshotInit
+    portMUX_TYPE writeLock;
+} snapshot_t;
+
+// `data` (size bytes, 4-byte aligned) holds the initial state and must
+// outlive the snapshot; after this it is only accessed through the
+// snapshot. Returns false if size is 0 or not a multiple of 4 (pad the
+// struct) or data is misaligned, rather than copying only part of it.
+bool snapshotInit(snapshot_t *snap, void *data, size_t size);
+
+// `state` buffers passed to Write and Read need no particular alignment;
+// they are copied byte-wise into and out of the shared words.
+
+// Publishes a complete new state. Safe from tasks and ISRs.
+void snapshotWrite(snapshot_t *snap, const void *state);
+
+// For changing a few fields in place: returns the (aligned) shared state. The
+// section between Begin and End runs with interrupts masked on this core,
+// so no blocking calls in between.
+void *snapshotWriteBegin(snapshot_t *snap);
+void snapshotWriteEnd(snapshot_t *snap);
+
+// Copies a consistent state into `state`. Returns the version it read,
+// which changes with every write.
+uint32_t snapshotRead(snapshot_t *snap, void *state);
+
+// Current version without reading the state, to skip unchanged reads.
+uint32_t snapshotVersion(const snapshot_t *snap);
+
+// Runs one writer and readersPerCore readers on each core for durationMs,
+// with the snapshot and then with a mutex, and logs reads/s, writes/s,
+// worst read and write latency and torn reads (must be 0).
+void snapshotBenchmark(uint8_t readersPerCore, uint32_t durationMs);
@@ -0,0 +1,155 @@
+#include "timer_wheel.h"
+
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "TimerWheel";
+
+// --- wheel -----------------------------------------------------------------
+
+static void deliver(timer_wheel_t *wheel, tw_timer_t *timer)
+{
+    if (timer->queue != NULL)
+    {
+        tw_event_t event = {timer, timer->arg};
+        if (xQueueSend((QueueHandle_t)timer->queue, &event, 0) != pdTRUE)
+            wheel->dropped++;
+    }
+    else if (timer->callback != NULL)
+    {
+        timer->callback(timer, timer->arg);
+    }
+}
+
+void timerWheelInit(timer_wheel_t *wheel, uint32_t now)
+{
+    wheelInit(&wheel->core, now);
+    wheel->dropped = 0;
+    portMUX_INITIALIZE(&wheel->lock);
+}
+
+void timerInit(tw_timer_t *timer, tw_callback_t callback, void *arg, QueueHandle_t queue)
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->period = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->queue = queue;
+}
+
+void timerWheelStart(timer_wheel_t *wheel, tw_timer_t *timer, uint32_t delay, uint32_t period)
+{
+    portENTER_CRITICAL(&wheel->lock);
+    wheelStart(&wheel->core, timer, delay, period);
+    portEXIT_CRITICAL(&wheel->lock);
+}
+
+bool timerWheelStop(timer_wheel_t *wheel, tw_timer_t *timer)
+{
+    portENTER_CRITICAL(&wheel->lock);
+    bool armed = wheelStop(&wheel->core, timer);
+    portEXIT_CRITICAL(&wheel->lock);
+    return armed;
+}
+
+void timerWheelAdvance(timer_wheel_t *wheel, uint32_t now)
+{
+    while (1)
+    {
+        // One bounded step per critical section, however full the slot
+        uint32_t budget = TW_POLL_BUDGET;
+        portENTER_CRITICAL(&wheel->lock);
+        tw_timer_t *timer = wheelPoll(&wheel->core, now, &budget);
+        bool done = (timer == NULL) && wheelCaughtUp(&wheel->core, now);
+        portEXIT_CRITICAL(&wheel->lock);
+
+        if (timer != NULL)
+            deliver(wheel, timer); // may start or stop timers, including this one
+        else if (done)
+            break;
+    }
+}
+
+void timerWheelDispatch(const tw_event_t *event)
+{
+    if (event->timer->callback != NULL)
+        event->timer->callback(event->timer, event->arg);
+}
+
+// --- timer service ---------------------------------------------------------
+
+static timer_wheel_t g_wheel;
+static uint32_t g_tickUs = 1000;
+static TaskHandle_t g_serviceTask = NULL;
+static esp_timer_handle_t g_tickTimer = NULL;
+
+static uint32_t currentTick(void)
+{
+    return (uint32_t)(esp_timer_get_time() / g_tickUs);
+}
+
+static void tickCallback(void *arg)
+{
+    xTaskNotifyGive(g_serviceTask);
+}
+
+static void serviceTask(void *pvParameter)
+{
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Catches up on any ticks missed while a callback ran long
+        timerWheelAdvance(&g_wheel, currentTick());
+    }
+}
+
+bool timerServiceStart(uint32_t tickUs, UBaseType_t priority, BaseType_t core)
+{
+    if (g_serviceTask != NULL)
+        return true;
+
+    g_tickUs = tickUs > 0 ? tickUs : 1000;
+    timerWheelInit(&g_wheel, currentTick());
+
+    if (xTaskCreatePinnedToCore(serviceTask, "timerService", 3072, NULL, priority, &g_serviceTask, core) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create service task!");
+        return false;
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = tickCallback;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "twTick";
+    args.skip_unhandled_events = true;
+    if (esp_timer_create(&args, &g_tickTimer) != ESP_OK || esp_timer_start_periodic(g_tickTimer, g_tickUs) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start tick timer!");
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Timer service running, tick %lu us", (unsigned long)g_tickUs);
+    return true;
+}
+
+void timerServiceArm(tw_timer_t *timer, uint32_t delayMs, uint32_t periodMs)
+{
+    uint32_t delay = (uint32_t)(((uint64_t)delayMs * 1000 + g_tickUs - 1) / g_tickUs);
+    uint32_t period = (uint32_t)(((uint64_t)periodMs * 1000 + g_tickUs - 1) / g_tickUs);
+    timerWheelStart(&g_wheel, timer, delay, period);
+}
+
+bool timerServiceDisarm(tw_timer_t *timer)
+{
+    return timerWheelStop(&g_wheel, timer);
+}
+
+void timerServiceReport(void)
+{
+    ESP_LOGI(TAG, "tick=%lu active=%lu fired=%lu cascaded=%lu dropped=%lu",
+             (unsigned long)g_wheel.core.now, (unsigned long)g_wheel.core.active, (unsigned long)g_wheel.core.fired,
+             (unsigned long)g_wheel.core.cascaded, (unsigned long)g_wheel.dropped);
+}
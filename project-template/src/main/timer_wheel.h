@@ -0,0 +1,77 @@
+/**
+ * Hierarchical timing wheel for thousands of software timers
+ *
+ * The exercises keep time with one task per periodic activity and a
+ * vTaskDelay loop. That does not scale to per-sensor sample deadlines,
+ * per-command timeouts and LED fades, which can add up to thousands of
+ * pending timeouts. The wheel itself is in timer_wheel_core.h (standard
+ * library only, benchmarked on a PC); this file adds the lock, queue
+ * delivery and the service that ticks it.
+ *
+ * timerWheelAdvance() takes the lock for one bounded wheelPoll() step at a
+ * time (TW_POLL_BUDGET timers cascaded or ticks caught up) and drops it
+ * between steps and around every delivery, so a slot holding thousands of
+ * timers never keeps interrupts masked for longer than one step.
+ *
+ * The timer service drives one global wheel from a periodic esp_timer (the
+ * high-resolution tick source) and a service task. When a timer expires:
+ *
+ *   - with no queue, its callback runs in the service task
+ *   - with a queue, a tw_event_t is posted there and the owning task calls
+ *     timerWheelDispatch() to run the callback in its own context
+ *
+ * Timer nodes belong to the caller (static or inside a component struct).
+ * The wheel never allocates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "timer_wheel_core.h"
+
+typedef struct
+{
+    tw_timer_t *timer;
+    void *arg;
+} tw_event_t;
+
+typedef struct
+{
+    tw_wheel_t core;
+    uint32_t dropped; // events lost to a full delivery queue
+    portMUX_TYPE lock;
+} timer_wheel_t;
+
+void timerWheelInit(timer_wheel_t *wheel, uint32_t now);
+
+// Binds a timer node to its callback. queue may be NULL.
+void timerInit(tw_timer_t *timer, tw_callback_t callback, void *arg, QueueHandle_t queue);
+
+// (Re)arms timer to expire `delay` ticks from now, then every `period`
+// ticks if period > 0. Callable from any task.
+void timerWheelStart(timer_wheel_t *wheel, tw_timer_t *timer, uint32_t delay, uint32_t period);
+
+// Returns true if the timer was armed.
+bool timerWheelStop(timer_wheel_t *wheel, tw_timer_t *timer);
+
+// Processes every tick up to and including `now`, delivering expiries.
+// Only one task may advance a wheel.
+void timerWheelAdvance(timer_wheel_t *wheel, uint32_t now);
+
+// Runs the callback of an event received from a timer's queue.
+void timerWheelDispatch(const tw_event_t *event);
+
+// --- timer service ---------------------------------------------------------
+
+// Starts the global wheel with a tick of tickUs microseconds.
+bool timerServiceStart(uint32_t tickUs, UBaseType_t priority, BaseType_t core);
+
+// Arm/disarm on the global wheel, in milliseconds (rounded up to ticks).
+void timerServiceArm(tw_timer_t *timer, uint32_t delayMs, uint32_t periodMs);
+bool timerServiceDisarm(tw_timer_t *timer);
+
+// Logs the global wheel's counters.
+void timerServiceReport(void);
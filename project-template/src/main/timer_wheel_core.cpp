@@ -0,0 +1,321 @@
+#include "timer_wheel_core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "host_test.h"
+
+#define SLOT_MASK (TW_SLOTS - 1)
+
+// --- wheel -----------------------------------------------------------------
+
+static void unlinkTimer(tw_timer_t *timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+static tw_timer_t **slotFor(tw_wheel_t *wheel, uint8_t level, uint32_t tick)
+{
+    return &wheel->slots[level][(tick >> (TW_SLOT_BITS * level)) & SLOT_MASK];
+}
+
+// Files a timer under the slot its expiry falls in. A timer coming down
+// from a higher level never lands in a slot that is still being cascaded:
+// anything inside the current block is close enough for a lower level.
+static void enqueue(tw_wheel_t *wheel, tw_timer_t *timer)
+{
+    uint32_t when = timer->expires;
+    uint32_t delta = when - wheel->now;
+
+    if ((int32_t)delta < 0)
+    {
+        // Already due: the current slot is run right after cascading
+        delta = 0;
+        when = wheel->now;
+    }
+    else if (delta > TW_MAX_DELTA)
+    {
+        // Too far out: park it in the top level, it re-queues on cascade
+        delta = TW_MAX_DELTA;
+        when = wheel->now + TW_MAX_DELTA;
+    }
+
+    uint8_t level = 0;
+    while (level < TW_LEVELS - 1 && delta >= (1UL << (TW_SLOT_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    tw_timer_t **head = slotFor(wheel, level, when);
+    timer->next = *head;
+    timer->pprev = head;
+    if (*head != NULL)
+        (*head)->pprev = &timer->next;
+    *head = timer;
+}
+
+void wheelInit(tw_wheel_t *wheel, uint32_t now)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+void wheelStart(tw_wheel_t *wheel, tw_timer_t *timer, uint32_t delay, uint32_t period)
+{
+    if (timer->pprev != NULL)
+        unlinkTimer(timer);
+    else
+        wheel->active++;
+
+    // The slot of tick `now` may already have run, so the earliest is now + 1
+    timer->expires = wheel->now + (delay > 0 ? delay : 1);
+    timer->period = period;
+    enqueue(wheel, timer);
+}
+
+bool wheelStop(tw_wheel_t *wheel, tw_timer_t *timer)
+{
+    if (timer->pprev == NULL)
+        return false;
+    unlinkTimer(timer);
+    wheel->active--;
+    return true;
+}
+
+tw_timer_t *wheelPoll(tw_wheel_t *wheel, uint32_t now, uint32_t *budget)
+{
+    while (1)
+    {
+        // Finish moving down the higher-level slots for this tick, one
+        // timer per unit of budget
+        while (wheel->cascading != 0)
+        {
+            uint8_t level = 1;
+            while ((wheel->cascading & (1U << level)) == 0)
+                level++;
+
+            tw_timer_t **head = slotFor(wheel, level, wheel->now);
+            if (*head == NULL)
+            {
+                wheel->cascading &= ~(1U << level);
+                continue;
+            }
+            if (*budget == 0)
+                return NULL;
+            (*budget)--;
+
+            tw_timer_t *timer = *head;
+            unlinkTimer(timer);
+            enqueue(wheel, timer);
+            wheel->cascaded++;
+        }
+
+        if (wheel->running)
+        {
+            tw_timer_t **slot = slotFor(wheel, 0, wheel->now);
+            if (*slot != NULL)
+            {
+                tw_timer_t *timer = *slot;
+                unlinkTimer(timer);
+                if (timer->period > 0)
+                {
+                    timer->expires += timer->period;
+                    enqueue(wheel, timer);
+                }
+                else
+                {
+                    wheel->active--;
+                }
+                wheel->fired++;
+                return timer;
+            }
+            wheel->running = false;
+        }
+
+        if ((int32_t)(now - wheel->now) <= 0 || *budget == 0)
+            return NULL;
+        (*budget)--;
+        wheel->now++;
+
+        // Entering a new 64-tick block: the matching level-1 slot comes
+        // down, and so on up while the lower bits are all zero
+        for (uint8_t level = 1; level < TW_LEVELS; level++)
+        {
+            if ((wheel->now & ((1UL << (TW_SLOT_BITS * level)) - 1)) != 0)
+                break;
+            wheel->cascading |= (1U << level);
+        }
+        wheel->running = true;
+    }
+}
+
+bool wheelCaughtUp(const tw_wheel_t *wheel, uint32_t now)
+{
+    return wheel->cascading == 0 && !wheel->running && (int32_t)(now - wheel->now) <= 0;
+}
+
+// --- self test -------------------------------------------------------------
+
+// Runs the wheel up to `now` with the given budget per poll; returns the
+// number of expiries and the tick of the last one.
+static uint32_t runTo(tw_wheel_t *wheel, uint32_t now, uint32_t budget, uint32_t *lastTick)
+{
+    uint32_t expired = 0;
+    while (!wheelCaughtUp(wheel, now))
+    {
+        uint32_t left = budget;
+        tw_timer_t *timer = wheelPoll(wheel, now, &left);
+        if (timer != NULL)
+        {
+            expired++;
+            if (lastTick != NULL)
+                *lastTick = wheel->now;
+            if (timer->callback != NULL)
+                timer->callback(timer, timer->arg);
+        }
+    }
+    return expired;
+}
+
+static void countCallback(tw_timer_t *timer, void *arg)
+{
+    (void)timer;
+    (*(uint32_t *)arg)++;
+}
+
+bool wheelSelfTest(void)
+{
+    printf("Timer wheel self test\n");
+    bool ok = true;
+    static tw_wheel_t wheel;
+    static tw_timer_t timers[200];
+    uint32_t calls = 0;
+    uint32_t last = 0;
+
+    wheelInit(&wheel, 100);
+    tw_timer_t *oneShot = &timers[0];
+    memset(oneShot, 0, sizeof(*oneShot));
+    oneShot->callback = countCallback;
+    oneShot->arg = &calls;
+    wheelStart(&wheel, oneShot, 5000, 0);
+    ok &= testCheck("not early", runTo(&wheel, 5099, 1, NULL) == 0);
+    ok &= testCheck("fires on its tick after two cascades", runTo(&wheel, 5200, 1, &last) == 1 && last == 5100);
+    ok &= testCheck("one-shot disarmed", oneShot->pprev == NULL && wheel.active == 0);
+
+    wheelStart(&wheel, oneShot, 10, 10);
+    ok &= testCheck("periodic fires every period", runTo(&wheel, 5300, 4, &last) == 10 && last == 5300);
+    ok &= testCheck("stop a periodic timer", wheelStop(&wheel, oneShot) && !wheelStop(&wheel, oneShot));
+
+    // 200 timers due in the same 64-tick block, a budget of 8 per poll
+    wheelInit(&wheel, 0);
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        memset(&timers[i], 0, sizeof(timers[i]));
+        wheelStart(&wheel, &timers[i], 4096 + i % 64, 0);
+    }
+    runTo(&wheel, 4095, 64, NULL);
+    uint32_t left = 8; // one tick and seven timers
+    ok &= testCheck("cascade stops when the budget runs out",
+                wheelPoll(&wheel, 4096, &left) == NULL && wheel.now == 4096 && wheel.cascading != 0);
+    ok &= testCheck("timers waiting to cascade can be stopped", wheelStop(&wheel, &timers[199]));
+    ok &= testCheck("all the others still fire", runTo(&wheel, 5000, 8, NULL) == 199 && wheel.active == 0);
+
+    wheelStart(&wheel, oneShot, TW_MAX_DELTA + 1000, 0);
+    ok &= testCheck("beyond the top level re-queues",
+                runTo(&wheel, 5000 + TW_MAX_DELTA + 999, 64, NULL) == 0 &&
+                    runTo(&wheel, 5000 + TW_MAX_DELTA + 1000, 64, &last) == 1 &&
+                    last == 5000 + TW_MAX_DELTA + 1000);
+
+    return testSummary(ok);
+}
+
+// --- benchmark -------------------------------------------------------------
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+static double elapsedNs(bench_clock_t::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(bench_clock_t::now() - start).count();
+}
+
+void wheelBenchmark(uint32_t maxTimers)
+{
+    tw_wheel_t *wheel = (tw_wheel_t *)malloc(sizeof(tw_wheel_t));
+    tw_timer_t *timers = (tw_timer_t *)calloc(maxTimers, sizeof(tw_timer_t));
+    if (wheel == NULL || timers == NULL)
+    {
+        printf("Failed to allocate %lu timers!\n", (unsigned long)maxTimers);
+        free(wheel);
+        free(timers);
+        return;
+    }
+
+    // 64 level-1 and one level-2 cascades over the run
+    const uint32_t ticks = 4096;
+    uint32_t calls = 0;
+
+    printf("Timer wheel benchmark (ns per op, poll budget %d)\n", TW_POLL_BUDGET);
+    for (uint32_t n = 10; n <= maxTimers; n *= 10)
+    {
+        wheelInit(wheel, 0);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            timers[i].callback = countCallback;
+            timers[i].arg = &calls;
+        }
+
+        // Delays spread over every level of the wheel
+        uint32_t seed = 12345;
+        bench_clock_t::time_point start = bench_clock_t::now();
+        for (uint32_t i = 0; i < n; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            wheelStart(wheel, &timers[i], 1 + (seed >> 12), 0);
+        }
+        double startNs = elapsedNs(start) / n;
+
+        calls = 0;
+        double worstPollNs = 0;
+        start = bench_clock_t::now();
+        while (!wheelCaughtUp(wheel, ticks))
+        {
+            uint32_t budget = TW_POLL_BUDGET;
+            bench_clock_t::time_point pollStart = bench_clock_t::now();
+            tw_timer_t *timer = wheelPoll(wheel, ticks, &budget);
+            double pollNs = elapsedNs(pollStart);
+            if (pollNs > worstPollNs)
+                worstPollNs = pollNs;
+            if (timer != NULL)
+                timer->callback(timer, timer->arg);
+        }
+        double tickNs = elapsedNs(start) / ticks;
+
+        start = bench_clock_t::now();
+        for (uint32_t i = 0; i < n; i++)
+        {
+            wheelStop(wheel, &timers[i]);
+        }
+        double stopNs = elapsedNs(start) / n;
+
+        printf("%7lu timers: start %5.1f  stop %5.1f  tick %7.1f  worst poll %6.0f  (%lu fired, %lu cascaded)\n",
+               (unsigned long)n, startNs, stopNs, tickNs, worstPollNs, (unsigned long)calls,
+               (unsigned long)wheel->cascaded);
+    }
+
+    free(wheel);
+    free(timers);
+}
+
+#ifdef TW_HOST_MAIN
+int main(void)
+{
+    bool ok = wheelSelfTest();
+    wheelBenchmark(100000);
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,88 @@
+/**
+ * Hierarchical timing wheel, platform-independent core
+ *
+ * Every timeout is a tw_timer_t node kept in a 4-level wheel of 64 slots
+ * each (6 bits of the expiry tick per level):
+ *
+ *   level 0: expiries   1 ..        63 ticks ahead, one slot per tick
+ *   level 1: expiries  64 ..      4095 ticks ahead, 64 ticks per slot
+ *   level 2:         4096 ..    262143 ticks ahead
+ *   level 3:       262144 ..  16777215 ticks ahead (longer ones re-queue)
+ *
+ * Start and stop are O(1) list operations. On each tick only the current
+ * level-0 slot is run, and every 64 ticks one higher-level slot is
+ * CASCADED down, so the cost per tick does not depend on how many timers
+ * are pending.
+ *
+ * A cascaded slot can still hold many timers, and a late caller may have
+ * many ticks to catch up on. wheelPoll() therefore works in steps: each
+ * call moves at most `budget` timers or ticks and returns at most one
+ * expired timer. The caller can drop its lock between calls so that no
+ * single hold grows with the number of timers. Timers waiting to be
+ * cascaded stay in their slot and can still be stopped or restarted.
+ *
+ * There is no locking here (timer_wheel.h adds it) and only the C++
+ * standard library is used, so the wheel is benchmarked on a PC too:
+ *
+ *   g++ -std=c++17 -O2 -DTW_HOST_MAIN timer_wheel_core.cpp -o wheel && ./wheel
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TW_LEVELS 4
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+#define TW_MAX_DELTA ((1UL << (TW_LEVELS * TW_SLOT_BITS)) - 1)
+#define TW_POLL_BUDGET 32 // timers or ticks moved per wheelPoll() by the service
+
+typedef struct tw_timer tw_timer_t;
+typedef void (*tw_callback_t)(tw_timer_t *timer, void *arg);
+
+struct tw_timer
+{
+    tw_timer_t *next;
+    tw_timer_t **pprev; // NULL while not armed
+    uint32_t expires;   // absolute tick
+    uint32_t period;    // ticks, 0 = one-shot
+    tw_callback_t callback;
+    void *arg;
+    void *queue; // delivery queue used by the timer service, NULL = callback
+};
+
+typedef struct
+{
+    tw_timer_t *slots[TW_LEVELS][TW_SLOTS];
+    uint8_t cascading; // levels whose slot for tick `now` is still moving down
+    bool running;      // the level-0 slot of tick `now` is being run
+    uint32_t now;      // last tick entered
+    uint32_t active;   // armed timers
+    uint32_t fired;
+    uint32_t cascaded;
+} tw_wheel_t;
+
+void wheelInit(tw_wheel_t *wheel, uint32_t now);
+
+// (Re)arms timer to expire `delay` ticks after the current tick, then
+// every `period` ticks if period > 0.
+void wheelStart(tw_wheel_t *wheel, tw_timer_t *timer, uint32_t delay, uint32_t period);
+
+// Returns true if the timer was armed.
+bool wheelStop(tw_wheel_t *wheel, tw_timer_t *timer);
+
+// Advances towards tick `now`. Returns the next expired timer (already
+// removed, or re-armed if periodic) for the caller to deliver, or NULL
+// when the budget ran out or the wheel has caught up.
+tw_timer_t *wheelPoll(tw_wheel_t *wheel, uint32_t now, uint32_t *budget);
+
+// True once every tick up to `now` has been fully processed.
+bool wheelCaughtUp(const tw_wheel_t *wheel, uint32_t now);
+
+bool wheelSelfTest(void);
+
+// Nanoseconds per start, stop and tick with 10, 100 ... maxTimers armed
+// timers, and the longest single wheelPoll() with TW_POLL_BUDGET, which is
+// the longest the timer service holds its lock.
+void wheelBenchmark(uint32_t maxTimers);
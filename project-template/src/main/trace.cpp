@@ -0,0 +1,358 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_ipc.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_vfs_dev.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "Trace";
+
+#define RING_MASK (TRACE_RING_SIZE - 1)
+#define PACKET_EVENTS 40 // events per stream packet
+#define NAME_LEN 24
+
+// Stream packets: 0xA5 0x5A, type, payload length (LE16), payload
+#define SYNC0 0xA5
+#define SYNC1 0x5A
+enum
+{
+    PKT_HEADER = 1, // u8 version, u8 cores, u16 cpu MHz
+    PKT_EVENTS,     // u8 core, u8 pad[3], trace_event_t[]
+    PKT_NAME,       // u32 object, u8 kind, char name[]
+    PKT_DROPPED     // u8 core, u8 pad[3], u32 total dropped
+};
+
+typedef struct
+{
+    uint32_t cycles;
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t aux;
+    uint32_t arg;
+} trace_event_t;
+
+typedef struct
+{
+    trace_event_t events[TRACE_RING_SIZE];
+    volatile uint32_t head; // written only by its own core
+    volatile uint32_t tail; // written only by the streaming task
+    volatile uint32_t dropped;
+    uint32_t droppedSent;
+} trace_ring_t;
+
+typedef struct
+{
+    uint32_t object;
+    uint8_t kind;
+    bool sent;
+    char name[NAME_LEN];
+} trace_name_t;
+
+static trace_ring_t g_rings[portNUM_PROCESSORS];
+static volatile bool g_tracing = false;
+static volatile uint32_t g_switchCount[portNUM_PROCESSORS]; // counted even when not tracing
+
+static trace_name_t g_names[TRACE_MAX_NAMES];
+static uint8_t g_nameCount = 0;
+static portMUX_TYPE g_nameLock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t g_streamTask = NULL;
+static uint32_t g_periodMs = 50;
+
+// --- recording -------------------------------------------------------------
+
+void IRAM_ATTR traceRecord(uint8_t type, uint32_t arg)
+{
+    if (!g_tracing)
+        return;
+
+    // Masking interrupts keeps ISRs on this core out of the slot; the other
+    // core has its own ring, so no lock is needed
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+    trace_ring_t *ring = &g_rings[esp_cpu_get_core_id()];
+    uint32_t head = ring->head;
+    if (head - ring->tail < TRACE_RING_SIZE)
+    {
+        trace_event_t *event = &ring->events[head & RING_MASK];
+        event->cycles = esp_cpu_get_cycle_count();
+        event->type = type;
+        event->reserved = 0;
+        event->aux = 0;
+        event->arg = arg;
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        ring->dropped = ring->dropped + 1;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+void IRAM_ATTR traceRecordSwitchIn(void)
+{
+    // Called by the kernel on its own core with the scheduler locked
+    int core = esp_cpu_get_core_id();
+    g_switchCount[core] = g_switchCount[core] + 1;
+    traceRecord(TRACE_EV_TASK_SWITCH_IN, (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle());
+}
+
+uint32_t IRAM_ATTR traceSwitchCount(int core)
+{
+    return g_switchCount[core];
+}
+
+// --- names -----------------------------------------------------------------
+
+// Adds a name unless the object already has one; returns false when full
+static bool addName(uint32_t object, uint8_t kind, const char *name)
+{
+    bool ok = true;
+    portENTER_CRITICAL(&g_nameLock);
+    uint8_t i = 0;
+    while (i < g_nameCount && g_names[i].object != object)
+    {
+        i++;
+    }
+    if (i == g_nameCount)
+    {
+        if (g_nameCount < TRACE_MAX_NAMES)
+        {
+            trace_name_t *entry = &g_names[g_nameCount++];
+            entry->object = object;
+            entry->kind = kind;
+            entry->sent = false;
+            strncpy(entry->name, name, NAME_LEN - 1);
+            entry->name[NAME_LEN - 1] = '\0';
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    portEXIT_CRITICAL(&g_nameLock);
+    return ok;
+}
+
+static bool knownName(uint32_t object)
+{
+    // Only the streaming task appends discovered names, so a stale count
+    // can only cause a harmless second addName()
+    for (uint8_t i = 0; i < g_nameCount; i++)
+    {
+        if (g_names[i].object == object)
+            return true;
+    }
+    return false;
+}
+
+void traceName(const void *object, uint8_t kind, const char *name)
+{
+    if (!addName((uint32_t)(uintptr_t)object, kind, name))
+        ESP_LOGW(TAG, "Name table full, '%s' will show as an address", name);
+}
+
+// Names tasks and labels the first time the stream references them
+static void discoverName(const trace_event_t *event)
+{
+    if (event->arg == 0 || knownName(event->arg))
+        return;
+
+    switch (event->type)
+    {
+    case TRACE_EV_TASK_SWITCH_IN:
+        addName(event->arg, TRACE_OBJ_TASK, pcTaskGetName((TaskHandle_t)(uintptr_t)event->arg));
+        break;
+    case TRACE_EV_SPAN_BEGIN:
+    case TRACE_EV_ISR_ENTER:
+        addName(event->arg, TRACE_OBJ_LABEL, (const char *)(uintptr_t)event->arg);
+        break;
+    default:
+        break;
+    }
+}
+
+// --- streaming -------------------------------------------------------------
+
+static void writePacket(uint8_t type, const void *payload, uint16_t len)
+{
+    static uint8_t packet[5 + 4 + PACKET_EVENTS * sizeof(trace_event_t)];
+    packet[0] = SYNC0;
+    packet[1] = SYNC1;
+    packet[2] = type;
+    packet[3] = (uint8_t)(len & 0xFF);
+    packet[4] = (uint8_t)(len >> 8);
+    memcpy(&packet[5], payload, len);
+
+    // One fwrite per packet, so log lines from other tasks cannot split it
+    fwrite(packet, 1, 5 + len, stdout);
+}
+
+static void writeHeader(void)
+{
+    uint8_t header[4] = {1, portNUM_PROCESSORS, (uint8_t)(CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ & 0xFF),
+                         (uint8_t)(CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ >> 8)};
+    writePacket(PKT_HEADER, header, sizeof(header));
+}
+
+static void drainCore(uint8_t core)
+{
+    static uint8_t payload[4 + PACKET_EVENTS * sizeof(trace_event_t)];
+    trace_ring_t *ring = &g_rings[core];
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+
+    while (tail != head)
+    {
+        uint32_t count = head - tail;
+        if (count > PACKET_EVENTS)
+            count = PACKET_EVENTS;
+
+        memset(payload, 0, 4);
+        payload[0] = core;
+        trace_event_t *out = (trace_event_t *)&payload[4];
+        for (uint32_t i = 0; i < count; i++)
+        {
+            out[i] = ring->events[(tail + i) & RING_MASK];
+            discoverName(&out[i]);
+        }
+        // Slots are free again once copied
+        tail += count;
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+        writePacket(PKT_EVENTS, payload, (uint16_t)(4 + count * sizeof(trace_event_t)));
+    }
+
+    if (ring->dropped != ring->droppedSent)
+    {
+        uint32_t dropped = ring->dropped;
+        uint8_t packet[8] = {core, 0, 0, 0};
+        memcpy(&packet[4], &dropped, sizeof(dropped));
+        writePacket(PKT_DROPPED, packet, sizeof(packet));
+        ring->droppedSent = dropped;
+    }
+}
+
+static void sendNames(void)
+{
+    uint8_t payload[5 + NAME_LEN];
+    for (uint8_t i = 0; i < g_nameCount; i++)
+    {
+        trace_name_t *entry = &g_names[i];
+        if (entry->sent)
+            continue;
+        uint8_t len = (uint8_t)strlen(entry->name);
+        memcpy(payload, &entry->object, 4);
+        payload[4] = entry->kind;
+        memcpy(&payload[5], entry->name, len);
+        writePacket(PKT_NAME, payload, 5 + len);
+        entry->sent = true;
+    }
+}
+
+static void syncOnCore(void *arg)
+{
+    traceRecord(TRACE_EV_SYNC, (uint32_t)esp_timer_get_time());
+}
+
+static void streamTask(void *pvParameter)
+{
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(g_periodMs));
+
+        if (g_tracing)
+        {
+            for (uint8_t core = 0; core < portNUM_PROCESSORS; core++)
+            {
+                esp_ipc_call_blocking(core, syncOnCore, NULL);
+            }
+        }
+
+        writeHeader();
+        for (uint8_t core = 0; core < portNUM_PROCESSORS; core++)
+        {
+            drainCore(core);
+        }
+        sendNames();
+        fflush(stdout);
+    }
+}
+
+bool traceStreamStart(uint32_t periodMs, UBaseType_t priority, BaseType_t core)
+{
+    g_periodMs = periodMs > 0 ? periodMs : 50;
+    if (g_streamTask == NULL)
+    {
+        // Binary packets must reach the host byte for byte
+        esp_vfs_dev_uart_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_LF);
+
+        if (xTaskCreatePinnedToCore(streamTask, "traceStream", 3072, NULL, priority, &g_streamTask, core) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create stream task!");
+            return false;
+        }
+    }
+
+    ESP_LOGI(TAG, "Tracing started, streaming every %lu ms", (unsigned long)g_periodMs);
+    g_tracing = true;
+    return true;
+}
+
+void traceStop(void)
+{
+    g_tracing = false;
+}
+
+void traceReport(void)
+{
+    for (uint8_t core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        ESP_LOGI(TAG, "core %u: recorded=%lu dropped=%lu", core, (unsigned long)g_rings[core].head,
+                 (unsigned long)g_rings[core].dropped);
+    }
+    ESP_LOGI(TAG, "names: %u/%u", g_nameCount, TRACE_MAX_NAMES);
+}
+
+// --- benchmark -------------------------------------------------------------
+
+void traceBenchmark(uint32_t events)
+{
+    if (g_streamTask != NULL || events == 0)
+    {
+        ESP_LOGW(TAG, "Benchmark before traceStreamStart()");
+        return;
+    }
+
+    // Record in batches that fit the ring, discarding each batch afterwards
+    const uint32_t batch = TRACE_RING_SIZE / 2;
+    uint32_t cycles = 0;
+    uint32_t done = 0;
+
+    g_tracing = true;
+    while (done < events)
+    {
+        uint32_t count = (events - done < batch) ? events - done : batch;
+        uint32_t start = esp_cpu_get_cycle_count();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            traceRecord(TRACE_EV_SPAN_BEGIN, 0);
+        }
+        cycles += esp_cpu_get_cycle_count() - start;
+        done += count;
+
+        for (uint8_t core = 0; core < portNUM_PROCESSORS; core++)
+        {
+            g_rings[core].tail = g_rings[core].head;
+        }
+    }
+    g_tracing = false;
+
+    ESP_LOGI(TAG, "traceRecord: %lu cycles/event over %lu events", (unsigned long)(cycles / done),
+             (unsigned long)done);
+}
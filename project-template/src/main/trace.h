@@ -0,0 +1,76 @@
+/**
+ * Low-overhead event tracer with a binary serial stream
+ *
+ * When the Day 6-7 controller stalls, the log cannot say whether
+ * patternSequencer was waiting on g_uartMutex, preempted by buttonTask, or
+ * serialTask was stuck in fgets. The tracer records what the scheduler did:
+ *
+ *   - task switches and queue / semaphore / mutex operations, through the
+ *     FreeRTOS hooks in trace_hooks.h (esp32dev_trace environment)
+ *   - ISR entry/exit and user spans, through the macros below
+ *
+ * Each event is 12 bytes (CPU cycle stamp, type, argument) written into
+ * the ring of the core it happened on. Recording masks interrupts on that
+ * core for a few instructions and never takes a lock, so it costs tens of
+ * cycles and works inside ISRs and the kernel. A full ring drops events and
+ * counts them; it never blocks.
+ *
+ * A streaming task drains the rings as binary packets on the console UART.
+ * Each core also records a SYNC event (cycle count + esp_timer time), which
+ * lets the host put both cores' unsynchronised cycle counters on one clock.
+ * On the host:
+ *
+ *   python tools/trace2perfetto.py --port /dev/ttyUSB0 --seconds 10 -o trace.json
+ *
+ * then open trace.json at https://ui.perfetto.dev. Log text on the same
+ * UART is skipped by the converter, but 115200 baud carries only ~900
+ * events/s. Raise CONFIG_ESP_CONSOLE_UART_BAUDRATE for busy systems.
+ *
+ * Labels passed to spans and ISR markers must be string literals, because
+ * the streaming task reads them later to name the events.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "trace_hooks.h"
+
+#define TRACE_RING_SIZE 512 // events per core, power of two
+#define TRACE_MAX_NAMES 64  // tasks + registered objects + labels
+
+enum
+{
+    TRACE_OBJ_TASK = 1,
+    TRACE_OBJ_QUEUE,
+    TRACE_OBJ_MUTEX,
+    TRACE_OBJ_SEMAPHORE,
+    TRACE_OBJ_LABEL
+};
+
+#define TRACE_SPAN_BEGIN(label) traceRecord(TRACE_EV_SPAN_BEGIN, (uint32_t)(uintptr_t)(label))
+#define TRACE_SPAN_END(label) traceRecord(TRACE_EV_SPAN_END, (uint32_t)(uintptr_t)(label))
+#define TRACE_ISR_ENTER(label) traceRecord(TRACE_EV_ISR_ENTER, (uint32_t)(uintptr_t)(label))
+#define TRACE_ISR_EXIT(label) traceRecord(TRACE_EV_ISR_EXIT, (uint32_t)(uintptr_t)(label))
+
+// Names a queue/semaphore/mutex so the timeline shows "take g_uartMutex"
+// instead of an address. Call once after creating it.
+void traceName(const void *object, uint8_t kind, const char *name);
+
+// Enables recording and starts the task that streams every periodMs.
+bool traceStreamStart(uint32_t periodMs, UBaseType_t priority, BaseType_t core);
+
+// Stops recording; the streaming task sends what is left and idles.
+void traceStop(void);
+
+// Task switches on a core so far. Only counts with the kernel hooks
+// compiled in; otherwise it stays 0.
+uint32_t traceSwitchCount(int core);
+
+// Logs events recorded and dropped per core.
+void traceReport(void);
+
+// Measures the cycles one traceRecord() call costs. Run it before
+// traceStreamStart().
+void traceBenchmark(uint32_t events);
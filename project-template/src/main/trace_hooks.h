@@ -0,0 +1,57 @@
+/**
+ * FreeRTOS kernel hooks for the event tracer (see trace.h)
+ *
+ * FreeRTOS only calls its traceXXX() macros if they are defined before the
+ * kernel sources are compiled, so this header has to reach every component,
+ * not just main. The esp32dev_trace environment in platformio.ini does that
+ * with a forced include:
+ *
+ *   build_flags = -include $PROJECT_SRC_DIR/main/trace_hooks.h
+ *
+ * Without it, user spans and ISR markers are still traced, but task
+ * switches and queue/mutex operations are not.
+ *
+ * Plain C on purpose: it is also compiled into the kernel's C files.
+ */
+
+#pragma once
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum
+{
+    TRACE_EV_TASK_SWITCH_IN = 1, // arg = task handle
+    TRACE_EV_QUEUE_SEND,         // arg = queue/semaphore handle (mutex give)
+    TRACE_EV_QUEUE_RECEIVE,      // arg = queue/semaphore handle (mutex take)
+    TRACE_EV_QUEUE_BLOCK_SEND,
+    TRACE_EV_QUEUE_BLOCK_RECEIVE,
+    TRACE_EV_ISR_ENTER,          // arg = label (string literal)
+    TRACE_EV_ISR_EXIT,
+    TRACE_EV_SPAN_BEGIN,         // arg = label (string literal)
+    TRACE_EV_SPAN_END,
+    TRACE_EV_SYNC                // arg = esp_timer microseconds, low 32 bits
+};
+
+// Safe from tasks, ISRs and inside the kernel's critical sections
+void traceRecord(uint8_t type, uint32_t arg);
+void traceRecordSwitchIn(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define traceTASK_SWITCHED_IN() traceRecordSwitchIn()
+#define traceQUEUE_SEND(pxQueue) traceRecord(TRACE_EV_QUEUE_SEND, (uint32_t)(uintptr_t)(pxQueue))
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) traceRecord(TRACE_EV_QUEUE_SEND, (uint32_t)(uintptr_t)(pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue) traceRecord(TRACE_EV_QUEUE_RECEIVE, (uint32_t)(uintptr_t)(pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) traceRecord(TRACE_EV_QUEUE_RECEIVE, (uint32_t)(uintptr_t)(pxQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) traceRecord(TRACE_EV_QUEUE_BLOCK_SEND, (uint32_t)(uintptr_t)(pxQueue))
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) traceRecord(TRACE_EV_QUEUE_BLOCK_RECEIVE, (uint32_t)(uintptr_t)(pxQueue))
+
+#endif // __ASSEMBLER__
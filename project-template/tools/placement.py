@@ -0,0 +1,451 @@
+#!/usr/bin/env python3
+"""
+Report where code and data ended up (IRAM, DRAM, flash) and check ISR paths.
+
+Run after a build, from the project directory:
+
+    python tools/placement.py .pio/build/esp32dev/firmware.elf
+
+or through PlatformIO (tools/placement_pio.py adds the target):
+
+    pio run -e esp32dev -t placement
+
+The map file next to the ELF is read for the memory regions and for which
+archive/object every input section came from. The ELF symbol table gives
+the functions. The report shows:
+
+  - each memory region: used, size, free
+  - per component (archive): IRAM, DRAM, flash code, flash data, RTC bytes
+  - with --functions COMPONENT: every function of that component and where
+    it sits
+  - ISR check: every function reachable from an IRAM function of the
+    checked components (default: the project's own, libsrc.a under
+    PlatformIO or libmain.a under idf.py) or from --root, that lives in
+    flash. A flash function called from an ISR faults while the flash
+    cache is disabled (SPI flash writes, e.g. NVS commits). Outside that
+    it can still stall on a cache miss. The call graph comes from objdump,
+    so calls through function pointers are not followed.
+
+Profile-driven placement: --hot FILE lists hot functions, one per line as
+"name [weight]". Lines from profileReport() ("Profile: <label> <count>
+...") are also accepted, in which case labels must be function names. The
+hottest flash functions that fit in --iram-budget bytes (default: free
+IRAM minus 2 KiB) are written as an ESP-IDF linker fragment:
+
+    python tools/placement.py firmware.elf --hot hot.txt --emit-lf src/main/hot_paths.lf
+
+src/CMakeLists.txt (the component PlatformIO builds) picks up
+src/main/hot_paths.lf when it exists. Rebuild and run the report again to
+see the new placement.
+"""
+
+import argparse
+import bisect
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+from collections import defaultdict
+
+IRAM, DRAM, FLASH_CODE, FLASH_DATA, RTC, OTHER = "iram", "dram", "flash code", "flash data", "rtc", "other"
+CLASSES = [IRAM, DRAM, FLASH_CODE, FLASH_DATA, RTC]
+
+EM_XTENSA, EM_RISCV = 94, 243
+OBJDUMPS = {
+    EM_XTENSA: ["xtensa-esp32-elf-objdump", "xtensa-esp-elf-objdump", "xtensa-esp32s3-elf-objdump"],
+    EM_RISCV: ["riscv32-esp-elf-objdump"],
+}
+
+
+def region_class(name):
+    """Memory region name from the ESP-IDF memory.ld -> placement class."""
+    name = name.lower()
+    if name.startswith("irom") or name == "iram0_2_seg":  # ESP32 maps flash code through iram0_2
+        return FLASH_CODE
+    if name.startswith("drom"):
+        return FLASH_DATA
+    if name.startswith("rtc"):
+        return RTC
+    if "iram" in name:
+        return IRAM
+    if "dram" in name:
+        return DRAM
+    return OTHER
+
+
+# --- map file --------------------------------------------------------------
+
+class Region:
+    def __init__(self, name, origin, length):
+        self.name, self.origin, self.length = name, origin, length
+        self.cls = region_class(name)
+        self.used = 0
+
+    def contains(self, addr):
+        return self.origin <= addr < self.origin + self.length
+
+
+class InputSection:
+    def __init__(self, name, addr, size, source):
+        self.name, self.addr, self.size, self.source = name, addr, size, source
+        self.component, self.object = split_source(source)
+
+
+ARCHIVE_RE = re.compile(r"(?:^|[/\\])lib([^/\\]+)\.a\((.+)\)$")
+ENTRY_RE = re.compile(r"^\s(\.\S+|COMMON)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+NAME_ONLY_RE = re.compile(r"^\s(\.\S+|COMMON)\s*$")
+CONT_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+REGION_RE = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+
+
+# The project's own component: PlatformIO builds src/ as "src", idf.py
+# builds main/ as "main"
+PROJECT_COMPONENTS = ("src", "main")
+
+
+def split_source(source):
+    """'esp-idf/main/libmain.a(keypad.cpp.obj)' -> ('main', 'keypad.cpp.obj')"""
+    m = ARCHIVE_RE.search(source.strip())
+    if m:
+        return m.group(1), m.group(2)
+    base = os.path.basename(source.strip())
+    return "(%s)" % base, base
+
+
+def parse_map(path):
+    regions, sections = [], []
+    with open(path, errors="replace") as f:
+        lines = f.read().splitlines()
+
+    i = 0
+    while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+        i += 1
+    i += 1
+    while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+        m = REGION_RE.match(lines[i])
+        if m and m.group(1) not in ("Name", "*default*"):
+            regions.append(Region(m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+        i += 1
+
+    pending = None
+    for line in lines[i:]:
+        if line.startswith("OUTPUT(") or line.startswith("/DISCARD/"):
+            break
+        if pending is not None:
+            m = CONT_RE.match(line)
+            if m:
+                add_section(sections, pending, int(m.group(1), 16), int(m.group(2), 16), m.group(3))
+            pending = None
+            continue
+        m = ENTRY_RE.match(line)
+        if m:
+            add_section(sections, m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4))
+            continue
+        m = NAME_ONLY_RE.match(line)
+        if m:
+            pending = m.group(1)
+
+    for s in sections:
+        for r in regions:
+            if r.contains(s.addr):
+                r.used += s.size
+                break
+    return regions, sections
+
+
+def add_section(sections, name, addr, size, source):
+    # Address 0 is debug info and the like, not loaded
+    if addr != 0 and size != 0 and not source.startswith("*"):
+        sections.append(InputSection(name, addr, size, source))
+
+
+# --- ELF -------------------------------------------------------------------
+
+def read_elf_functions(path):
+    """Returns (machine, [(addr, size, name)]) for STT_FUNC symbols."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF":
+        sys.exit("%s is not an ELF file" % path)
+    is64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+    if is64:
+        (machine,) = struct.unpack_from(endian + "H", data, 18)
+        shoff, = struct.unpack_from(endian + "Q", data, 40)
+        shentsize, shnum = struct.unpack_from(endian + "HH", data, 58)
+        shdr = struct.Struct(endian + "IIQQQQIIQQ")
+        sym = struct.Struct(endian + "IBBHQQ")
+    else:
+        (machine,) = struct.unpack_from(endian + "H", data, 18)
+        shoff, = struct.unpack_from(endian + "I", data, 32)
+        shentsize, shnum = struct.unpack_from(endian + "HH", data, 46)
+        shdr = struct.Struct(endian + "IIIIIIIIII")
+        sym = struct.Struct(endian + "IIIBBH")
+
+    headers = [shdr.unpack_from(data, shoff + n * shentsize) for n in range(shnum)]
+    functions = []
+    for h in headers:
+        if h[1] != 2:  # SHT_SYMTAB
+            continue
+        offset, size, link = h[4], h[5], h[6]
+        strtab = headers[link]
+        stroff = strtab[4]
+        for pos in range(offset, offset + size, sym.size):
+            if is64:
+                name_off, info, _, _, value, sym_size = sym.unpack_from(data, pos)
+            else:
+                name_off, value, sym_size, info, _, _ = sym.unpack_from(data, pos)
+            if info & 0xF != 2 or value == 0:  # STT_FUNC
+                continue
+            end = data.index(b"\0", stroff + name_off)
+            functions.append((value, sym_size, data[stroff + name_off:end].decode(errors="replace")))
+    return machine, functions
+
+
+# --- call graph ------------------------------------------------------------
+
+FUNC_RE = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+TARGET_RE = re.compile(r"\s([0-9a-f]+) <([^+>]+)>\s*$")
+
+
+def find_objdump(machine, override):
+    if override:
+        return override
+    for tool in OBJDUMPS.get(machine, []) + ["objdump"]:
+        if shutil.which(tool):
+            return tool
+    return None
+
+
+def call_graph(elf, objdump):
+    """Direct calls and tail jumps: {caller: set(callee)}, by symbol name."""
+    graph = defaultdict(set)
+    proc = subprocess.Popen([objdump, "-d", "--no-show-raw-insn", elf], stdout=subprocess.PIPE,
+                            universal_newlines=True, errors="replace")
+    current = None
+    for line in proc.stdout:
+        m = FUNC_RE.match(line)
+        if m:
+            current = m.group(2)
+            continue
+        # A target without +offset is the start of a function; branches
+        # inside the current function always carry an offset
+        m = TARGET_RE.search(line)
+        if current and m and m.group(2) != current:
+            graph[current].add(m.group(2))
+    proc.wait()
+    return graph
+
+
+# --- reports ---------------------------------------------------------------
+
+class Placement:
+    def __init__(self, regions, sections, functions):
+        self.regions = regions
+        self.sections = sorted(sections, key=lambda s: s.addr)
+        self.starts = [s.addr for s in self.sections]
+        self.functions = {}
+        for addr, size, name in functions:
+            self.functions.setdefault(name, (addr, size))
+
+    def region_of(self, addr):
+        for r in self.regions:
+            if r.contains(addr):
+                return r
+        return None
+
+    def class_of(self, addr):
+        r = self.region_of(addr)
+        return r.cls if r else "rom"  # mask ROM is not in the map's regions
+
+    def section_of(self, addr):
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0:
+            s = self.sections[i]
+            if s.addr <= addr < s.addr + s.size:
+                return s
+        return None
+
+
+def report_regions(p):
+    print("%-16s %-10s %10s %10s %10s %6s" % ("region", "class", "used", "size", "free", "used%"))
+    for r in p.regions:
+        if r.cls == OTHER or r.length == 0:
+            continue
+        print("%-16s %-10s %10d %10d %10d %5.1f%%" % (r.name, r.cls, r.used, r.length, r.length - r.used,
+                                                       100.0 * r.used / r.length))
+
+
+def report_components(p, top):
+    totals = defaultdict(lambda: defaultdict(int))
+    for s in p.sections:
+        totals[s.component][p.class_of(s.addr)] += s.size
+    rows = sorted(totals.items(), key=lambda kv: -(kv[1][IRAM] * 1000000 + sum(kv[1].values())))
+    print()
+    print("%-24s" % "component" + "".join("%12s" % c for c in CLASSES))
+    for name, by_class in rows[:top]:
+        print("%-24s" % name + "".join("%12d" % by_class[c] for c in CLASSES))
+    if len(rows) > top:
+        print("(%d more components, --top to show them)" % (len(rows) - top))
+
+
+def report_functions(p, component):
+    rows = []
+    for name, (addr, size) in p.functions.items():
+        s = p.section_of(addr)
+        if s and s.component == component:
+            rows.append((p.class_of(addr), s.object, name, size))
+    print()
+    print("Functions of %s:" % component)
+    for cls, obj, name, size in sorted(rows):
+        print("  %-11s %6d  %-26s %s" % (cls, size, obj, name))
+
+
+def project_components(p):
+    present = {s.component for s in p.sections}
+    return {c for c in PROJECT_COMPONENTS if c in present} or set(PROJECT_COMPONENTS)
+
+
+def isr_check(p, graph, components, roots, ignore):
+    """Flash functions reachable from IRAM code. Returns the count."""
+    start = set(roots)
+    for name, (addr, _) in p.functions.items():
+        s = p.section_of(addr)
+        if s and s.component in components and p.class_of(addr) == IRAM:
+            start.add(name)
+
+    # Breadth first so the reported chain is the shortest one
+    parent = {name: None for name in start}
+    queue = sorted(start)
+    violations = []
+    while queue:
+        name = queue.pop(0)
+        for callee in sorted(graph.get(name, ())):
+            if callee in parent or (ignore and ignore.search(callee)):
+                continue
+            parent[callee] = name
+            addr = p.functions.get(callee, (None,))[0]
+            if addr is not None and p.class_of(addr) == FLASH_CODE:
+                violations.append(callee)  # do not descend: the first flash hop is the problem
+            else:
+                queue.append(callee)
+
+    print()
+    print("ISR check: %d root functions, %d reachable flash functions" % (len(start), len(violations)))
+    for callee in violations:
+        chain = [callee]
+        while parent[chain[-1]] is not None:
+            chain.append(parent[chain[-1]])
+        s = p.section_of(p.functions[callee][0])
+        print("  %-32s %s  [%s]" % (callee, " <- ".join(chain[1:]), s.component if s else "?"))
+    return len(violations)
+
+
+# --- profile-driven placement ----------------------------------------------
+
+PROFILE_LINE_RE = re.compile(r"Profile:\s+(\S+)\s+(\d+)\s+\d+\s+(\d+)")
+
+
+def read_hot(path):
+    """{name: weight}. Profiler lines weigh count x mean cycles."""
+    hot = {}
+    with open(path) as f:
+        for line in f:
+            m = PROFILE_LINE_RE.search(line)
+            if m:
+                hot[m.group(1)] = int(m.group(2)) * int(m.group(3))
+                continue
+            parts = line.split()
+            if not parts or parts[0].startswith("#") or "Profile:" in line:
+                continue
+            hot[parts[0]] = float(parts[1]) if len(parts) > 1 else 1.0
+    return hot
+
+
+def emit_fragment(p, hot, budget, path):
+    chosen = defaultdict(list)  # archive -> [(object, symbol)]
+    used = 0
+    for name, weight in sorted(hot.items(), key=lambda kv: -kv[1]):
+        if name not in p.functions:
+            print("  %-32s not found in the ELF" % name, file=sys.stderr)
+            continue
+        addr, size = p.functions[name]
+        s = p.section_of(addr)
+        if p.class_of(addr) != FLASH_CODE or s is None:
+            continue
+        if not s.name.startswith(".text."):
+            print("  %-32s shares %s with other code, skipped" % (name, s.name), file=sys.stderr)
+            continue
+        if used + s.size > budget:
+            print("  %-32s %d bytes, over the IRAM budget" % (name, s.size), file=sys.stderr)
+            continue
+        used += s.size
+        obj = s.object.split(".")[0]
+        chosen[s.component].append((obj, s.name[len(".text."):], name, weight))
+
+    with open(path, "w") as f:
+        f.write("# Generated by tools/placement.py from a hot-function profile.\n")
+        f.write("# Moves %d bytes of flash code into IRAM. Delete the file to undo.\n" % used)
+        for component in sorted(chosen):
+            f.write("\n[mapping:hot_%s]\narchive: lib%s.a\nentries:\n" % (component, component))
+            for obj, symbol, name, weight in chosen[component]:
+                f.write("    %s:%s (noflash)  # %s, weight %g\n" % (obj, symbol, name, weight))
+    count = sum(len(v) for v in chosen.values())
+    print("\n%d functions, %d bytes of IRAM written to %s" % (count, used, path))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--map", help="linker map (default: the ELF path with .map)")
+    parser.add_argument("--top", type=int, default=20, help="components to list")
+    parser.add_argument("--functions", metavar="COMPONENT", help="list every function of a component")
+    parser.add_argument("--check", action="append", default=None, metavar="COMPONENT",
+                        help="components whose IRAM functions are ISR roots (default: src or main, "
+                        "whichever the map has)")
+    parser.add_argument("--root", action="append", default=[], help="extra ISR or hot-path entry function")
+    parser.add_argument("--ignore", help="regex of callees not to flag")
+    parser.add_argument("--objdump", help="objdump for the target (default: found on PATH)")
+    parser.add_argument("--hot", help="hot function profile for --emit-lf")
+    parser.add_argument("--emit-lf", help="write an ESP-IDF linker fragment for the hot functions")
+    parser.add_argument("--iram-budget", type=int, help="bytes of IRAM --emit-lf may use")
+    parser.add_argument("--strict", action="store_true", help="exit 1 if the ISR check finds anything")
+    args = parser.parse_args()
+
+    map_path = args.map or os.path.splitext(args.elf)[0] + ".map"
+    if not os.path.exists(map_path):
+        sys.exit("No map file at %s (use --map)" % map_path)
+    regions, sections = parse_map(map_path)
+    machine, functions = read_elf_functions(args.elf)
+    p = Placement(regions, sections, functions)
+
+    report_regions(p)
+    report_components(p, args.top)
+    if args.functions:
+        report_functions(p, args.functions)
+
+    violations = 0
+    objdump = find_objdump(machine, args.objdump)
+    if objdump is None:
+        print("\nISR check skipped: no objdump for this target on PATH (use --objdump)")
+    else:
+        graph = call_graph(args.elf, objdump)
+        ignore = re.compile(args.ignore) if args.ignore else None
+        violations = isr_check(p, graph, set(args.check or project_components(p)), args.root, ignore)
+
+    if args.emit_lf:
+        if not args.hot:
+            parser.error("--emit-lf needs --hot")
+        budget = args.iram_budget
+        if budget is None:
+            free = sum(r.length - r.used for r in p.regions if r.cls == IRAM)
+            budget = max(0, free - 2048)
+        emit_fragment(p, read_hot(args.hot), budget, args.emit_lf)
+
+    sys.exit(1 if args.strict and violations else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,19 @@
+"""
+PlatformIO extra script: adds the "placement" target, which runs
+tools/placement.py on the firmware just built.
+
+    pio run -e esp32dev -t placement
+"""
+
+import os
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+script = os.path.join("$PROJECT_DIR", "tools", "placement.py")
+env.AddCustomTarget(  # noqa: F821
+    name="placement",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions='"$PYTHONEXE" "%s" "$BUILD_DIR/${PROGNAME}.elf"' % script,
+    title="Placement",
+    description="IRAM/DRAM/flash usage per component and ISR-to-flash calls",
+)
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""
+Convert the binary stream from src/main/trace.cpp into Chrome trace JSON
+that https://ui.perfetto.dev (or chrome://tracing) can load.
+
+Capture straight from the board (needs pyserial):
+
+    python tools/trace2perfetto.py --port /dev/ttyUSB0 --seconds 10 -o trace.json
+
+or convert a raw capture made earlier:
+
+    python tools/trace2perfetto.py capture.bin -o trace.json
+
+Log text mixed into the stream is skipped. The timeline shows:
+  - "Cores":  which task ran on each core, plus ISR tracks
+  - "Tasks":  per task, queue/mutex operations, time spent blocked on them,
+              and user spans (TRACE_SPAN_BEGIN/END)
+"""
+
+import argparse
+import json
+import struct
+import sys
+import time
+
+SYNC = b"\xa5\x5a"
+PKT_HEADER, PKT_EVENTS, PKT_NAME, PKT_DROPPED = 1, 2, 3, 4
+MAX_PAYLOAD = 4 + 40 * 12
+
+(EV_TASK_SWITCH_IN, EV_QUEUE_SEND, EV_QUEUE_RECEIVE, EV_QUEUE_BLOCK_SEND,
+ EV_QUEUE_BLOCK_RECEIVE, EV_ISR_ENTER, EV_ISR_EXIT, EV_SPAN_BEGIN,
+ EV_SPAN_END, EV_SYNC) = range(1, 11)
+
+OBJ_TASK, OBJ_QUEUE, OBJ_MUTEX, OBJ_SEMAPHORE, OBJ_LABEL = range(1, 6)
+
+EVENT = struct.Struct("<IBBHI")
+
+# Verb for each operation, by object kind
+OP_NAMES = {
+    OBJ_MUTEX: {EV_QUEUE_SEND: "give", EV_QUEUE_RECEIVE: "take",
+                EV_QUEUE_BLOCK_SEND: "wait give", EV_QUEUE_BLOCK_RECEIVE: "wait take"},
+    OBJ_SEMAPHORE: {EV_QUEUE_SEND: "give", EV_QUEUE_RECEIVE: "take",
+                    EV_QUEUE_BLOCK_SEND: "wait give", EV_QUEUE_BLOCK_RECEIVE: "wait take"},
+    OBJ_QUEUE: {EV_QUEUE_SEND: "send", EV_QUEUE_RECEIVE: "receive",
+                EV_QUEUE_BLOCK_SEND: "wait send", EV_QUEUE_BLOCK_RECEIVE: "wait receive"},
+}
+
+
+def valid_length(ptype, length):
+    if ptype == PKT_HEADER:
+        return length == 4
+    if ptype == PKT_EVENTS:
+        return length >= 4 + EVENT.size and (length - 4) % EVENT.size == 0 and length <= MAX_PAYLOAD
+    if ptype == PKT_NAME:
+        return 5 < length <= 5 + 24
+    if ptype == PKT_DROPPED:
+        return length == 8
+    return False
+
+
+def parse_packets(data):
+    """Yield (type, payload), resynchronising past log text."""
+    pos = 0
+    while True:
+        pos = data.find(SYNC, pos)
+        if pos < 0 or pos + 5 > len(data):
+            return
+        ptype = data[pos + 2]
+        length = data[pos + 3] | (data[pos + 4] << 8)
+        if not valid_length(ptype, length) or pos + 5 + length > len(data):
+            pos += 1
+            continue
+        yield ptype, data[pos + 5:pos + 5 + length]
+        pos += 5 + length
+
+
+class CoreClock:
+    """Maps one core's 32-bit cycle counter onto esp_timer microseconds."""
+
+    def __init__(self):
+        self.sync = None  # (cycles, us)
+        self.last_us32 = None
+        self.us_high = 0
+
+    def add_sync(self, cycles, us32):
+        if self.last_us32 is not None and us32 < self.last_us32:
+            self.us_high += 1 << 32
+        self.last_us32 = us32
+        self.sync = (cycles, self.us_high + us32)
+
+    def to_us(self, cycles, mhz):
+        sync_cycles, sync_us = self.sync
+        delta = (cycles - sync_cycles) & 0xFFFFFFFF
+        if delta & 0x80000000:
+            delta -= 1 << 32
+        return sync_us + delta / mhz
+
+
+def convert(data):
+    mhz = 240
+    names = {}  # object -> (kind, name)
+    per_core = {}  # core -> list of raw events, in recording order
+    dropped = {}
+
+    for ptype, payload in parse_packets(data):
+        if ptype == PKT_HEADER:
+            mhz = payload[2] | (payload[3] << 8) or mhz
+        elif ptype == PKT_NAME:
+            obj, kind = struct.unpack_from("<IB", payload)
+            names[obj] = (kind, payload[5:].decode("ascii", "replace"))
+        elif ptype == PKT_DROPPED:
+            dropped[payload[0]] = struct.unpack_from("<I", payload, 4)[0]
+        elif ptype == PKT_EVENTS:
+            events = per_core.setdefault(payload[0], [])
+            for off in range(4, len(payload), EVENT.size):
+                cycles, etype, _, _, arg = EVENT.unpack_from(payload, off)
+                events.append((cycles, etype, arg))
+
+    def name_of(obj):
+        return names.get(obj, (None, "0x%08x" % obj))[1]
+
+    out = []
+    task_tids = {}
+
+    def task_tid(handle):
+        if handle not in task_tids:
+            task_tids[handle] = len(task_tids) + 1
+            out.append({"ph": "M", "name": "thread_name", "pid": 1, "tid": task_tids[handle],
+                        "args": {"name": name_of(handle)}})
+        return task_tids[handle]
+
+    out.append({"ph": "M", "name": "process_name", "pid": 0, "args": {"name": "Cores"}})
+    out.append({"ph": "M", "name": "process_name", "pid": 1, "args": {"name": "Tasks"}})
+
+    blocked = {}  # task -> (ts, label) waiting for it to run again
+    for core, events in sorted(per_core.items()):
+        out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": core,
+                    "args": {"name": "core %d" % core}})
+        out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": 100 + core,
+                    "args": {"name": "ISR core %d" % core}})
+
+        # Events before the first sync use the first sync, backwards
+        clock = CoreClock()
+        first = next((e for e in events if e[1] == EV_SYNC), None)
+        if first is None:
+            print("core %d: no sync events, skipped" % core, file=sys.stderr)
+            continue
+        clock.add_sync(first[0], first[2])
+
+        current = None  # (task handle, switch-in ts)
+        ts = 0.0
+        for cycles, etype, arg in events:
+            if etype == EV_SYNC:
+                clock.add_sync(cycles, arg)
+                continue
+            ts = clock.to_us(cycles, mhz)
+
+            if etype == EV_TASK_SWITCH_IN:
+                if current is not None:
+                    out.append({"ph": "X", "name": name_of(current[0]), "pid": 0, "tid": core,
+                                "ts": current[1], "dur": ts - current[1]})
+                current = (arg, ts)
+                if arg in blocked:
+                    start, label = blocked.pop(arg)
+                    out.append({"ph": "X", "name": label, "pid": 1, "tid": task_tid(arg),
+                                "ts": start, "dur": ts - start})
+            elif etype in (EV_ISR_ENTER, EV_ISR_EXIT):
+                out.append({"ph": "B" if etype == EV_ISR_ENTER else "E", "name": name_of(arg),
+                            "pid": 0, "tid": 100 + core, "ts": ts})
+            elif current is not None:
+                task = current[0]
+                if etype in (EV_SPAN_BEGIN, EV_SPAN_END):
+                    out.append({"ph": "B" if etype == EV_SPAN_BEGIN else "E", "name": name_of(arg),
+                                "pid": 1, "tid": task_tid(task), "ts": ts})
+                else:
+                    kind = names.get(arg, (OBJ_QUEUE, None))[0]
+                    verb = OP_NAMES.get(kind, OP_NAMES[OBJ_QUEUE]).get(etype, "op")
+                    label = "%s %s" % (verb, name_of(arg))
+                    out.append({"ph": "i", "s": "t", "name": label, "pid": 1, "tid": task_tid(task),
+                                "ts": ts})
+                    if etype in (EV_QUEUE_BLOCK_SEND, EV_QUEUE_BLOCK_RECEIVE):
+                        blocked[task] = (ts, label)
+
+        if current is not None:
+            out.append({"ph": "X", "name": name_of(current[0]), "pid": 0, "tid": core,
+                        "ts": current[1], "dur": ts - current[1]})
+        if core in dropped:
+            out.append({"ph": "C", "name": "dropped events core %d" % core, "pid": 0, "ts": ts,
+                        "args": {"dropped": dropped[core]}})
+            print("core %d: %d events dropped on target" % (core, dropped[core]), file=sys.stderr)
+
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def capture(port, baud, seconds):
+    import serial  # pyserial, only needed for live capture
+
+    data = bytearray()
+    with serial.Serial(port, baud, timeout=0.1) as ser:
+        end = time.time() + seconds
+        while time.time() < end:
+            data += ser.read(4096)
+    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("input", nargs="?", help="raw capture file")
+    parser.add_argument("--port", help="capture live from this serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--seconds", type=float, default=10.0)
+    parser.add_argument("--save-raw", help="also write the raw capture here")
+    parser.add_argument("-o", "--output", default="trace.json")
+    args = parser.parse_args()
+
+    if args.port:
+        data = capture(args.port, args.baud, args.seconds)
+        if args.save_raw:
+            with open(args.save_raw, "wb") as f:
+                f.write(data)
+    elif args.input:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("give a capture file or --port")
+
+    trace = convert(data)
+    with open(args.output, "w") as f:
+        json.dump(trace, f)
+    print("%d trace events written to %s" % (len(trace["traceEvents"]), args.output))
+
+
+if __name__ == "__main__":
+    main()